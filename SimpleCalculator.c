@@ -8,18 +8,32 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <math.h>
+#include <float.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdalign.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__linux__)
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+#include "SimpleCalculator.h"
 
 /** 我们这里使用简约的var作为对象类型的自动推导 */
 #define var     __auto_type
 
-/** 我们指定输入表达式的最大长度为2047字节，超出部分将被截断 */
-#define MAX_ARGUMENT_LENGTH     2047
-
 /** 用于标记解析符号时的当前状态 */
 enum PARSE_PHASE_STATUS
 {
@@ -72,51 +86,1103 @@ static inline bool IsMathFunction(char ch)
     return ch >= 'a' && ch <= 'z';
 }
 
-/** 对数字进行解析 */
-static double ParseDigital(const char *cursor, int *pRetLength)
+/** 词法分析时字符的类别 */
+enum CHARACTER_CLASS
 {
-    // 我们先判断当前是否为数学常量
-    var length = IsMathConstant(cursor);
-    if(length > 0)
+    /** 不能出现在表达式中的字符 */
+    CHARACTER_CLASS_INVALID = 0,
+    
+    /** 表达式结束符'\0' */
+    CHARACTER_CLASS_END,
+    
+    CHARACTER_CLASS_DIGIT,
+    
+    /** 小写字母，它是数学常量、数学函数名或者变量名的开头 */
+    CHARACTER_CLASS_LETTER,
+    
+    /** 二元操作符，其函数与优先级可在operatorTable中查到 */
+    CHARACTER_CLASS_OPERATOR,
+    
+    CHARACTER_CLASS_LEFT_PARENTHESIS,
+    CHARACTER_CLASS_RIGHT_PARENTHESIS
+};
+
+/**
+ * 字符类别表。表达式在解析之前已经过滤为小写，并且[]与$已被替换为()与^，
+ * 所以大写字母以及这几个替换前的字符都属于非法字符
+*/
+static const uint8_t characterClasses[256] = {
+    ['\0'] = CHARACTER_CLASS_END,
+    ['0' ... '9'] = CHARACTER_CLASS_DIGIT,
+    ['a' ... 'z'] = CHARACTER_CLASS_LETTER,
+    ['%'] = CHARACTER_CLASS_OPERATOR,
+    ['*'] = CHARACTER_CLASS_OPERATOR,
+    ['+'] = CHARACTER_CLASS_OPERATOR,
+    ['-'] = CHARACTER_CLASS_OPERATOR,
+    ['/'] = CHARACTER_CLASS_OPERATOR,
+    ['^'] = CHARACTER_CLASS_OPERATOR,
+    ['('] = CHARACTER_CLASS_LEFT_PARENTHESIS,
+    [')'] = CHARACTER_CLASS_RIGHT_PARENTHESIS
+};
+
+/** 获取字符的类别 */
+static inline enum CHARACTER_CLASS GetCharacterClass(char ch)
+{
+    return (enum CHARACTER_CLASS)characterClasses[(unsigned char)ch];
+}
+
+/** 十进制浮点数快速路径所能使用的10的最大精确幂次 */
+#define NUMBER_EXACT_POWER_OF_TEN_MAX       22
+
+/** 十进制有效数字中能被完整放入64位整数的位数 */
+#define NUMBER_MAX_FAST_DIGIT_COUNT         19
+
+/** 十进制浮点数所能使用的十进制指数范围，超出该范围的数必然下溢为0或者上溢为无穷大 */
+#define NUMBER_MIN_DECIMAL_EXPONENT         (-342)
+#define NUMBER_MAX_DECIMAL_EXPONENT         308
+
+/** powersOfFive128表所覆盖的最大幂次，格式化次正规数时需要用到比NUMBER_MAX_DECIMAL_EXPONENT更大的幂次 */
+#define POWERS_OF_FIVE_MAX_EXPONENT         325
+
+/** 慢速路径中保留的有效数字位数，任何double的舍入都不需要超过767位有效数字 */
+#define NUMBER_SLOW_PATH_DIGIT_COUNT        780
+
+/**
+ * 5的幂次的128位近似值，对应的指数从NUMBER_MIN_DECIMAL_EXPONENT到POWERS_OF_FIVE_MAX_EXPONENT。
+ * 每个值都被移位至最高位为1，第一个元素为高64位，第二个元素为低64位。
+ * 非负幂次的值向下取整；-27到-1的幂次的值是精确的上取整值，更小的幂次则是将更宽的上取整值截断到128位
+*/
+static const uint64_t powersOfFive128[][2] = {
+    { 0xeef453d6923bd65aU, 0x113faa2906a13b3fU },
+    { 0x9558b4661b6565f8U, 0x4ac7ca59a424c507U },
+    { 0xbaaee17fa23ebf76U, 0x5d79bcf00d2df649U },
+    { 0xe95a99df8ace6f53U, 0xf4d82c2c107973dcU },
+    { 0x91d8a02bb6c10594U, 0x79071b9b8a4be869U },
+    { 0xb64ec836a47146f9U, 0x9748e2826cdee284U },
+    { 0xe3e27a444d8d98b7U, 0xfd1b1b2308169b25U },
+    { 0x8e6d8c6ab0787f72U, 0xfe30f0f5e50e20f7U },
+    { 0xb208ef855c969f4fU, 0xbdbd2d335e51a935U },
+    { 0xde8b2b66b3bc4723U, 0xad2c788035e61382U },
+    { 0x8b16fb203055ac76U, 0x4c3bcb5021afcc31U },
+    { 0xaddcb9e83c6b1793U, 0xdf4abe242a1bbf3dU },
+    { 0xd953e8624b85dd78U, 0xd71d6dad34a2af0dU },
+    { 0x87d4713d6f33aa6bU, 0x8672648c40e5ad68U },
+    { 0xa9c98d8ccb009506U, 0x680efdaf511f18c2U },
+    { 0xd43bf0effdc0ba48U, 0x0212bd1b2566def2U },
+    { 0x84a57695fe98746dU, 0x014bb630f7604b57U },
+    { 0xa5ced43b7e3e9188U, 0x419ea3bd35385e2dU },
+    { 0xcf42894a5dce35eaU, 0x52064cac828675b9U },
+    { 0x818995ce7aa0e1b2U, 0x7343efebd1940993U },
+    { 0xa1ebfb4219491a1fU, 0x1014ebe6c5f90bf8U },
+    { 0xca66fa129f9b60a6U, 0xd41a26e077774ef6U },
+    { 0xfd00b897478238d0U, 0x8920b098955522b4U },
+    { 0x9e20735e8cb16382U, 0x55b46e5f5d5535b0U },
+    { 0xc5a890362fddbc62U, 0xeb2189f734aa831dU },
+    { 0xf712b443bbd52b7bU, 0xa5e9ec7501d523e4U },
+    { 0x9a6bb0aa55653b2dU, 0x47b233c92125366eU },
+    { 0xc1069cd4eabe89f8U, 0x999ec0bb696e840aU },
+    { 0xf148440a256e2c76U, 0xc00670ea43ca250dU },
+    { 0x96cd2a865764dbcaU, 0x380406926a5e5728U },
+    { 0xbc807527ed3e12bcU, 0xc605083704f5ecf2U },
+    { 0xeba09271e88d976bU, 0xf7864a44c633682eU },
+    { 0x93445b8731587ea3U, 0x7ab3ee6afbe0211dU },
+    { 0xb8157268fdae9e4cU, 0x5960ea05bad82964U },
+    { 0xe61acf033d1a45dfU, 0x6fb92487298e33bdU },
+    { 0x8fd0c16206306babU, 0xa5d3b6d479f8e056U },
+    { 0xb3c4f1ba87bc8696U, 0x8f48a4899877186cU },
+    { 0xe0b62e2929aba83cU, 0x331acdabfe94de87U },
+    { 0x8c71dcd9ba0b4925U, 0x9ff0c08b7f1d0b14U },
+    { 0xaf8e5410288e1b6fU, 0x07ecf0ae5ee44dd9U },
+    { 0xdb71e91432b1a24aU, 0xc9e82cd9f69d6150U },
+    { 0x892731ac9faf056eU, 0xbe311c083a225cd2U },
+    { 0xab70fe17c79ac6caU, 0x6dbd630a48aaf406U },
+    { 0xd64d3d9db981787dU, 0x092cbbccdad5b108U },
+    { 0x85f0468293f0eb4eU, 0x25bbf56008c58ea5U },
+    { 0xa76c582338ed2621U, 0xaf2af2b80af6f24eU },
+    { 0xd1476e2c07286faaU, 0x1af5af660db4aee1U },
+    { 0x82cca4db847945caU, 0x50d98d9fc890ed4dU },
+    { 0xa37fce126597973cU, 0xe50ff107bab528a0U },
+    { 0xcc5fc196fefd7d0cU, 0x1e53ed49a96272c8U },
+    { 0xff77b1fcbebcdc4fU, 0x25e8e89c13bb0f7aU },
+    { 0x9faacf3df73609b1U, 0x77b191618c54e9acU },
+    { 0xc795830d75038c1dU, 0xd59df5b9ef6a2417U },
+    { 0xf97ae3d0d2446f25U, 0x4b0573286b44ad1dU },
+    { 0x9becce62836ac577U, 0x4ee367f9430aec32U },
+    { 0xc2e801fb244576d5U, 0x229c41f793cda73fU },
+    { 0xf3a20279ed56d48aU, 0x6b43527578c1110fU },
+    { 0x9845418c345644d6U, 0x830a13896b78aaa9U },
+    { 0xbe5691ef416bd60cU, 0x23cc986bc656d553U },
+    { 0xedec366b11c6cb8fU, 0x2cbfbe86b7ec8aa8U },
+    { 0x94b3a202eb1c3f39U, 0x7bf7d71432f3d6a9U },
+    { 0xb9e08a83a5e34f07U, 0xdaf5ccd93fb0cc53U },
+    { 0xe858ad248f5c22c9U, 0xd1b3400f8f9cff68U },
+    { 0x91376c36d99995beU, 0x23100809b9c21fa1U },
+    { 0xb58547448ffffb2dU, 0xabd40a0c2832a78aU },
+    { 0xe2e69915b3fff9f9U, 0x16c90c8f323f516cU },
+    { 0x8dd01fad907ffc3bU, 0xae3da7d97f6792e3U },
+    { 0xb1442798f49ffb4aU, 0x99cd11cfdf41779cU },
+    { 0xdd95317f31c7fa1dU, 0x40405643d711d583U },
+    { 0x8a7d3eef7f1cfc52U, 0x482835ea666b2572U },
+    { 0xad1c8eab5ee43b66U, 0xda3243650005eecfU },
+    { 0xd863b256369d4a40U, 0x90bed43e40076a82U },
+    { 0x873e4f75e2224e68U, 0x5a7744a6e804a291U },
+    { 0xa90de3535aaae202U, 0x711515d0a205cb36U },
+    { 0xd3515c2831559a83U, 0x0d5a5b44ca873e03U },
+    { 0x8412d9991ed58091U, 0xe858790afe9486c2U },
+    { 0xa5178fff668ae0b6U, 0x626e974dbe39a872U },
+    { 0xce5d73ff402d98e3U, 0xfb0a3d212dc8128fU },
+    { 0x80fa687f881c7f8eU, 0x7ce66634bc9d0b99U },
+    { 0xa139029f6a239f72U, 0x1c1fffc1ebc44e80U },
+    { 0xc987434744ac874eU, 0xa327ffb266b56220U },
+    { 0xfbe9141915d7a922U, 0x4bf1ff9f0062baa8U },
+    { 0x9d71ac8fada6c9b5U, 0x6f773fc3603db4a9U },
+    { 0xc4ce17b399107c22U, 0xcb550fb4384d21d3U },
+    { 0xf6019da07f549b2bU, 0x7e2a53a146606a48U },
+    { 0x99c102844f94e0fbU, 0x2eda7444cbfc426dU },
+    { 0xc0314325637a1939U, 0xfa911155fefb5308U },
+    { 0xf03d93eebc589f88U, 0x793555ab7eba27caU },
+    { 0x96267c7535b763b5U, 0x4bc1558b2f3458deU },
+    { 0xbbb01b9283253ca2U, 0x9eb1aaedfb016f16U },
+    { 0xea9c227723ee8bcbU, 0x465e15a979c1cadcU },
+    { 0x92a1958a7675175fU, 0x0bfacd89ec191ec9U },
+    { 0xb749faed14125d36U, 0xcef980ec671f667bU },
+    { 0xe51c79a85916f484U, 0x82b7e12780e7401aU },
+    { 0x8f31cc0937ae58d2U, 0xd1b2ecb8b0908810U },
+    { 0xb2fe3f0b8599ef07U, 0x861fa7e6dcb4aa15U },
+    { 0xdfbdcece67006ac9U, 0x67a791e093e1d49aU },
+    { 0x8bd6a141006042bdU, 0xe0c8bb2c5c6d24e0U },
+    { 0xaecc49914078536dU, 0x58fae9f773886e18U },
+    { 0xda7f5bf590966848U, 0xaf39a475506a899eU },
+    { 0x888f99797a5e012dU, 0x6d8406c952429603U },
+    { 0xaab37fd7d8f58178U, 0xc8e5087ba6d33b83U },
+    { 0xd5605fcdcf32e1d6U, 0xfb1e4a9a90880a64U },
+    { 0x855c3be0a17fcd26U, 0x5cf2eea09a55067fU },
+    { 0xa6b34ad8c9dfc06fU, 0xf42faa48c0ea481eU },
+    { 0xd0601d8efc57b08bU, 0xf13b94daf124da26U },
+    { 0x823c12795db6ce57U, 0x76c53d08d6b70858U },
+    { 0xa2cb1717b52481edU, 0x54768c4b0c64ca6eU },
+    { 0xcb7ddcdda26da268U, 0xa9942f5dcf7dfd09U },
+    { 0xfe5d54150b090b02U, 0xd3f93b35435d7c4cU },
+    { 0x9efa548d26e5a6e1U, 0xc47bc5014a1a6dafU },
+    { 0xc6b8e9b0709f109aU, 0x359ab6419ca1091bU },
+    { 0xf867241c8cc6d4c0U, 0xc30163d203c94b62U },
+    { 0x9b407691d7fc44f8U, 0x79e0de63425dcf1dU },
+    { 0xc21094364dfb5636U, 0x985915fc12f542e4U },
+    { 0xf294b943e17a2bc4U, 0x3e6f5b7b17b2939dU },
+    { 0x979cf3ca6cec5b5aU, 0xa705992ceecf9c42U },
+    { 0xbd8430bd08277231U, 0x50c6ff782a838353U },
+    { 0xece53cec4a314ebdU, 0xa4f8bf5635246428U },
+    { 0x940f4613ae5ed136U, 0x871b7795e136be99U },
+    { 0xb913179899f68584U, 0x28e2557b59846e3fU },
+    { 0xe757dd7ec07426e5U, 0x331aeada2fe589cfU },
+    { 0x9096ea6f3848984fU, 0x3ff0d2c85def7621U },
+    { 0xb4bca50b065abe63U, 0x0fed077a756b53a9U },
+    { 0xe1ebce4dc7f16dfbU, 0xd3e8495912c62894U },
+    { 0x8d3360f09cf6e4bdU, 0x64712dd7abbbd95cU },
+    { 0xb080392cc4349decU, 0xbd8d794d96aacfb3U },
+    { 0xdca04777f541c567U, 0xecf0d7a0fc5583a0U },
+    { 0x89e42caaf9491b60U, 0xf41686c49db57244U },
+    { 0xac5d37d5b79b6239U, 0x311c2875c522ced5U },
+    { 0xd77485cb25823ac7U, 0x7d633293366b828bU },
+    { 0x86a8d39ef77164bcU, 0xae5dff9c02033197U },
+    { 0xa8530886b54dbdebU, 0xd9f57f830283fdfcU },
+    { 0xd267caa862a12d66U, 0xd072df63c324fd7bU },
+    { 0x8380dea93da4bc60U, 0x4247cb9e59f71e6dU },
+    { 0xa46116538d0deb78U, 0x52d9be85f074e608U },
+    { 0xcd795be870516656U, 0x67902e276c921f8bU },
+    { 0x806bd9714632dff6U, 0x00ba1cd8a3db53b6U },
+    { 0xa086cfcd97bf97f3U, 0x80e8a40eccd228a4U },
+    { 0xc8a883c0fdaf7df0U, 0x6122cd128006b2cdU },
+    { 0xfad2a4b13d1b5d6cU, 0x796b805720085f81U },
+    { 0x9cc3a6eec6311a63U, 0xcbe3303674053bb0U },
+    { 0xc3f490aa77bd60fcU, 0xbedbfc4411068a9cU },
+    { 0xf4f1b4d515acb93bU, 0xee92fb5515482d44U },
+    { 0x991711052d8bf3c5U, 0x751bdd152d4d1c4aU },
+    { 0xbf5cd54678eef0b6U, 0xd262d45a78a0635dU },
+    { 0xef340a98172aace4U, 0x86fb897116c87c34U },
+    { 0x9580869f0e7aac0eU, 0xd45d35e6ae3d4da0U },
+    { 0xbae0a846d2195712U, 0x8974836059cca109U },
+    { 0xe998d258869facd7U, 0x2bd1a438703fc94bU },
+    { 0x91ff83775423cc06U, 0x7b6306a34627ddcfU },
+    { 0xb67f6455292cbf08U, 0x1a3bc84c17b1d542U },
+    { 0xe41f3d6a7377eecaU, 0x20caba5f1d9e4a93U },
+    { 0x8e938662882af53eU, 0x547eb47b7282ee9cU },
+    { 0xb23867fb2a35b28dU, 0xe99e619a4f23aa43U },
+    { 0xdec681f9f4c31f31U, 0x6405fa00e2ec94d4U },
+    { 0x8b3c113c38f9f37eU, 0xde83bc408dd3dd04U },
+    { 0xae0b158b4738705eU, 0x9624ab50b148d445U },
+    { 0xd98ddaee19068c76U, 0x3badd624dd9b0957U },
+    { 0x87f8a8d4cfa417c9U, 0xe54ca5d70a80e5d6U },
+    { 0xa9f6d30a038d1dbcU, 0x5e9fcf4ccd211f4cU },
+    { 0xd47487cc8470652bU, 0x7647c3200069671fU },
+    { 0x84c8d4dfd2c63f3bU, 0x29ecd9f40041e073U },
+    { 0xa5fb0a17c777cf09U, 0xf468107100525890U },
+    { 0xcf79cc9db955c2ccU, 0x7182148d4066eeb4U },
+    { 0x81ac1fe293d599bfU, 0xc6f14cd848405530U },
+    { 0xa21727db38cb002fU, 0xb8ada00e5a506a7cU },
+    { 0xca9cf1d206fdc03bU, 0xa6d90811f0e4851cU },
+    { 0xfd442e4688bd304aU, 0x908f4a166d1da663U },
+    { 0x9e4a9cec15763e2eU, 0x9a598e4e043287feU },
+    { 0xc5dd44271ad3cdbaU, 0x40eff1e1853f29fdU },
+    { 0xf7549530e188c128U, 0xd12bee59e68ef47cU },
+    { 0x9a94dd3e8cf578b9U, 0x82bb74f8301958ceU },
+    { 0xc13a148e3032d6e7U, 0xe36a52363c1faf01U },
+    { 0xf18899b1bc3f8ca1U, 0xdc44e6c3cb279ac1U },
+    { 0x96f5600f15a7b7e5U, 0x29ab103a5ef8c0b9U },
+    { 0xbcb2b812db11a5deU, 0x7415d448f6b6f0e7U },
+    { 0xebdf661791d60f56U, 0x111b495b3464ad21U },
+    { 0x936b9fcebb25c995U, 0xcab10dd900beec34U },
+    { 0xb84687c269ef3bfbU, 0x3d5d514f40eea742U },
+    { 0xe65829b3046b0afaU, 0x0cb4a5a3112a5112U },
+    { 0x8ff71a0fe2c2e6dcU, 0x47f0e785eaba72abU },
+    { 0xb3f4e093db73a093U, 0x59ed216765690f56U },
+    { 0xe0f218b8d25088b8U, 0x306869c13ec3532cU },
+    { 0x8c974f7383725573U, 0x1e414218c73a13fbU },
+    { 0xafbd2350644eeacfU, 0xe5d1929ef90898faU },
+    { 0xdbac6c247d62a583U, 0xdf45f746b74abf39U },
+    { 0x894bc396ce5da772U, 0x6b8bba8c328eb783U },
+    { 0xab9eb47c81f5114fU, 0x066ea92f3f326564U },
+    { 0xd686619ba27255a2U, 0xc80a537b0efefebdU },
+    { 0x8613fd0145877585U, 0xbd06742ce95f5f36U },
+    { 0xa798fc4196e952e7U, 0x2c48113823b73704U },
+    { 0xd17f3b51fca3a7a0U, 0xf75a15862ca504c5U },
+    { 0x82ef85133de648c4U, 0x9a984d73dbe722fbU },
+    { 0xa3ab66580d5fdaf5U, 0xc13e60d0d2e0ebbaU },
+    { 0xcc963fee10b7d1b3U, 0x318df905079926a8U },
+    { 0xffbbcfe994e5c61fU, 0xfdf17746497f7052U },
+    { 0x9fd561f1fd0f9bd3U, 0xfeb6ea8bedefa633U },
+    { 0xc7caba6e7c5382c8U, 0xfe64a52ee96b8fc0U },
+    { 0xf9bd690a1b68637bU, 0x3dfdce7aa3c673b0U },
+    { 0x9c1661a651213e2dU, 0x06bea10ca65c084eU },
+    { 0xc31bfa0fe5698db8U, 0x486e494fcff30a62U },
+    { 0xf3e2f893dec3f126U, 0x5a89dba3c3efccfaU },
+    { 0x986ddb5c6b3a76b7U, 0xf89629465a75e01cU },
+    { 0xbe89523386091465U, 0xf6bbb397f1135823U },
+    { 0xee2ba6c0678b597fU, 0x746aa07ded582e2cU },
+    { 0x94db483840b717efU, 0xa8c2a44eb4571cdcU },
+    { 0xba121a4650e4ddebU, 0x92f34d62616ce413U },
+    { 0xe896a0d7e51e1566U, 0x77b020baf9c81d17U },
+    { 0x915e2486ef32cd60U, 0x0ace1474dc1d122eU },
+    { 0xb5b5ada8aaff80b8U, 0x0d819992132456baU },
+    { 0xe3231912d5bf60e6U, 0x10e1fff697ed6c69U },
+    { 0x8df5efabc5979c8fU, 0xca8d3ffa1ef463c1U },
+    { 0xb1736b96b6fd83b3U, 0xbd308ff8a6b17cb2U },
+    { 0xddd0467c64bce4a0U, 0xac7cb3f6d05ddbdeU },
+    { 0x8aa22c0dbef60ee4U, 0x6bcdf07a423aa96bU },
+    { 0xad4ab7112eb3929dU, 0x86c16c98d2c953c6U },
+    { 0xd89d64d57a607744U, 0xe871c7bf077ba8b7U },
+    { 0x87625f056c7c4a8bU, 0x11471cd764ad4972U },
+    { 0xa93af6c6c79b5d2dU, 0xd598e40d3dd89bcfU },
+    { 0xd389b47879823479U, 0x4aff1d108d4ec2c3U },
+    { 0x843610cb4bf160cbU, 0xcedf722a585139baU },
+    { 0xa54394fe1eedb8feU, 0xc2974eb4ee658828U },
+    { 0xce947a3da6a9273eU, 0x733d226229feea32U },
+    { 0x811ccc668829b887U, 0x0806357d5a3f525fU },
+    { 0xa163ff802a3426a8U, 0xca07c2dcb0cf26f7U },
+    { 0xc9bcff6034c13052U, 0xfc89b393dd02f0b5U },
+    { 0xfc2c3f3841f17c67U, 0xbbac2078d443ace2U },
+    { 0x9d9ba7832936edc0U, 0xd54b944b84aa4c0dU },
+    { 0xc5029163f384a931U, 0x0a9e795e65d4df11U },
+    { 0xf64335bcf065d37dU, 0x4d4617b5ff4a16d5U },
+    { 0x99ea0196163fa42eU, 0x504bced1bf8e4e45U },
+    { 0xc06481fb9bcf8d39U, 0xe45ec2862f71e1d6U },
+    { 0xf07da27a82c37088U, 0x5d767327bb4e5a4cU },
+    { 0x964e858c91ba2655U, 0x3a6a07f8d510f86fU },
+    { 0xbbe226efb628afeaU, 0x890489f70a55368bU },
+    { 0xeadab0aba3b2dbe5U, 0x2b45ac74ccea842eU },
+    { 0x92c8ae6b464fc96fU, 0x3b0b8bc90012929dU },
+    { 0xb77ada0617e3bbcbU, 0x09ce6ebb40173744U },
+    { 0xe55990879ddcaabdU, 0xcc420a6a101d0515U },
+    { 0x8f57fa54c2a9eab6U, 0x9fa946824a12232dU },
+    { 0xb32df8e9f3546564U, 0x47939822dc96abf9U },
+    { 0xdff9772470297ebdU, 0x59787e2b93bc56f7U },
+    { 0x8bfbea76c619ef36U, 0x57eb4edb3c55b65aU },
+    { 0xaefae51477a06b03U, 0xede622920b6b23f1U },
+    { 0xdab99e59958885c4U, 0xe95fab368e45ecedU },
+    { 0x88b402f7fd75539bU, 0x11dbcb0218ebb414U },
+    { 0xaae103b5fcd2a881U, 0xd652bdc29f26a119U },
+    { 0xd59944a37c0752a2U, 0x4be76d3346f0495fU },
+    { 0x857fcae62d8493a5U, 0x6f70a4400c562ddbU },
+    { 0xa6dfbd9fb8e5b88eU, 0xcb4ccd500f6bb952U },
+    { 0xd097ad07a71f26b2U, 0x7e2000a41346a7a7U },
+    { 0x825ecc24c873782fU, 0x8ed400668c0c28c8U },
+    { 0xa2f67f2dfa90563bU, 0x728900802f0f32faU },
+    { 0xcbb41ef979346bcaU, 0x4f2b40a03ad2ffb9U },
+    { 0xfea126b7d78186bcU, 0xe2f610c84987bfa8U },
+    { 0x9f24b832e6b0f436U, 0x0dd9ca7d2df4d7c9U },
+    { 0xc6ede63fa05d3143U, 0x91503d1c79720dbbU },
+    { 0xf8a95fcf88747d94U, 0x75a44c6397ce912aU },
+    { 0x9b69dbe1b548ce7cU, 0xc986afbe3ee11abaU },
+    { 0xc24452da229b021bU, 0xfbe85badce996168U },
+    { 0xf2d56790ab41c2a2U, 0xfae27299423fb9c3U },
+    { 0x97c560ba6b0919a5U, 0xdccd879fc967d41aU },
+    { 0xbdb6b8e905cb600fU, 0x5400e987bbc1c920U },
+    { 0xed246723473e3813U, 0x290123e9aab23b68U },
+    { 0x9436c0760c86e30bU, 0xf9a0b6720aaf6521U },
+    { 0xb94470938fa89bceU, 0xf808e40e8d5b3e69U },
+    { 0xe7958cb87392c2c2U, 0xb60b1d1230b20e04U },
+    { 0x90bd77f3483bb9b9U, 0xb1c6f22b5e6f48c2U },
+    { 0xb4ecd5f01a4aa828U, 0x1e38aeb6360b1af3U },
+    { 0xe2280b6c20dd5232U, 0x25c6da63c38de1b0U },
+    { 0x8d590723948a535fU, 0x579c487e5a38ad0eU },
+    { 0xb0af48ec79ace837U, 0x2d835a9df0c6d851U },
+    { 0xdcdb1b2798182244U, 0xf8e431456cf88e65U },
+    { 0x8a08f0f8bf0f156bU, 0x1b8e9ecb641b58ffU },
+    { 0xac8b2d36eed2dac5U, 0xe272467e3d222f3fU },
+    { 0xd7adf884aa879177U, 0x5b0ed81dcc6abb0fU },
+    { 0x86ccbb52ea94baeaU, 0x98e947129fc2b4e9U },
+    { 0xa87fea27a539e9a5U, 0x3f2398d747b36224U },
+    { 0xd29fe4b18e88640eU, 0x8eec7f0d19a03aadU },
+    { 0x83a3eeeef9153e89U, 0x1953cf68300424acU },
+    { 0xa48ceaaab75a8e2bU, 0x5fa8c3423c052dd7U },
+    { 0xcdb02555653131b6U, 0x3792f412cb06794dU },
+    { 0x808e17555f3ebf11U, 0xe2bbd88bbee40bd0U },
+    { 0xa0b19d2ab70e6ed6U, 0x5b6aceaeae9d0ec4U },
+    { 0xc8de047564d20a8bU, 0xf245825a5a445275U },
+    { 0xfb158592be068d2eU, 0xeed6e2f0f0d56712U },
+    { 0x9ced737bb6c4183dU, 0x55464dd69685606bU },
+    { 0xc428d05aa4751e4cU, 0xaa97e14c3c26b886U },
+    { 0xf53304714d9265dfU, 0xd53dd99f4b3066a8U },
+    { 0x993fe2c6d07b7fabU, 0xe546a8038efe4029U },
+    { 0xbf8fdb78849a5f96U, 0xde98520472bdd033U },
+    { 0xef73d256a5c0f77cU, 0x963e66858f6d4440U },
+    { 0x95a8637627989aadU, 0xdde7001379a44aa8U },
+    { 0xbb127c53b17ec159U, 0x5560c018580d5d52U },
+    { 0xe9d71b689dde71afU, 0xaab8f01e6e10b4a6U },
+    { 0x9226712162ab070dU, 0xcab3961304ca70e8U },
+    { 0xb6b00d69bb55c8d1U, 0x3d607b97c5fd0d22U },
+    { 0xe45c10c42a2b3b05U, 0x8cb89a7db77c506aU },
+    { 0x8eb98a7a9a5b04e3U, 0x77f3608e92adb242U },
+    { 0xb267ed1940f1c61cU, 0x55f038b237591ed3U },
+    { 0xdf01e85f912e37a3U, 0x6b6c46dec52f6688U },
+    { 0x8b61313bbabce2c6U, 0x2323ac4b3b3da015U },
+    { 0xae397d8aa96c1b77U, 0xabec975e0a0d081aU },
+    { 0xd9c7dced53c72255U, 0x96e7bd358c904a21U },
+    { 0x881cea14545c7575U, 0x7e50d64177da2e54U },
+    { 0xaa242499697392d2U, 0xdde50bd1d5d0b9e9U },
+    { 0xd4ad2dbfc3d07787U, 0x955e4ec64b44e864U },
+    { 0x84ec3c97da624ab4U, 0xbd5af13bef0b113eU },
+    { 0xa6274bbdd0fadd61U, 0xecb1ad8aeacdd58eU },
+    { 0xcfb11ead453994baU, 0x67de18eda5814af2U },
+    { 0x81ceb32c4b43fcf4U, 0x80eacf948770ced7U },
+    { 0xa2425ff75e14fc31U, 0xa1258379a94d028dU },
+    { 0xcad2f7f5359a3b3eU, 0x096ee45813a04330U },
+    { 0xfd87b5f28300ca0dU, 0x8bca9d6e188853fcU },
+    { 0x9e74d1b791e07e48U, 0x775ea264cf55347eU },
+    { 0xc612062576589ddaU, 0x95364afe032a819eU },
+    { 0xf79687aed3eec551U, 0x3a83ddbd83f52205U },
+    { 0x9abe14cd44753b52U, 0xc4926a9672793543U },
+    { 0xc16d9a0095928a27U, 0x75b7053c0f178294U },
+    { 0xf1c90080baf72cb1U, 0x5324c68b12dd6339U },
+    { 0x971da05074da7beeU, 0xd3f6fc16ebca5e04U },
+    { 0xbce5086492111aeaU, 0x88f4bb1ca6bcf585U },
+    { 0xec1e4a7db69561a5U, 0x2b31e9e3d06c32e6U },
+    { 0x9392ee8e921d5d07U, 0x3aff322e62439fd0U },
+    { 0xb877aa3236a4b449U, 0x09befeb9fad487c3U },
+    { 0xe69594bec44de15bU, 0x4c2ebe687989a9b4U },
+    { 0x901d7cf73ab0acd9U, 0x0f9d37014bf60a11U },
+    { 0xb424dc35095cd80fU, 0x538484c19ef38c95U },
+    { 0xe12e13424bb40e13U, 0x2865a5f206b06fbaU },
+    { 0x8cbccc096f5088cbU, 0xf93f87b7442e45d4U },
+    { 0xafebff0bcb24aafeU, 0xf78f69a51539d749U },
+    { 0xdbe6fecebdedd5beU, 0xb573440e5a884d1cU },
+    { 0x89705f4136b4a597U, 0x31680a88f8953031U },
+    { 0xabcc77118461cefcU, 0xfdc20d2b36ba7c3eU },
+    { 0xd6bf94d5e57a42bcU, 0x3d32907604691b4dU },
+    { 0x8637bd05af6c69b5U, 0xa63f9a49c2c1b110U },
+    { 0xa7c5ac471b478423U, 0x0fcf80dc33721d54U },
+    { 0xd1b71758e219652bU, 0xd3c36113404ea4a9U },
+    { 0x83126e978d4fdf3bU, 0x645a1cac083126eaU },
+    { 0xa3d70a3d70a3d70aU, 0x3d70a3d70a3d70a4U },
+    { 0xccccccccccccccccU, 0xcccccccccccccccdU },
+    { 0x8000000000000000U, 0x0000000000000000U },
+    { 0xa000000000000000U, 0x0000000000000000U },
+    { 0xc800000000000000U, 0x0000000000000000U },
+    { 0xfa00000000000000U, 0x0000000000000000U },
+    { 0x9c40000000000000U, 0x0000000000000000U },
+    { 0xc350000000000000U, 0x0000000000000000U },
+    { 0xf424000000000000U, 0x0000000000000000U },
+    { 0x9896800000000000U, 0x0000000000000000U },
+    { 0xbebc200000000000U, 0x0000000000000000U },
+    { 0xee6b280000000000U, 0x0000000000000000U },
+    { 0x9502f90000000000U, 0x0000000000000000U },
+    { 0xba43b74000000000U, 0x0000000000000000U },
+    { 0xe8d4a51000000000U, 0x0000000000000000U },
+    { 0x9184e72a00000000U, 0x0000000000000000U },
+    { 0xb5e620f480000000U, 0x0000000000000000U },
+    { 0xe35fa931a0000000U, 0x0000000000000000U },
+    { 0x8e1bc9bf04000000U, 0x0000000000000000U },
+    { 0xb1a2bc2ec5000000U, 0x0000000000000000U },
+    { 0xde0b6b3a76400000U, 0x0000000000000000U },
+    { 0x8ac7230489e80000U, 0x0000000000000000U },
+    { 0xad78ebc5ac620000U, 0x0000000000000000U },
+    { 0xd8d726b7177a8000U, 0x0000000000000000U },
+    { 0x878678326eac9000U, 0x0000000000000000U },
+    { 0xa968163f0a57b400U, 0x0000000000000000U },
+    { 0xd3c21bcecceda100U, 0x0000000000000000U },
+    { 0x84595161401484a0U, 0x0000000000000000U },
+    { 0xa56fa5b99019a5c8U, 0x0000000000000000U },
+    { 0xcecb8f27f4200f3aU, 0x0000000000000000U },
+    { 0x813f3978f8940984U, 0x4000000000000000U },
+    { 0xa18f07d736b90be5U, 0x5000000000000000U },
+    { 0xc9f2c9cd04674edeU, 0xa400000000000000U },
+    { 0xfc6f7c4045812296U, 0x4d00000000000000U },
+    { 0x9dc5ada82b70b59dU, 0xf020000000000000U },
+    { 0xc5371912364ce305U, 0x6c28000000000000U },
+    { 0xf684df56c3e01bc6U, 0xc732000000000000U },
+    { 0x9a130b963a6c115cU, 0x3c7f400000000000U },
+    { 0xc097ce7bc90715b3U, 0x4b9f100000000000U },
+    { 0xf0bdc21abb48db20U, 0x1e86d40000000000U },
+    { 0x96769950b50d88f4U, 0x1314448000000000U },
+    { 0xbc143fa4e250eb31U, 0x17d955a000000000U },
+    { 0xeb194f8e1ae525fdU, 0x5dcfab0800000000U },
+    { 0x92efd1b8d0cf37beU, 0x5aa1cae500000000U },
+    { 0xb7abc627050305adU, 0xf14a3d9e40000000U },
+    { 0xe596b7b0c643c719U, 0x6d9ccd05d0000000U },
+    { 0x8f7e32ce7bea5c6fU, 0xe4820023a2000000U },
+    { 0xb35dbf821ae4f38bU, 0xdda2802c8a800000U },
+    { 0xe0352f62a19e306eU, 0xd50b2037ad200000U },
+    { 0x8c213d9da502de45U, 0x4526f422cc340000U },
+    { 0xaf298d050e4395d6U, 0x9670b12b7f410000U },
+    { 0xdaf3f04651d47b4cU, 0x3c0cdd765f114000U },
+    { 0x88d8762bf324cd0fU, 0xa5880a69fb6ac800U },
+    { 0xab0e93b6efee0053U, 0x8eea0d047a457a00U },
+    { 0xd5d238a4abe98068U, 0x72a4904598d6d880U },
+    { 0x85a36366eb71f041U, 0x47a6da2b7f864750U },
+    { 0xa70c3c40a64e6c51U, 0x999090b65f67d924U },
+    { 0xd0cf4b50cfe20765U, 0xfff4b4e3f741cf6dU },
+    { 0x82818f1281ed449fU, 0xbff8f10e7a8921a4U },
+    { 0xa321f2d7226895c7U, 0xaff72d52192b6a0dU },
+    { 0xcbea6f8ceb02bb39U, 0x9bf4f8a69f764490U },
+    { 0xfee50b7025c36a08U, 0x02f236d04753d5b4U },
+    { 0x9f4f2726179a2245U, 0x01d762422c946590U },
+    { 0xc722f0ef9d80aad6U, 0x424d3ad2b7b97ef5U },
+    { 0xf8ebad2b84e0d58bU, 0xd2e0898765a7deb2U },
+    { 0x9b934c3b330c8577U, 0x63cc55f49f88eb2fU },
+    { 0xc2781f49ffcfa6d5U, 0x3cbf6b71c76b25fbU },
+    { 0xf316271c7fc3908aU, 0x8bef464e3945ef7aU },
+    { 0x97edd871cfda3a56U, 0x97758bf0e3cbb5acU },
+    { 0xbde94e8e43d0c8ecU, 0x3d52eeed1cbea317U },
+    { 0xed63a231d4c4fb27U, 0x4ca7aaa863ee4bddU },
+    { 0x945e455f24fb1cf8U, 0x8fe8caa93e74ef6aU },
+    { 0xb975d6b6ee39e436U, 0xb3e2fd538e122b44U },
+    { 0xe7d34c64a9c85d44U, 0x60dbbca87196b616U },
+    { 0x90e40fbeea1d3a4aU, 0xbc8955e946fe31cdU },
+    { 0xb51d13aea4a488ddU, 0x6babab6398bdbe41U },
+    { 0xe264589a4dcdab14U, 0xc696963c7eed2dd1U },
+    { 0x8d7eb76070a08aecU, 0xfc1e1de5cf543ca2U },
+    { 0xb0de65388cc8ada8U, 0x3b25a55f43294bcbU },
+    { 0xdd15fe86affad912U, 0x49ef0eb713f39ebeU },
+    { 0x8a2dbf142dfcc7abU, 0x6e3569326c784337U },
+    { 0xacb92ed9397bf996U, 0x49c2c37f07965404U },
+    { 0xd7e77a8f87daf7fbU, 0xdc33745ec97be906U },
+    { 0x86f0ac99b4e8dafdU, 0x69a028bb3ded71a3U },
+    { 0xa8acd7c0222311bcU, 0xc40832ea0d68ce0cU },
+    { 0xd2d80db02aabd62bU, 0xf50a3fa490c30190U },
+    { 0x83c7088e1aab65dbU, 0x792667c6da79e0faU },
+    { 0xa4b8cab1a1563f52U, 0x577001b891185938U },
+    { 0xcde6fd5e09abcf26U, 0xed4c0226b55e6f86U },
+    { 0x80b05e5ac60b6178U, 0x544f8158315b05b4U },
+    { 0xa0dc75f1778e39d6U, 0x696361ae3db1c721U },
+    { 0xc913936dd571c84cU, 0x03bc3a19cd1e38e9U },
+    { 0xfb5878494ace3a5fU, 0x04ab48a04065c723U },
+    { 0x9d174b2dcec0e47bU, 0x62eb0d64283f9c76U },
+    { 0xc45d1df942711d9aU, 0x3ba5d0bd324f8394U },
+    { 0xf5746577930d6500U, 0xca8f44ec7ee36479U },
+    { 0x9968bf6abbe85f20U, 0x7e998b13cf4e1ecbU },
+    { 0xbfc2ef456ae276e8U, 0x9e3fedd8c321a67eU },
+    { 0xefb3ab16c59b14a2U, 0xc5cfe94ef3ea101eU },
+    { 0x95d04aee3b80ece5U, 0xbba1f1d158724a12U },
+    { 0xbb445da9ca61281fU, 0x2a8a6e45ae8edc97U },
+    { 0xea1575143cf97226U, 0xf52d09d71a3293bdU },
+    { 0x924d692ca61be758U, 0x593c2626705f9c56U },
+    { 0xb6e0c377cfa2e12eU, 0x6f8b2fb00c77836cU },
+    { 0xe498f455c38b997aU, 0x0b6dfb9c0f956447U },
+    { 0x8edf98b59a373fecU, 0x4724bd4189bd5eacU },
+    { 0xb2977ee300c50fe7U, 0x58edec91ec2cb657U },
+    { 0xdf3d5e9bc0f653e1U, 0x2f2967b66737e3edU },
+    { 0x8b865b215899f46cU, 0xbd79e0d20082ee74U },
+    { 0xae67f1e9aec07187U, 0xecd8590680a3aa11U },
+    { 0xda01ee641a708de9U, 0xe80e6f4820cc9495U },
+    { 0x884134fe908658b2U, 0x3109058d147fdcddU },
+    { 0xaa51823e34a7eedeU, 0xbd4b46f0599fd415U },
+    { 0xd4e5e2cdc1d1ea96U, 0x6c9e18ac7007c91aU },
+    { 0x850fadc09923329eU, 0x03e2cf6bc604ddb0U },
+    { 0xa6539930bf6bff45U, 0x84db8346b786151cU },
+    { 0xcfe87f7cef46ff16U, 0xe612641865679a63U },
+    { 0x81f14fae158c5f6eU, 0x4fcb7e8f3f60c07eU },
+    { 0xa26da3999aef7749U, 0xe3be5e330f38f09dU },
+    { 0xcb090c8001ab551cU, 0x5cadf5bfd3072cc5U },
+    { 0xfdcb4fa002162a63U, 0x73d9732fc7c8f7f6U },
+    { 0x9e9f11c4014dda7eU, 0x2867e7fddcdd9afaU },
+    { 0xc646d63501a1511dU, 0xb281e1fd541501b8U },
+    { 0xf7d88bc24209a565U, 0x1f225a7ca91a4226U },
+    { 0x9ae757596946075fU, 0x3375788de9b06958U },
+    { 0xc1a12d2fc3978937U, 0x0052d6b1641c83aeU },
+    { 0xf209787bb47d6b84U, 0xc0678c5dbd23a49aU },
+    { 0x9745eb4d50ce6332U, 0xf840b7ba963646e0U },
+    { 0xbd176620a501fbffU, 0xb650e5a93bc3d898U },
+    { 0xec5d3fa8ce427affU, 0xa3e51f138ab4cebeU },
+    { 0x93ba47c980e98cdfU, 0xc66f336c36b10137U },
+    { 0xb8a8d9bbe123f017U, 0xb80b0047445d4184U },
+    { 0xe6d3102ad96cec1dU, 0xa60dc059157491e5U },
+    { 0x9043ea1ac7e41392U, 0x87c89837ad68db2fU },
+    { 0xb454e4a179dd1877U, 0x29babe4598c311fbU },
+    { 0xe16a1dc9d8545e94U, 0xf4296dd6fef3d67aU },
+    { 0x8ce2529e2734bb1dU, 0x1899e4a65f58660cU },
+    { 0xb01ae745b101e9e4U, 0x5ec05dcff72e7f8fU },
+    { 0xdc21a1171d42645dU, 0x76707543f4fa1f73U },
+    { 0x899504ae72497ebaU, 0x6a06494a791c53a8U },
+    { 0xabfa45da0edbde69U, 0x0487db9d17636892U },
+    { 0xd6f8d7509292d603U, 0x45a9d2845d3c42b6U },
+    { 0x865b86925b9bc5c2U, 0x0b8a2392ba45a9b2U },
+    { 0xa7f26836f282b732U, 0x8e6cac7768d7141eU },
+    { 0xd1ef0244af2364ffU, 0x3207d795430cd926U },
+    { 0x8335616aed761f1fU, 0x7f44e6bd49e807b8U },
+    { 0xa402b9c5a8d3a6e7U, 0x5f16206c9c6209a6U },
+    { 0xcd036837130890a1U, 0x36dba887c37a8c0fU },
+    { 0x802221226be55a64U, 0xc2494954da2c9789U },
+    { 0xa02aa96b06deb0fdU, 0xf2db9baa10b7bd6cU },
+    { 0xc83553c5c8965d3dU, 0x6f92829494e5acc7U },
+    { 0xfa42a8b73abbf48cU, 0xcb772339ba1f17f9U },
+    { 0x9c69a97284b578d7U, 0xff2a760414536efbU },
+    { 0xc38413cf25e2d70dU, 0xfef5138519684abaU },
+    { 0xf46518c2ef5b8cd1U, 0x7eb258665fc25d69U },
+    { 0x98bf2f79d5993802U, 0xef2f773ffbd97a61U },
+    { 0xbeeefb584aff8603U, 0xaafb550ffacfd8faU },
+    { 0xeeaaba2e5dbf6784U, 0x95ba2a53f983cf38U },
+    { 0x952ab45cfa97a0b2U, 0xdd945a747bf26183U },
+    { 0xba756174393d88dfU, 0x94f971119aeef9e4U },
+    { 0xe912b9d1478ceb17U, 0x7a37cd5601aab85dU },
+    { 0x91abb422ccb812eeU, 0xac62e055c10ab33aU },
+    { 0xb616a12b7fe617aaU, 0x577b986b314d6009U },
+    { 0xe39c49765fdf9d94U, 0xed5a7e85fda0b80bU },
+    { 0x8e41ade9fbebc27dU, 0x14588f13be847307U },
+    { 0xb1d219647ae6b31cU, 0x596eb2d8ae258fc8U },
+    { 0xde469fbd99a05fe3U, 0x6fca5f8ed9aef3bbU },
+    { 0x8aec23d680043beeU, 0x25de7bb9480d5854U },
+    { 0xada72ccc20054ae9U, 0xaf561aa79a10ae6aU },
+    { 0xd910f7ff28069da4U, 0x1b2ba1518094da04U },
+    { 0x87aa9aff79042286U, 0x90fb44d2f05d0842U },
+    { 0xa99541bf57452b28U, 0x353a1607ac744a53U },
+    { 0xd3fa922f2d1675f2U, 0x42889b8997915ce8U },
+    { 0x847c9b5d7c2e09b7U, 0x69956135febada11U },
+    { 0xa59bc234db398c25U, 0x43fab9837e699095U },
+    { 0xcf02b2c21207ef2eU, 0x94f967e45e03f4bbU },
+    { 0x8161afb94b44f57dU, 0x1d1be0eebac278f5U },
+    { 0xa1ba1ba79e1632dcU, 0x6462d92a69731732U },
+    { 0xca28a291859bbf93U, 0x7d7b8f7503cfdcfeU },
+    { 0xfcb2cb35e702af78U, 0x5cda735244c3d43eU },
+    { 0x9defbf01b061adabU, 0x3a0888136afa64a7U },
+    { 0xc56baec21c7a1916U, 0x088aaa1845b8fdd0U },
+    { 0xf6c69a72a3989f5bU, 0x8aad549e57273d45U },
+    { 0x9a3c2087a63f6399U, 0x36ac54e2f678864bU },
+    { 0xc0cb28a98fcf3c7fU, 0x84576a1bb416a7ddU },
+    { 0xf0fdf2d3f3c30b9fU, 0x656d44a2a11c51d5U },
+    { 0x969eb7c47859e743U, 0x9f644ae5a4b1b325U },
+    { 0xbc4665b596706114U, 0x873d5d9f0dde1feeU },
+    { 0xeb57ff22fc0c7959U, 0xa90cb506d155a7eaU },
+    { 0x9316ff75dd87cbd8U, 0x09a7f12442d588f2U },
+    { 0xb7dcbf5354e9beceU, 0x0c11ed6d538aeb2fU },
+    { 0xe5d3ef282a242e81U, 0x8f1668c8a86da5faU },
+    { 0x8fa475791a569d10U, 0xf96e017d694487bcU },
+    { 0xb38d92d760ec4455U, 0x37c981dcc395a9acU },
+    { 0xe070f78d3927556aU, 0x85bbe253f47b1417U },
+    { 0x8c469ab843b89562U, 0x93956d7478ccec8eU },
+    { 0xaf58416654a6babbU, 0x387ac8d1970027b2U },
+    { 0xdb2e51bfe9d0696aU, 0x06997b05fcc0319eU },
+    { 0x88fcf317f22241e2U, 0x441fece3bdf81f03U },
+    { 0xab3c2fddeeaad25aU, 0xd527e81cad7626c3U },
+    { 0xd60b3bd56a5586f1U, 0x8a71e223d8d3b074U },
+    { 0x85c7056562757456U, 0xf6872d5667844e49U },
+    { 0xa738c6bebb12d16cU, 0xb428f8ac016561dbU },
+    { 0xd106f86e69d785c7U, 0xe13336d701beba52U },
+    { 0x82a45b450226b39cU, 0xecc0024661173473U },
+    { 0xa34d721642b06084U, 0x27f002d7f95d0190U },
+    { 0xcc20ce9bd35c78a5U, 0x31ec038df7b441f4U },
+    { 0xff290242c83396ceU, 0x7e67047175a15271U },
+    { 0x9f79a169bd203e41U, 0x0f0062c6e984d386U },
+    { 0xc75809c42c684dd1U, 0x52c07b78a3e60868U },
+    { 0xf92e0c3537826145U, 0xa7709a56ccdf8a82U },
+    { 0x9bbcc7a142b17ccbU, 0x88a66076400bb691U },
+    { 0xc2abf989935ddbfeU, 0x6acff893d00ea435U },
+    { 0xf356f7ebf83552feU, 0x0583f6b8c4124d43U },
+    { 0x98165af37b2153deU, 0xc3727a337a8b704aU },
+    { 0xbe1bf1b059e9a8d6U, 0x744f18c0592e4c5cU },
+    { 0xeda2ee1c7064130cU, 0x1162def06f79df73U },
+    { 0x9485d4d1c63e8be7U, 0x8addcb5645ac2ba8U },
+    { 0xb9a74a0637ce2ee1U, 0x6d953e2bd7173692U },
+    { 0xe8111c87c5c1ba99U, 0xc8fa8db6ccdd0437U },
+    { 0x910ab1d4db9914a0U, 0x1d9c9892400a22a2U },
+    { 0xb54d5e4a127f59c8U, 0x2503beb6d00cab4bU },
+    { 0xe2a0b5dc971f303aU, 0x2e44ae64840fd61dU },
+    { 0x8da471a9de737e24U, 0x5ceaecfed289e5d2U },
+    { 0xb10d8e1456105dadU, 0x7425a83e872c5f47U },
+    { 0xdd50f1996b947518U, 0xd12f124e28f77719U },
+    { 0x8a5296ffe33cc92fU, 0x82bd6b70d99aaa6fU },
+    { 0xace73cbfdc0bfb7bU, 0x636cc64d1001550bU },
+    { 0xd8210befd30efa5aU, 0x3c47f7e05401aa4eU },
+    { 0x8714a775e3e95c78U, 0x65acfaec34810a71U },
+    { 0xa8d9d1535ce3b396U, 0x7f1839a741a14d0dU },
+    { 0xd31045a8341ca07cU, 0x1ede48111209a050U },
+    { 0x83ea2b892091e44dU, 0x934aed0aab460432U },
+    { 0xa4e4b66b68b65d60U, 0xf81da84d5617853fU },
+    { 0xce1de40642e3f4b9U, 0x36251260ab9d668eU },
+    { 0x80d2ae83e9ce78f3U, 0xc1d72b7c6b426019U },
+    { 0xa1075a24e4421730U, 0xb24cf65b8612f81fU },
+    { 0xc94930ae1d529cfcU, 0xdee033f26797b627U },
+    { 0xfb9b7cd9a4a7443cU, 0x169840ef017da3b1U },
+    { 0x9d412e0806e88aa5U, 0x8e1f289560ee864eU },
+    { 0xc491798a08a2ad4eU, 0xf1a6f2bab92a27e2U },
+    { 0xf5b5d7ec8acb58a2U, 0xae10af696774b1dbU },
+    { 0x9991a6f3d6bf1765U, 0xacca6da1e0a8ef29U },
+    { 0xbff610b0cc6edd3fU, 0x17fd090a58d32af3U },
+    { 0xeff394dcff8a948eU, 0xddfc4b4cef07f5b0U },
+    { 0x95f83d0a1fb69cd9U, 0x4abdaf101564f98eU },
+    { 0xbb764c4ca7a4440fU, 0x9d6d1ad41abe37f1U },
+    { 0xea53df5fd18d5513U, 0x84c86189216dc5edU },
+    { 0x92746b9be2f8552cU, 0x32fd3cf5b4e49bb4U },
+    { 0xb7118682dbb66a77U, 0x3fbc8c33221dc2a1U },
+    { 0xe4d5e82392a40515U, 0x0fabaf3feaa5334aU },
+    { 0x8f05b1163ba6832dU, 0x29cb4d87f2a7400eU },
+    { 0xb2c71d5bca9023f8U, 0x743e20e9ef511012U },
+    { 0xdf78e4b2bd342cf6U, 0x914da9246b255416U },
+    { 0x8bab8eefb6409c1aU, 0x1ad089b6c2f7548eU },
+    { 0xae9672aba3d0c320U, 0xa184ac2473b529b1U },
+    { 0xda3c0f568cc4f3e8U, 0xc9e5d72d90a2741eU },
+    { 0x8865899617fb1871U, 0x7e2fa67c7a658892U },
+    { 0xaa7eebfb9df9de8dU, 0xddbb901b98feeab7U },
+    { 0xd51ea6fa85785631U, 0x552a74227f3ea565U },
+    { 0x8533285c936b35deU, 0xd53a88958f87275fU },
+    { 0xa67ff273b8460356U, 0x8a892abaf368f137U },
+    { 0xd01fef10a657842cU, 0x2d2b7569b0432d85U },
+    { 0x8213f56a67f6b29bU, 0x9c3b29620e29fc73U },
+    { 0xa298f2c501f45f42U, 0x8349f3ba91b47b8fU },
+    { 0xcb3f2f7642717713U, 0x241c70a936219a73U },
+    { 0xfe0efb53d30dd4d7U, 0xed238cd383aa0110U },
+    { 0x9ec95d1463e8a506U, 0xf4363804324a40aaU },
+    { 0xc67bb4597ce2ce48U, 0xb143c6053edcd0d5U },
+    { 0xf81aa16fdc1b81daU, 0xdd94b7868e94050aU },
+    { 0x9b10a4e5e9913128U, 0xca7cf2b4191c8326U },
+    { 0xc1d4ce1f63f57d72U, 0xfd1c2f611f63a3f0U },
+    { 0xf24a01a73cf2dccfU, 0xbc633b39673c8cecU },
+    { 0x976e41088617ca01U, 0xd5be0503e085d813U },
+    { 0xbd49d14aa79dbc82U, 0x4b2d8644d8a74e18U },
+    { 0xec9c459d51852ba2U, 0xddf8e7d60ed1219eU },
+    { 0x93e1ab8252f33b45U, 0xcabb90e5c942b503U },
+    { 0xb8da1662e7b00a17U, 0x3d6a751f3b936243U },
+    { 0xe7109bfba19c0c9dU, 0x0cc512670a783ad4U },
+    { 0x906a617d450187e2U, 0x27fb2b80668b24c5U },
+    { 0xb484f9dc9641e9daU, 0xb1f9f660802dedf6U },
+    { 0xe1a63853bbd26451U, 0x5e7873f8a0396973U },
+    { 0x8d07e33455637eb2U, 0xdb0b487b6423e1e8U },
+    { 0xb049dc016abc5e5fU, 0x91ce1a9a3d2cda62U },
+    { 0xdc5c5301c56b75f7U, 0x7641a140cc7810fbU },
+    { 0x89b9b3e11b6329baU, 0xa9e904c87fcb0a9dU },
+    { 0xac2820d9623bf429U, 0x546345fa9fbdcd44U },
+    { 0xd732290fbacaf133U, 0xa97c177947ad4095U },
+    { 0x867f59a9d4bed6c0U, 0x49ed8eabcccc485dU },
+    { 0xa81f301449ee8c70U, 0x5c68f256bfff5a74U },
+    { 0xd226fc195c6a2f8cU, 0x73832eec6fff3111U },
+    { 0x83585d8fd9c25db7U, 0xc831fd53c5ff7eabU },
+    { 0xa42e74f3d032f525U, 0xba3e7ca8b77f5e55U },
+    { 0xcd3a1230c43fb26fU, 0x28ce1bd2e55f35ebU },
+    { 0x80444b5e7aa7cf85U, 0x7980d163cf5b81b3U },
+    { 0xa0555e361951c366U, 0xd7e105bcc332621fU },
+    { 0xc86ab5c39fa63440U, 0x8dd9472bf3fefaa7U },
+    { 0xfa856334878fc150U, 0xb14f98f6f0feb951U },
+    { 0x9c935e00d4b9d8d2U, 0x6ed1bf9a569f33d3U },
+    { 0xc3b8358109e84f07U, 0x0a862f80ec4700c8U },
+    { 0xf4a642e14c6262c8U, 0xcd27bb612758c0faU },
+    { 0x98e7e9cccfbd7dbdU, 0x8038d51cb897789cU },
+    { 0xbf21e44003acdd2cU, 0xe0470a63e6bd56c3U },
+    { 0xeeea5d5004981478U, 0x1858ccfce06cac74U },
+    { 0x95527a5202df0ccbU, 0x0f37801e0c43ebc8U },
+    { 0xbaa718e68396cffdU, 0xd30560258f54e6baU },
+    { 0xe950df20247c83fdU, 0x47c6b82ef32a2069U },
+    { 0x91d28b7416cdd27eU, 0x4cdc331d57fa5441U },
+    { 0xb6472e511c81471dU, 0xe0133fe4adf8e952U },
+    { 0xe3d8f9e563a198e5U, 0x58180fddd97723a6U },
+    { 0x8e679c2f5e44ff8fU, 0x570f09eaa7ea7648U },
+    { 0xb201833b35d63f73U, 0x2cd2cc6551e513daU },
+    { 0xde81e40a034bcf4fU, 0xf8077f7ea65e58d1U },
+    { 0x8b112e86420f6191U, 0xfb04afaf27faf782U },
+    { 0xadd57a27d29339f6U, 0x79c5db9af1f9b563U },
+    { 0xd94ad8b1c7380874U, 0x18375281ae7822bcU },
+    { 0x87cec76f1c830548U, 0x8f2293910d0b15b5U },
+    { 0xa9c2794ae3a3c69aU, 0xb2eb3875504ddb22U },
+    { 0xd433179d9c8cb841U, 0x5fa60692a46151ebU },
+    { 0x849feec281d7f328U, 0xdbc7c41ba6bcd333U },
+    { 0xa5c7ea73224deff3U, 0x12b9b522906c0800U },
+    { 0xcf39e50feae16befU, 0xd768226b34870a00U },
+    { 0x81842f29f2cce375U, 0xe6a1158300d46640U },
+    { 0xa1e53af46f801c53U, 0x60495ae3c1097fd0U },
+    { 0xca5e89b18b602368U, 0x385bb19cb14bdfc4U },
+    { 0xfcf62c1dee382c42U, 0x46729e03dd9ed7b5U },
+    { 0x9e19db92b4e31ba9U, 0x6c07a2c26a8346d1U },
+    { 0xc5a05277621be293U, 0xc7098b7305241885U }
+};
+
+/** 将两个64位无符号整数相乘，返回128位乘积的高64位，低64位由pLow输出 */
+static inline uint64_t MultiplyFull64(uint64_t a, uint64_t b, uint64_t *pLow)
+{
+    var product = (unsigned __int128)a * b;
+    *pLow = (uint64_t)product;
+    return (uint64_t)(product >> 64);
+}
+
+/**
+ * 用Eisel-Lemire算法计算w * 10^q最接近的double值
+ * @param w 十进制有效数字，不能为0
+ * @param q 十进制指数，必须在powersOfFive128表所覆盖的范围之内
+ * @return 所得double值的位模式
+*/
+static uint64_t ComputeDecimalFloatBits(uint64_t w, int q)
+{
+    var leadingZeros = __builtin_clzll(w);
+    w <<= leadingZeros;
+    
+    // 计算w与5^q的128位乘积，只有在高64位中所需的位数不能确定时才使用5^q的低64位
+    const var pPower = powersOfFive128[q - NUMBER_MIN_DECIMAL_EXPONENT];
+    uint64_t low;
+    var high = MultiplyFull64(w, pPower[0], &low);
+    if((high & 0x1ffU) == 0x1ffU)
     {
-        *pRetLength = length;
-        return (cursor[0] == 'p')? M_PI : M_E;
+        uint64_t secondLow;
+        var secondHigh = MultiplyFull64(w, pPower[1], &secondLow);
+        low += secondHigh;
+        if(secondHigh > low)
+            high++;
     }
     
-    char value[MAX_ARGUMENT_LENGTH + 1];
+    // 保留54位（比尾数多出一位用于舍入）
+    var upperBit = (int)(high >> 63);
+    var shift = upperBit + 64 - 52 - 3;
+    var mantissa = high >> shift;
     
-    char ch;
-    var index = 0;
+    // 以2为底的指数，即floor(log2(10^q)) + 63，再加上double的指数偏置
+    var power2 = (((152170 + 65536) * q) >> 16) + 63 + upperBit - leadingZeros + 1023;
+    
+    if(power2 <= 0)
+    {
+        // 结果为次正规数
+        if(-power2 + 1 >= 64)
+            return 0;
+        
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        
+        // 舍入后可能恰好进位成最小的正规数
+        return mantissa;
+    }
+    
+    // 乘积恰好落在两个double正中间时，按照向偶数舍入的规则处理
+    if(low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == high)
+        mantissa &= ~UINT64_C(1);
+    
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if(mantissa >= UINT64_C(2) << 52)
+    {
+        mantissa = UINT64_C(1) << 52;
+        power2++;
+    }
+    mantissa &= ~(UINT64_C(1) << 52);
+    
+    if(power2 >= 0x7ff)
+        return UINT64_C(0x7ff) << 52;
+    
+    return mantissa | (uint64_t)power2 << 52;
+}
+
+/**
+ * 十进制浮点数解析的慢速路径。
+ * 当有效数字超过19位、且Eisel-Lemire算法无法确定舍入方向时，
+ * 将有效数字与指数改写为不含小数点的形式之后交由strtod处理，因此不受当前locale影响
+ * @param cursor 数字字面量的起始位置
+ * @param exponent 字面量中指数部分的值
+*/
+static __attribute__((noinline)) double ParseDecimalFloatSlowPath(const char *cursor, int exponent)
+{
+    char buffer[NUMBER_SLOW_PATH_DIGIT_COUNT + 32];
+    var digitCount = 0;
+    var isInexact = false;
     var hasDot = false;
     
-    do
+    for(; IsDigital(*cursor) || (*cursor == '.' && !hasDot); cursor++)
     {
-        ch = cursor[index];
+        var ch = *cursor;
         if(ch == '.')
         {
-            // 如果之前已经出现了小数点，那么这里就中断解析
+            hasDot = true;
+            continue;
+        }
+        
+        if(digitCount == 0 && ch == '0')
+        {
+            // 跳过前导零
             if(hasDot)
-                break;
-            else
+                exponent--;
+        }
+        else if(digitCount < NUMBER_SLOW_PATH_DIGIT_COUNT)
+        {
+            buffer[digitCount++] = ch;
+            if(hasDot)
+                exponent--;
+        }
+        else
+        {
+            if(!hasDot)
+                exponent++;
+            if(ch != '0')
+                isInexact = true;
+        }
+    }
+    
+    // 被截掉的非零数字只影响舍入方向，用末尾追加的一个1来代替它们
+    if(isInexact)
+    {
+        buffer[digitCount++] = '1';
+        exponent--;
+    }
+    
+    sprintf(&buffer[digitCount], "e%d", exponent);
+    
+    return strtod(buffer, NULL);
+}
+
+/**
+ * 解析十六进制浮点数字面量，格式为0x后跟十六进制数字，可包含小数点，以及以p开头的二进制指数
+ * @param cursor 指向0x之后的第一个字符
+ * @param pLength 输出所解析的字符个数，不包括0x；若没有任何十六进制数字，则输出0
+*/
+static double ParseHexFloat(const char *cursor, int *pLength)
+{
+    const var begin = cursor;
+    uint64_t mantissa = 0;
+    var exponent = 0;
+    var hasDigit = false;
+    var hasDot = false;
+    var isInexact = false;
+    
+    while(true)
+    {
+        var ch = *cursor;
+        int digit;
+        if(IsDigital(ch))
+            digit = ch - '0';
+        else if(ch >= 'a' && ch <= 'f')
+            digit = ch - 'a' + 10;
+        else if(ch == '.' && !hasDot)
+        {
+            hasDot = true;
+            cursor++;
+            continue;
+        }
+        else
+            break;
+        
+        hasDigit = true;
+        cursor++;
+        
+        // 只保留最高的64位有效位，其余位只影响舍入方向
+        if(mantissa >> 60 == 0)
+        {
+            mantissa = mantissa << 4 | digit;
+            if(hasDot)
+                exponent -= 4;
+        }
+        else
+        {
+            if(!hasDot)
+                exponent += 4;
+            if(digit != 0)
+                isInexact = true;
+        }
+    }
+    
+    if(!hasDigit)
+    {
+        *pLength = 0;
+        return 0.0;
+    }
+    
+    // 二进制指数部分，只有在p之后确实跟有数字时才被解析；只有在'p'之后才继续向后查看，以免越过字符串结束符读取
+    var sign = 1;
+    var digitOffset = 1;
+    if(cursor[0] == 'p')
+    {
+        sign = (cursor[1] == '-')? -1 : 1;
+        digitOffset = (cursor[1] == '-' || cursor[1] == '+')? 2 : 1;
+    }
+    if(cursor[0] == 'p' && IsDigital(cursor[digitOffset]))
+    {
+        cursor += digitOffset;
+        var value = 0;
+        for(; IsDigital(*cursor); cursor++)
+        {
+            if(value < 100000)
+                value = value * 10 + (*cursor - '0');
+        }
+        exponent += sign * value;
+    }
+    
+    *pLength = (int)(cursor - begin);
+    
+    if(mantissa == 0)
+        return 0.0;
+    
+    // 将最高有效位移到第63位，则所表示的值为mantissa * 2^exponent，其二进制阶码为exponent + 63
+    var leadingZeros = __builtin_clzll(mantissa);
+    mantissa <<= leadingZeros;
+    exponent -= leadingZeros;
+    
+    // 正规数保留53位，次正规数则保留更少的位数
+    var shift = 11;
+    if(exponent + 63 < -1022)
+        shift += -1022 - (exponent + 63);
+    if(shift > 64)
+        return 0.0;
+    
+    var half = UINT64_C(1) << (shift - 1);
+    var kept = (shift == 64)? 0 : mantissa >> shift;
+    var remainder = (shift == 64)? mantissa : mantissa & ((half << 1) - 1);
+    
+    // 向偶数舍入
+    if(remainder > half || (remainder == half && (isInexact || (kept & 1) != 0)))
+        kept++;
+    
+    return ldexp((double)kept, exponent + shift);
+}
+
+/**
+ * 直接在源字符串上解析一个无符号的数字字面量，既不拷贝字符串，也不分配存储空间。
+ * 支持诸如12、3.5、5.这样的十进制数，诸如1.5e-3、2e10这样的指数形式，以及诸如0x1.8p3、0xff这样的十六进制浮点数。
+ * 对于任意多位的有效数字，所得结果都是正确舍入的。
+ * 字母e之后只有紧跟（可带正负号的）数字时才被视作指数，否则仍作为数学常量e交给后续解析
+ * @param cursor 指向字面量的第一个字符，它必须是数字
+ * @param pLength 输出字面量的字符个数
+*/
+static double ParseNumberLiteral(const char *cursor, int *pLength)
+{
+    const var begin = cursor;
+    
+    if(cursor[0] == '0' && cursor[1] == 'x')
+    {
+        int length;
+        var value = ParseHexFloat(&cursor[2], &length);
+        if(length > 0)
+        {
+            *pLength = length + 2;
+            return value;
+        }
+        // 0x之后没有十六进制数字，那么只解析0
+    }
+    
+    uint64_t w = 0;
+    var digitCount = 0;
+    var exponent = 0;
+    var isTruncated = false;
+    
+    for(; IsDigital(*cursor); cursor++)
+    {
+        if(digitCount < NUMBER_MAX_FAST_DIGIT_COUNT)
+        {
+            w = w * 10 + (*cursor - '0');
+            if(w != 0)
+                digitCount++;
+        }
+        else
+        {
+            exponent++;
+            if(*cursor != '0')
+                isTruncated = true;
+        }
+    }
+    
+    if(*cursor == '.')
+    {
+        for(cursor++; IsDigital(*cursor); cursor++)
+        {
+            if(digitCount < NUMBER_MAX_FAST_DIGIT_COUNT)
             {
-                hasDot = true;
-                value[index] = ch;
+                w = w * 10 + (*cursor - '0');
+                exponent--;
+                if(w != 0)
+                    digitCount++;
             }
+            else if(*cursor != '0')
+                isTruncated = true;
         }
-        else if(!IsDigital(ch))
-            break;  // 在其余情况下，倘若不是数字，则立即中断解析
-        
-        value[index++] = ch;
     }
-    while(ch != '\0');
     
-    value[index] = '\0';
+    var explicitExponent = 0;
+    var sign = 1;
+    var digitOffset = 1;
+    // 只有在'e'之后才继续向后查看，以免越过字符串结束符读取
+    if(cursor[0] == 'e')
+    {
+        sign = (cursor[1] == '-')? -1 : 1;
+        digitOffset = (cursor[1] == '-' || cursor[1] == '+')? 2 : 1;
+    }
+    if(cursor[0] == 'e' && IsDigital(cursor[digitOffset]))
+    {
+        cursor += digitOffset;
+        for(; IsDigital(*cursor); cursor++)
+        {
+            // 过大的指数无论如何都会溢出，这里只需防止整数溢出
+            if(explicitExponent < 100000)
+                explicitExponent = explicitExponent * 10 + (*cursor - '0');
+        }
+        explicitExponent *= sign;
+    }
     
-    *pRetLength = index;
+    *pLength = (int)(cursor - begin);
     
-    // atof函数是将一个字符数组中的内容转为一个double类型的浮点数值
-    // 该函数在<stdlib.h>头文件中
-    return atof(value);
+    if(w == 0)
+        return 0.0;
+    
+    var q = exponent + explicitExponent;
+    
+    // 有效数字与10的幂次都能被double精确表示时，一次乘法或除法的结果就是正确舍入的
+    if(!isTruncated && q >= -NUMBER_EXACT_POWER_OF_TEN_MAX && q <= NUMBER_EXACT_POWER_OF_TEN_MAX && w <= UINT64_C(1) << 53)
+    {
+        static const double exactPowersOfTen[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        return (q < 0)? (double)w / exactPowersOfTen[-q] : (double)w * exactPowersOfTen[q];
+    }
+    
+    if(q < NUMBER_MIN_DECIMAL_EXPONENT)
+        return 0.0;
+    if(q > NUMBER_MAX_DECIMAL_EXPONENT)
+        return HUGE_VAL;
+    
+    var bits = ComputeDecimalFloatBits(w, q);
+    
+    // 有效数字被截断时，真实值介于w与w + 1之间，只有两者的舍入结果相同时才能确定结果
+    if(isTruncated && bits != ComputeDecimalFloatBits(w + 1, q))
+        return ParseDecimalFloatSlowPath(begin, explicitExponent);
+    
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/** 对数字进行解析 */
+static double ParseDigital(const char *cursor, int *pRetLength)
+{
+    // 我们先判断当前是否为数学常量
+    var length = IsMathConstant(cursor);
+    if(length > 0)
+    {
+        *pRetLength = length;
+        return (cursor[0] == 'p')? M_PI : M_E;
+    }
+    
+    return ParseNumberLiteral(cursor, pRetLength);
 }
 
 static double AddOp(double a, double b)
@@ -143,133 +1209,779 @@ static double ModOp(double a, double b)
 {
     // 由于求模操作时，操作数必须是整数，
     // 所以我们这里将a与b都转换为带符号的64位整数类型
-    return (int64_t)a % (int64_t)b;
+    var divisor = (int64_t)b;
+    
+    // 截断后的除数为0时结果为nan，不能触发SIGFPE，否则批处理、服务端以及宿主程序都会被整个终止。
+    // x % -1总是0，单独处理以免INT64_MIN % -1溢出
+    if(divisor == 0)
+        return NAN;
+    if(divisor == -1)
+        return 0.0;
+    
+    return (int64_t)a % divisor;
 }
 
-/** 定义了一个操作函数表，方便快速定位当前操作符所对应的操作函数 */
-static double (* const opFuncTables[])(double, double) = {
-    // 为了进一步节省全局存储空间，我们这里将根据ASCII码表找出最小的字符值，
-    // 将该值作为0，后续的都减去该值。通过ASCII表可以知道，值最小的符号是%，
-    // 它的值为0x25。然后我们可以用指定索引的初始化器对opFuncTables进行初始化
-    ['%' - '%'] = &ModOp,
-    ['*' - '%'] = &MulOp,
-    ['+' - '%'] = &AddOp,
-    ['-' - '%'] = &MinusOp,
-    ['/' - '%'] = &DivOp,
-    ['^' - '%'] = &pow
+/**
+ * 精确整数模式下的数值。不含小数点与指数的整数字面量以及它们之间的加、减、乘、求模与乘方运算结果
+ * 以int64_t精确表示；运算溢出、除不尽、或者有一方不是整数时，结果转为double，此后便一直以double参与运算
+*/
+struct ExactNumber
+{
+    union
+    {
+        int64_t integer;
+        double real;
+    };
+    
+    bool isInteger;
 };
 
-/** 判定是否为有效操作符 */
-static inline bool IsOperator(char ch)
+static inline struct ExactNumber MakeExactInteger(int64_t value)
 {
-    return (ch >= '%' && ch <= '/') || ch == '^';
+    return (struct ExactNumber){ .integer = value, .isInteger = true };
 }
 
-static double radian(double degree)
+static inline struct ExactNumber MakeExactReal(double value)
 {
-    return degree * M_PI / 180.0;
+    return (struct ExactNumber){ .real = value, .isInteger = false };
 }
 
-static double degree(double radian)
+/** 获取数值的double形式，整数会被舍入到最接近的double */
+static inline double GetExactNumberReal(struct ExactNumber number)
 {
-    return radian * 180.0 / M_PI;
+    return number.isInteger? (double)number.integer : number.real;
 }
 
-static double cot(double radian)
+/** 取相反数，只有INT64_MIN的相反数会溢出 */
+static inline struct ExactNumber NegateExactNumber(struct ExactNumber number)
 {
-    return tan(M_PI * 0.5 - radian);
+    if(number.isInteger && number.integer != INT64_MIN)
+        return MakeExactInteger(-number.integer);
+    
+    return MakeExactReal(-GetExactNumberReal(number));
 }
 
-static double recp(double x)
+static struct ExactNumber ExactAddOp(struct ExactNumber a, struct ExactNumber b)
 {
-    return 1.0 / x;
+    int64_t value;
+    if(a.isInteger && b.isInteger && !__builtin_add_overflow(a.integer, b.integer, &value))
+        return MakeExactInteger(value);
+    
+    return MakeExactReal(GetExactNumberReal(a) + GetExactNumberReal(b));
 }
 
-static const struct
+static struct ExactNumber ExactMinusOp(struct ExactNumber a, struct ExactNumber b)
 {
-    int name;
-    double (*pFunc)(double);
-} mathFuncList[] = {
-    { '\0nis', &sin },
-    { '\0soc', &cos },
-    { '\0nat', &tan },
-    { '\0toc', &cot },
-    { 'hnis', &sinh },
-    { 'hsoc', &cosh },
-    { 'hnat', &tanh },
-    { 'nisa', &asin },
-    { 'soca', &acos },
-    { 'nata', &atan },
-    { 'hnsa', &asinh },
-    { 'hsca', &acosh },
-    { '\0gol', &log2 },
-    { '\0\0gl', &log10 },
-    { '\0\0nl', &log },
-    { 'trqs', &sqrt },
-    { 'trbc', cbrt },
-    { 'pcer', &recp },
-    { '\0dar', &radian },
-    { '\0ged', &degree },
-    { '\0pxe', &exp }
-};
-
-static double (*ParseMathFunction(const char *cursor, int *pLength))(double)
-{
-    // 这里buffer至少要求4字节对齐。因为我们后面会对前4个字节内容进行同时访问
-    char alignas(4) buffer[8] = { '\0' };
-    var index = 0;
+    int64_t value;
+    if(a.isInteger && b.isInteger && !__builtin_sub_overflow(a.integer, b.integer, &value))
+        return MakeExactInteger(value);
     
-    // 由于我们这里规定的数学符号最多占用4个字节，
-    // 所以需要用一个计数器来防治访问越界
-    for(var count = 0; count < 4; count++, index++)
+    return MakeExactReal(GetExactNumberReal(a) - GetExactNumberReal(b));
+}
+
+static struct ExactNumber ExactMulOp(struct ExactNumber a, struct ExactNumber b)
+{
+    int64_t value;
+    if(a.isInteger && b.isInteger && !__builtin_mul_overflow(a.integer, b.integer, &value))
+        return MakeExactInteger(value);
+    
+    return MakeExactReal(GetExactNumberReal(a) * GetExactNumberReal(b));
+}
+
+static struct ExactNumber ExactDivOp(struct ExactNumber a, struct ExactNumber b)
+{
+    // 只有能整除时商才是整数，INT64_MIN / -1会溢出，所以同样交给double计算
+    if(a.isInteger && b.isInteger && b.integer != 0 && !(a.integer == INT64_MIN && b.integer == -1) && a.integer % b.integer == 0)
+        return MakeExactInteger(a.integer / b.integer);
+    
+    return MakeExactReal(GetExactNumberReal(a) / GetExactNumberReal(b));
+}
+
+static struct ExactNumber ExactModOp(struct ExactNumber a, struct ExactNumber b)
+{
+    // 与ModOp一样，double操作数先截断为整数，除数为0时结果为nan
+    var divisor = b.isInteger? b.integer : (int64_t)b.real;
+    if(divisor == 0)
+        return MakeExactReal(NAN);
+    
+    // x % -1总是0，单独处理以免INT64_MIN % -1溢出
+    var dividend = a.isInteger? a.integer : (int64_t)a.real;
+    var value = (divisor == -1)? 0 : dividend % divisor;
+    
+    return (a.isInteger && b.isInteger)? MakeExactInteger(value) : MakeExactReal((double)value);
+}
+
+static struct ExactNumber ExactPowOp(struct ExactNumber a, struct ExactNumber b)
+{
+    if(a.isInteger && b.isInteger && b.integer >= 0)
     {
-        var ch = cursor[index];
-        if(!IsMathFunction(ch))
-            break;
+        // 平方求幂。底数的平方溢出时，还剩下的指数至少为1，而此时|a| >= 2，所以结果也必然溢出
+        int64_t value = 1;
+        var base = a.integer;
+        var exponent = b.integer;
+        var isOverflow = false;
+        while(true)
+        {
+            if((exponent & 1) != 0 && __builtin_mul_overflow(value, base, &value))
+            {
+                isOverflow = true;
+                break;
+            }
+            exponent >>= 1;
+            if(exponent == 0)
+                break;
+            if(__builtin_mul_overflow(base, base, &base))
+            {
+                isOverflow = true;
+                break;
+            }
+        }
         
-        buffer[index] = ch;
+        if(!isOverflow)
+            return MakeExactInteger(value);
     }
-    buffer[index] = '\0';
-    
-    // 同时取出刚才所存放的四个字节内容，方便比较
-    var value = *(int*)buffer;
     
-    // 查找函数表中是否含有该函数名
-    const var length = sizeof(mathFuncList) / sizeof(mathFuncList[0]);
-    for(typeof(length + 0) i = 0; i < length; i++)
+    return MakeExactReal(pow(GetExactNumberReal(a), GetExactNumberReal(b)));
+}
+
+/**
+ * 精确整数模式下解析一个数字记号。不含小数点与指数、并且不超过INT64_MAX的十进制整数字面量解析为整数，
+ * 其余的字面量以及数学常量都与ParseDigital一样解析为double
+*/
+static struct ExactNumber ParseExactDigital(const char *cursor, int *pRetLength)
+{
+    if(IsDigital(cursor[0]) && !(cursor[0] == '0' && cursor[1] == 'x'))
     {
-        if(mathFuncList[i].name == value)
+        uint64_t w = 0;
+        var isOverflow = false;
+        var length = 0;
+        for(; IsDigital(cursor[length]); length++)
+            isOverflow |= __builtin_mul_overflow(w, 10, &w) | __builtin_add_overflow(w, (uint64_t)(cursor[length] - '0'), &w);
+        
+        // 与ParseNumberLiteral一样，e之后只有紧跟（可带正负号的）数字时才是指数；只有在e之后才继续向后查看，以免越过字符串结束符读取
+        var next = cursor[length];
+        var hasExponent = false;
+        if(next == 'e')
         {
-            *pLength = index;
-            return mathFuncList[i].pFunc;
+            var digitOffset = (cursor[length + 1] == '-' || cursor[length + 1] == '+')? 2 : 1;
+            hasExponent = IsDigital(cursor[length + digitOffset]);
+        }
+        if(!isOverflow && w <= INT64_MAX && next != '.' && !hasExponent)
+        {
+            *pRetLength = length;
+            return MakeExactInteger((int64_t)w);
         }
     }
     
-    return NULL;
+    return MakeExactReal(ParseDigital(cursor, pRetLength));
 }
 
-/** 
- * 解析当前的算术表达式
- * @param ppCursor 指向当前算术表达式字符串的地址。
- * 它既是输入又是输出。当当前算术表达式作为括号进行计算时，
- * 需要将右括号的位置输出到实参。
- * @param leftOperand 当前左操作数的值
- * @param status 当前计算状态
- * @param priority 当前计算的算术优先级
- * @param pStatus 输出解析状态
- * @return 输出计算表达式的结果
-*/
-static double ParseArithmeticExpression(const char **ppCursor, double leftOperand, enum PARSE_PHASE_STATUS status, enum OPERATOR_PRIORITY priority, bool *pStatus)
+/** 二元操作符的操作函数及其优先级 */
+struct OperatorInfo
 {
-    const char *cursor = *ppCursor;
-    var rightOperand = 0.0;
+    double (*pFunc)(double, double);
     
-    var length = 0;
+    enum OPERATOR_PRIORITY priority;
     
-    // 指向操作符函数的指针
-    double (*pOpFunc)(double, double) = NULL;
+    /**
+     * 之前的操作符优先级不低于该值时，需要先将之前的操作归约，再处理当前操作符。
+     * 左结合的操作符该值等于priority，右结合的操作符则比priority高一级
+    */
+    int reducePriority;
     
-    // 指向数学函数的指针
+    /** 精确整数模式下的操作函数 */
+    struct ExactNumber (*pExactFunc)(struct ExactNumber, struct ExactNumber);
+};
+
+/** 定义了一个操作符表，方便快速定位当前操作符所对应的操作函数以及优先级 */
+static const struct OperatorInfo operatorTable[] = {
+    // 为了进一步节省全局存储空间，我们这里将根据ASCII码表找出最小的字符值，
+    // 将该值作为0，后续的都减去该值。通过ASCII表可以知道，值最小的符号是%，
+    // 它的值为0x25。然后我们可以用指定索引的初始化器对operatorTable进行初始化
+    ['%' - '%'] = { &ModOp, OPERATOR_PRIORITY_MUL, OPERATOR_PRIORITY_MUL, &ExactModOp },
+    ['*' - '%'] = { &MulOp, OPERATOR_PRIORITY_MUL, OPERATOR_PRIORITY_MUL, &ExactMulOp },
+    ['+' - '%'] = { &AddOp, OPERATOR_PRIORITY_ADD, OPERATOR_PRIORITY_ADD, &ExactAddOp },
+    ['-' - '%'] = { &MinusOp, OPERATOR_PRIORITY_ADD, OPERATOR_PRIORITY_ADD, &ExactMinusOp },
+    ['/' - '%'] = { &DivOp, OPERATOR_PRIORITY_MUL, OPERATOR_PRIORITY_MUL, &ExactDivOp },
+    
+    // 本计算器中的幂运算一直是左结合的，即2^3^2 = (2^3)^2 = 64
+    ['^' - '%'] = { &pow, OPERATOR_PRIORITY_POW, OPERATOR_PRIORITY_POW, &ExactPowOp }
+};
+
+/** 获取操作符ch的信息，ch的类别必须为CHARACTER_CLASS_OPERATOR */
+static inline const struct OperatorInfo* GetOperatorInfo(char ch)
+{
+    return &operatorTable[ch - '%'];
+}
+
+static double radian(double degree)
+{
+    return degree * M_PI / 180.0;
+}
+
+static double degree(double radian)
+{
+    return radian * 180.0 / M_PI;
+}
+
+static double cot(double radian)
+{
+    return tan(M_PI * 0.5 - radian);
+}
+
+static double recp(double x)
+{
+    return 1.0 / x;
+}
+
+/** 数学函数名的最大长度 */
+#define MATH_FUNCTION_NAME_MAX_LENGTH   7
+
+/** 数学函数表的大小，它是2的幂 */
+#define MATH_FUNCTION_TABLE_SIZE        64
+
+/**
+ * 数学函数名的完美哈希。
+ * 它由函数名的首字符、中间字符（下标为length / 2）、末字符以及长度算出，
+ * 系数是离线搜索得到的，能保证mathFuncList中的所有函数名互不冲突。
+ * 由于它只用到了整型常量表达式，所以可以直接作为mathFuncList的下标初始化器
+*/
+#define MATH_FUNCTION_HASH(first, middle, last, length)  \
+    ((9 * (first) + 13 * (middle) + 4 * (last) + 4 * (length)) & (MATH_FUNCTION_TABLE_SIZE - 1))
+
+/** 在mathFuncList中定义一个函数，name的长度必须为length，并且first、middle、last与之相符 */
+#define MATH_FUNCTION_ENTRY(first, middle, last, length, name, pFunc)  \
+    [MATH_FUNCTION_HASH(first, middle, last, length)] = { name, length, pFunc }
+
+/**
+ * 数学函数表，按函数名的哈希值存放，空位的length为0。
+ * 程序中的CALL指令以函数在该表中的索引作为操作数。
+ * 若新加入的函数名与已有的函数名冲突，用-Wextra（其中包含-Woverride-init）编译时会给出警告，此时需要重新搜索哈希系数。
+ * 命令行的--bench-functions选项还会检查每个函数名的哈希值是否与其所在的位置一致
+*/
+static const struct MathFunction
+{
+    /** 函数名，不足的部分以'\0'填充，以便一次比较8个字节 */
+    char name[MATH_FUNCTION_NAME_MAX_LENGTH + 1];
+    
+    int length;
+    double (*pFunc)(double);
+} mathFuncList[MATH_FUNCTION_TABLE_SIZE] = {
+    MATH_FUNCTION_ENTRY('s', 'i', 'n', 3, "sin", &sin),
+    MATH_FUNCTION_ENTRY('c', 'o', 's', 3, "cos", &cos),
+    MATH_FUNCTION_ENTRY('t', 'a', 'n', 3, "tan", &tan),
+    MATH_FUNCTION_ENTRY('c', 'o', 't', 3, "cot", &cot),
+    MATH_FUNCTION_ENTRY('s', 'n', 'h', 4, "sinh", &sinh),
+    MATH_FUNCTION_ENTRY('c', 's', 'h', 4, "cosh", &cosh),
+    MATH_FUNCTION_ENTRY('t', 'n', 'h', 4, "tanh", &tanh),
+    MATH_FUNCTION_ENTRY('a', 'i', 'n', 4, "asin", &asin),
+    MATH_FUNCTION_ENTRY('a', 'o', 's', 4, "acos", &acos),
+    MATH_FUNCTION_ENTRY('a', 'a', 'n', 4, "atan", &atan),
+    MATH_FUNCTION_ENTRY('a', 'n', 'h', 4, "asnh", &asinh),
+    MATH_FUNCTION_ENTRY('a', 's', 'h', 4, "acsh", &acosh),
+    MATH_FUNCTION_ENTRY('l', 'o', 'g', 3, "log", &log2),
+    MATH_FUNCTION_ENTRY('l', 'g', 'g', 2, "lg", &log10),
+    MATH_FUNCTION_ENTRY('l', 'n', 'n', 2, "ln", &log),
+    MATH_FUNCTION_ENTRY('s', 'r', 't', 4, "sqrt", &sqrt),
+    MATH_FUNCTION_ENTRY('c', 'r', 't', 4, "cbrt", &cbrt),
+    MATH_FUNCTION_ENTRY('r', 'c', 'p', 4, "recp", &recp),
+    MATH_FUNCTION_ENTRY('r', 'a', 'd', 3, "rad", &radian),
+    MATH_FUNCTION_ENTRY('d', 'e', 'g', 3, "deg", &degree),
+    MATH_FUNCTION_ENTRY('e', 'x', 'p', 3, "exp", &exp),
+    
+    // 较长的别名以及atanh
+    MATH_FUNCTION_ENTRY('a', 'i', 'h', 5, "asinh", &asinh),
+    MATH_FUNCTION_ENTRY('a', 'o', 'h', 5, "acosh", &acosh),
+    MATH_FUNCTION_ENTRY('a', 'a', 'h', 5, "atanh", &atanh),
+    MATH_FUNCTION_ENTRY('a', 's', 'n', 6, "arcsin", &asin),
+    MATH_FUNCTION_ENTRY('a', 'c', 's', 6, "arccos", &acos),
+    MATH_FUNCTION_ENTRY('a', 't', 'n', 6, "arctan", &atan),
+    MATH_FUNCTION_ENTRY('a', 's', 'h', 7, "arcsinh", &asinh),
+    MATH_FUNCTION_ENTRY('a', 'c', 'h', 7, "arccosh", &acosh),
+    MATH_FUNCTION_ENTRY('a', 't', 'h', 7, "arctanh", &atanh),
+    MATH_FUNCTION_ENTRY('l', 'g', '2', 4, "log2", &log2),
+    MATH_FUNCTION_ENTRY('l', 'g', '0', 5, "log10", &log10)
+};
+
+/** 数学函数的快速近似实现的种类，按列求值时据此选用对应的向量实现 */
+enum FAST_MATH_KERNEL
+{
+    /** 没有快速实现，总是使用mathFuncList中的函数 */
+    FAST_MATH_KERNEL_NONE = 0,
+    
+    FAST_MATH_KERNEL_SIN,
+    FAST_MATH_KERNEL_COS,
+    FAST_MATH_KERNEL_TAN,
+    FAST_MATH_KERNEL_COT,
+    FAST_MATH_KERNEL_EXP,
+    FAST_MATH_KERNEL_LN,
+    FAST_MATH_KERNEL_LOG2,
+    FAST_MATH_KERNEL_LOG10
+};
+
+/** 用于取整的偏移量：|x| < 2^51时，(x + FAST_MATH_ROUNDING_SHIFT) - FAST_MATH_ROUNDING_SHIFT即为x舍入到最近整数的结果，并且相加之后的低位就是该整数的补码 */
+#define FAST_MATH_ROUNDING_SHIFT    0x1.8p52
+
+/** 三角函数的快速实现所能处理的最大参数绝对值（约1.6e6），超出时转而调用libm。在此范围内，象限数k不超过2^20，k与π/2的前两段之积都是精确的 */
+#define FAST_TRIG_REDUCTION_LIMIT   0x1.921fb5p20
+
+/* π/2被拆分成三段：前两段各有33位有效数字，与不超过2^20的整数相乘时没有舍入误差；第三段是余下的部分 */
+#define FAST_TRIG_PIO2_1            1.57079632673412561417e+00
+#define FAST_TRIG_PIO2_2            6.07710050630396597660e-11
+#define FAST_TRIG_PIO2_3            2.02226624879595063154e-21
+
+/** 将double按位解释为64位整数 */
+static inline uint64_t GetDoubleBits(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/** 将64位整数按位解释为double */
+static inline double MakeDoubleFromBits(uint64_t bits)
+{
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/**
+ * 三角函数的参数约简：x = k * π/2 + r + low，|r| <= π/4
+ * @param x 参数，其绝对值不超过FAST_TRIG_REDUCTION_LIMIT
+ * @param pLow 输出约简结果的低位部分
+ * @param pQuadrant 输出k的低位，只有低2位有意义
+ * @return 约简结果的高位部分r
+*/
+static inline double ReduceTrigArgument(double x, double *pLow, uint64_t *pQuadrant)
+{
+    var k = x * M_2_PI + FAST_MATH_ROUNDING_SHIFT;
+    *pQuadrant = GetDoubleBits(k);
+    k -= FAST_MATH_ROUNDING_SHIFT;
+    
+    // 第一次相减没有舍入误差，第二次相减的舍入误差由2Sum精确求出，与第三段一起计入低位部分，
+    // 因此x接近π/2的整数倍时也不会丢失精度
+    var high = x - k * FAST_TRIG_PIO2_1;
+    var middle = k * FAST_TRIG_PIO2_2;
+    var r = high - middle;
+    var rounding = r - high;
+    var low = ((high - (r - rounding)) - (middle + rounding)) - k * FAST_TRIG_PIO2_3;
+    var sum = r + low;
+    *pLow = low - (sum - r);
+    return sum;
+}
+
+/** [-π/4, π/4]上sin(r + low)的极小化多项式，误差小于2^-58 */
+static inline double EvaluateSinPolynomial(double r, double low)
+{
+    var z = r * r;
+    var v = z * r;
+    var p = 8.33333333332248946124e-03 + z * (-1.98412698298579493134e-04 + z * (2.75573137070700676789e-06 + z * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10)));
+    return r - ((z * (0.5 * low - v * p) - low) - v * -1.66666666666666324348e-01);
+}
+
+/** [-π/4, π/4]上cos(r + low)的极小化多项式，误差小于2^-58。1 - z/2的舍入误差被单独补偿 */
+static inline double EvaluateCosPolynomial(double r, double low)
+{
+    var z = r * r;
+    var w = z * z;
+    var p = z * (4.16666666666666019037e-02 + z * (-1.38888888888741095749e-03 + z * 2.48015872894767294178e-05)) +
+            w * w * (-2.75573143513906633035e-07 + z * (2.08757232129817482790e-09 + z * -1.13596475577881948265e-11));
+    var halfZ = 0.5 * z;
+    var head = 1.0 - halfZ;
+    return head + (((1.0 - head) - halfZ) + (z * p - r * low));
+}
+
+/** sin的快速实现，误差不超过1 ULP。参数绝对值超过FAST_TRIG_REDUCTION_LIMIT时调用libm */
+static double FastSin(double x)
+{
+    if(!(fabs(x) <= FAST_TRIG_REDUCTION_LIMIT))
+        return sin(x);
+    
+    // 奇数象限上sin(x) = ±cos(r)，第2、3象限上符号相反
+    double low;
+    uint64_t quadrant;
+    var r = ReduceTrigArgument(x, &low, &quadrant);
+    var value = (quadrant & 1) != 0? EvaluateCosPolynomial(r, low) : EvaluateSinPolynomial(r, low);
+    return MakeDoubleFromBits(GetDoubleBits(value) ^ (quadrant & 2) << 62);
+}
+
+/** cos的快速实现，误差不超过1 ULP。参数绝对值超过FAST_TRIG_REDUCTION_LIMIT时调用libm */
+static double FastCos(double x)
+{
+    if(!(fabs(x) <= FAST_TRIG_REDUCTION_LIMIT))
+        return cos(x);
+    
+    // cos(x) = sin(x + π/2)，即象限数加1
+    double low;
+    uint64_t quadrant;
+    var r = ReduceTrigArgument(x, &low, &quadrant);
+    quadrant++;
+    var value = (quadrant & 1) != 0? EvaluateCosPolynomial(r, low) : EvaluateSinPolynomial(r, low);
+    return MakeDoubleFromBits(GetDoubleBits(value) ^ (quadrant & 2) << 62);
+}
+
+/** tan的快速实现，误差不超过3 ULP。参数绝对值超过FAST_TRIG_REDUCTION_LIMIT时调用libm */
+static double FastTan(double x)
+{
+    if(!(fabs(x) <= FAST_TRIG_REDUCTION_LIMIT))
+        return tan(x);
+    
+    // 奇数象限上tan(x) = -cos(r) / sin(r)
+    double low;
+    uint64_t quadrant;
+    var r = ReduceTrigArgument(x, &low, &quadrant);
+    var s = EvaluateSinPolynomial(r, low);
+    var c = EvaluateCosPolynomial(r, low);
+    var value = (quadrant & 1) != 0? c / s : s / c;
+    return MakeDoubleFromBits(GetDoubleBits(value) ^ (quadrant & 1) << 63);
+}
+
+/** cot的快速实现，误差不超过3 ULP，比mathFuncList中以tan(π/2 - x)实现的cot精确得多。参数绝对值超过FAST_TRIG_REDUCTION_LIMIT时调用后者 */
+static double FastCot(double x)
+{
+    if(!(fabs(x) <= FAST_TRIG_REDUCTION_LIMIT))
+        return cot(x);
+    
+    double low;
+    uint64_t quadrant;
+    var r = ReduceTrigArgument(x, &low, &quadrant);
+    var s = EvaluateSinPolynomial(r, low);
+    var c = EvaluateCosPolynomial(r, low);
+    var value = (quadrant & 1) != 0? s / c : c / s;
+    return MakeDoubleFromBits(GetDoubleBits(value) ^ (quadrant & 1) << 63);
+}
+
+/** 在fastMathKernelList中定义一个快速实现，其位置与mathFuncList中同名的函数相同 */
+#define FAST_MATH_KERNEL_ENTRY(first, middle, last, length, kernel, pFunc)  \
+    [MATH_FUNCTION_HASH(first, middle, last, length)] = { kernel, pFunc }
+
+/**
+ * 数学函数的快速近似实现，与mathFuncList一一对应，kernel为FAST_MATH_KERNEL_NONE的位置表示该函数没有快速实现。
+ * glibc中exp、ln与log2的标量实现本身就是查表加低次多项式，标量的近似实现无法比它更快，
+ * 所以这几个函数以及lg只有向量版本（pFunc为NULL），标量调用仍使用libm。
+ * 各实现的误差上界都以long double的结果为参照，由命令行的--bench-kernels选项在各自的定义域上抽样验证。
+ * 幂运算、cbrt以及其余的函数没有快速实现
+*/
+static const struct FastMathKernel
+{
+    enum FAST_MATH_KERNEL kernel;
+    
+    /** 标量版本，为NULL时使用mathFuncList中的函数 */
+    double (*pFunc)(double);
+} fastMathKernelList[MATH_FUNCTION_TABLE_SIZE] = {
+    FAST_MATH_KERNEL_ENTRY('s', 'i', 'n', 3, FAST_MATH_KERNEL_SIN, &FastSin),
+    FAST_MATH_KERNEL_ENTRY('c', 'o', 's', 3, FAST_MATH_KERNEL_COS, &FastCos),
+    FAST_MATH_KERNEL_ENTRY('t', 'a', 'n', 3, FAST_MATH_KERNEL_TAN, &FastTan),
+    FAST_MATH_KERNEL_ENTRY('c', 'o', 't', 3, FAST_MATH_KERNEL_COT, &FastCot),
+    FAST_MATH_KERNEL_ENTRY('e', 'x', 'p', 3, FAST_MATH_KERNEL_EXP, NULL),
+    FAST_MATH_KERNEL_ENTRY('l', 'n', 'n', 2, FAST_MATH_KERNEL_LN, NULL),
+    FAST_MATH_KERNEL_ENTRY('l', 'o', 'g', 3, FAST_MATH_KERNEL_LOG2, NULL),
+    FAST_MATH_KERNEL_ENTRY('l', 'g', '2', 4, FAST_MATH_KERNEL_LOG2, NULL),
+    FAST_MATH_KERNEL_ENTRY('l', 'g', 'g', 2, FAST_MATH_KERNEL_LOG10, NULL),
+    FAST_MATH_KERNEL_ENTRY('l', 'g', '0', 5, FAST_MATH_KERNEL_LOG10, NULL)
+};
+
+/** 获取数学函数表中第index个函数在指定实现下的标量版本 */
+static inline double (*GetMathFunction(int index, enum MATH_KERNEL_SET kernelSet))(double)
+{
+    if(kernelSet == MATH_KERNEL_SET_FAST && fastMathKernelList[index].pFunc != NULL)
+        return fastMathKernelList[index].pFunc;
+    
+    return mathFuncList[index].pFunc;
+}
+
+/** 判定当前字符是否可以作为函数名中除首字符以外的字符 */
+static inline bool IsMathFunctionNameCharacter(char ch)
+{
+    var charClass = GetCharacterClass(ch);
+    return charClass == CHARACTER_CLASS_LETTER || charClass == CHARACTER_CLASS_DIGIT;
+}
+
+/** 读取处理器的时间戳计数器，不支持时返回0 */
+static inline uint64_t ReadCycleCounter(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// 定义SIMPLE_CALCULATOR_STATISTICS之后，热路径上的各个插桩点会记录各阶段的周期数、
+// 各操作符与数学函数的出现次数、括号嵌套深度的分布以及失败原因。未定义时插桩宏全部展开为空，不产生任何代码
+#if defined(SIMPLE_CALCULATOR_STATISTICS)
+
+/** 分别计时的阶段 */
+enum STATISTICS_TIMER
+{
+    /** 向量化预检 */
+    STATISTICS_TIMER_PRESCAN,
+    
+    /** 迭代求值的全过程，包括其中的数字与函数名解析 */
+    STATISTICS_TIMER_EVALUATE,
+    
+    /** 数字字面量以及数学常量的解析，即ParseDigital */
+    STATISTICS_TIMER_NUMBER,
+    
+    /** 数学函数名的解析，即ParseMathFunction */
+    STATISTICS_TIMER_FUNCTION,
+    
+    /** 结果的格式化 */
+    STATISTICS_TIMER_FORMAT,
+    
+    STATISTICS_TIMER_COUNT
+};
+
+/** 嵌套深度直方图的桶数，第i个桶统计深度不超过2^i的次数（不含更小的桶），最后一个桶统计其余所有深度 */
+#define STATISTICS_DEPTH_BUCKET_COUNT   16
+
+/**
+ * 每个线程各自的统计数据。每个计数器只会被所属线程写入，所以不需要原子的读-改-写操作，
+ * 使用relaxed的原子读写只是为了让输出统计的线程能够无竞争地读取。
+ * 线程退出之后它仍留在链表中，以免丢失已经统计的数据
+*/
+struct CalculationStatistics
+{
+    atomic_ullong timerCycles[STATISTICS_TIMER_COUNT];
+    atomic_ullong timerCalls[STATISTICS_TIMER_COUNT];
+    
+    /** 以操作符字符为下标的出现次数，负号单独统计 */
+    atomic_ullong operatorCounts[128];
+    atomic_ullong negationCount;
+    
+    /** 以mathFuncList中的索引为下标的函数名解析次数 */
+    atomic_ullong functionCounts[MATH_FUNCTION_TABLE_SIZE];
+    
+    /** 每次进入括号时的嵌套深度分布以及深度之和 */
+    atomic_ullong depthHistogram[STATISTICS_DEPTH_BUCKET_COUNT];
+    atomic_ullong depthSum;
+    
+    /** 以CALCULATION_ERROR为下标的求值失败次数 */
+    atomic_ullong errorCounts[CALCULATION_ERROR_INVALID_REDUCTION + 1];
+    
+    /** 被预检拒绝的表达式个数 */
+    atomic_ullong prescanRejectionCount;
+    
+    /** 求值的表达式个数以及它们的总字节数 */
+    atomic_ullong expressionCount;
+    atomic_ullong byteCount;
+    
+    // 以上各字段都是计数器，汇总时按计数器数组逐个相加，所以next必须是最后一个字段
+    struct CalculationStatistics *next;
+};
+
+static pthread_mutex_t statisticsMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct CalculationStatistics *statisticsList;
+static _Thread_local struct CalculationStatistics *threadStatistics;
+
+/** 作为分配失败时的后备，这样插桩点就不必检查NULL */
+static struct CalculationStatistics fallbackStatistics;
+
+/** 获取当前线程的统计数据，首次调用时创建并加入链表 */
+static struct CalculationStatistics* GetThreadStatistics(void)
+{
+    if(__builtin_expect(threadStatistics != NULL, 1))
+        return threadStatistics;
+    
+    var statistics = (struct CalculationStatistics*)calloc(1, sizeof(struct CalculationStatistics));
+    pthread_mutex_lock(&statisticsMutex);
+    if(statistics == NULL)
+        statistics = &fallbackStatistics;
+    else
+    {
+        statistics->next = statisticsList;
+        statisticsList = statistics;
+    }
+    pthread_mutex_unlock(&statisticsMutex);
+    
+    threadStatistics = statistics;
+    return statistics;
+}
+
+/** 给只被当前线程写入的计数器加上count */
+static inline void AddStatisticsCounter(atomic_ullong *counter, unsigned long long count)
+{
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + count, memory_order_relaxed);
+}
+
+/** 返回嵌套深度所属的直方图桶 */
+static inline int GetStatisticsDepthBucket(size_t depth)
+{
+    var bucket = (depth <= 1)? 0 : 64 - __builtin_clzll((unsigned long long)depth - 1);
+    return (bucket < STATISTICS_DEPTH_BUCKET_COUNT)? bucket : STATISTICS_DEPTH_BUCKET_COUNT - 1;
+}
+
+#define STATISTICS_COUNT(field, count)          AddStatisticsCounter(&GetThreadStatistics()->field, (count))
+#define STATISTICS_RECORD_DEPTH(depth)          do { STATISTICS_COUNT(depthHistogram[GetStatisticsDepthBucket(depth)], 1); STATISTICS_COUNT(depthSum, depth); } while(0)
+#define STATISTICS_BEGIN_TIMER(name)            const uint64_t name##BeginCycles = ReadCycleCounter()
+#define STATISTICS_END_TIMER(name, timer)       do { var statistics = GetThreadStatistics(); \
+                                                     AddStatisticsCounter(&statistics->timerCycles[timer], ReadCycleCounter() - name##BeginCycles); \
+                                                     AddStatisticsCounter(&statistics->timerCalls[timer], 1); } while(0)
+
+#else
+
+#define STATISTICS_COUNT(field, count)          ((void)0)
+#define STATISTICS_RECORD_DEPTH(depth)          ((void)0)
+#define STATISTICS_BEGIN_TIMER(name)            ((void)0)
+#define STATISTICS_END_TIMER(name, timer)       ((void)0)
+
+#endif  // SIMPLE_CALCULATOR_STATISTICS
+
+/**
+ * 解析当前游标处的数学函数名
+ * @param cursor 指向函数名起始字符
+ * @param pLength 输出函数名所占用的字符个数
+ * @return 若解析成功，返回该函数在mathFuncList中的索引，否则返回-1
+*/
+static int ParseMathFunctionIndex(const char *cursor, int *pLength)
+{
+    // 函数名以字母开头，后面可以跟字母或数字（比如log10）。
+    // 比最长的函数名还长的标识符一定不是函数名，所以最多只需要向后查看MATH_FUNCTION_NAME_MAX_LENGTH个字符
+    // 扫描的同时将函数名以小端方式装入一个64位整数，以便与函数表中的名字一次比较完毕
+    uint64_t key = (uint8_t)cursor[0];
+    var length = 1;
+    for(; length <= MATH_FUNCTION_NAME_MAX_LENGTH && IsMathFunctionNameCharacter(cursor[length]); length++)
+        key |= (uint64_t)(uint8_t)cursor[length] << (length * 8);
+    
+    if(length > MATH_FUNCTION_NAME_MAX_LENGTH)
+        return -1;
+    
+    var index = MATH_FUNCTION_HASH(cursor[0], cursor[length / 2], cursor[length - 1], length);
+    uint64_t name;
+    memcpy(&name, mathFuncList[index].name, sizeof(name));
+    if(name != key)
+        return -1;
+    
+    *pLength = length;
+    return index;
+}
+
+/**
+ * 解析当前游标处的数学函数名
+ * @param cursor 指向函数名起始字符
+ * @param pLength 输出函数名所占用的字符个数
+ * @param kernelSet 数学函数的实现方式
+ * @return 若解析成功，返回该函数在指定实现下的函数指针，否则返回NULL
+*/
+static double (*ParseMathFunction(const char *cursor, int *pLength, enum MATH_KERNEL_SET kernelSet))(double)
+{
+    STATISTICS_BEGIN_TIMER(lookup);
+    var index = ParseMathFunctionIndex(cursor, pLength);
+    STATISTICS_END_TIMER(lookup, STATISTICS_TIMER_FUNCTION);
+    if(index < 0)
+        return NULL;
+    
+    STATISTICS_COUNT(functionCounts[index], 1);
+    return GetMathFunction(index, kernelSet);
+}
+
+/** 区间归约的种类。积分与求根的参数形式与归约相同，所以也作为归约来解析 */
+enum REDUCTION_KIND
+{
+    REDUCTION_KIND_SUM,
+    REDUCTION_KIND_PROD,
+    REDUCTION_KIND_MIN,
+    REDUCTION_KIND_MAX,
+    
+    /** 在实数区间上的数值积分 */
+    REDUCTION_KIND_INTEGRATE,
+    
+    /** 在实数区间上求根 */
+    REDUCTION_KIND_SOLVE
+};
+
+/** 归约名，按REDUCTION_KIND的顺序排列 */
+static const char *const reductionNames[] = { "sum", "prod", "min", "max", "integrate", "solve" };
+
+/** 归约名的最大长度 */
+#define REDUCTION_NAME_MAX_LENGTH   9
+
+/**
+ * 查找归约名
+ * @param name 小写的名字，不必以'\0'结尾
+ * @param length 名字的字节数
+ * @return 若是归约名，返回其种类，否则返回-1
+*/
+static int FindReductionKind(const char *name, size_t length)
+{
+    for(var kind = 0; kind < (int)(sizeof(reductionNames) / sizeof(reductionNames[0])); kind++)
+    {
+        if(strlen(reductionNames[kind]) == length && memcmp(name, reductionNames[kind], length) == 0)
+            return kind;
+    }
+    return -1;
+}
+
+/**
+ * 判定当前游标处是否为归约调用，即归约名后面紧跟'('。
+ * 只有在ParseMathFunction失败之后才会调用它，所以不会影响普通表达式的解析
+ * @param cursor 指向名字的起始字符，已经过NormalizeArithmeticExpression过滤
+*/
+static bool IsReductionCall(const char *cursor)
+{
+    var length = 1;
+    while(length <= REDUCTION_NAME_MAX_LENGTH && IsMathFunctionNameCharacter(cursor[length]))
+        length++;
+    
+    return cursor[length] == '(' && FindReductionKind(cursor, length) >= 0;
+}
+
+// 归约的参数中可以再出现完整的表达式，所以它与EvaluateArithmeticSpan相互调用，其定义位于按列求值之后
+static bool EvaluateReduction(const char *expr, size_t length, enum MATH_KERNEL_SET kernelSet, double *pValue, size_t *pLength, struct CalculationError *pError);
+
+// 递归版本的解析只作为命令行程序中各项校验与性能测试的参照实现，
+// 库以及命令行的计算都使用后面的EvaluateArithmeticSpan
+#ifndef SIMPLE_CALCULATOR_LIBRARY
+
+/** 判定是否为有效操作符，这个区间范围内包含了常用的算术操作符、左右圆括号以及',' '.'等非法字符 */
+static inline bool IsOperator(char ch)
+{
+    return (ch >= '%' && ch <= '/') || ch == '^';
+}
+
+/** 解析过程中用于记录错误信息的上下文 */
+struct ParseContext
+{
+    /** 首个错误所在的位置 */
+    const char *errorCursor;
+    
+    enum CALCULATION_ERROR errorCode;
+};
+
+/** 记录解析错误，只保留最先发现的那个错误 */
+static inline void SetParseError(struct ParseContext *context, const char *cursor, enum CALCULATION_ERROR code)
+{
+    if(context != NULL && context->errorCode == CALCULATION_ERROR_NONE)
+    {
+        context->errorCursor = cursor;
+        context->errorCode = code;
+    }
+}
+
+/** 
+ * 解析当前的算术表达式
+ * @param ppCursor 指向当前算术表达式字符串的地址。
+ * 它既是输入又是输出。当当前算术表达式作为括号进行计算时，
+ * 需要将右括号的位置输出到实参。
+ * @param leftOperand 当前左操作数的值
+ * @param status 当前计算状态
+ * @param priority 当前计算的算术优先级
+ * @param pStatus 输出解析状态
+ * @param context 用于记录错误原因及位置，若不关心错误信息，可传NULL
+ * @return 输出计算表达式的结果
+*/
+static double ParseArithmeticExpression(const char **ppCursor, double leftOperand, enum PARSE_PHASE_STATUS status, enum OPERATOR_PRIORITY priority, bool *pStatus, struct ParseContext *context)
+{
+    const char *cursor = *ppCursor;
+    var rightOperand = 0.0;
+    
+    var length = 0;
+    
+    // 指向操作符函数的指针
+    double (*pOpFunc)(double, double) = NULL;
+    
+    // 指向数学函数的指针
     double (*pMathFunc)(double) = NULL;
     
     bool isSuccessful = true;
@@ -312,10 +2024,11 @@ static double ParseArithmeticExpression(const char **ppCursor, double leftOperan
         }
         else if(IsMathFunction(ch))
         {
-            pMathFunc = ParseMathFunction(cursor, &length);
+            pMathFunc = ParseMathFunction(cursor, &length, MATH_KERNEL_SET_LIBM);
             if(pMathFunc == NULL)
             {
                 // 如果数学函数返回空，说明解析失败，立即中断解析
+                SetParseError(context, cursor, CALCULATION_ERROR_UNKNOWN_FUNCTION);
                 isSuccessful = false;
                 break;
             }
@@ -323,6 +2036,7 @@ static double ParseArithmeticExpression(const char **ppCursor, double leftOperan
             if(*cursor != '(')
             {
                 // 如果函数后面没有跟(，那也不是一个合法的表达式，立即中断解析
+                SetParseError(context, cursor, CALCULATION_ERROR_MISSING_FUNCTION_ARGUMENT);
                 isSuccessful = false;
                 break;
             }
@@ -333,13 +2047,14 @@ static double ParseArithmeticExpression(const char **ppCursor, double leftOperan
             // 因此我们在这个分支中同时对这两类符号进行解析判断
             if(ch == '(')
             {
-                cursor++;
+                var parenthesis = cursor++;
                 
-                double value = ParseArithmeticExpression(&cursor, 0.0, PARSE_PHASE_STATUS_LEFT_OPERAND | PARSE_PHASE_STATUS_LEFT_PARENTHESIS, OPERATOR_PRIORITY_ADD, &isSuccessful);
+                double value = ParseArithmeticExpression(&cursor, 0.0, PARSE_PHASE_STATUS_LEFT_OPERAND | PARSE_PHASE_STATUS_LEFT_PARENTHESIS, OPERATOR_PRIORITY_ADD, &isSuccessful, context);
                 
                 // 如果当前游标所指向的字符不是')'，说明没有匹配到合适的)，中断解析
                 if(!isSuccessful || *cursor != ')')
                 {
+                    SetParseError(context, parenthesis, CALCULATION_ERROR_UNMATCHED_PARENTHESIS);
                     isSuccessful = false;
                     break;
                 }
@@ -392,32 +2107,33 @@ static double ParseArithmeticExpression(const char **ppCursor, double leftOperan
                            status |= PARSE_PHASE_STATUS_HAS_NEG;
                         else
                         {
+                            SetParseError(context, cursor, CALCULATION_ERROR_UNEXPECTED_OPERATOR);
                             isSuccessful = false;
                             break;
                         }
                     }
                     else
                     {
-                        // 对于其他情况，如果当前状态不需要操作符，那么表达式非法，立即中断解析
+                        // 对于其他情况，如果当前状态不需要操作符，那么表达式非法，立即中断解析。
+                        // 不对应任何操作符函数的字符（比如','和'.'）则属于非法字符
+                        SetParseError(context, cursor, (GetOperatorInfo(ch)->pFunc == NULL)? CALCULATION_ERROR_INVALID_CHARACTER : CALCULATION_ERROR_UNEXPECTED_OPERATOR);
                         isSuccessful = false;
                         break;
                     }
                 }
                 else
                 {
-                    var tmpFunc = opFuncTables[ch - '%'];
+                    const var info = GetOperatorInfo(ch);
+                    var tmpFunc = info->pFunc;
                     if(tmpFunc == NULL)
                     {
                         // 如果没找到对应的操纵符函数，说明当前输入字符是非法的，直接中断解析
+                        SetParseError(context, cursor, CALCULATION_ERROR_INVALID_CHARACTER);
                         isSuccessful = false;
                         break;
                     }
-                    // 判定当前操作符的计算优先级
-                    var pry = OPERATOR_PRIORITY_ADD;
-                    if(tmpFunc == ModOp || tmpFunc == MulOp || tmpFunc == DivOp)
-                        pry = OPERATOR_PRIORITY_MUL;
-                    else if(tmpFunc == pow)
-                        pry = OPERATOR_PRIORITY_POW;
+                    // 当前操作符的计算优先级
+                    var pry = info->priority;
                     
                     if(pOpFunc == NULL)
                         pOpFunc = tmpFunc;
@@ -429,8 +2145,8 @@ static double ParseArithmeticExpression(const char **ppCursor, double leftOperan
                     }
                     else
                     {
-                        // 如果之前优先级不小于当前操作符的优先级，那么立即做归约
-                        if(priority >= pry)
+                        // 如果之前优先级不小于当前操作符的优先级（对右结合的操作符则是高于），那么立即做归约
+                        if(priority >= info->reducePriority)
                         {
                             leftOperand = pOpFunc(leftOperand, rightOperand);
                             rightOperand = 0.0;
@@ -457,7 +2173,7 @@ static double ParseArithmeticExpression(const char **ppCursor, double leftOperan
                             }
                             
                             // 递归做高优先级的运算操作
-                            var value = ParseArithmeticExpression(&cursor, rightOperand, PARSE_PHASE_STATUS_LEFT_OPERAND | PARSE_PHASE_STATUS_NEED_OPERATOR, pry, pStatus);
+                            var value = ParseArithmeticExpression(&cursor, rightOperand, PARSE_PHASE_STATUS_LEFT_OPERAND | PARSE_PHASE_STATUS_NEED_OPERATOR, pry, pStatus, context);
                             
                             // 由于我们可能会碰到在括号操作符中的高优先级运算的归约，
                             // 比如考虑这个表达式：(1+2*3)
@@ -482,6 +2198,7 @@ static double ParseArithmeticExpression(const char **ppCursor, double leftOperan
             // 如果遇到其他字符，倘若不是字符串结束符则宣告解析失败
             if(ch != '\0')
             {
+                SetParseError(context, cursor, CALCULATION_ERROR_INVALID_CHARACTER);
                 isSuccessful = false;
                 break;
             }
@@ -499,85 +2216,13322 @@ static double ParseArithmeticExpression(const char **ppCursor, double leftOperan
     return (pOpFunc == NULL)? leftOperand : pOpFunc(leftOperand, rightOperand);
 }
 
+#endif  // !SIMPLE_CALCULATOR_LIBRARY
+
 /**
- * 计算输入的算术表达式
- * @param expr 输入的算术表达式字符串
- * @param result 以字符串的形式输出结果，这里设置了实参至少需要提供的缓存长度
- * @return 如果表达式解析成功，返回true，否则返回false
+ * 对输入字符串做一些过滤，使得当中出现的一些符号能适配本程序
+ * @param dst 存放过滤结果的缓存，至少包含length个字节，它可以与src相同，此时过滤结果直接写回原字符串
+ * @param src 需要过滤的算术表达式字符串
+ * @param length 表达式字符串的长度
 */
-bool CalculateArithmeticExpression(char expr[], char result[static 32])
+static void NormalizeArithmeticExpression(char dst[], const char src[], size_t length)
 {
-    if(expr[0] == '\0')
-        return false;
-    
-    /*** 我们先对输入字符串做一些过滤，使得当中出现的一些符号能适配本程序 */
-    var length = (int)strlen(expr);
-    
     // 由于一些命令控制台不支持带有圆括号()的表达式，但支持方括号[]表达式，
     // 所以我们这里可以将输入中的[]再替换回()。
     // 此外，我们将出现的所有大写字母替换为小写字母
-    for(var i = 0; i < length; i++)
+    for(size_t i = 0; i < length; i++)
     {
-        var ch = expr[i];
+        var ch = src[i];
 
         switch(ch)
         {
         case '[':
-            expr[i] = '(';
+            ch = '(';
             break;
         case ']':
-            expr[i] = ')';
+            ch = ')';
             break;
         case '$':
-            expr[i] = '^';
+            ch = '^';
             break;
         case 'A' ... 'Z':
-            expr[i] += 0x20;
+            ch += 0x20;
             break;
         }
+        
+        dst[i] = ch;
     }
+}
+
+/** 预检时一次处理的字节数 */
+#define PRESCAN_VECTOR_LENGTH       16
+
+/** 预检所使用的字节向量，在x86-64上对应于SSE2寄存器，在其他平台上由编译器选择合适的指令 */
+typedef uint8_t PrescanVector __attribute__((vector_size(PRESCAN_VECTOR_LENGTH)));
+typedef int8_t PrescanSignedVector __attribute__((vector_size(PRESCAN_VECTOR_LENGTH)));
+
+/** 从两个向量中按下标选取字节组成新的向量，下标不小于PRESCAN_VECTOR_LENGTH的字节取自b */
+#if defined(__clang__)
+#define SHUFFLE_PRESCAN_VECTOR(a, b, ...)   __builtin_shufflevector(a, b, __VA_ARGS__)
+#else
+#define SHUFFLE_PRESCAN_VECTOR(a, b, ...)   __builtin_shuffle(a, b, (PrescanSignedVector){ __VA_ARGS__ })
+#endif
+
+/** 判定向量中的每个字节是否位于[low, high]之间，是则对应的字节为0xff，否则为0 */
+static inline PrescanVector IsPrescanVectorInRange(PrescanVector v, uint8_t low, uint8_t high)
+{
+    return (PrescanVector)(v - low <= (uint8_t)(high - low));
+}
+
+/** 将向量中mask为0xff的字节替换为ch */
+static inline PrescanVector ReplacePrescanVectorBytes(PrescanVector v, PrescanVector mask, uint8_t ch)
+{
+    return (v & ~mask) | (mask & ch);
+}
+
+/** 判定向量中的所有字节是否都为0 */
+static inline bool IsPrescanVectorZero(PrescanVector v)
+{
+    uint64_t halves[2];
+    memcpy(halves, &v, sizeof(halves));
+    return (halves[0] | halves[1]) == 0;
+}
+
+/** 预检时逐字节查表所用的字符表，合法字符的adjustment为过滤之后的字符与原字符之差 */
+static const struct
+{
+    bool isValid;
+    int8_t adjustment;
+} prescanCharacters[256] = {
+    ['0' ... '9'] = { true, 0 },
+    ['a' ... 'z'] = { true, 0 },
+    ['A' ... 'Z'] = { true, 'a' - 'A' },
+    ['.'] = { true, 0 },
+    ['%'] = { true, 0 },
+    ['*'] = { true, 0 },
+    ['+'] = { true, 0 },
+    ['-'] = { true, 0 },
+    ['/'] = { true, 0 },
+    ['^'] = { true, 0 },
+    ['('] = { true, 0 },
+    [')'] = { true, 0 },
+    ['['] = { true, '(' - '[' },
+    [']'] = { true, ')' - ']' },
+    ['$'] = { true, '^' - '$' },
+    [','] = { true, 0 },
+    ['_'] = { true, 0 }
+};
+
+/**
+ * 对批量输入的表达式做预检：以PRESCAN_VECTOR_LENGTH个字节为单位，完成与NormalizeArithmeticExpression相同的过滤，
+ * 同时检查其中是否含有不可能出现在合法表达式中的字符，并用前缀和检查圆括号是否配对。
+ * 表达式中的每个字符都会被某个记号所读取，而每个'('与')'都会使求值栈压入或弹出一层，
+ * 所以被预检拒绝的表达式一定也会被EvaluateArithmeticSpan拒绝，只是所报告的错误原因与位置未必相同，
+ * 因此只有不关心错误信息的调用者才能使用它
+ * @param dst 存放过滤结果的缓存，至少包含length个字节，它可以与src相同。预检失败时其内容不确定
+ * @param src 需要预检的算术表达式字符串
+ * @param length 表达式字符串的长度
+ * @return 若表达式中没有非法字符，并且括号配对，返回true，否则返回false
+*/
+static bool PrevalidateArithmeticExpression(char dst[], const char src[], size_t length)
+{
+    const PrescanSignedVector zero = { 0 };
+    long depth = 0;
+    size_t offset = 0;
     
-    bool ret = false;
-    
-    var value = ParseArithmeticExpression((const char**)&expr, 0.0, PARSE_PHASE_STATUS_LEFT_OPERAND, OPERATOR_PRIORITY_ADD, &ret);
-    
-    if(!ret)
-        return ret;
-    
-    // 我们将结果显示为小数点后面跟8位尾数
-    sprintf(result, "%.8f", value);
+    for(; offset + PRESCAN_VECTOR_LENGTH <= length; offset += PRESCAN_VECTOR_LENGTH)
+    {
+        PrescanVector v;
+        memcpy(&v, &src[offset], sizeof(v));
+        
+        // 合法字符为过滤之前的数字、字母、'.'、操作符、各种括号以及区间归约中所用的','与'_'，这里将它们合并为5个区间：
+        // "$%"、"()*+,-./0123456789"、"A...Z["、"]^_"以及"a...z"
+        var isValid = IsPrescanVectorInRange(v, '$', '%') | IsPrescanVectorInRange(v, '(', '9') | IsPrescanVectorInRange(v, 'A', '[') |
+                      IsPrescanVectorInRange(v, ']', '_') | IsPrescanVectorInRange(v, 'a', 'z');
+        if(!IsPrescanVectorZero(~isValid))
+            return false;
+        
+        v += IsPrescanVectorInRange(v, 'A', 'Z') & (uint8_t)0x20;
+        v = ReplacePrescanVectorBytes(v, (PrescanVector)(v == (uint8_t)'['), '(');
+        v = ReplacePrescanVectorBytes(v, (PrescanVector)(v == (uint8_t)']'), ')');
+        v = ReplacePrescanVectorBytes(v, (PrescanVector)(v == (uint8_t)'$'), '^');
+        memcpy(&dst[offset], &v, sizeof(v));
+        
+        // '('为+1，')'为-1，没有括号的向量不必计算前缀和
+        var delta = (PrescanSignedVector)(v == (uint8_t)')') - (PrescanSignedVector)(v == (uint8_t)'(');
+        if(IsPrescanVectorZero((PrescanVector)delta))
+            continue;
+        
+        // 向量内的前缀和，每一步将向量整体移动1、2、4、8个字节之后再累加
+        delta += SHUFFLE_PRESCAN_VECTOR(delta, zero, 16, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14);
+        delta += SHUFFLE_PRESCAN_VECTOR(delta, zero, 16, 16, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13);
+        delta += SHUFFLE_PRESCAN_VECTOR(delta, zero, 16, 16, 16, 16, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11);
+        delta += SHUFFLE_PRESCAN_VECTOR(delta, zero, 16, 16, 16, 16, 16, 16, 16, 16, 0, 1, 2, 3, 4, 5, 6, 7);
+        
+        // 前缀和加上之前的深度不能小于0，否则就有')'没有与之匹配的'('。
+        // 向量内的前缀和不小于-PRESCAN_VECTOR_LENGTH，所以只有当之前的深度较小时才需要逐字节比较
+        if(depth < PRESCAN_VECTOR_LENGTH)
+        {
+            var isNegative = (delta + (int8_t)depth) < zero;
+            if(!IsPrescanVectorZero((PrescanVector)isNegative))
+                return false;
+        }
+        
+        depth += delta[PRESCAN_VECTOR_LENGTH - 1];
+    }
+    
+    // 不足一个向量的尾部逐字节查表处理。批量输入中的大多数行都很短，这样可以避免拼凑向量的开销
+    for(; offset < length; offset++)
+    {
+        var ch = src[offset];
+        const var entry = prescanCharacters[(uint8_t)ch];
+        if(!entry.isValid)
+            return false;
+        
+        ch += entry.adjustment;
+        dst[offset] = ch;
+        
+        if(ch == '(')
+            depth++;
+        else if(ch == ')' && --depth < 0)
+            return false;
+    }
+    
+    return depth == 0;
+}
+
+/**
+ * 初始化工作区
+ * @param arena 需要初始化的工作区
+ * @param memory 由调用者提供的存储空间，工作区并不拥有它，也不会释放它
+ * @param capacity 存储空间的字节数
+*/
+void InitCalculationArena(struct CalculationArena *arena, void *memory, size_t capacity)
+{
+    arena->memory = (unsigned char*)memory;
+    arena->capacity = (memory == NULL)? 0 : capacity;
+    arena->used = 0;
+}
+
+/**
+ * 从工作区中分配存储空间
+ * @param alignment 对齐字节数，必须是2的幂
+ * @return 所分配的存储空间，若工作区剩余空间不足，返回NULL
+*/
+static void* AllocateFromCalculationArena(struct CalculationArena *arena, size_t size, size_t alignment)
+{
+    var padding = (size_t)(-(uintptr_t)(arena->memory + arena->used) & (alignment - 1));
+    var available = arena->capacity - arena->used;
+    if(padding > available || size > available - padding)
+        return NULL;
+    
+    void *memory = arena->memory + arena->used + padding;
+    arena->used += padding + size;
+    
+    return memory;
+}
+
+/** 迭代求值时，预读窗口的初始字节数。窗口只有在遇到更长的数字字面量时才会扩大 */
+#define EVALUATION_WINDOW_SIZE          256
+
+/** 窗口中当前位置之后至少要保留的已读字符个数，它不小于除数字字面量以外所有记号的最大预读长度 */
+#define EVALUATION_WINDOW_LOOKAHEAD     16
+
+/** 窗口末尾所填充的'\0'个数。解析数字字面量时，最多会越过字面量末尾再读取两个字符 */
+#define EVALUATION_WINDOW_PADDING       3
+
+/** 迭代求值时，函数栈上用于存放求值栈的初始字节数 */
+#define EVALUATION_STACK_SIZE           1024
+
+/**
+ * 迭代求值时，进入左括号之前所保存的外层状态，
+ * 各个成员与ParseArithmeticExpression中的局部变量一一对应
+*/
+struct EvaluationFrame
+{
+    double leftOperand;
+    double rightOperand;
+    double (*pOpFunc)(double, double);
+    double (*pMathFunc)(double);
+    
+    /** 外层括号的左括号相对于表达式起始处的字节偏移 */
+    size_t parenthesisOffset;
+    
+    /** 外层括号中尚未归约的左操作数个数 */
+    size_t pendingCount;
+    
+    enum PARSE_PHASE_STATUS status;
+    enum OPERATOR_PRIORITY priority;
+};
+
+/**
+ * 碰到优先级更高的操作符时，尚待与右侧结果归约的左操作数。
+ * 它对应于ParseArithmeticExpression中递归做高优先级运算之后的pOpFunc(leftOperand, value)
+*/
+struct PendingOperand
+{
+    double leftOperand;
+    double (*pOpFunc)(double, double);
+};
+
+/** 迭代求值时所使用的可扩展缓存，其初始空间位于函数栈上 */
+struct EvaluationBuffer
+{
+    unsigned char *memory;
+    size_t capacity;
+    
+    /** memory是否由malloc分配 */
+    bool isAllocated;
+};
+
+/**
+ * 将缓存扩大到至少minCapacity个字节，并保留原先的前size个字节
+ * @param arena 若不为NULL，则新的空间从工作区中分配，否则从堆上分配
+ * @return 若存储空间不足，返回false
+*/
+static bool GrowEvaluationBuffer(struct EvaluationBuffer *buffer, struct CalculationArena *arena, size_t size, size_t minCapacity)
+{
+    var capacity = buffer->capacity * 2;
+    if(capacity < minCapacity)
+        capacity = minCapacity;
+    
+    unsigned char *memory;
+    if(arena != NULL)
+        memory = (unsigned char*)AllocateFromCalculationArena(arena, capacity, 16);
+    else
+        memory = (unsigned char*)(buffer->isAllocated? realloc(buffer->memory, capacity) : malloc(capacity));
+    
+    if(memory == NULL)
+        return false;
+    
+    if(arena != NULL || !buffer->isAllocated)
+        memcpy(memory, buffer->memory, size);
+    
+    buffer->memory = memory;
+    buffer->capacity = capacity;
+    buffer->isAllocated = arena == NULL;
+    
+    return true;
+}
+
+/** 迭代求值时按顺序读取输入表达式的预读窗口，窗口中存放的是已经过滤过的字符 */
+struct EvaluationReader
+{
+    const char *expr;
+    size_t length;
+    
+    struct EvaluationBuffer window;
+    
+    /** 窗口起始处相对于表达式起始处的字节偏移 */
+    size_t windowOffset;
+    
+    /** 窗口中已读入的字符个数 */
+    size_t windowLength;
+    
+    /** 下一个尚未读入窗口的字符的偏移 */
+    size_t inputOffset;
+};
+
+/** 丢弃窗口中keepFrom之前的字符，并用后续输入将窗口填满 */
+static void SlideEvaluationWindow(struct EvaluationReader *reader, size_t keepFrom)
+{
+    var buffer = (char*)reader->window.memory;
+    var keepLength = reader->windowLength - keepFrom;
+    memmove(buffer, buffer + keepFrom, keepLength);
+    reader->windowOffset += keepFrom;
+    
+    var count = reader->window.capacity - EVALUATION_WINDOW_PADDING - keepLength;
+    if(count > reader->length - reader->inputOffset)
+        count = reader->length - reader->inputOffset;
+    
+    NormalizeArithmeticExpression(buffer + keepLength, reader->expr + reader->inputOffset, count);
+    reader->inputOffset += count;
+    reader->windowLength = keepLength + count;
+    memset(buffer + reader->windowLength, 0, EVALUATION_WINDOW_PADDING);
+}
+
+/** 返回窗口中不必滑动即可继续解析的最大位置 */
+static inline size_t GetEvaluationSlideLimit(const struct EvaluationReader *reader)
+{
+    if(reader->inputOffset == reader->length)
+        return SIZE_MAX;
+    
+    return reader->windowLength - EVALUATION_WINDOW_LOOKAHEAD;
+}
+
+/** 确保求值栈还能再容纳size个字节 */
+static inline bool ReserveEvaluationStack(struct EvaluationBuffer *stack, struct CalculationArena *arena, size_t top, size_t size)
+{
+    return top + size <= stack->capacity || GrowEvaluationBuffer(stack, arena, top, top + size);
+}
+
+/**
+ * 以迭代的方式计算算术表达式，其解析规则以及计算顺序与ParseArithmeticExpression完全相同，因此结果逐位相同。
+ * 递归版本中每个左括号以及每次优先级的提升都会产生一层函数调用，这里则将它们保存在显式的求值栈上：
+ * 进入左括号时保存外层状态，碰到更高优先级的操作符时保存尚待归约的左操作数。
+ * 输入通过一个预读窗口读取，所以存储空间的占用与括号嵌套深度以及尚待归约的左操作数个数成正比。
+ * 后者在1+2*3+4*5这样的扁平表达式中会随长度增长，每个占16个字节；除此之外只有很长的数字字面量会使窗口扩大
+ * @param expr 输入的算术表达式，它不必以'\0'结尾，但其中不能包含'\0'
+ * @param length 表达式的字节数
+ * @param isNormalized 表达式是否已经过NormalizeArithmeticExpression过滤并以'\0'结尾，
+ * 若是，则直接在表达式上解析，而不必经由预读窗口
+ * @param kernelSet 数学函数的实现方式，只有MATH_KERNEL_SET_LIBM的结果才与ParseArithmeticExpression逐位相同
+ * @param arena 若不为NULL，则超出函数栈上初始空间的部分从工作区中分配，否则从堆上分配
+ * @param pValue 输出计算结果
+ * @param pError 若不为NULL，则输出错误原因以及出错位置
+ * @param pPeakMemory 若不为NULL，则输出求值过程中预读窗口与求值栈所占用的最大字节数
+ * @return 如果表达式解析成功，返回true，否则返回false
+*/
+static bool EvaluateArithmeticSpan(const char *expr, size_t length, bool isNormalized, enum MATH_KERNEL_SET kernelSet, struct CalculationArena *arena, double *pValue, struct CalculationError *pError, size_t *pPeakMemory)
+{
+    alignas(16) unsigned char localWindow[EVALUATION_WINDOW_SIZE + EVALUATION_WINDOW_PADDING];
+    alignas(16) unsigned char localStack[EVALUATION_STACK_SIZE];
+    
+    struct EvaluationReader reader = { expr, length, { localWindow, sizeof(localWindow), false }, 0, 0, 0 };
+    struct EvaluationBuffer stack = { localStack, sizeof(localStack), false };
+    size_t stackTop = 0;
+    size_t peakStackTop = 0;
+    var savedUsed = (arena != NULL)? arena->used : 0;
+    STATISTICS_BEGIN_TIMER(evaluation);
+    
+    struct CalculationError error = { CALCULATION_ERROR_NONE, 0 };
+    var result = 0.0;
+    
+    // 当前括号层的状态，与ParseArithmeticExpression中的局部变量一一对应
+    var leftOperand = 0.0;
+    var rightOperand = 0.0;
+    double (*pOpFunc)(double, double) = NULL;
+    double (*pMathFunc)(double) = NULL;
+    enum PARSE_PHASE_STATUS status = PARSE_PHASE_STATUS_LEFT_OPERAND;
+    var priority = OPERATOR_PRIORITY_ADD;
+    size_t parenthesisOffset = 0;
+    size_t pendingCount = 0;
+    size_t depth = 0;
+    
+    if(isNormalized)
+    {
+        // 整个表达式就是一个已经读满的窗口，窗口不会再滑动，也不会扩大
+        reader.window = (struct EvaluationBuffer){ (unsigned char*)expr, length + 1, false };
+        reader.windowLength = length;
+        reader.inputOffset = length;
+    }
+    else
+        SlideEvaluationWindow(&reader, 0);
+    size_t position = 0;
+    
+    // 当前位置超过slideLimit时需要滑动窗口；输入全部读入窗口之后就不会再滑动
+    var slideLimit = GetEvaluationSlideLimit(&reader);
+    
+    while(true)
+    {
+        // 确保当前位置之后有足够的已读字符可供预读
+        if(position > slideLimit)
+        {
+            SlideEvaluationWindow(&reader, position);
+            slideLimit = GetEvaluationSlideLimit(&reader);
+            position = 0;
+        }
+        
+        const char *cursor = (const char*)reader.window.memory + position;
+        var ch = *cursor;
+        var charClass = GetCharacterClass(ch);
+        
+        if(charClass == CHARACTER_CLASS_DIGIT || (charClass == CHARACTER_CLASS_LETTER && IsMathConstant(cursor) > 0))
+        {
+            int tokenLength;
+            STATISTICS_BEGIN_TIMER(number);
+            var value = ParseDigital(cursor, &tokenLength);
+            STATISTICS_END_TIMER(number, STATISTICS_TIMER_NUMBER);
+            
+            // 数字字面量的解析可能读到了窗口末尾的填充字符，此时需要读入更多的字符后重新解析
+            while(position + tokenLength + EVALUATION_WINDOW_PADDING > reader.windowLength && reader.inputOffset < length)
+            {
+                if(position == 0)
+                {
+                    var capacity = reader.window.capacity * 2;
+                    if(!GrowEvaluationBuffer(&reader.window, arena, reader.windowLength, capacity))
+                    {
+                        error = (struct CalculationError){ CALCULATION_ERROR_OUT_OF_MEMORY, reader.windowOffset };
+                        break;
+                    }
+                }
+                SlideEvaluationWindow(&reader, position);
+                slideLimit = GetEvaluationSlideLimit(&reader);
+                position = 0;
+                cursor = (const char*)reader.window.memory;
+                value = ParseDigital(cursor, &tokenLength);
+            }
+            if(error.code != CALCULATION_ERROR_NONE)
+                break;
+            
+            position += tokenLength;
+            
+            if((status & PARSE_PHASE_STATUS_RIGHT_OPERAND) == PARSE_PHASE_STATUS_LEFT_OPERAND)
+                leftOperand = ((status & PARSE_PHASE_STATUS_HAS_NEG) != 0)? -value : value;
+            else
+                rightOperand = ((status & PARSE_PHASE_STATUS_HAS_NEG) != 0)? -value : value;
+            
+            status &= ~PARSE_PHASE_STATUS_HAS_NEG;
+            status |= PARSE_PHASE_STATUS_NEED_OPERATOR;
+        }
+        else if(charClass == CHARACTER_CLASS_LETTER)
+        {
+            int tokenLength;
+            pMathFunc = ParseMathFunction(cursor, &tokenLength, kernelSet);
+            if(pMathFunc == NULL && IsReductionCall(cursor))
+            {
+                // 归约的参数直接从原始输入中读取，结果与数字字面量一样作为操作数
+                var offset = reader.windowOffset + position;
+                double value;
+                size_t reductionLength;
+                if(!EvaluateReduction(expr + offset, length - offset, kernelSet, &value, &reductionLength, &error))
+                {
+                    error.offset += offset;
+                    break;
+                }
+                
+                // 归约可能跨越了窗口末尾，此时从归约之后的位置重新填充窗口
+                offset += reductionLength;
+                if(offset <= reader.windowOffset + reader.windowLength)
+                    position = offset - reader.windowOffset;
+                else
+                {
+                    reader.windowOffset = offset;
+                    reader.windowLength = 0;
+                    reader.inputOffset = offset;
+                    SlideEvaluationWindow(&reader, 0);
+                    slideLimit = GetEvaluationSlideLimit(&reader);
+                    position = 0;
+                }
+                
+                if((status & PARSE_PHASE_STATUS_RIGHT_OPERAND) == PARSE_PHASE_STATUS_LEFT_OPERAND)
+                    leftOperand = value;
+                else
+                    rightOperand = value;
+                
+                status |= PARSE_PHASE_STATUS_NEED_OPERATOR;
+                continue;
+            }
+            if(pMathFunc == NULL)
+            {
+                error = (struct CalculationError){ CALCULATION_ERROR_UNKNOWN_FUNCTION, reader.windowOffset + position };
+                break;
+            }
+            position += tokenLength;
+            if(cursor[tokenLength] != '(')
+            {
+                error = (struct CalculationError){ CALCULATION_ERROR_MISSING_FUNCTION_ARGUMENT, reader.windowOffset + position };
+                break;
+            }
+        }
+        else if(charClass == CHARACTER_CLASS_LEFT_PARENTHESIS)
+        {
+            // 保存外层状态，开始一个新的括号层
+            if(!ReserveEvaluationStack(&stack, arena, stackTop, sizeof(struct EvaluationFrame)))
+            {
+                error = (struct CalculationError){ CALCULATION_ERROR_OUT_OF_MEMORY, reader.windowOffset + position };
+                break;
+            }
+            *(struct EvaluationFrame*)(stack.memory + stackTop) = (struct EvaluationFrame){
+                leftOperand, rightOperand, pOpFunc, pMathFunc, parenthesisOffset, pendingCount, status, priority
+            };
+            stackTop += sizeof(struct EvaluationFrame);
+            depth++;
+            STATISTICS_RECORD_DEPTH(depth);
+            if(stackTop > peakStackTop)
+                peakStackTop = stackTop;
+            
+            leftOperand = 0.0;
+            rightOperand = 0.0;
+            pOpFunc = NULL;
+            pMathFunc = NULL;
+            status = PARSE_PHASE_STATUS_LEFT_OPERAND | PARSE_PHASE_STATUS_LEFT_PARENTHESIS;
+            priority = OPERATOR_PRIORITY_ADD;
+            parenthesisOffset = reader.windowOffset + position;
+            pendingCount = 0;
+            position++;
+        }
+        else if(charClass == CHARACTER_CLASS_RIGHT_PARENTHESIS || charClass == CHARACTER_CLASS_END)
+        {
+            // 当前括号层结束，先按后进先出的顺序与尚待归约的左操作数依次归约
+            var value = (pOpFunc != NULL)? pOpFunc(leftOperand, rightOperand) : leftOperand;
+            for(; pendingCount > 0; pendingCount--)
+            {
+                stackTop -= sizeof(struct PendingOperand);
+                var pending = (const struct PendingOperand*)(stack.memory + stackTop);
+                value = pending->pOpFunc(pending->leftOperand, value);
+            }
+            
+            if(depth == 0)
+            {
+                // 最外层碰到')'说明它没有与之匹配的'('
+                if(ch == ')')
+                    error = (struct CalculationError){ CALCULATION_ERROR_UNMATCHED_PARENTHESIS, reader.windowOffset + position };
+                else
+                    result = value;
+                break;
+            }
+            
+            if(ch == '\0')
+            {
+                error = (struct CalculationError){ CALCULATION_ERROR_UNMATCHED_PARENTHESIS, parenthesisOffset };
+                break;
+            }
+            
+            // 恢复外层状态，并把括号内的结果作为外层的操作数
+            stackTop -= sizeof(struct EvaluationFrame);
+            depth--;
+            const var frame = *(const struct EvaluationFrame*)(stack.memory + stackTop);
+            leftOperand = frame.leftOperand;
+            rightOperand = frame.rightOperand;
+            pOpFunc = frame.pOpFunc;
+            pMathFunc = frame.pMathFunc;
+            status = frame.status;
+            priority = frame.priority;
+            parenthesisOffset = frame.parenthesisOffset;
+            pendingCount = frame.pendingCount;
+            
+            if(pMathFunc != NULL)
+            {
+                value = pMathFunc(value);
+                pMathFunc = NULL;
+            }
+            
+            if((status & PARSE_PHASE_STATUS_RIGHT_OPERAND) == 0)
+                leftOperand = value;
+            else
+                rightOperand = value;
+            
+            status &= ~PARSE_PHASE_STATUS_LEFT_PARENTHESIS;
+            status |= PARSE_PHASE_STATUS_NEED_OPERATOR;
+            position++;
+        }
+        else if(charClass == CHARACTER_CLASS_OPERATOR)
+        {
+            if((status & PARSE_PHASE_STATUS_NEED_OPERATOR) == 0)
+            {
+                // 作为负数符号的减号后面必须跟一个数
+                if(ch != '-' || !(IsDigital(cursor[1]) || IsMathConstant(&cursor[1]) > 0))
+                {
+                    error = (struct CalculationError){ CALCULATION_ERROR_UNEXPECTED_OPERATOR, reader.windowOffset + position };
+                    break;
+                }
+                status |= PARSE_PHASE_STATUS_HAS_NEG;
+                STATISTICS_COUNT(negationCount, 1);
+            }
+            else
+            {
+                const var info = GetOperatorInfo(ch);
+                STATISTICS_COUNT(operatorCounts[(uint8_t)ch], 1);
+                var tmpFunc = info->pFunc;
+                var pry = info->priority;
+                
+                if(pOpFunc == NULL)
+                    pOpFunc = tmpFunc;
+                
+                if((status & PARSE_PHASE_STATUS_RIGHT_OPERAND) == 0)
+                    status |= PARSE_PHASE_STATUS_RIGHT_OPERAND;
+                else if(priority >= info->reducePriority)
+                {
+                    leftOperand = pOpFunc(leftOperand, rightOperand);
+                    rightOperand = 0.0;
+                    pOpFunc = tmpFunc;
+                }
+                else
+                {
+                    // 与递归版本一样，减法与除法分别转换为加上相反数与乘以倒数
+                    if(pOpFunc == MinusOp)
+                    {
+                        pOpFunc = AddOp;
+                        rightOperand = -rightOperand;
+                    }
+                    else if(pOpFunc == DivOp)
+                    {
+                        pOpFunc = MulOp;
+                        rightOperand = 1.0 / rightOperand;
+                    }
+                    
+                    // 递归版本在这里会以右操作数作为左操作数做高优先级的运算，
+                    // 并在返回后立即与当前的左操作数归约，所以只需将当前的左操作数压栈，
+                    // 然后在同一个括号层中继续解析，当前的操作符则留给高优先级的运算来处理
+                    if(!ReserveEvaluationStack(&stack, arena, stackTop, sizeof(struct PendingOperand)))
+                    {
+                        error = (struct CalculationError){ CALCULATION_ERROR_OUT_OF_MEMORY, reader.windowOffset + position };
+                        break;
+                    }
+                    *(struct PendingOperand*)(stack.memory + stackTop) = (struct PendingOperand){ leftOperand, pOpFunc };
+                    stackTop += sizeof(struct PendingOperand);
+                    pendingCount++;
+                    
+                    leftOperand = rightOperand;
+                    rightOperand = 0.0;
+                    pOpFunc = NULL;
+                    status = PARSE_PHASE_STATUS_LEFT_OPERAND | PARSE_PHASE_STATUS_NEED_OPERATOR;
+                    priority = pry;
+                    
+                    if(stackTop > peakStackTop)
+                        peakStackTop = stackTop;
+                    continue;
+                }
+                priority = pry;
+            }
+            status &= ~PARSE_PHASE_STATUS_NEED_OPERATOR;
+            position++;
+        }
+        else
+        {
+            error = (struct CalculationError){ CALCULATION_ERROR_INVALID_CHARACTER, reader.windowOffset + position };
+            break;
+        }
+    }
+    
+    if(pPeakMemory != NULL)
+        *pPeakMemory = reader.window.capacity + peakStackTop;
+    
+    if(reader.window.isAllocated)
+        free(reader.window.memory);
+    if(stack.isAllocated)
+        free(stack.memory);
+    if(arena != NULL)
+        arena->used = savedUsed;
+    
+    STATISTICS_COUNT(expressionCount, 1);
+    STATISTICS_COUNT(byteCount, length);
+    if(error.code != CALCULATION_ERROR_NONE)
+        STATISTICS_COUNT(errorCounts[error.code], 1);
+    STATISTICS_END_TIMER(evaluation, STATISTICS_TIMER_EVALUATE);
+    
+    if(pError != NULL)
+        *pError = error;
+    
+    if(error.code != CALCULATION_ERROR_NONE)
+        return false;
+    
+    *pValue = result;
+    return true;
+}
+
+/** 精确整数模式下迭代求值时的外层状态，与EvaluationFrame一一对应 */
+struct ExactEvaluationFrame
+{
+    struct ExactNumber leftOperand;
+    struct ExactNumber rightOperand;
+    struct ExactNumber (*pOpFunc)(struct ExactNumber, struct ExactNumber);
+    double (*pMathFunc)(double);
+    size_t parenthesisOffset;
+    size_t pendingCount;
+    enum PARSE_PHASE_STATUS status;
+    enum OPERATOR_PRIORITY priority;
+};
+
+/** 精确整数模式下尚待归约的左操作数，与PendingOperand一一对应 */
+struct ExactPendingOperand
+{
+    struct ExactNumber leftOperand;
+    struct ExactNumber (*pOpFunc)(struct ExactNumber, struct ExactNumber);
+};
+
+/**
+ * 以精确整数模式迭代计算算术表达式。解析规则、计算顺序以及预读窗口与求值栈的用法都与EvaluateArithmeticSpan完全相同，
+ * 只是操作数带有是否为精确整数的标记，并使用各操作符的pExactFunc进行计算。
+ * 因此所有中间结果的绝对值都不超过2^53时，两者的结果相同；超过时，这里的整数结果仍是精确的
+ * @param expr 输入的算术表达式，它不必以'\0'结尾，但其中不能包含'\0'
+ * @param length 表达式的字节数
+ * @param isNormalized 表达式是否已经过NormalizeArithmeticExpression过滤并以'\0'结尾
+ * @param kernelSet 数学函数的实现方式
+ * @param arena 若不为NULL，则超出函数栈上初始空间的部分从工作区中分配，否则从堆上分配
+ * @param pValue 输出计算结果
+ * @param pError 若不为NULL，则输出错误原因以及出错位置
+ * @return 如果表达式解析成功，返回true，否则返回false
+*/
+static bool EvaluateExactArithmeticSpan(const char *expr, size_t length, bool isNormalized, enum MATH_KERNEL_SET kernelSet, struct CalculationArena *arena, struct ExactNumber *pValue, struct CalculationError *pError)
+{
+    alignas(16) unsigned char localWindow[EVALUATION_WINDOW_SIZE + EVALUATION_WINDOW_PADDING];
+    alignas(16) unsigned char localStack[EVALUATION_STACK_SIZE];
+    
+    struct EvaluationReader reader = { expr, length, { localWindow, sizeof(localWindow), false }, 0, 0, 0 };
+    struct EvaluationBuffer stack = { localStack, sizeof(localStack), false };
+    size_t stackTop = 0;
+    var savedUsed = (arena != NULL)? arena->used : 0;
+    STATISTICS_BEGIN_TIMER(evaluation);
+    
+    struct CalculationError error = { CALCULATION_ERROR_NONE, 0 };
+    var result = MakeExactInteger(0);
+    
+    var leftOperand = MakeExactInteger(0);
+    var rightOperand = MakeExactInteger(0);
+    struct ExactNumber (*pOpFunc)(struct ExactNumber, struct ExactNumber) = NULL;
+    double (*pMathFunc)(double) = NULL;
+    enum PARSE_PHASE_STATUS status = PARSE_PHASE_STATUS_LEFT_OPERAND;
+    var priority = OPERATOR_PRIORITY_ADD;
+    size_t parenthesisOffset = 0;
+    size_t pendingCount = 0;
+    size_t depth = 0;
+    
+    if(isNormalized)
+    {
+        reader.window = (struct EvaluationBuffer){ (unsigned char*)expr, length + 1, false };
+        reader.windowLength = length;
+        reader.inputOffset = length;
+    }
+    else
+        SlideEvaluationWindow(&reader, 0);
+    size_t position = 0;
+    var slideLimit = GetEvaluationSlideLimit(&reader);
+    
+    while(true)
+    {
+        if(position > slideLimit)
+        {
+            SlideEvaluationWindow(&reader, position);
+            slideLimit = GetEvaluationSlideLimit(&reader);
+            position = 0;
+        }
+        
+        const char *cursor = (const char*)reader.window.memory + position;
+        var ch = *cursor;
+        var charClass = GetCharacterClass(ch);
+        
+        if(charClass == CHARACTER_CLASS_DIGIT || (charClass == CHARACTER_CLASS_LETTER && IsMathConstant(cursor) > 0))
+        {
+            int tokenLength;
+            STATISTICS_BEGIN_TIMER(number);
+            var value = ParseExactDigital(cursor, &tokenLength);
+            STATISTICS_END_TIMER(number, STATISTICS_TIMER_NUMBER);
+            
+            while(position + tokenLength + EVALUATION_WINDOW_PADDING > reader.windowLength && reader.inputOffset < length)
+            {
+                if(position == 0)
+                {
+                    var capacity = reader.window.capacity * 2;
+                    if(!GrowEvaluationBuffer(&reader.window, arena, reader.windowLength, capacity))
+                    {
+                        error = (struct CalculationError){ CALCULATION_ERROR_OUT_OF_MEMORY, reader.windowOffset };
+                        break;
+                    }
+                }
+                SlideEvaluationWindow(&reader, position);
+                slideLimit = GetEvaluationSlideLimit(&reader);
+                position = 0;
+                cursor = (const char*)reader.window.memory;
+                value = ParseExactDigital(cursor, &tokenLength);
+            }
+            if(error.code != CALCULATION_ERROR_NONE)
+                break;
+            
+            position += tokenLength;
+            
+            if((status & PARSE_PHASE_STATUS_HAS_NEG) != 0)
+                value = NegateExactNumber(value);
+            
+            if((status & PARSE_PHASE_STATUS_RIGHT_OPERAND) == PARSE_PHASE_STATUS_LEFT_OPERAND)
+                leftOperand = value;
+            else
+                rightOperand = value;
+            
+            status &= ~PARSE_PHASE_STATUS_HAS_NEG;
+            status |= PARSE_PHASE_STATUS_NEED_OPERATOR;
+        }
+        else if(charClass == CHARACTER_CLASS_LETTER)
+        {
+            int tokenLength;
+            pMathFunc = ParseMathFunction(cursor, &tokenLength, kernelSet);
+            if(pMathFunc == NULL && IsReductionCall(cursor))
+            {
+                // 归约的参数直接从原始输入中读取，结果与数字字面量一样作为操作数
+                var offset = reader.windowOffset + position;
+                double value;
+                size_t reductionLength;
+                if(!EvaluateReduction(expr + offset, length - offset, kernelSet, &value, &reductionLength, &error))
+                {
+                    error.offset += offset;
+                    break;
+                }
+                
+                // 归约可能跨越了窗口末尾，此时从归约之后的位置重新填充窗口
+                offset += reductionLength;
+                if(offset <= reader.windowOffset + reader.windowLength)
+                    position = offset - reader.windowOffset;
+                else
+                {
+                    reader.windowOffset = offset;
+                    reader.windowLength = 0;
+                    reader.inputOffset = offset;
+                    SlideEvaluationWindow(&reader, 0);
+                    slideLimit = GetEvaluationSlideLimit(&reader);
+                    position = 0;
+                }
+                
+                if((status & PARSE_PHASE_STATUS_RIGHT_OPERAND) == PARSE_PHASE_STATUS_LEFT_OPERAND)
+                    leftOperand = MakeExactReal(value);
+                else
+                    rightOperand = MakeExactReal(value);
+                
+                status |= PARSE_PHASE_STATUS_NEED_OPERATOR;
+                continue;
+            }
+            if(pMathFunc == NULL)
+            {
+                error = (struct CalculationError){ CALCULATION_ERROR_UNKNOWN_FUNCTION, reader.windowOffset + position };
+                break;
+            }
+            position += tokenLength;
+            if(cursor[tokenLength] != '(')
+            {
+                error = (struct CalculationError){ CALCULATION_ERROR_MISSING_FUNCTION_ARGUMENT, reader.windowOffset + position };
+                break;
+            }
+        }
+        else if(charClass == CHARACTER_CLASS_LEFT_PARENTHESIS)
+        {
+            if(!ReserveEvaluationStack(&stack, arena, stackTop, sizeof(struct ExactEvaluationFrame)))
+            {
+                error = (struct CalculationError){ CALCULATION_ERROR_OUT_OF_MEMORY, reader.windowOffset + position };
+                break;
+            }
+            *(struct ExactEvaluationFrame*)(stack.memory + stackTop) = (struct ExactEvaluationFrame){
+                leftOperand, rightOperand, pOpFunc, pMathFunc, parenthesisOffset, pendingCount, status, priority
+            };
+            stackTop += sizeof(struct ExactEvaluationFrame);
+            depth++;
+            STATISTICS_RECORD_DEPTH(depth);
+            
+            leftOperand = MakeExactInteger(0);
+            rightOperand = MakeExactInteger(0);
+            pOpFunc = NULL;
+            pMathFunc = NULL;
+            status = PARSE_PHASE_STATUS_LEFT_OPERAND | PARSE_PHASE_STATUS_LEFT_PARENTHESIS;
+            priority = OPERATOR_PRIORITY_ADD;
+            parenthesisOffset = reader.windowOffset + position;
+            pendingCount = 0;
+            position++;
+        }
+        else if(charClass == CHARACTER_CLASS_RIGHT_PARENTHESIS || charClass == CHARACTER_CLASS_END)
+        {
+            var value = (pOpFunc != NULL)? pOpFunc(leftOperand, rightOperand) : leftOperand;
+            for(; pendingCount > 0; pendingCount--)
+            {
+                stackTop -= sizeof(struct ExactPendingOperand);
+                var pending = (const struct ExactPendingOperand*)(stack.memory + stackTop);
+                value = pending->pOpFunc(pending->leftOperand, value);
+            }
+            
+            if(depth == 0)
+            {
+                if(ch == ')')
+                    error = (struct CalculationError){ CALCULATION_ERROR_UNMATCHED_PARENTHESIS, reader.windowOffset + position };
+                else
+                    result = value;
+                break;
+            }
+            
+            if(ch == '\0')
+            {
+                error = (struct CalculationError){ CALCULATION_ERROR_UNMATCHED_PARENTHESIS, parenthesisOffset };
+                break;
+            }
+            
+            stackTop -= sizeof(struct ExactEvaluationFrame);
+            depth--;
+            const var frame = *(const struct ExactEvaluationFrame*)(stack.memory + stackTop);
+            leftOperand = frame.leftOperand;
+            rightOperand = frame.rightOperand;
+            pOpFunc = frame.pOpFunc;
+            pMathFunc = frame.pMathFunc;
+            status = frame.status;
+            priority = frame.priority;
+            parenthesisOffset = frame.parenthesisOffset;
+            pendingCount = frame.pendingCount;
+            
+            // 数学函数的结果总是double
+            if(pMathFunc != NULL)
+            {
+                value = MakeExactReal(pMathFunc(GetExactNumberReal(value)));
+                pMathFunc = NULL;
+            }
+            
+            if((status & PARSE_PHASE_STATUS_RIGHT_OPERAND) == 0)
+                leftOperand = value;
+            else
+                rightOperand = value;
+            
+            status &= ~PARSE_PHASE_STATUS_LEFT_PARENTHESIS;
+            status |= PARSE_PHASE_STATUS_NEED_OPERATOR;
+            position++;
+        }
+        else if(charClass == CHARACTER_CLASS_OPERATOR)
+        {
+            if((status & PARSE_PHASE_STATUS_NEED_OPERATOR) == 0)
+            {
+                if(ch != '-' || !(IsDigital(cursor[1]) || IsMathConstant(&cursor[1]) > 0))
+                {
+                    error = (struct CalculationError){ CALCULATION_ERROR_UNEXPECTED_OPERATOR, reader.windowOffset + position };
+                    break;
+                }
+                status |= PARSE_PHASE_STATUS_HAS_NEG;
+                STATISTICS_COUNT(negationCount, 1);
+            }
+            else
+            {
+                const var info = GetOperatorInfo(ch);
+                STATISTICS_COUNT(operatorCounts[(uint8_t)ch], 1);
+                var tmpFunc = info->pExactFunc;
+                var pry = info->priority;
+                
+                if(pOpFunc == NULL)
+                    pOpFunc = tmpFunc;
+                
+                if((status & PARSE_PHASE_STATUS_RIGHT_OPERAND) == 0)
+                    status |= PARSE_PHASE_STATUS_RIGHT_OPERAND;
+                else if(priority >= info->reducePriority)
+                {
+                    leftOperand = pOpFunc(leftOperand, rightOperand);
+                    rightOperand = MakeExactInteger(0);
+                    pOpFunc = tmpFunc;
+                }
+                else
+                {
+                    // 减法与除法同样转换为加上相反数与乘以倒数，只有±1的倒数仍是整数
+                    if(pOpFunc == ExactMinusOp)
+                    {
+                        pOpFunc = ExactAddOp;
+                        rightOperand = NegateExactNumber(rightOperand);
+                    }
+                    else if(pOpFunc == ExactDivOp)
+                    {
+                        pOpFunc = ExactMulOp;
+                        rightOperand = ExactDivOp(MakeExactInteger(1), rightOperand);
+                    }
+                    
+                    if(!ReserveEvaluationStack(&stack, arena, stackTop, sizeof(struct ExactPendingOperand)))
+                    {
+                        error = (struct CalculationError){ CALCULATION_ERROR_OUT_OF_MEMORY, reader.windowOffset + position };
+                        break;
+                    }
+                    *(struct ExactPendingOperand*)(stack.memory + stackTop) = (struct ExactPendingOperand){ leftOperand, pOpFunc };
+                    stackTop += sizeof(struct ExactPendingOperand);
+                    pendingCount++;
+                    
+                    leftOperand = rightOperand;
+                    rightOperand = MakeExactInteger(0);
+                    pOpFunc = NULL;
+                    status = PARSE_PHASE_STATUS_LEFT_OPERAND | PARSE_PHASE_STATUS_NEED_OPERATOR;
+                    priority = pry;
+                    continue;
+                }
+                priority = pry;
+            }
+            status &= ~PARSE_PHASE_STATUS_NEED_OPERATOR;
+            position++;
+        }
+        else
+        {
+            error = (struct CalculationError){ CALCULATION_ERROR_INVALID_CHARACTER, reader.windowOffset + position };
+            break;
+        }
+    }
+    
+    if(reader.window.isAllocated)
+        free(reader.window.memory);
+    if(stack.isAllocated)
+        free(stack.memory);
+    if(arena != NULL)
+        arena->used = savedUsed;
+    
+    STATISTICS_COUNT(expressionCount, 1);
+    STATISTICS_COUNT(byteCount, length);
+    if(error.code != CALCULATION_ERROR_NONE)
+        STATISTICS_COUNT(errorCounts[error.code], 1);
+    STATISTICS_END_TIMER(evaluation, STATISTICS_TIMER_EVALUATE);
+    
+    if(pError != NULL)
+        *pError = error;
+    
+    if(error.code != CALCULATION_ERROR_NONE)
+        return false;
+    
+    *pValue = result;
+    return true;
+}
+
+/** 以mantissa * 10^exponent表示的十进制浮点数 */
+struct DecimalFloat
+{
+    uint64_t mantissa;
+    int exponent;
+};
+
+/** 当e大于0时，返回ceil(log2(5^e))；当e为0时，返回1 */
+static inline int Pow5Bits(int e)
+{
+    return ((e * 1217359) >> 19) + 1;
+}
+
+/** 返回floor(log10(2^e))，e不小于0 */
+static inline int Log10Pow2(int e)
+{
+    return (e * 78913) >> 18;
+}
+
+/** 返回floor(log10(5^e))，e不小于0 */
+static inline int Log10Pow5(int e)
+{
+    return (e * 732923) >> 20;
+}
+
+/** 判定value是否为5^p的倍数 */
+static inline bool IsMultipleOfPowerOf5(uint64_t value, int p)
+{
+    var count = 0;
+    while(value % 5 == 0 && count < p)
+    {
+        value /= 5;
+        count++;
+    }
+    return count >= p;
+}
+
+/** 判定value是否为2^p的倍数 */
+static inline bool IsMultipleOfPowerOf2(uint64_t value, int p)
+{
+    return (value & ((UINT64_C(1) << p) - 1)) == 0;
+}
+
+/** 返回5^q的125位近似值（向下取整），它是powersOfFive128中对应的值右移3位的结果 */
+static inline unsigned __int128 GetPowerOfFive125(int q)
+{
+    const var pPower = powersOfFive128[q - NUMBER_MIN_DECIMAL_EXPONENT];
+    return ((unsigned __int128)pPower[0] << 64 | pPower[1]) >> 3;
+}
+
+/** 返回floor(2^k / 5^q) + 1，其中k = ceil(log2(5^q)) - 1 + 125，即Ryu算法所使用的5^-q的125位近似值 */
+static inline unsigned __int128 GetInversePowerOfFive125(int q)
+{
+    if(q == 0)
+        return ((unsigned __int128)1 << 125) + 1;
+    
+    const var pPower = powersOfFive128[-q - NUMBER_MIN_DECIMAL_EXPONENT];
+    var value = (unsigned __int128)pPower[0] << 64 | pPower[1];
+    
+    // 对于-27到-1的幂次，表中存放的是精确的上取整值，减1之后即为下取整值；
+    // 而更小的幂次的值已经被截断过，右移之后的结果恰好等于下取整值
+    if(q <= 27)
+        value--;
+    
+    return (value >> 3) + 1;
+}
+
+/** 计算(m * multiplier) >> shift，其中multiplier不超过126位，shift不小于64 */
+static inline uint64_t MultiplyShift125(uint64_t m, unsigned __int128 multiplier, int shift)
+{
+    var low = (unsigned __int128)m * (uint64_t)multiplier;
+    var high = (unsigned __int128)m * (uint64_t)(multiplier >> 64);
+    return (uint64_t)(((low >> 64) + high) >> (shift - 64));
+}
+
+/**
+ * 用Ryu算法求出有限非零double值的最短十进制表示。
+ * 所得的十进制数在能被精确读回原值的所有十进制数中位数最少，位数相同时最接近原值
+ * @param ieeeMantissa double的52位尾数字段
+ * @param ieeeExponent double的11位阶码字段，不能为0x7ff
+*/
+static struct DecimalFloat ComputeShortestDecimal(uint64_t ieeeMantissa, int ieeeExponent)
+{
+    int e2;
+    uint64_t m2;
+    if(ieeeExponent == 0)
+    {
+        e2 = 1 - 1023 - 52 - 2;
+        m2 = ieeeMantissa;
+    }
+    else
+    {
+        e2 = ieeeExponent - 1023 - 52 - 2;
+        m2 = UINT64_C(1) << 52 | ieeeMantissa;
+        
+        // 不超过2^53的整数直接去掉末尾的零即可
+        if(e2 + 2 <= 0 && e2 + 2 >= -52 && IsMultipleOfPowerOf2(m2, -(e2 + 2)))
+        {
+            struct DecimalFloat result = { m2 >> -(e2 + 2), 0 };
+            while(result.mantissa % 10 == 0)
+            {
+                result.mantissa /= 10;
+                result.exponent++;
+            }
+            return result;
+        }
+    }
+    
+    // 尾数为偶数时，舍入区间包含其端点
+    var isAcceptingBounds = (m2 & 1) == 0;
+    
+    // 以4 * m2 * 2^e2表示原值，mv为其中点，下边界在尾数为0且阶码大于1时更靠近原值
+    var mv = 4 * m2;
+    var mmShift = (ieeeMantissa != 0 || ieeeExponent <= 1)? 1 : 0;
+    
+    // 将舍入区间的上下边界以及原值转换为以10为底的形式
+    uint64_t vr, vp, vm;
+    int e10;
+    var isVmTrailingZeros = false;
+    var isVrTrailingZeros = false;
+    
+    if(e2 >= 0)
+    {
+        var q = Log10Pow2(e2) - (e2 > 3);
+        e10 = q;
+        var k = 125 + Pow5Bits(q) - 1;
+        var i = -e2 + q + k;
+        var multiplier = GetInversePowerOfFive125(q);
+        
+        vr = MultiplyShift125(4 * m2, multiplier, i);
+        vp = MultiplyShift125(4 * m2 + 2, multiplier, i);
+        vm = MultiplyShift125(4 * m2 - 1 - mmShift, multiplier, i);
+        
+        if(q <= 21)
+        {
+            // 只有在这个范围内，区间端点才可能恰好是10^q的倍数
+            if(mv % 5 == 0)
+                isVrTrailingZeros = IsMultipleOfPowerOf5(mv, q);
+            else if(isAcceptingBounds)
+                isVmTrailingZeros = IsMultipleOfPowerOf5(mv - 1 - mmShift, q);
+            else
+                vp -= IsMultipleOfPowerOf5(mv + 2, q);
+        }
+    }
+    else
+    {
+        var q = Log10Pow5(-e2) - (-e2 > 1);
+        e10 = q + e2;
+        var i = -e2 - q;
+        var k = Pow5Bits(i) - 125;
+        var j = q - k;
+        var multiplier = GetPowerOfFive125(i);
+        
+        vr = MultiplyShift125(4 * m2, multiplier, j);
+        vp = MultiplyShift125(4 * m2 + 2, multiplier, j);
+        vm = MultiplyShift125(4 * m2 - 1 - mmShift, multiplier, j);
+        
+        if(q <= 1)
+        {
+            // mv至少有两个末尾的零位，因此vr必然以零结尾
+            isVrTrailingZeros = true;
+            if(isAcceptingBounds)
+                isVmTrailingZeros = mmShift == 1;
+            else
+                vp--;
+        }
+        else if(q < 63)
+            isVrTrailingZeros = IsMultipleOfPowerOf2(mv, q);
+    }
+    
+    // 不断去掉末位数字，直到区间内无法再容纳更短的数
+    var removed = 0;
+    var lastRemovedDigit = 0;
+    uint64_t output;
+    
+    if(isVmTrailingZeros || isVrTrailingZeros)
+    {
+        // 一般情况，需要追踪被去掉的数字是否全为零，以便精确处理端点以及恰好居中的情形
+        while(vp / 10 > vm / 10)
+        {
+            isVmTrailingZeros &= vm % 10 == 0;
+            isVrTrailingZeros &= lastRemovedDigit == 0;
+            lastRemovedDigit = (int)(vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        
+        if(isVmTrailingZeros)
+        {
+            while(vm % 10 == 0)
+            {
+                isVrTrailingZeros &= lastRemovedDigit == 0;
+                lastRemovedDigit = (int)(vr % 10);
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+        
+        // 原值恰好居中时，向偶数舍入
+        if(isVrTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0)
+            lastRemovedDigit = 4;
+        
+        output = vr + ((vr == vm && (!isAcceptingBounds || !isVmTrailingZeros)) || lastRemovedDigit >= 5);
+    }
+    else
+    {
+        // 绝大多数的情况，端点不可能恰好落在十进制数上
+        var isRoundingUp = false;
+        if(vp / 100 > vm / 100)
+        {
+            isRoundingUp = vr % 100 >= 50;
+            vr /= 100;
+            vp /= 100;
+            vm /= 100;
+            removed += 2;
+        }
+        
+        while(vp / 10 > vm / 10)
+        {
+            isRoundingUp = vr % 10 >= 5;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        
+        output = vr + (vr == vm || isRoundingUp);
+    }
+    
+    return (struct DecimalFloat){ output, e10 + removed };
+}
+
+/**
+ * 将无符号整数以十进制形式写入缓存，不添加结束符
+ * @return 所写入的字符个数
+*/
+static int WriteDecimalDigits(char buffer[], uint64_t value)
+{
+    char digits[20];
+    var count = 0;
+    do
+    {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    }
+    while(value != 0);
+    
+    for(var i = 0; i < count; i++)
+        buffer[i] = digits[count - 1 - i];
+    
+    return count;
+}
+
+/**
+ * 将十进制浮点数写成科学计数法的形式，例如1.5e-7或者1e+21
+ * @return 所写入的字符个数，不包括结束符
+*/
+static int WriteScientificDecimal(char buffer[], struct DecimalFloat decimal)
+{
+    char digits[20];
+    var digitCount = WriteDecimalDigits(digits, decimal.mantissa);
+    var length = 0;
+    
+    buffer[length++] = digits[0];
+    if(digitCount > 1)
+    {
+        buffer[length++] = '.';
+        memcpy(&buffer[length], &digits[1], digitCount - 1);
+        length += digitCount - 1;
+    }
+    
+    var exponent = decimal.exponent + digitCount - 1;
+    buffer[length++] = 'e';
+    buffer[length++] = (exponent < 0)? '-' : '+';
+    length += WriteDecimalDigits(&buffer[length], (uint64_t)(exponent < 0? -exponent : exponent));
+    
+    buffer[length] = '\0';
+    return length;
+}
+
+/**
+ * 将十进制浮点数写成不带指数的形式，例如0.00015或者1200
+ * @return 所写入的字符个数，不包括结束符
+*/
+static int WritePlainDecimal(char buffer[], struct DecimalFloat decimal)
+{
+    char digits[20];
+    var digitCount = WriteDecimalDigits(digits, decimal.mantissa);
+    
+    // pointIndex为小数点之前的数字个数
+    var pointIndex = digitCount + decimal.exponent;
+    var length = 0;
+    
+    if(pointIndex <= 0)
+    {
+        buffer[length++] = '0';
+        buffer[length++] = '.';
+        memset(&buffer[length], '0', -pointIndex);
+        length += -pointIndex;
+        memcpy(&buffer[length], digits, digitCount);
+        length += digitCount;
+    }
+    else if(pointIndex >= digitCount)
+    {
+        memcpy(buffer, digits, digitCount);
+        length = digitCount;
+        memset(&buffer[length], '0', pointIndex - digitCount);
+        length += pointIndex - digitCount;
+    }
+    else
+    {
+        memcpy(buffer, digits, pointIndex);
+        length = pointIndex;
+        buffer[length++] = '.';
+        memcpy(&buffer[length], &digits[pointIndex], digitCount - pointIndex);
+        length += digitCount - pointIndex;
+    }
+    
+    buffer[length] = '\0';
+    return length;
+}
+
+/**
+ * 以定点格式写出绝对值小于1e21的有限非负值，小数点后至多保留precision位并去掉末尾的零。
+ * 舍入是针对二进制原值精确进行的，结果与printf的"%.*f"去掉末尾的零之后完全相同
+ * @return 所写入的字符个数，不包括结束符
+*/
+static int WriteFixedDecimal(char buffer[], uint64_t ieeeMantissa, int ieeeExponent, int precision)
+{
+    static const uint64_t powersOfTen[] = {
+        UINT64_C(1), UINT64_C(10), UINT64_C(100), UINT64_C(1000), UINT64_C(10000), UINT64_C(100000),
+        UINT64_C(1000000), UINT64_C(10000000), UINT64_C(100000000), UINT64_C(1000000000),
+        UINT64_C(10000000000), UINT64_C(100000000000), UINT64_C(1000000000000), UINT64_C(10000000000000),
+        UINT64_C(100000000000000), UINT64_C(1000000000000000), UINT64_C(10000000000000000),
+        UINT64_C(100000000000000000), UINT64_C(1000000000000000000), UINT64_C(10000000000000000000)
+    };
+    
+    // 原值为m * 2^e，其中m不超过53位，而原值乘以10^precision之后不超过127位，因此可以用128位整数精确计算
+    var m = (ieeeExponent == 0)? ieeeMantissa : (UINT64_C(1) << 52 | ieeeMantissa);
+    var e = (ieeeExponent == 0)? -1074 : ieeeExponent - 1075;
+    var scaled = (unsigned __int128)m * powersOfTen[precision];
+    unsigned __int128 rounded;
+    
+    if(e >= 0)
+        rounded = scaled << e;
+    else if(-e >= 128)
+        rounded = 0;
+    else
+    {
+        rounded = scaled >> -e;
+        var remainder = scaled - (rounded << -e);
+        var half = (unsigned __int128)1 << (-e - 1);
+        if(remainder > half || (remainder == half && (rounded & 1) != 0))
+            rounded++;
+    }
+    
+    var integerPart = rounded / powersOfTen[precision];
+    var fraction = (uint64_t)(rounded - integerPart * powersOfTen[precision]);
+    
+    // 整数部分可能超过64位，因此分成高低两段输出
+    var length = 0;
+    if(integerPart >= powersOfTen[19])
+    {
+        length = WriteDecimalDigits(buffer, (uint64_t)(integerPart / powersOfTen[19]));
+        var low = (uint64_t)(integerPart % powersOfTen[19]);
+        for(var i = 18; i >= 0; i--)
+        {
+            buffer[length + i] = (char)('0' + low % 10);
+            low /= 10;
+        }
+        length += 19;
+    }
+    else
+        length = WriteDecimalDigits(buffer, (uint64_t)integerPart);
+    
+    if(fraction != 0)
+    {
+        var digitCount = precision;
+        while(fraction % 10 == 0)
+        {
+            fraction /= 10;
+            digitCount--;
+        }
+        
+        buffer[length++] = '.';
+        for(var i = digitCount - 1; i >= 0; i--)
+        {
+            buffer[length + i] = (char)('0' + fraction % 10);
+            fraction /= 10;
+        }
+        length += digitCount;
+    }
+    
+    buffer[length] = '\0';
+    return length;
+}
+
+/**
+ * 将计算结果格式化为字符串，整个过程不调用printf系列函数
+ * @param value 计算结果
+ * @param format 格式化方式，若为NULL，则使用最短表示
+ * @param result 存放结果字符串的缓存
+ * @return 结果字符串的长度
+*/
+int FormatArithmeticResult(double value, const struct ResultFormat *format, char result[static RESULT_STRING_SIZE])
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    
+    var ieeeMantissa = bits & ((UINT64_C(1) << 52) - 1);
+    var ieeeExponent = (int)(bits >> 52 & 0x7ff);
+    var length = 0;
+    
+    if(bits >> 63 != 0)
+        result[length++] = '-';
+    
+    if(ieeeExponent == 0x7ff)
+    {
+        memcpy(&result[length], ieeeMantissa == 0? "inf" : "nan", 4);
+        return length + 3;
+    }
+    
+    if(ieeeExponent == 0 && ieeeMantissa == 0)
+    {
+        memcpy(&result[length], "0", 2);
+        return length + 1;
+    }
+    
+    var mode = (format == NULL)? RESULT_FORMAT_MODE_SHORTEST : format->mode;
+    
+    // 绝对值不小于1e21的数在任何格式下都使用科学计数法
+    if(mode == RESULT_FORMAT_MODE_FIXED && fabs(value) < 1e21)
+        return length + WriteFixedDecimal(&result[length], ieeeMantissa, ieeeExponent, format->precision);
+    
+    var decimal = ComputeShortestDecimal(ieeeMantissa, ieeeExponent);
+    
+    // 小数点的位置减1即为科学计数法中的指数
+    var exponent = decimal.exponent + WriteDecimalDigits((char[20]){ 0 }, decimal.mantissa) - 1;
+    if(mode == RESULT_FORMAT_MODE_SHORTEST && exponent >= -7 && exponent < 21)
+        return length + WritePlainDecimal(&result[length], decimal);
+    
+    return length + WriteScientificDecimal(&result[length], decimal);
+}
+
+/**
+ * 格式化精确整数模式的计算结果。整数结果直接以十进制写出全部数字而不经由double，
+ * 因此在定点格式与最短表示下都不带小数部分，在科学计数法下则去掉有效数字末尾的零
+ * @param value 计算结果
+ * @param format 结果的格式化方式，若为NULL，则使用最短表示
+ * @param result 输出格式化之后的字符串
+ * @return 结果字符串的长度，不包括结束符
+*/
+int FormatArithmeticValue(const struct ArithmeticValue *value, const struct ResultFormat *format, char result[static RESULT_STRING_SIZE])
+{
+    if(!value->isInteger)
+        return FormatArithmeticResult(value->real, format, result);
+    
+    var length = 0;
+    var magnitude = (uint64_t)value->integer;
+    if(value->integer < 0)
+    {
+        result[length++] = '-';
+        magnitude = -magnitude;
+    }
+    
+    if(format != NULL && format->mode == RESULT_FORMAT_MODE_SCIENTIFIC && magnitude != 0)
+    {
+        struct DecimalFloat decimal = { magnitude, 0 };
+        for(; decimal.mantissa % 10 == 0; decimal.exponent++)
+            decimal.mantissa /= 10;
+        
+        return length + WriteScientificDecimal(&result[length], decimal);
+    }
+    
+    length += WriteDecimalDigits(&result[length], magnitude);
+    result[length] = '\0';
+    
+    return length;
+}
+
+/** 将精确整数模式内部的数值转换为对外的计算结果 */
+static inline struct ArithmeticValue GetArithmeticValue(struct ExactNumber number)
+{
+    return (struct ArithmeticValue){ number.isInteger, number.isInteger? number.integer : 0, GetExactNumberReal(number) };
+}
+
+/**
+ * 就地预检库接口所接收的表达式，并记录预检的统计数据
+ * @param expr 需要预检的算术表达式字符串，过滤结果直接写回
+ * @param length 表达式字符串的长度
+ * @return 参见PrevalidateArithmeticExpression
+*/
+static inline bool PrescanArithmeticExpression(char expr[], size_t length)
+{
+    STATISTICS_BEGIN_TIMER(prescan);
+    var isAccepted = PrevalidateArithmeticExpression(expr, expr, length);
+    STATISTICS_END_TIMER(prescan, STATISTICS_TIMER_PRESCAN);
+    if(!isAccepted)
+        STATISTICS_COUNT(prescanRejectionCount, 1);
+    
+    return isAccepted;
+}
+
+/**
+ * 计算已经过滤过的算术表达式
+ * @param expr 经NormalizeArithmeticExpression过滤之后的算术表达式字符串
+ * @param format 结果的格式化方式，若为NULL，则使用最短表示
+ * @param result 以字符串的形式输出结果
+ * @return 如果表达式解析成功，返回true，否则返回false
+*/
+static bool CalculateNormalizedArithmeticExpression(const char *expr, const struct ResultFormat *format, char result[static RESULT_STRING_SIZE])
+{
+    var kernelSet = (format != NULL)? format->kernelSet : MATH_KERNEL_SET_LIBM;
+    
+    if(format != NULL && format->isExactInteger)
+    {
+        struct ExactNumber number;
+        if(!EvaluateExactArithmeticSpan(expr, strlen(expr), true, kernelSet, NULL, &number, NULL))
+            return false;
+        
+        const var value = GetArithmeticValue(number);
+        STATISTICS_BEGIN_TIMER(format);
+        FormatArithmeticValue(&value, format, result);
+        STATISTICS_END_TIMER(format, STATISTICS_TIMER_FORMAT);
+        
+        return true;
+    }
+    
+    double value;
+    
+    if(!EvaluateArithmeticSpan(expr, strlen(expr), true, kernelSet, NULL, &value, NULL, NULL))
+        return false;
+    
+    STATISTICS_BEGIN_TIMER(format);
+    FormatArithmeticResult(value, format, result);
+    STATISTICS_END_TIMER(format, STATISTICS_TIMER_FORMAT);
+    
+    return true;
+}
+
+/**
+ * 计算输入的算术表达式，并按指定的格式输出结果
+ * @param expr 输入的算术表达式字符串
+ * @param format 结果的格式化方式，若为NULL，则使用最短表示
+ * @param result 以字符串的形式输出结果
+ * @return 如果表达式解析成功，返回true，否则返回false
+*/
+bool CalculateArithmeticExpressionWithFormat(char expr[], const struct ResultFormat *format, char result[static RESULT_STRING_SIZE])
+{
+    if(expr[0] == '\0')
+        return false;
+    
+    /*** 我们先对输入字符串做一些过滤，使得当中出现的一些符号能适配本程序。
+     * 这里不需要错误信息，所以用向量化的预检代替逐字节的过滤，含有非法字符或者括号不配对的表达式在此直接被拒绝 */
+    if(!PrescanArithmeticExpression(expr, strlen(expr)))
+        return false;
+    
+    return CalculateNormalizedArithmeticExpression(expr, format, result);
+}
+
+/**
+ * 计算输入的算术表达式
+ * @param expr 输入的算术表达式字符串
+ * @param result 以字符串的形式输出结果，这里设置了实参至少需要提供的缓存长度。
+ * 结果使用能被精确读回的最短表示，它不会超过26个字符
+ * @return 如果表达式解析成功，返回true，否则返回false
+*/
+bool CalculateArithmeticExpression(char expr[], char result[static 32])
+{
+    char buffer[RESULT_STRING_SIZE];
+    
+    if(!CalculateArithmeticExpressionWithFormat(expr, NULL, buffer))
+        return false;
+    
+    memcpy(result, buffer, strlen(buffer) + 1);
+    
+    return true;
+}
+
+/**
+ * 获取计算长度为length的任意表达式时，EvaluateArithmeticExpression最多会从工作区中分配的字节数。
+ * 该值是按每个字符都产生一个括号层来估计的上限，实际的占用与括号嵌套深度加上尚待归约的左操作数个数成正比，
+ * 后者在1+2*3+4*5这样的扁平表达式中也会随长度增长。嵌套不深、待归约操作数不多的表达式完全使用函数栈上的空间，不会占用工作区。
+ * 区间归约、integrate与solve从堆上分配存储空间，不计入该值
+ * @param length 表达式的长度
+*/
+size_t GetCalculationArenaSize(size_t length)
+{
+    // 预读窗口与求值栈都按2倍扩大，并且扩大之前的空间不会归还给工作区，所以各需要4倍的空间
+    var windowSize = length + EVALUATION_WINDOW_LOOKAHEAD + EVALUATION_WINDOW_PADDING;
+    // 精确整数模式的栈帧更大，这里按它来估计
+    var stackSize = (length + 1) * sizeof(struct ExactEvaluationFrame);
+    
+    return 4 * (windowSize + stackSize) + 1024;
+}
+
+/** 获取错误码所对应的描述信息 */
+const char* GetCalculationErrorMessage(enum CALCULATION_ERROR code)
+{
+    static const char *const messages[] = {
+        [CALCULATION_ERROR_NONE] = "no error",
+        [CALCULATION_ERROR_EMPTY_EXPRESSION] = "empty expression",
+        [CALCULATION_ERROR_INVALID_CHARACTER] = "invalid character",
+        [CALCULATION_ERROR_UNEXPECTED_OPERATOR] = "unexpected operator",
+        [CALCULATION_ERROR_UNKNOWN_FUNCTION] = "unknown function",
+        [CALCULATION_ERROR_MISSING_FUNCTION_ARGUMENT] = "function name not followed by '('",
+        [CALCULATION_ERROR_UNMATCHED_PARENTHESIS] = "unmatched parenthesis",
+        [CALCULATION_ERROR_OUT_OF_MEMORY] = "arena too small",
+        [CALCULATION_ERROR_INVALID_REDUCTION] = "invalid range reduction"
+    };
+    
+    if((unsigned)code >= sizeof(messages) / sizeof(messages[0]))
+        return "unknown error";
+    
+    return messages[code];
+}
+
+/**
+ * 用指定的数学函数实现计算算术表达式，其余参数与返回值的含义与EvaluateArithmeticExpression相同
+ * @param kernelSet 数学函数的实现方式
+*/
+static bool EvaluateArithmeticExpressionWithKernels(const char *expr, size_t length, enum MATH_KERNEL_SET kernelSet, struct CalculationArena *arena, double *pValue, struct CalculationError *pError)
+{
+    struct CalculationError error = { CALCULATION_ERROR_NONE, 0 };
+    const char *terminator = NULL;
+    
+    if(length == 0)
+        error.code = CALCULATION_ERROR_EMPTY_EXPRESSION;
+    else if((terminator = (const char*)memchr(expr, '\0', length)) != NULL)
+        error = (struct CalculationError){ CALCULATION_ERROR_INVALID_CHARACTER, (size_t)(terminator - expr) };
+    else
+        return EvaluateArithmeticSpan(expr, length, false, kernelSet, arena, pValue, pError, NULL);
+    
+    if(pError != NULL)
+        *pError = error;
+    
+    return false;
+}
+
+/**
+ * 计算算术表达式。该函数不会修改输入的表达式，也不会对它做任何拷贝，
+ * 因此多个线程可以同时计算同一个表达式。求值采用显式的求值栈，没有递归调用，
+ * 所以表达式的长度以及括号嵌套深度只受存储空间的限制
+ * @param expr 输入的算术表达式，它不必以'\0'结尾
+ * @param length 表达式的字节数，其中不能包含'\0'
+ * @param arena 工作区。嵌套较深时所需的额外空间从中分配，并在返回前归还，此时对表达式本身的求值不会分配堆存储空间。
+ * 其剩余空间不少于GetCalculationArenaSize(length)个字节时一定够用。若为NULL，则在需要时从堆上分配。
+ * 区间归约以及integrate、solve例外：它们编译归约体、准备按列求值的缓冲区时总是从堆上分配，不占用工作区
+ * @param pValue 输出计算结果
+ * @param pError 若不为NULL，则输出错误原因以及出错位置相对于expr的字节偏移
+ * @return 如果表达式解析成功，返回true，否则返回false
+*/
+bool EvaluateArithmeticExpression(const char *expr, size_t length, struct CalculationArena *arena, double *pValue, struct CalculationError *pError)
+{
+    return EvaluateArithmeticExpressionWithKernels(expr, length, MATH_KERNEL_SET_LIBM, arena, pValue, pError);
+}
+
+/**
+ * 用指定的数学函数实现以精确整数模式计算算术表达式，其余参数与返回值的含义与EvaluateArithmeticExpressionExact相同
+ * @param kernelSet 数学函数的实现方式
+*/
+static bool EvaluateArithmeticExpressionExactWithKernels(const char *expr, size_t length, enum MATH_KERNEL_SET kernelSet, struct CalculationArena *arena, struct ArithmeticValue *pValue, struct CalculationError *pError)
+{
+    struct CalculationError error = { CALCULATION_ERROR_NONE, 0 };
+    const char *terminator = NULL;
+    struct ExactNumber number;
+    
+    if(length == 0)
+        error.code = CALCULATION_ERROR_EMPTY_EXPRESSION;
+    else if((terminator = (const char*)memchr(expr, '\0', length)) != NULL)
+        error = (struct CalculationError){ CALCULATION_ERROR_INVALID_CHARACTER, (size_t)(terminator - expr) };
+    else
+    {
+        if(!EvaluateExactArithmeticSpan(expr, length, false, kernelSet, arena, &number, pError))
+            return false;
+        
+        *pValue = GetArithmeticValue(number);
+        return true;
+    }
+    
+    if(pError != NULL)
+        *pError = error;
+    
+    return false;
+}
+
+/**
+ * 以精确整数模式计算算术表达式。不含小数点与指数的整数字面量以int64_t表示，
+ * 它们之间的加、减、乘、求模与乘方都按64位整数精确计算，除法则只在能整除时得到整数；
+ * 一旦溢出、除不尽、或者与小数、数学常量以及数学函数的结果一起运算，该部分结果便转为double。
+ * 除了超出2^53的整数不再被舍入以外，结果都与EvaluateArithmeticExpression相同。
+ * 其余参数与返回值的含义与EvaluateArithmeticExpression相同
+ * @param pValue 输出计算结果
+*/
+bool EvaluateArithmeticExpressionExact(const char *expr, size_t length, struct CalculationArena *arena, struct ArithmeticValue *pValue, struct CalculationError *pError)
+{
+    return EvaluateArithmeticExpressionExactWithKernels(expr, length, MATH_KERNEL_SET_LIBM, arena, pValue, pError);
+}
+
+/** 结果缓存的分片个数，必须是2的幂。各分片各自加锁，因此多个线程访问不同分片时互不阻塞 */
+#define RESULT_CACHE_SHARD_COUNT    64
+
+/** 结果缓存中的一个条目 */
+struct ResultCacheEntry
+{
+    /** 过滤之后的表达式，若为NULL，则说明该条目尚未被使用 */
+    char *key;
+    size_t keyLength;
+    uint64_t hash;
+    
+    /** 同一哈希桶中下一个条目的索引，-1表示没有 */
+    int next;
+    
+    /** CLOCK算法的访问标志，条目被命中时置位，时钟指针扫过时清除 */
+    bool isReferenced;
+    
+    /** 表达式是否合法，非法表达式同样会被缓存 */
+    bool isValid;
+    
+    char value[RESULT_STRING_SIZE];
+};
+
+/** 结果缓存的一个分片，按缓存行对齐以免不同分片之间的伪共享 */
+struct ResultCacheShard
+{
+    alignas(64) pthread_mutex_t mutex;
+    
+    struct ResultCacheEntry *entries;
+    int capacity;
+    int count;
+    
+    /** 哈希桶，存放各个链表首条目的索引，-1表示空桶 */
+    int *buckets;
+    int bucketMask;
+    
+    /** CLOCK算法的时钟指针 */
+    int clockHand;
+    
+    long hitCount;
+    long missCount;
+    long evictionCount;
+};
+
+/**
+ * 以过滤之后的表达式为键、以格式化之后的结果字符串为值的有界缓存。
+ * 缓存被划分成若干分片，每个分片独立加锁，并用CLOCK算法近似LRU来淘汰条目，
+ * 因此可以被批处理模式的多个工作线程同时使用
+*/
+struct ResultCache
+{
+    struct ResultCacheShard shards[RESULT_CACHE_SHARD_COUNT];
+    
+    /** 所缓存的结果字符串的格式化方式 */
+    struct ResultFormat format;
+};
+
+/** 释放结果缓存 */
+void DestroyResultCache(struct ResultCache *cache)
+{
+    if(cache == NULL)
+        return;
+    
+    for(var i = 0; i < RESULT_CACHE_SHARD_COUNT; i++)
+    {
+        var shard = &cache->shards[i];
+        if(shard->entries != NULL)
+        {
+            for(var j = 0; j < shard->count; j++)
+                free(shard->entries[j].key);
+        }
+        free(shard->entries);
+        free(shard->buckets);
+        pthread_mutex_destroy(&shard->mutex);
+    }
+    free(cache);
+}
+
+/**
+ * 创建结果缓存
+ * @param capacity 最多缓存的条目个数，它会被向上取整为分片个数的整数倍
+ * @param format 结果的格式化方式，若为NULL，则使用最短表示
+ * @return 若创建成功，返回结果缓存，使用完毕后需用DestroyResultCache释放；否则返回NULL
+*/
+struct ResultCache* CreateResultCache(long capacity, const struct ResultFormat *format)
+{
+    if(capacity <= 0 || capacity > (long)INT32_MAX / 2 * RESULT_CACHE_SHARD_COUNT)
+        return NULL;
+    
+    var cache = (struct ResultCache*)aligned_alloc(alignof(struct ResultCache), sizeof(struct ResultCache));
+    if(cache == NULL)
+        return NULL;
+    
+    cache->format = (format == NULL)? (struct ResultFormat){ RESULT_FORMAT_MODE_SHORTEST, 0, false, MATH_KERNEL_SET_LIBM } : *format;
+    
+    var shardCapacity = (int)((capacity + RESULT_CACHE_SHARD_COUNT - 1) / RESULT_CACHE_SHARD_COUNT);
+    var bucketCount = 1;
+    while(bucketCount < shardCapacity)
+        bucketCount *= 2;
+    
+    var isSuccessful = true;
+    for(var i = 0; i < RESULT_CACHE_SHARD_COUNT; i++)
+    {
+        var shard = &cache->shards[i];
+        *shard = (struct ResultCacheShard){ .capacity = shardCapacity, .bucketMask = bucketCount - 1 };
+        pthread_mutex_init(&shard->mutex, NULL);
+        
+        shard->entries = (struct ResultCacheEntry*)malloc(sizeof(struct ResultCacheEntry) * shardCapacity);
+        shard->buckets = (int*)malloc(sizeof(int) * bucketCount);
+        if(shard->entries == NULL || shard->buckets == NULL)
+        {
+            isSuccessful = false;
+            continue;
+        }
+        
+        for(var j = 0; j < bucketCount; j++)
+            shard->buckets[j] = -1;
+    }
+    
+    if(!isSuccessful)
+    {
+        DestroyResultCache(cache);
+        return NULL;
+    }
+    
+    return cache;
+}
+
+/** 用FNV-1a算法计算表达式的64位哈希值 */
+static uint64_t HashExpressionString(const char *expr, size_t length)
+{
+    var hash = UINT64_C(14695981039346656037);
+    for(size_t i = 0; i < length; i++)
+    {
+        hash ^= (uint8_t)expr[i];
+        hash *= UINT64_C(1099511628211);
+    }
+    return hash;
+}
+
+/** 在分片中查找表达式所对应的条目，调用者需持有该分片的锁 */
+static struct ResultCacheEntry* FindResultCacheEntry(struct ResultCacheShard *shard, const char *key, size_t keyLength, uint64_t hash)
+{
+    for(var index = shard->buckets[hash & shard->bucketMask]; index >= 0; index = shard->entries[index].next)
+    {
+        var entry = &shard->entries[index];
+        if(entry->hash == hash && entry->keyLength == keyLength && memcmp(entry->key, key, keyLength) == 0)
+            return entry;
+    }
+    return NULL;
+}
+
+/**
+ * 为新条目在分片中找一个位置。分片未满时直接使用下一个空闲条目，
+ * 否则推进时钟指针，清除沿途条目的访问标志，并淘汰第一个访问标志已被清除的条目。
+ * 调用者需持有该分片的锁
+ * @return 可用条目的索引，该条目已从其哈希桶中摘除
+*/
+static int AllocateResultCacheEntry(struct ResultCacheShard *shard)
+{
+    if(shard->count < shard->capacity)
+        return shard->count++;
+    
+    while(true)
+    {
+        var index = shard->clockHand;
+        var entry = &shard->entries[index];
+        shard->clockHand = (index + 1 == shard->capacity)? 0 : index + 1;
+        
+        if(entry->isReferenced)
+        {
+            entry->isReferenced = false;
+            continue;
+        }
+        
+        // 将被淘汰的条目从其哈希桶的链表中摘除
+        var pLink = &shard->buckets[entry->hash & shard->bucketMask];
+        while(*pLink != index)
+            pLink = &shard->entries[*pLink].next;
+        *pLink = entry->next;
+        
+        free(entry->key);
+        shard->evictionCount++;
+        
+        return index;
+    }
+}
+
+/**
+ * 带缓存地计算输入的算术表达式。以过滤之后的表达式为键查找缓存，
+ * 命中时直接返回所缓存的结果字符串，否则计算后将结果放入缓存。
+ * 结果的格式化方式由创建缓存时指定。该函数可以被多个线程同时调用
+ * @param cache 结果缓存，若为NULL，则等同于以最短表示输出结果的CalculateArithmeticExpressionWithFormat
+ * @param expr 输入的算术表达式字符串
+ * @param result 以字符串的形式输出结果
+ * @return 如果表达式解析成功，返回true，否则返回false
+*/
+bool CalculateArithmeticExpressionCached(struct ResultCache *cache, char expr[], char result[static RESULT_STRING_SIZE])
+{
+    if(cache == NULL)
+        return CalculateArithmeticExpressionWithFormat(expr, NULL, result);
+    
+    if(expr[0] == '\0')
+        return false;
+    
+    // 预检失败的表达式一定不合法，它们不会进入缓存，也不会占用缓存的淘汰名额
+    var length = strlen(expr);
+    if(!PrescanArithmeticExpression(expr, length))
+        return false;
+    
+    // 哈希值的高位用于选择分片，低位用于选择分片中的哈希桶
+    var hash = HashExpressionString(expr, length);
+    var shard = &cache->shards[(hash >> 58) & (RESULT_CACHE_SHARD_COUNT - 1)];
+    
+    pthread_mutex_lock(&shard->mutex);
+    var entry = FindResultCacheEntry(shard, expr, length, hash);
+    if(entry != NULL)
+    {
+        entry->isReferenced = true;
+        var isValid = entry->isValid;
+        if(isValid)
+            strcpy(result, entry->value);
+        shard->hitCount++;
+        pthread_mutex_unlock(&shard->mutex);
+        return isValid;
+    }
+    shard->missCount++;
+    pthread_mutex_unlock(&shard->mutex);
+    
+    // 计算过程不持有锁，因此其他线程可以同时访问同一个分片
+    var isValid = CalculateNormalizedArithmeticExpression(expr, &cache->format, result);
+    
+    var key = (char*)malloc(length + 1);
+    if(key == NULL)
+        return isValid;
+    memcpy(key, expr, length + 1);
+    
+    pthread_mutex_lock(&shard->mutex);
+    
+    // 在计算期间，其他线程可能已经将同一个表达式放入了缓存
+    if(FindResultCacheEntry(shard, expr, length, hash) != NULL)
+        free(key);
+    else
+    {
+        var index = AllocateResultCacheEntry(shard);
+        entry = &shard->entries[index];
+        *entry = (struct ResultCacheEntry){ .key = key, .keyLength = length, .hash = hash, .isValid = isValid };
+        if(isValid)
+            strcpy(entry->value, result);
+        
+        var pBucket = &shard->buckets[hash & shard->bucketMask];
+        entry->next = *pBucket;
+        *pBucket = index;
+    }
+    
+    pthread_mutex_unlock(&shard->mutex);
+    
+    return isValid;
+}
+
+/** 获取结果缓存的统计信息，各个分片的计数器依次加锁读取 */
+void GetResultCacheStatistics(struct ResultCache *cache, struct ResultCacheStatistics *pStatistics)
+{
+    *pStatistics = (struct ResultCacheStatistics){ 0 };
+    
+    for(var i = 0; i < RESULT_CACHE_SHARD_COUNT; i++)
+    {
+        var shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->mutex);
+        pStatistics->hitCount += shard->hitCount;
+        pStatistics->missCount += shard->missCount;
+        pStatistics->evictionCount += shard->evictionCount;
+        pStatistics->entryCount += shard->count;
+        pStatistics->capacity += shard->capacity;
+        pthread_mutex_unlock(&shard->mutex);
+    }
+}
+
+/** 编译后程序所使用的指令操作码 */
+enum PROGRAM_OPCODE
+{
+    /** 无效操作码，用于标记操作码表中的空位 */
+    PROGRAM_OPCODE_INVALID = 0,
+    
+    /** 将常量池中的常量压栈，操作数为常量索引 */
+    PROGRAM_OPCODE_PUSH_CONSTANT,
+    
+    /** 将绑定值数组中的变量值压栈，操作数为变量的槽位索引 */
+    PROGRAM_OPCODE_PUSH_VARIABLE,
+    
+    /** 以下为二元算术操作，从栈顶弹出右操作数，再用结果替换左操作数 */
+    PROGRAM_OPCODE_ADD,
+    PROGRAM_OPCODE_MINUS,
+    PROGRAM_OPCODE_MUL,
+    PROGRAM_OPCODE_DIV,
+    PROGRAM_OPCODE_MOD,
+    PROGRAM_OPCODE_POW,
+    
+    /** 对栈顶元素取相反数 */
+    PROGRAM_OPCODE_NEG,
+    
+    /** 对栈顶元素取倒数 */
+    PROGRAM_OPCODE_RECIPROCAL,
+    
+    /** 对栈顶元素调用数学函数，操作数为该函数在mathFuncList中的索引 */
+    PROGRAM_OPCODE_CALL,
+    
+    /** 将临时单元中的值压栈，操作数为临时单元索引 */
+    PROGRAM_OPCODE_LOAD_TEMPORARY,
+    
+    /** 将栈顶元素保存到临时单元中，但不将其弹出，操作数为临时单元索引 */
+    PROGRAM_OPCODE_STORE_TEMPORARY
+};
+
+/** 与operatorTable相对应的操作码表 */
+static const uint8_t opCodeTables[] = {
+    ['%' - '%'] = PROGRAM_OPCODE_MOD,
+    ['*' - '%'] = PROGRAM_OPCODE_MUL,
+    ['+' - '%'] = PROGRAM_OPCODE_ADD,
+    ['-' - '%'] = PROGRAM_OPCODE_MINUS,
+    ['/' - '%'] = PROGRAM_OPCODE_DIV,
+    ['^' - '%'] = PROGRAM_OPCODE_POW
+};
+
+/** 一条指令占用4个字节，其中低8位为操作码，高24位为操作数 */
+struct ProgramInstruction
+{
+    uint32_t opcode : 8;
+    uint32_t operand : 24;
+};
+
+/**
+ * 编译后的算术表达式程序。
+ * 程序以后缀形式存放，一旦生成便不再修改，因此可以被反复求值，也可以被多个线程同时求值。
+ * 程序本身与常量池、指令序列存放在同一块连续的存储空间中，用DestroyArithmeticProgram一次性释放
+*/
+struct ArithmeticProgram
+{
+    /** 程序中所声明的变量个数，求值时所提供的绑定值数组至少要包含这么多元素 */
+    int variableCount;
+    
+    /** 常量池中的常量个数 */
+    int constantCount;
+    
+    /** 指令个数 */
+    int instructionCount;
+    
+    /** 求值过程中所需要的最大栈深度 */
+    int maxStackDepth;
+    
+    /** 用于保存公共子表达式结果的临时单元个数 */
+    int temporaryCount;
+    
+    /** 常量池 */
+    const double *constants;
+    
+    /** 指令序列 */
+    const struct ProgramInstruction *instructions;
+};
+
+/** 求值时，栈深度不超过该值的程序直接使用函数栈上的空间 */
+#define PROGRAM_LOCAL_STACK_SIZE    64
+
+/** 编译过程中用于生成程序的上下文 */
+struct ProgramBuilder
+{
+    struct ProgramInstruction *instructions;
+    int instructionCount;
+    int instructionCapacity;
+    
+    double *constants;
+    int constantCount;
+    int constantCapacity;
+    
+    /** 以常量的位模式为键、开放寻址的散列表，存放常量索引加1，0表示空位 */
+    int *constantBuckets;
+    int constantBucketCount;
+    
+    /** 当前已生成的指令执行完之后的栈深度 */
+    int stackDepth;
+    int maxStackDepth;
+    
+    int temporaryCount;
+    
+    /** 所声明的变量名，变量名在该数组中的索引即为其槽位索引 */
+    const char *const *variableNames;
+    int variableCount;
+    
+    /** 生成过程中是否出现了存储空间分配失败 */
+    bool isOutOfMemory;
+};
+
+/** 获取指定操作码执行后对栈深度的影响 */
+static inline int GetOpcodeStackEffect(enum PROGRAM_OPCODE opcode)
+{
+    switch(opcode)
+    {
+    case PROGRAM_OPCODE_PUSH_CONSTANT:
+    case PROGRAM_OPCODE_PUSH_VARIABLE:
+    case PROGRAM_OPCODE_LOAD_TEMPORARY:
+        return 1;
+        
+    case PROGRAM_OPCODE_ADD ... PROGRAM_OPCODE_POW:
+        return -1;
+        
+    default:
+        return 0;
+    }
+}
+
+/** 往程序中添加一条指令 */
+static void EmitInstruction(struct ProgramBuilder *builder, enum PROGRAM_OPCODE opcode, int operand)
+{
+    if(builder->isOutOfMemory)
+        return;
+    
+    if(builder->instructionCount == builder->instructionCapacity)
+    {
+        var capacity = builder->instructionCapacity == 0? 32 : builder->instructionCapacity * 2;
+        var instructions = (struct ProgramInstruction*)realloc(builder->instructions, sizeof(struct ProgramInstruction) * capacity);
+        if(instructions == NULL)
+        {
+            builder->isOutOfMemory = true;
+            return;
+        }
+        builder->instructions = instructions;
+        builder->instructionCapacity = capacity;
+    }
+    
+    builder->instructions[builder->instructionCount++] = (struct ProgramInstruction){ .opcode = opcode, .operand = operand };
+    
+    builder->stackDepth += GetOpcodeStackEffect(opcode);
+    if(builder->stackDepth > builder->maxStackDepth)
+        builder->maxStackDepth = builder->stackDepth;
+}
+
+/**
+ * 往常量池末尾添加一个常量
+ * @return 该常量的索引
+*/
+static int AddProgramConstant(struct ProgramBuilder *builder, double value)
+{
+    if(builder->constantCount == builder->constantCapacity)
+    {
+        var capacity = builder->constantCapacity == 0? 16 : builder->constantCapacity * 2;
+        var constants = (double*)realloc(builder->constants, sizeof(double) * capacity);
+        if(constants == NULL)
+        {
+            builder->isOutOfMemory = true;
+            return 0;
+        }
+        builder->constants = constants;
+        builder->constantCapacity = capacity;
+    }
+    builder->constants[builder->constantCount] = value;
+    return builder->constantCount++;
+}
+
+static inline uint32_t HashProgramConstant(uint64_t bits)
+{
+    bits = (bits ^ (bits >> 31)) * UINT64_C(0xBF58476D1CE4E5B9);
+    bits = (bits ^ (bits >> 29)) * UINT64_C(0x94D049BB133111EB);
+    return (uint32_t)(bits >> 32);
+}
+
+/** 将常量散列表扩大一倍，并重新放入所有常量 */
+static bool GrowProgramConstantBuckets(struct ProgramBuilder *builder)
+{
+    var bucketCount = builder->constantBucketCount == 0? 64 : builder->constantBucketCount * 2;
+    var buckets = (int*)calloc(bucketCount, sizeof(int));
+    if(buckets == NULL)
+        return false;
+    
+    for(var i = 0; i < builder->constantCount; i++)
+    {
+        uint64_t bits;
+        memcpy(&bits, &builder->constants[i], sizeof(bits));
+        var index = HashProgramConstant(bits) & (bucketCount - 1);
+        while(buckets[index] != 0)
+            index = (index + 1) & (bucketCount - 1);
+        buckets[index] = i + 1;
+    }
+    
+    free(builder->constantBuckets);
+    builder->constantBuckets = buckets;
+    builder->constantBucketCount = bucketCount;
+    return true;
+}
+
+/** 往程序中添加一条压入常量的指令，相同的常量在常量池中只保存一份 */
+static void EmitConstant(struct ProgramBuilder *builder, double value)
+{
+    if(builder->isOutOfMemory)
+        return;
+    
+    // 散列表的装载率保持在一半以下
+    if(builder->constantCount * 2 >= builder->constantBucketCount && !GrowProgramConstantBuckets(builder))
+    {
+        builder->isOutOfMemory = true;
+        return;
+    }
+    
+    // 这里按位进行比较，以区分0.0与-0.0
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    var mask = builder->constantBucketCount - 1;
+    var bucket = HashProgramConstant(bits) & mask;
+    var index = -1;
+    while(builder->constantBuckets[bucket] != 0)
+    {
+        var candidate = builder->constantBuckets[bucket] - 1;
+        if(memcmp(&builder->constants[candidate], &value, sizeof(value)) == 0)
+        {
+            index = candidate;
+            break;
+        }
+        bucket = (bucket + 1) & mask;
+    }
+    
+    if(index < 0)
+    {
+        index = AddProgramConstant(builder, value);
+        if(builder->isOutOfMemory)
+            return;
+        builder->constantBuckets[bucket] = index + 1;
+    }
+    
+    EmitInstruction(builder, PROGRAM_OPCODE_PUSH_CONSTANT, index);
+}
+
+/** 判定当前字符是否可以作为变量名中除首字符以外的字符 */
+static inline bool IsVariableNameCharacter(char ch)
+{
+    return IsMathFunction(ch) || IsDigital(ch) || ch == '_';
+}
+
+/**
+ * 解析当前游标处的变量名
+ * @param builder 程序生成上下文，其中包含了所声明的变量名
+ * @param cursor 指向变量名的起始字符，该字符必须为小写字母
+ * @param pLength 输出变量名所占用的字符个数
+ * @return 若当前标识符是一个已声明的变量，返回其槽位索引，否则返回-1
+*/
+static int ParseVariable(const struct ProgramBuilder *builder, const char *cursor, int *pLength)
+{
+    if(builder->variableCount == 0 || !IsMathFunction(cursor[0]))
+        return -1;
+    
+    var length = 1;
+    while(IsVariableNameCharacter(cursor[length]))
+        length++;
+    
+    // 表达式已被过滤为小写，而变量名在声明时可以含有大写字母，所以这里忽略大小写进行比较
+    for(var i = 0; i < builder->variableCount; i++)
+    {
+        const char *name = builder->variableNames[i];
+        if(strncasecmp(name, cursor, length) == 0 && name[length] == '\0')
+        {
+            *pLength = length;
+            return i;
+        }
+    }
+    
+    return -1;
+}
+
+/**
+ * 判定所声明的变量名是否合法。
+ * 变量名须以字母开头，后面跟字母、数字或下划线，且不能与数学常量、数学函数或归约同名
+*/
+static bool IsValidVariableName(const char *name)
+{
+    if(name == NULL || !IsMathFunction(name[0] | 0x20))
+        return false;
+    
+    for(var i = 1; name[i] != '\0'; i++)
+    {
+        // '_'或上0x20之后就不再是'_'了，所以这里只将大写字母转为小写
+        if(!IsVariableNameCharacter((name[i] >= 'A' && name[i] <= 'Z')? name[i] | 0x20 : name[i]))
+            return false;
+    }
+    
+    if(strcasecmp(name, "pi") == 0 || strcasecmp(name, "e") == 0)
+        return false;
+    
+    // 数学函数名最多只有MATH_FUNCTION_NAME_MAX_LENGTH个字符，归约名则最多有REDUCTION_NAME_MAX_LENGTH个字符（比如integrate），
+    // 我们将其转为小写之后再到函数表与归约名中查找
+    var length = (int)strlen(name);
+    if(length <= REDUCTION_NAME_MAX_LENGTH)
+    {
+        char lowerName[REDUCTION_NAME_MAX_LENGTH + 1] = { '\0' };
+        for(var i = 0; i < length; i++)
+            lowerName[i] = name[i] | 0x20;
+        
+        var funcLength = 0;
+        if(ParseMathFunctionIndex(lowerName, &funcLength) >= 0 && funcLength == length)
+            return false;
+        
+        if(FindReductionKind(lowerName, length) >= 0)
+            return false;
+    }
+    
+    return true;
+}
+
+/**
+ * 准备生成一个新的操作数。
+ * ParseArithmeticExpression在遇到连续出现的操作数时（比如2(3)），会用后一个操作数覆盖前一个，
+ * 而被覆盖的操作数的指令必定位于当前指令序列的末尾，所以这里直接将其丢弃
+ * @param pOperandStart 指向该操作数第一条指令的索引，若为-1则表示该操作数尚未生成。
+ * 它既是输入又是输出，输出新操作数第一条指令的索引
+*/
+static void BeginOperand(struct ProgramBuilder *builder, int *pOperandStart)
+{
+    if(*pOperandStart >= 0)
+    {
+        builder->instructionCount = *pOperandStart;
+        builder->stackDepth--;
+    }
+    *pOperandStart = builder->instructionCount;
+}
+
+/**
+ * 在当前解析层级结束时生成剩余的计算指令，与ParseArithmeticExpression的返回值相对应
+ * @param opcode 当前层级尚未归约的操作码
+ * @param leftStart 左操作数第一条指令的索引，为-1表示没有左操作数
+ * @param rightStart 右操作数第一条指令的索引，为-1表示没有右操作数
+*/
+static void FinishCompilePhase(struct ProgramBuilder *builder, enum PROGRAM_OPCODE opcode, int leftStart, int rightStart)
+{
+    // 缺省的操作数值为0.0，这与ParseArithmeticExpression中的初始值保持一致
+    if(opcode == PROGRAM_OPCODE_INVALID)
+    {
+        if(leftStart < 0)
+            EmitConstant(builder, 0.0);
+    }
+    else
+    {
+        if(rightStart < 0)
+            EmitConstant(builder, 0.0);
+        EmitInstruction(builder, opcode, 0);
+    }
+}
+
+/**
+ * 编译时进入左括号之前所保存的外层状态，与EvaluationFrame相对应。
+ * 碰到更高优先级的操作符时，尚待生成的操作码则以enum PROGRAM_OPCODE的形式压在同一个栈上，
+ * 所以这里的成员都只有4个字节，以保持栈上各项的对齐
+*/
+struct CompileFrame
+{
+    int leftStart;
+    int rightStart;
+    int funcIndex;
+    enum PROGRAM_OPCODE opcode;
+    enum PARSE_PHASE_STATUS status;
+    enum OPERATOR_PRIORITY priority;
+    
+    /** 外层括号中尚待生成的操作码个数 */
+    int pendingCount;
+};
+
+/**
+ * 将过滤之后的算术表达式编译为后缀形式的指令序列。
+ * 该函数的解析流程与ParseArithmeticExpression逐步对应，只是把每一步计算替换为生成相应的指令，
+ * 从而保证编译后的程序与直接解析计算的结果逐位相同，并且对同一表达式的合法性判定也完全一致。
+ * 与EvaluateArithmeticSpan一样，括号层级以及碰到更高优先级操作符时尚待生成的操作码都放在显式的栈上，而不是通过递归，
+ * 因此表达式的长度与括号的嵌套深度都不受函数栈大小的限制
+ * @param builder 程序生成上下文
+ * @param expr 过滤之后的表达式，以'\0'结尾
+ * @param length 表达式的长度
+ * @return 若表达式合法，返回true
+*/
+static bool CompileArithmeticExpressionSpan(struct ProgramBuilder *builder, const char *expr, size_t length)
+{
+    const char *cursor = expr;
+    const char *end = expr + length;
+    
+    // 括号层级与尚待生成的操作码都先使用函数栈上的空间，不够时再从堆上分配
+    alignas(16) unsigned char stackSpace[EVALUATION_STACK_SIZE];
+    struct EvaluationBuffer stack = { stackSpace, sizeof(stackSpace), false };
+    size_t stackTop = 0;
+    size_t depth = 0;
+    
+    // 当前括号层中尚待生成的操作码个数
+    var pendingCount = 0;
+    
+    // 当前层级的状态，与递归解析时各层调用的局部变量相对应
+    var leftStart = -1;
+    var rightStart = -1;
+    enum PARSE_PHASE_STATUS status = PARSE_PHASE_STATUS_LEFT_OPERAND;
+    enum OPERATOR_PRIORITY priority = OPERATOR_PRIORITY_ADD;
+    
+    // 当前尚未归约的操作码
+    enum PROGRAM_OPCODE opcode = PROGRAM_OPCODE_INVALID;
+    
+    // 当前待调用的数学函数索引
+    var funcIndex = -1;
+    
+    var tokenLength = 0;
+    
+    bool isSuccessful = true;
+    
+    while(true)
+    {
+        var ch = *cursor;
+        var charClass = GetCharacterClass(ch);
+        
+        // 已声明的变量优先于数学常量与数学函数，其用法与数字字面量完全相同
+        var varIndex = ParseVariable(builder, cursor, &tokenLength);
+        if(varIndex >= 0)
+        {
+            cursor += tokenLength;
+            
+            BeginOperand(builder, (status & PARSE_PHASE_STATUS_RIGHT_OPERAND) == PARSE_PHASE_STATUS_LEFT_OPERAND? &leftStart : &rightStart);
+            EmitInstruction(builder, PROGRAM_OPCODE_PUSH_VARIABLE, varIndex);
+            if((status & PARSE_PHASE_STATUS_HAS_NEG) != 0)
+                EmitInstruction(builder, PROGRAM_OPCODE_NEG, 0);
+            
+            status &= ~PARSE_PHASE_STATUS_HAS_NEG;
+            status |= PARSE_PHASE_STATUS_NEED_OPERATOR;
+        }
+        else if(charClass == CHARACTER_CLASS_DIGIT || (charClass == CHARACTER_CLASS_LETTER && IsMathConstant(cursor) > 0))
+        {
+            double value = ParseDigital(cursor, &tokenLength);
+            cursor += tokenLength;
+            
+            // 负数符号只会作用于字面量，因此我们直接将相反数放入常量池
+            if((status & PARSE_PHASE_STATUS_HAS_NEG) != 0)
+                value = -value;
+            
+            BeginOperand(builder, (status & PARSE_PHASE_STATUS_RIGHT_OPERAND) == PARSE_PHASE_STATUS_LEFT_OPERAND? &leftStart : &rightStart);
+            EmitConstant(builder, value);
+            
+            status &= ~PARSE_PHASE_STATUS_HAS_NEG;
+            status |= PARSE_PHASE_STATUS_NEED_OPERATOR;
+        }
+        else if(charClass == CHARACTER_CLASS_LETTER)
+        {
+            funcIndex = ParseMathFunctionIndex(cursor, &tokenLength);
+            if(funcIndex < 0 && IsReductionCall(cursor))
+            {
+                // 归约的上下界与被归约的表达式都只能含有常量与索引变量，所以在编译时就求出其值，作为常量放入常量池
+                double value;
+                size_t reductionLength;
+                if(!EvaluateReduction(cursor, (size_t)(end - cursor), MATH_KERNEL_SET_LIBM, &value, &reductionLength, NULL))
+                {
+                    isSuccessful = false;
+                    break;
+                }
+                cursor += reductionLength;
+                
+                BeginOperand(builder, (status & PARSE_PHASE_STATUS_RIGHT_OPERAND) == PARSE_PHASE_STATUS_LEFT_OPERAND? &leftStart : &rightStart);
+                EmitConstant(builder, value);
+                
+                status |= PARSE_PHASE_STATUS_NEED_OPERATOR;
+                continue;
+            }
+            if(funcIndex < 0)
+            {
+                isSuccessful = false;
+                break;
+            }
+            cursor += tokenLength;
+            if(*cursor != '(')
+            {
+                isSuccessful = false;
+                break;
+            }
+        }
+        else if(charClass == CHARACTER_CLASS_OPERATOR || charClass == CHARACTER_CLASS_LEFT_PARENTHESIS || charClass == CHARACTER_CLASS_RIGHT_PARENTHESIS)
+        {
+            if(ch == '(')
+            {
+                cursor++;
+                
+                BeginOperand(builder, (status & PARSE_PHASE_STATUS_RIGHT_OPERAND) == 0? &leftStart : &rightStart);
+                
+                // 保存外层状态，随后从一个新的层级开始解析括号中的内容
+                if(!ReserveEvaluationStack(&stack, NULL, stackTop, sizeof(struct CompileFrame)))
+                {
+                    builder->isOutOfMemory = true;
+                    isSuccessful = false;
+                    break;
+                }
+                *(struct CompileFrame*)(stack.memory + stackTop) = (struct CompileFrame){
+                    .leftStart = leftStart, .rightStart = rightStart, .funcIndex = funcIndex, .opcode = opcode,
+                    .status = status, .priority = priority, .pendingCount = pendingCount
+                };
+                stackTop += sizeof(struct CompileFrame);
+                depth++;
+                
+                pendingCount = 0;
+                leftStart = -1;
+                rightStart = -1;
+                funcIndex = -1;
+                opcode = PROGRAM_OPCODE_INVALID;
+                status = PARSE_PHASE_STATUS_LEFT_OPERAND | PARSE_PHASE_STATUS_LEFT_PARENTHESIS;
+                priority = OPERATOR_PRIORITY_ADD;
+                continue;
+            }
+            else if(ch == ')')
+            {
+                // 最外层碰到')'说明它没有与之匹配的'('
+                if(depth == 0)
+                {
+                    isSuccessful = false;
+                    break;
+                }
+                
+                // 结束括号中的当前层级，并按后进先出的顺序生成括号中尚待生成的操作码，然后回到外层
+                FinishCompilePhase(builder, opcode, leftStart, rightStart);
+                for(; pendingCount > 0; pendingCount--)
+                {
+                    stackTop -= sizeof(enum PROGRAM_OPCODE);
+                    EmitInstruction(builder, *(const enum PROGRAM_OPCODE*)(stack.memory + stackTop), 0);
+                }
+                
+                stackTop -= sizeof(struct CompileFrame);
+                depth--;
+                const var frame = *(const struct CompileFrame*)(stack.memory + stackTop);
+                leftStart = frame.leftStart;
+                rightStart = frame.rightStart;
+                funcIndex = frame.funcIndex;
+                opcode = frame.opcode;
+                status = frame.status;
+                priority = frame.priority;
+                pendingCount = frame.pendingCount;
+                
+                if(funcIndex >= 0)
+                {
+                    EmitInstruction(builder, PROGRAM_OPCODE_CALL, funcIndex);
+                    funcIndex = -1;
+                }
+                
+                status &= ~PARSE_PHASE_STATUS_LEFT_PARENTHESIS;
+                status |= PARSE_PHASE_STATUS_NEED_OPERATOR;
+            }
+            else
+            {
+                if((status & PARSE_PHASE_STATUS_NEED_OPERATOR) == 0)
+                {
+                    if(ch == '-')
+                    {
+                        if(IsDigital(cursor[1]) || IsMathConstant(&cursor[1]) > 0 || ParseVariable(builder, &cursor[1], &tokenLength) >= 0)
+                            status |= PARSE_PHASE_STATUS_HAS_NEG;
+                        else
+                        {
+                            isSuccessful = false;
+                            break;
+                        }
+                    }
+                    else
+                    {
+                        isSuccessful = false;
+                        break;
+                    }
+                }
+                else
+                {
+                    enum PROGRAM_OPCODE tmpOpcode = opCodeTables[ch - '%'];
+                    const var info = GetOperatorInfo(ch);
+                    var pry = info->priority;
+                    
+                    if(opcode == PROGRAM_OPCODE_INVALID)
+                        opcode = tmpOpcode;
+                    
+                    if((status & PARSE_PHASE_STATUS_RIGHT_OPERAND) == 0)
+                        status |= PARSE_PHASE_STATUS_RIGHT_OPERAND;
+                    else
+                    {
+                        if(priority >= info->reducePriority)
+                        {
+                            // 归约之后，左操作数的指令就包含了原先左右两个操作数以及当前操作
+                            FinishCompilePhase(builder, opcode, leftStart, rightStart);
+                            rightStart = -1;
+                            opcode = tmpOpcode;
+                        }
+                        else
+                        {
+                            // 与ParseArithmeticExpression一样，将减法与除法分别改写为加上相反数以及乘以倒数
+                            if(opcode == PROGRAM_OPCODE_MINUS)
+                            {
+                                opcode = PROGRAM_OPCODE_ADD;
+                                EmitInstruction(builder, PROGRAM_OPCODE_NEG, 0);
+                            }
+                            else if(opcode == PROGRAM_OPCODE_DIV)
+                            {
+                                opcode = PROGRAM_OPCODE_MUL;
+                                EmitInstruction(builder, PROGRAM_OPCODE_RECIPROCAL, 0);
+                            }
+                            
+                            // 当前操作码要等高优先级的运算全部生成之后才能生成，所以先将其压栈
+                            if(!ReserveEvaluationStack(&stack, NULL, stackTop, sizeof(enum PROGRAM_OPCODE)))
+                            {
+                                builder->isOutOfMemory = true;
+                                isSuccessful = false;
+                                break;
+                            }
+                            *(enum PROGRAM_OPCODE*)(stack.memory + stackTop) = opcode;
+                            stackTop += sizeof(enum PROGRAM_OPCODE);
+                            pendingCount++;
+                            
+                            // 当前的右操作数将作为高优先级运算的左操作数，并且从当前操作符处重新开始解析
+                            leftStart = rightStart;
+                            rightStart = -1;
+                            opcode = PROGRAM_OPCODE_INVALID;
+                            status = PARSE_PHASE_STATUS_LEFT_OPERAND | PARSE_PHASE_STATUS_NEED_OPERATOR;
+                            priority = pry;
+                            continue;
+                        }
+                    }
+                    priority = pry;
+                }
+                status &= ~PARSE_PHASE_STATUS_NEED_OPERATOR;
+            }
+            
+            cursor++;
+        }
+        else
+        {
+            // 表达式结束时，所有的括号都必须已经闭合
+            if(ch != '\0' || depth > 0)
+                isSuccessful = false;
+            break;
+        }
+    }
+    
+    if(isSuccessful)
+    {
+        FinishCompilePhase(builder, opcode, leftStart, rightStart);
+        for(; pendingCount > 0; pendingCount--)
+        {
+            stackTop -= sizeof(enum PROGRAM_OPCODE);
+            EmitInstruction(builder, *(const enum PROGRAM_OPCODE*)(stack.memory + stackTop), 0);
+        }
+    }
+    
+    if(stack.isAllocated)
+        free(stack.memory);
+    
+    return isSuccessful;
+}
+
+/** 表达式图中的一个节点，它对应编译后程序中的一条指令及其所有操作数 */
+struct ExpressionNode
+{
+    /** 节点的操作码，常量节点为PROGRAM_OPCODE_PUSH_CONSTANT，变量节点为PROGRAM_OPCODE_PUSH_VARIABLE */
+    uint8_t opcode;
+    
+    /** 变量节点的槽位索引，或者函数调用节点的函数索引 */
+    int operand;
+    
+    /** 常量节点的值 */
+    double value;
+    
+    /** 左右子节点的索引，一元操作只有左子节点，没有子节点时为-1 */
+    int left;
+    int right;
+    
+    /** 从根节点可达的父节点对该节点的引用次数 */
+    int useCount;
+    
+    /** 共享节点的结果所存放的临时单元索引，常量节点则为其常量池索引，-1表示尚未分配 */
+    int slot;
+};
+
+/**
+ * 由编译后的程序所构造的表达式有向无环图。
+ * 所有节点都经过散列去重，因此完全相同的子表达式只会对应同一个节点
+*/
+struct ExpressionGraph
+{
+    struct ExpressionNode *nodes;
+    int nodeCount;
+    int nodeCapacity;
+    
+    /** 开放寻址的散列表，存放节点索引加1，0表示空位 */
+    int *buckets;
+    int bucketCount;
+    
+    bool isOutOfMemory;
+};
+
+/** 判定一个节点是否为指定值的常量，这里按位进行比较，以区分0.0与-0.0 */
+static inline bool IsConstantNode(const struct ExpressionGraph *graph, int node, double value)
+{
+    return graph->nodes[node].opcode == PROGRAM_OPCODE_PUSH_CONSTANT && memcmp(&graph->nodes[node].value, &value, sizeof(value)) == 0;
+}
+
+static uint32_t HashExpressionNode(const struct ExpressionNode *node)
+{
+    uint64_t bits;
+    memcpy(&bits, &node->value, sizeof(bits));
+    
+    var hash = (uint64_t)node->opcode * UINT64_C(0x9E3779B97F4A7C15);
+    hash = (hash ^ (uint64_t)(uint32_t)node->operand) * UINT64_C(0xBF58476D1CE4E5B9);
+    hash = (hash ^ bits) * UINT64_C(0x94D049BB133111EB);
+    hash = (hash ^ (uint64_t)(uint32_t)node->left) * UINT64_C(0x9E3779B97F4A7C15);
+    hash = (hash ^ (uint64_t)(uint32_t)node->right) * UINT64_C(0xBF58476D1CE4E5B9);
+    return (uint32_t)(hash >> 32);
+}
+
+static inline bool IsSameExpressionNode(const struct ExpressionNode *a, const struct ExpressionNode *b)
+{
+    return a->opcode == b->opcode && a->operand == b->operand && a->left == b->left && a->right == b->right &&
+            memcmp(&a->value, &b->value, sizeof(a->value)) == 0;
+}
+
+/** 将散列表扩大一倍，并重新放入所有节点 */
+static bool GrowExpressionGraphBuckets(struct ExpressionGraph *graph)
+{
+    var bucketCount = graph->bucketCount == 0? 256 : graph->bucketCount * 2;
+    var buckets = (int*)calloc(bucketCount, sizeof(int));
+    if(buckets == NULL)
+        return false;
+    
+    for(var i = 0; i < graph->nodeCount; i++)
+    {
+        var index = HashExpressionNode(&graph->nodes[i]) & (bucketCount - 1);
+        while(buckets[index] != 0)
+            index = (index + 1) & (bucketCount - 1);
+        buckets[index] = i + 1;
+    }
+    
+    free(graph->buckets);
+    graph->buckets = buckets;
+    graph->bucketCount = bucketCount;
+    return true;
+}
+
+/**
+ * 在图中查找与key完全相同的节点，若不存在则添加一个新节点
+ * @return 节点索引，若存储空间不足，返回-1
+*/
+static int InternExpressionNode(struct ExpressionGraph *graph, const struct ExpressionNode *key)
+{
+    if(graph->isOutOfMemory)
+        return -1;
+    
+    // 保持散列表的负载不超过一半
+    if((graph->nodeCount + 1) * 2 > graph->bucketCount && !GrowExpressionGraphBuckets(graph))
+    {
+        graph->isOutOfMemory = true;
+        return -1;
+    }
+    
+    var index = HashExpressionNode(key) & (graph->bucketCount - 1);
+    while(graph->buckets[index] != 0)
+    {
+        var node = graph->buckets[index] - 1;
+        if(IsSameExpressionNode(&graph->nodes[node], key))
+            return node;
+        index = (index + 1) & (graph->bucketCount - 1);
+    }
+    
+    if(graph->nodeCount == graph->nodeCapacity)
+    {
+        var capacity = graph->nodeCapacity == 0? 64 : graph->nodeCapacity * 2;
+        var nodes = (struct ExpressionNode*)realloc(graph->nodes, sizeof(struct ExpressionNode) * capacity);
+        if(nodes == NULL)
+        {
+            graph->isOutOfMemory = true;
+            return -1;
+        }
+        graph->nodes = nodes;
+        graph->nodeCapacity = capacity;
+    }
+    
+    var node = graph->nodeCount++;
+    graph->nodes[node] = *key;
+    graph->buckets[index] = node + 1;
+    return node;
+}
+
+static inline int MakeConstantNode(struct ExpressionGraph *graph, double value)
+{
+    return InternExpressionNode(graph, &(struct ExpressionNode){ .opcode = PROGRAM_OPCODE_PUSH_CONSTANT, .value = value, .left = -1, .right = -1 });
+}
+
+/**
+ * 构造一个操作节点，并在构造时完成常量折叠与代数化简。
+ * 常量折叠所使用的运算与EvaluateArithmeticProgram完全相同，
+ * 而代数化简只采用对所有输入（包括无穷大、NaN以及带符号的零）都成立的恒等式，
+ * 因此优化后的程序与优化前的计算结果逐位相同。唯一的例外是NaN的符号位：
+ * 比如glibc的pow(NaN, 1)会清除NaN的符号位，而x^1被化简为x之后则会保留它
+ * @return 节点索引，若存储空间不足，返回-1
+*/
+static int MakeOperationNode(struct ExpressionGraph *graph, enum PROGRAM_OPCODE opcode, int operand, int left, int right)
+{
+    if(left < 0 || (right < 0 && GetOpcodeStackEffect(opcode) < 0))
+        return -1;
+    
+    var nodes = graph->nodes;
+    var isLeftConstant = nodes[left].opcode == PROGRAM_OPCODE_PUSH_CONSTANT;
+    var isRightConstant = right < 0 || nodes[right].opcode == PROGRAM_OPCODE_PUSH_CONSTANT;
+    
+    if(isLeftConstant && isRightConstant)
+    {
+        var a = nodes[left].value;
+        var b = right < 0? 0.0 : nodes[right].value;
+        var isFoldable = true;
+        double value = 0.0;
+        
+        switch(opcode)
+        {
+        case PROGRAM_OPCODE_ADD:
+            value = a + b;
+            break;
+        case PROGRAM_OPCODE_MINUS:
+            value = a - b;
+            break;
+        case PROGRAM_OPCODE_MUL:
+            value = a * b;
+            break;
+        case PROGRAM_OPCODE_DIV:
+            value = a / b;
+            break;
+        case PROGRAM_OPCODE_MOD:
+            // 除数为0或-1的整数求模可能引发异常，这种情况留到求值时再计算，以保持原有的行为
+            isFoldable = (int64_t)b != 0 && (int64_t)b != -1;
+            if(isFoldable)
+                value = ModOp(a, b);
+            break;
+        case PROGRAM_OPCODE_POW:
+            value = pow(a, b);
+            break;
+        case PROGRAM_OPCODE_NEG:
+            value = -a;
+            break;
+        case PROGRAM_OPCODE_RECIPROCAL:
+            value = 1.0 / a;
+            break;
+        case PROGRAM_OPCODE_CALL:
+            value = mathFuncList[operand].pFunc(a);
+            break;
+        default:
+            isFoldable = false;
+            break;
+        }
+        
+        if(isFoldable)
+            return MakeConstantNode(graph, value);
+    }
+    
+    switch(opcode)
+    {
+    case PROGRAM_OPCODE_ADD:
+        // x + (-0.0) == x，但x + 0.0对于x == -0.0并不成立
+        if(IsConstantNode(graph, right, -0.0))
+            return left;
+        if(IsConstantNode(graph, left, -0.0))
+            return right;
+        break;
+        
+    case PROGRAM_OPCODE_MINUS:
+        if(IsConstantNode(graph, right, 0.0))
+            return left;
+        break;
+        
+    case PROGRAM_OPCODE_MUL:
+        if(IsConstantNode(graph, right, 1.0))
+            return left;
+        if(IsConstantNode(graph, left, 1.0))
+            return right;
+        break;
+        
+    case PROGRAM_OPCODE_DIV:
+        if(IsConstantNode(graph, right, 1.0))
+            return left;
+        break;
+        
+    case PROGRAM_OPCODE_POW:
+        // pow(x, 1) == x（NaN的符号位除外）；而pow(x, ±0)与pow(1, y)对于任何x与y（包括NaN）都等于1
+        if(IsConstantNode(graph, right, 1.0))
+            return left;
+        if(IsConstantNode(graph, right, 0.0) || IsConstantNode(graph, right, -0.0) || IsConstantNode(graph, left, 1.0))
+            return MakeConstantNode(graph, 1.0);
+        break;
+        
+    case PROGRAM_OPCODE_NEG:
+        if(nodes[left].opcode == PROGRAM_OPCODE_NEG)
+            return nodes[left].left;
+        break;
+        
+    default:
+        break;
+    }
+    
+    return InternExpressionNode(graph, &(struct ExpressionNode){ .opcode = opcode, .operand = operand, .left = left, .right = right });
+}
+
+/**
+ * 模拟执行程序，将其转换为表达式图
+ * @return 根节点的索引，若失败，返回-1
+*/
+static int BuildExpressionGraph(struct ExpressionGraph *graph, const struct ProgramBuilder *source)
+{
+    var stack = (int*)malloc(sizeof(int) * (source->maxStackDepth + 1));
+    if(stack == NULL)
+        return -1;
+    
+    var top = -1;
+    
+    for(var i = 0; i < source->instructionCount; i++)
+    {
+        var instruction = source->instructions[i];
+        var node = -1;
+        
+        switch(instruction.opcode)
+        {
+        case PROGRAM_OPCODE_PUSH_CONSTANT:
+            node = MakeConstantNode(graph, source->constants[instruction.operand]);
+            break;
+            
+        case PROGRAM_OPCODE_PUSH_VARIABLE:
+            node = InternExpressionNode(graph, &(struct ExpressionNode){ .opcode = PROGRAM_OPCODE_PUSH_VARIABLE, .operand = instruction.operand, .left = -1, .right = -1 });
+            break;
+            
+        case PROGRAM_OPCODE_ADD ... PROGRAM_OPCODE_POW:
+            top--;
+            node = MakeOperationNode(graph, instruction.opcode, 0, stack[top], stack[top + 1]);
+            top--;
+            break;
+            
+        default:
+            node = MakeOperationNode(graph, instruction.opcode, instruction.operand, stack[top], -1);
+            top--;
+            break;
+        }
+        
+        if(node < 0)
+        {
+            top = -1;
+            break;
+        }
+        stack[++top] = node;
+    }
+    
+    var root = (top == 0)? stack[0] : -1;
+    free(stack);
+    return root;
+}
+
+/**
+ * 按后序遍历从根节点生成程序。
+ * 被引用多次的操作节点在第一次计算之后将结果存入一个临时单元，之后的引用直接从临时单元读取。
+ * 为了能处理任意深的表达式，这里使用显式的栈而不是递归
+ * @return 若生成成功，返回true
+*/
+static bool EmitExpressionGraph(struct ExpressionGraph *graph, int root, struct ProgramBuilder *target)
+{
+    var nodes = graph->nodes;
+    var stack = (int*)malloc(sizeof(int) * (graph->nodeCount + 1));
+    if(stack == NULL)
+        return false;
+    
+    // 先统计从根节点可达的各个节点的引用次数。每个节点只在第一次被访问时展开其子节点
+    for(var i = 0; i < graph->nodeCount; i++)
+    {
+        nodes[i].useCount = 0;
+        nodes[i].slot = -1;
+    }
+    
+    var top = 0;
+    stack[0] = root;
+    nodes[root].useCount = 1;
+    
+    while(top >= 0)
+    {
+        var node = stack[top--];
+        
+        int children[] = { nodes[node].left, nodes[node].right };
+        for(var i = 0; i < 2; i++)
+        {
+            var child = children[i];
+            if(child >= 0 && nodes[child].useCount++ == 0)
+                stack[++top] = child;
+        }
+    }
+    
+    // 后序遍历，stages记录每个节点已经展开了几个子节点
+    var stages = (uint8_t*)calloc(graph->nodeCount, 1);
+    if(stages == NULL)
+    {
+        free(stack);
+        return false;
+    }
+    
+    var temporaryCount = 0;
+    top = 0;
+    stack[0] = root;
+    
+    while(top >= 0 && !target->isOutOfMemory)
+    {
+        var node = stack[top];
+        var pNode = &nodes[node];
+        
+        if(pNode->opcode == PROGRAM_OPCODE_PUSH_CONSTANT)
+        {
+            if(pNode->slot < 0)
+                pNode->slot = AddProgramConstant(target, pNode->value);
+            EmitInstruction(target, PROGRAM_OPCODE_PUSH_CONSTANT, pNode->slot);
+            top--;
+            continue;
+        }
+        
+        if(pNode->opcode == PROGRAM_OPCODE_PUSH_VARIABLE)
+        {
+            EmitInstruction(target, PROGRAM_OPCODE_PUSH_VARIABLE, pNode->operand);
+            top--;
+            continue;
+        }
+        
+        // 已经计算过的共享节点直接读取临时单元
+        if(pNode->slot >= 0)
+        {
+            EmitInstruction(target, PROGRAM_OPCODE_LOAD_TEMPORARY, pNode->slot);
+            top--;
+            continue;
+        }
+        
+        if(stages[node] == 0)
+        {
+            stages[node] = 1;
+            stack[++top] = pNode->left;
+        }
+        else if(stages[node] == 1 && pNode->right >= 0)
+        {
+            stages[node] = 2;
+            stack[++top] = pNode->right;
+        }
+        else
+        {
+            EmitInstruction(target, pNode->opcode, pNode->operand);
+            if(pNode->useCount > 1)
+            {
+                pNode->slot = temporaryCount++;
+                EmitInstruction(target, PROGRAM_OPCODE_STORE_TEMPORARY, pNode->slot);
+            }
+            stages[node] = 0;
+            top--;
+        }
+    }
+    
+    target->temporaryCount = temporaryCount;
+    
+    free(stages);
+    free(stack);
+    
+    return !target->isOutOfMemory;
+}
+
+/** 统计表达式图中从根节点可达的节点个数，必须在EmitExpressionGraph之后调用 */
+static int CountReachableExpressionNodes(const struct ExpressionGraph *graph)
+{
+    var count = 0;
+    for(var i = 0; i < graph->nodeCount; i++)
+    {
+        if(graph->nodes[i].useCount > 0)
+            count++;
+    }
+    return count;
+}
+
+/**
+ * 优化编译后的程序：构造表达式有向无环图，折叠常量子表达式，做安全的代数化简，并消除公共子表达式
+ * @param source 优化前的程序
+ * @param target 用于存放优化后程序的空的生成上下文
+ * @param pNodeCount 若不为NULL，则输出优化后表达式图的节点个数
+ * @return 若优化成功，返回true
+*/
+static bool OptimizeProgram(const struct ProgramBuilder *source, struct ProgramBuilder *target, int *pNodeCount)
+{
+    struct ExpressionGraph graph = { 0 };
+    
+    var root = BuildExpressionGraph(&graph, source);
+    var isSuccessful = root >= 0 && !graph.isOutOfMemory && EmitExpressionGraph(&graph, root, target);
+    
+    if(isSuccessful && pNodeCount != NULL)
+        *pNodeCount = CountReachableExpressionNodes(&graph);
+    
+    free(graph.nodes);
+    free(graph.buckets);
+    
+    return isSuccessful;
+}
+
+/**
+ * 将生成上下文中的指令与常量打包成程序。
+ * 程序头、常量池以及指令序列放在同一块存储空间中，常量池紧跟在程序头之后，以保证其8字节对齐
+ * @return 打包后的程序，若存储空间不足，返回NULL
+*/
+static struct ArithmeticProgram* CreateArithmeticProgram(const struct ProgramBuilder *builder, int variableCount)
+{
+    var constantsSize = sizeof(double) * builder->constantCount;
+    var instructionsSize = sizeof(struct ProgramInstruction) * builder->instructionCount;
+    
+    var program = (struct ArithmeticProgram*)malloc(sizeof(struct ArithmeticProgram) + constantsSize + instructionsSize);
+    if(program == NULL)
+        return NULL;
+    
+    var constants = (double*)(program + 1);
+    var instructions = (struct ProgramInstruction*)((char*)constants + constantsSize);
+    if(builder->constantCount > 0)
+        memcpy(constants, builder->constants, constantsSize);
+    memcpy(instructions, builder->instructions, instructionsSize);
+    
+    program->variableCount = variableCount;
+    program->constantCount = builder->constantCount;
+    program->instructionCount = builder->instructionCount;
+    program->maxStackDepth = builder->maxStackDepth;
+    program->temporaryCount = builder->temporaryCount;
+    program->constants = constants;
+    program->instructions = instructions;
+    
+    return program;
+}
+
+/** 释放生成上下文中的存储空间 */
+static void DestroyProgramBuilder(struct ProgramBuilder *builder)
+{
+    free(builder->constants);
+    free(builder->constantBuckets);
+    free(builder->instructions);
+}
+
+/**
+ * 将算术表达式编译为程序
+ * @param isOptimized 是否对程序做优化
+ * @param pNodeCounts 若不为NULL，则输出优化前后的表达式节点个数
+*/
+static struct ArithmeticProgram* CompileArithmeticProgram(const char *expr, const char *const variableNames[], int variableCount, bool isOptimized, int pNodeCounts[2])
+{
+    if(expr[0] == '\0' || variableCount < 0)
+        return NULL;
+    
+    for(var i = 0; i < variableCount; i++)
+    {
+        if(!IsValidVariableName(variableNames[i]))
+            return NULL;
+    }
+    
+    // 过滤操作会修改字符串，所以我们这里先对表达式做一份拷贝
+    var length = (int)strlen(expr);
+    var buffer = (char*)malloc(length + 1);
+    if(buffer == NULL)
+        return NULL;
+    
+    memcpy(buffer, expr, length + 1);
+    NormalizeArithmeticExpression(buffer, buffer, length);
+    
+    struct ProgramBuilder builder = { .variableNames = variableNames, .variableCount = variableCount };
+    bool ret = CompileArithmeticExpressionSpan(&builder, buffer, length);
+    
+    free(buffer);
+    
+    struct ArithmeticProgram *program = NULL;
+    
+    if(ret && !builder.isOutOfMemory && builder.stackDepth == 1)
+    {
+        // 未经优化的程序中，每条指令都对应表达式树中的一个节点
+        if(pNodeCounts != NULL)
+            pNodeCounts[0] = pNodeCounts[1] = builder.instructionCount;
+        
+        if(isOptimized)
+        {
+            struct ProgramBuilder optimizedBuilder = { 0 };
+            if(OptimizeProgram(&builder, &optimizedBuilder, pNodeCounts != NULL? &pNodeCounts[1] : NULL))
+                program = CreateArithmeticProgram(&optimizedBuilder, variableCount);
+            DestroyProgramBuilder(&optimizedBuilder);
+        }
+        else
+            program = CreateArithmeticProgram(&builder, variableCount);
+    }
+    
+    DestroyProgramBuilder(&builder);
+    
+    return program;
+}
+
+/**
+ * 将算术表达式编译为可被反复求值的程序。
+ * 编译时会折叠常量子表达式、做安全的代数化简并消除公共子表达式，这些优化都不会改变计算结果
+ * @param expr 输入的算术表达式字符串，该函数不会修改它
+ * @param variableNames 表达式中可以使用的变量名，变量名在该数组中的索引即为其槽位索引。
+ * 变量名不区分大小写，且不能与数学常量或数学函数同名。若没有变量，可传NULL
+ * @param variableCount 变量个数
+ * @return 若表达式合法，返回编译后的程序，使用完毕后需用DestroyArithmeticProgram释放；否则返回NULL
+*/
+struct ArithmeticProgram* CompileArithmeticExpression(const char *expr, const char *const variableNames[], int variableCount)
+{
+    return CompileArithmeticProgram(expr, variableNames, variableCount, true, NULL);
+}
+
+/** 释放编译后的程序 */
+void DestroyArithmeticProgram(struct ArithmeticProgram *program)
+{
+    free(program);
+}
+
+/**
+ * 在给定的求值栈上执行编译后的程序
+ * @param stack 求值栈，至少包含program->maxStackDepth + program->temporaryCount个元素，临时单元紧跟在求值栈之后
+ * @param kernelSet 数学函数的实现方式
+*/
+static double RunArithmeticProgram(const struct ArithmeticProgram *program, const double bindings[], double stack[], enum MATH_KERNEL_SET kernelSet)
+{
+    // top始终指向当前栈顶元素
+    var top = stack - 1;
+    var temporaries = stack + program->maxStackDepth;
+    
+    const var constants = program->constants;
+    const var instructions = program->instructions;
+    const var count = program->instructionCount;
+    
+    for(var i = 0; i < count; i++)
+    {
+        var instruction = instructions[i];
+        
+        // 二元操作的实现与operatorTable中的各个操作函数保持一致
+        switch(instruction.opcode)
+        {
+        case PROGRAM_OPCODE_PUSH_CONSTANT:
+            *++top = constants[instruction.operand];
+            break;
+            
+        case PROGRAM_OPCODE_PUSH_VARIABLE:
+            *++top = bindings[instruction.operand];
+            break;
+            
+        case PROGRAM_OPCODE_ADD:
+            top--;
+            top[0] = top[0] + top[1];
+            break;
+            
+        case PROGRAM_OPCODE_MINUS:
+            top--;
+            top[0] = top[0] - top[1];
+            break;
+            
+        case PROGRAM_OPCODE_MUL:
+            top--;
+            top[0] = top[0] * top[1];
+            break;
+            
+        case PROGRAM_OPCODE_DIV:
+            top--;
+            top[0] = top[0] / top[1];
+            break;
+            
+        case PROGRAM_OPCODE_MOD:
+            top--;
+            top[0] = ModOp(top[0], top[1]);
+            break;
+            
+        case PROGRAM_OPCODE_POW:
+            top--;
+            top[0] = pow(top[0], top[1]);
+            break;
+            
+        case PROGRAM_OPCODE_NEG:
+            top[0] = -top[0];
+            break;
+            
+        case PROGRAM_OPCODE_RECIPROCAL:
+            top[0] = 1.0 / top[0];
+            break;
+            
+        case PROGRAM_OPCODE_CALL:
+            top[0] = GetMathFunction(instruction.operand, kernelSet)(top[0]);
+            break;
+            
+        case PROGRAM_OPCODE_LOAD_TEMPORARY:
+            *++top = temporaries[instruction.operand];
+            break;
+            
+        case PROGRAM_OPCODE_STORE_TEMPORARY:
+            temporaries[instruction.operand] = top[0];
+            break;
+            
+        default:
+            break;
+        }
+    }
+    
+    return *top;
+}
+
+/**
+ * 用指定的数学函数实现对编译后的程序进行求值。编译时被折叠的常量子表达式总是用libm计算
+ * @param program 由CompileArithmeticExpression所生成的程序
+ * @param bindings 各个变量的值，含义与EvaluateArithmeticProgram相同
+ * @param kernelSet 数学函数的实现方式
+ * @return 程序的计算结果
+*/
+double EvaluateArithmeticProgramWithKernels(const struct ArithmeticProgram *program, const double bindings[], enum MATH_KERNEL_SET kernelSet)
+{
+    double localStack[PROGRAM_LOCAL_STACK_SIZE];
+    
+    var stackSize = program->maxStackDepth + program->temporaryCount;
+    if(stackSize <= PROGRAM_LOCAL_STACK_SIZE)
+        return RunArithmeticProgram(program, bindings, localStack, kernelSet);
+    
+    var stack = (double*)malloc(sizeof(double) * stackSize);
+    if(stack == NULL)
+        return NAN;
+    
+    var result = RunArithmeticProgram(program, bindings, stack, kernelSet);
+    free(stack);
+    
+    return result;
+}
+
+/**
+ * 对编译后的程序进行求值，整个过程不再访问表达式源字符串
+ * @param program 由CompileArithmeticExpression所生成的程序
+ * @param bindings 各个变量的值，按槽位索引依次存放，其元素个数不少于program->variableCount。
+ * 若程序中没有变量，可传NULL
+ * @return 程序的计算结果
+*/
+double EvaluateArithmeticProgram(const struct ArithmeticProgram *program, const double bindings[])
+{
+    return EvaluateArithmeticProgramWithKernels(program, bindings, MATH_KERNEL_SET_LIBM);
+}
+
+/** 获取EvaluateArithmeticProgramInArena对该程序求值时所需的工作区字节数（已包含对齐所需的空间） */
+size_t GetArithmeticProgramArenaSize(const struct ArithmeticProgram *program)
+{
+    var stackSize = program->maxStackDepth + program->temporaryCount;
+    if(stackSize <= PROGRAM_LOCAL_STACK_SIZE)
+        return 0;
+    
+    return sizeof(double) * (size_t)stackSize + alignof(double) - 1;
+}
+
+/**
+ * 对编译后的程序进行求值，栈深度较大的程序所需的求值栈从调用者提供的工作区中分配，整个过程不会分配堆存储空间
+ * @param program 由CompileArithmeticExpression所生成的程序
+ * @param bindings 各个变量的值，含义与EvaluateArithmeticProgram相同
+ * @param arena 工作区，其剩余空间至少需要GetArithmeticProgramArenaSize(program)个字节
+ * @param pValue 输出计算结果，与EvaluateArithmeticProgram的结果逐位相同
+ * @return 若求值成功，返回true，若工作区空间不足，返回false
+*/
+bool EvaluateArithmeticProgramInArena(const struct ArithmeticProgram *program, const double bindings[], struct CalculationArena *arena, double *pValue)
+{
+    double localStack[PROGRAM_LOCAL_STACK_SIZE];
+    double *stack = localStack;
+    var savedUsed = arena->used;
+    
+    var stackSize = program->maxStackDepth + program->temporaryCount;
+    if(stackSize > PROGRAM_LOCAL_STACK_SIZE)
+    {
+        stack = (double*)AllocateFromCalculationArena(arena, sizeof(double) * (size_t)stackSize, alignof(double));
+        if(stack == NULL)
+            return false;
+    }
+    
+    *pValue = RunArithmeticProgram(program, bindings, stack, MATH_KERNEL_SET_LIBM);
+    arena->used = savedUsed;
+    
+    return true;
+}
+
+/** 按列求值时，每次处理的数据块所包含的元素个数 */
+#define COLUMN_BLOCK_SIZE       128
+
+/** 每个向量所包含的double元素个数 */
+#define COLUMN_VECTOR_LENGTH    4
+
+/** 每个数据块所包含的向量个数 */
+#define COLUMN_BLOCK_VECTORS    (COLUMN_BLOCK_SIZE / COLUMN_VECTOR_LENGTH)
+
+/**
+ * 按列求值时所使用的向量类型。
+ * 这里使用GNU C的向量扩展，编译器会根据目标指令集将其映射为AVX2、SSE2等指令，
+ * 对于不支持SIMD的处理器则映射为标量指令
+*/
+typedef double ColumnVector __attribute__((vector_size(COLUMN_VECTOR_LENGTH * sizeof(double))));
+
+// 下面这些函数总是被内联，不存在实际的函数调用。为了避免在没有启用AVX的基础指令集下编译时，
+// GCC对按值传递32字节向量给出ABI方面的提示，向量参数都通过指针传递；返回向量时的同类警告则在此屏蔽，
+// GCC在整个翻译单元的末尾才给出这类警告，所以这里不能用push与pop只屏蔽其中的一段
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+/** 指数函数的向量版本只需一次乘以2^k的最大参数绝对值，此时结果既不会上溢，也不会成为非正规数 */
+#define FAST_EXP_REDUCTION_LIMIT    708.0
+
+/* ln2被拆分成两段，前一段的低32位为0，与不超过2^21的整数相乘时没有舍入误差 */
+#define FAST_LOG_LN2_HI             6.93147180369123816490e-01
+#define FAST_LOG_LN2_LO             1.90821492927058770002e-10
+
+/* 1/ln2、1/ln10与lg2的两段拆分，用于以额外的精度计算log2与log10 */
+#define FAST_LOG_INV_LN2_HI         1.44269504072144627571e+00
+#define FAST_LOG_INV_LN2_LO         1.67517131648865118353e-10
+#define FAST_LOG_INV_LN10_HI        4.34294481878168880939e-01
+#define FAST_LOG_INV_LN10_LO        2.50829467116452752298e-11
+#define FAST_LOG_LG2_HI             3.01029995663611771306e-01
+#define FAST_LOG_LG2_LO             3.69423907715893078616e-13
+
+/** 与ColumnVector等长的64位整数向量，用于按位操作ColumnVector中的元素以及保存向量比较的结果 */
+typedef uint64_t ColumnBitsVector __attribute__((vector_size(COLUMN_VECTOR_LENGTH * sizeof(uint64_t))));
+
+/** 按掩码逐个元素地选择：掩码中全为1的元素取*pA中的元素，全为0的元素取*pB中的元素 */
+static inline __attribute__((always_inline)) ColumnVector SelectColumnVector(const ColumnBitsVector *pMask, const ColumnVector *pA, const ColumnVector *pB)
+{
+    return (ColumnVector)((*pMask & (ColumnBitsVector)*pA) | (~*pMask & (ColumnBitsVector)*pB));
+}
+
+/** 逐个元素地求绝对值 */
+static inline __attribute__((always_inline)) ColumnVector GetColumnVectorMagnitude(const ColumnVector *pX)
+{
+    return (ColumnVector)((ColumnBitsVector)*pX & UINT64_C(0x7fffffffffffffff));
+}
+
+/**
+ * 快速实现的向量版本只处理常规的参数，其余的元素在这里改用标量函数重新计算
+ * @param pValue 向量版本的计算结果，同时也是输出
+ * @param pX 参数
+ * @param pIsSpecial 需要改用标量函数计算的元素，其对应的掩码全为1
+ * @param pFunc 标量函数，即快速实现的标量版本，或者没有标量版本时的libm函数
+*/
+static inline __attribute__((always_inline)) void FixColumnVectorLanes(ColumnVector *pValue, const ColumnVector *pX, const ColumnBitsVector *pIsSpecial, double (*pFunc)(double))
+{
+    var isSpecial = *pIsSpecial;
+    if((isSpecial[0] | isSpecial[1] | isSpecial[2] | isSpecial[3]) != 0)
+    {
+        for(var j = 0; j < COLUMN_VECTOR_LENGTH; j++)
+        {
+            if(isSpecial[j] != 0)
+                (*pValue)[j] = pFunc((*pX)[j]);
+        }
+    }
+}
+
+// 以下是三角函数的向量版本，其运算顺序与对应的标量版本完全相同，因此结果也逐位相同
+
+static inline __attribute__((always_inline)) ColumnVector ReduceTrigVector(const ColumnVector *pX, ColumnVector *pLow, ColumnBitsVector *pQuadrant)
+{
+    var x = *pX;
+    var k = x * M_2_PI + FAST_MATH_ROUNDING_SHIFT;
+    *pQuadrant = (ColumnBitsVector)k;
+    k -= FAST_MATH_ROUNDING_SHIFT;
+    
+    var high = x - k * FAST_TRIG_PIO2_1;
+    var middle = k * FAST_TRIG_PIO2_2;
+    var r = high - middle;
+    var rounding = r - high;
+    var low = ((high - (r - rounding)) - (middle + rounding)) - k * FAST_TRIG_PIO2_3;
+    var sum = r + low;
+    *pLow = low - (sum - r);
+    return sum;
+}
+
+static inline __attribute__((always_inline)) ColumnVector EvaluateSinPolynomialVector(const ColumnVector *pR, const ColumnVector *pLow)
+{
+    var r = *pR;
+    var low = *pLow;
+    var z = r * r;
+    var v = z * r;
+    var p = 8.33333333332248946124e-03 + z * (-1.98412698298579493134e-04 + z * (2.75573137070700676789e-06 + z * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10)));
+    return r - ((z * (0.5 * low - v * p) - low) - v * -1.66666666666666324348e-01);
+}
+
+static inline __attribute__((always_inline)) ColumnVector EvaluateCosPolynomialVector(const ColumnVector *pR, const ColumnVector *pLow)
+{
+    var r = *pR;
+    var z = r * r;
+    var w = z * z;
+    var p = z * (4.16666666666666019037e-02 + z * (-1.38888888888741095749e-03 + z * 2.48015872894767294178e-05)) +
+            w * w * (-2.75573143513906633035e-07 + z * (2.08757232129817482790e-09 + z * -1.13596475577881948265e-11));
+    var halfZ = 0.5 * z;
+    var head = 1.0 - halfZ;
+    return head + (((1.0 - head) - halfZ) + (z * p - r * *pLow));
+}
+
+/**
+ * 用sin与cos的向量版本就地计算一个数据块
+ * @param quadrantOffset 为0时计算sin，为1时计算cos
+*/
+static inline __attribute__((always_inline)) void FastSinCosColumns(ColumnVector values[], int vectorCount, uint64_t quadrantOffset)
+{
+    var pFunc = (quadrantOffset != 0)? &FastCos : &FastSin;
+    
+    for(var v = 0; v < vectorCount; v++)
+    {
+        var x = values[v];
+        ColumnVector low;
+        ColumnBitsVector quadrant;
+        var r = ReduceTrigVector(&x, &low, &quadrant);
+        quadrant += quadrantOffset;
+        var isOdd = -(quadrant & 1);
+        var s = EvaluateSinPolynomialVector(&r, &low);
+        var c = EvaluateCosPolynomialVector(&r, &low);
+        var value = SelectColumnVector(&isOdd, &c, &s);
+        values[v] = (ColumnVector)((ColumnBitsVector)value ^ (quadrant & 2) << 62);
+        
+        var isSpecial = ~(ColumnBitsVector)(GetColumnVectorMagnitude(&x) <= FAST_TRIG_REDUCTION_LIMIT);
+        FixColumnVectorLanes(&values[v], &x, &isSpecial, pFunc);
+    }
+}
+
+/**
+ * 用tan与cot的向量版本就地计算一个数据块
+ * @param isCotangent 是否计算cot
+*/
+static inline __attribute__((always_inline)) void FastTanCotColumns(ColumnVector values[], int vectorCount, bool isCotangent)
+{
+    var pFunc = isCotangent? &FastCot : &FastTan;
+    
+    for(var v = 0; v < vectorCount; v++)
+    {
+        var x = values[v];
+        ColumnVector low;
+        ColumnBitsVector quadrant;
+        var r = ReduceTrigVector(&x, &low, &quadrant);
+        var s = EvaluateSinPolynomialVector(&r, &low);
+        var c = EvaluateCosPolynomialVector(&r, &low);
+        
+        // 奇数象限上tan(x) = -cos(r) / sin(r)，cot则与之相反
+        var isOdd = -(quadrant & 1);
+        var isSwapped = isCotangent? ~isOdd : isOdd;
+        var value = SelectColumnVector(&isSwapped, &c, &s) / SelectColumnVector(&isSwapped, &s, &c);
+        values[v] = (ColumnVector)((ColumnBitsVector)value ^ (quadrant & 1) << 63);
+        
+        var isSpecial = ~(ColumnBitsVector)(GetColumnVectorMagnitude(&x) <= FAST_TRIG_REDUCTION_LIMIT);
+        FixColumnVectorLanes(&values[v], &x, &isSpecial, pFunc);
+    }
+}
+
+// 以下是指数与对数函数的向量版本，它们没有对应的标量版本，结果为非正规数、无穷大或者NaN的元素直接调用libm
+
+/**
+ * 用exp的向量版本就地计算一个数据块，误差不超过1 ULP。
+ * 先约简为x = k * ln2 + r，|r| <= ln2 / 2，其中e^r用13次的泰勒多项式计算，截断误差小于2^-57
+*/
+static inline __attribute__((always_inline)) void FastExpColumns(ColumnVector values[], int vectorCount)
+{
+    for(var v = 0; v < vectorCount; v++)
+    {
+        var x = values[v];
+        var k = x * M_LOG2E + FAST_MATH_ROUNDING_SHIFT;
+        var exponent = (ColumnBitsVector)k - GetDoubleBits(FAST_MATH_ROUNDING_SHIFT);
+        k -= FAST_MATH_ROUNDING_SHIFT;
+        var r = (x - k * FAST_LOG_LN2_HI) - k * FAST_LOG_LN2_LO;
+        
+        var p = r * (1.0 / 6227020800.0) + 1.0 / 479001600.0;
+        p = p * r + 1.0 / 39916800.0;
+        p = p * r + 1.0 / 3628800.0;
+        p = p * r + 1.0 / 362880.0;
+        p = p * r + 1.0 / 40320.0;
+        p = p * r + 1.0 / 5040.0;
+        p = p * r + 1.0 / 720.0;
+        p = p * r + 1.0 / 120.0;
+        p = p * r + 1.0 / 24.0;
+        p = p * r + 1.0 / 6.0;
+        p = p * r + 0.5;
+        values[v] = (1.0 + (r + r * r * p)) * (ColumnVector)((exponent + 1023) << 52);
+        
+        var isSpecial = ~(ColumnBitsVector)(GetColumnVectorMagnitude(&x) <= FAST_EXP_REDUCTION_LIMIT);
+        FixColumnVectorLanes(&values[v], &x, &isSpecial, &exp);
+    }
+}
+
+/** 对数函数约简之后的各个部分，x = 2^exponent * (1 + f)，ln(1 + f) = f - halfSquare + correction */
+struct LogReductionVector
+{
+    ColumnVector exponent;
+    ColumnVector f;
+    ColumnVector halfSquare;
+    ColumnVector correction;
+    
+    /** 不是正规正数的参数，包括0、负数、非正规数、无穷大与NaN，需要改用libm计算 */
+    ColumnBitsVector isSpecial;
+};
+
+/**
+ * 对数函数的参数约简与多项式部分：将尾数约简到[√2/2, √2)，
+ * 然后由ln(1 + f) = 2atanh(s)，s = f / (2 + f)计算，其中的奇次多项式用极小化多项式近似，误差小于2^-58
+*/
+static inline __attribute__((always_inline)) void ReduceLogVector(const ColumnVector *pX, struct LogReductionVector *pReduction)
+{
+    var x = *pX;
+    var bits = (ColumnBitsVector)x;
+    var exponent = (ColumnVector)(bits >> 52 | GetDoubleBits(0x1p52)) - (0x1p52 + 1023.0);
+    var m = (ColumnVector)((bits & UINT64_C(0x000fffffffffffff)) | GetDoubleBits(1.0));
+    var isLarge = (ColumnBitsVector)(m > M_SQRT2);
+    var halfM = m * 0.5;
+    m = SelectColumnVector(&isLarge, &halfM, &m);
+    exponent += (ColumnVector)(isLarge & GetDoubleBits(1.0));
+    
+    var f = m - 1.0;
+    var halfSquare = 0.5 * f * f;
+    var s = f / (2.0 + f);
+    var z = s * s;
+    var w = z * z;
+    var t1 = w * (3.999999999940941908e-01 + w * (2.222219843214978396e-01 + w * 1.531383769920937332e-01));
+    var t2 = z * (6.666666666666735130e-01 + w * (2.857142874366239149e-01 + w * (1.818357216161805012e-01 + w * 1.479819860511658591e-01)));
+    var isSpecial = ~((ColumnBitsVector)(x >= DBL_MIN) & (ColumnBitsVector)(x <= DBL_MAX));
+    *pReduction = (struct LogReductionVector){ exponent, f, halfSquare, s * (halfSquare + t1 + t2), isSpecial };
+}
+
+/** 将ln(1 + f)拆成高低两部分，高位部分的低32位为0，与拆分后的常数相乘时没有舍入误差 */
+static inline __attribute__((always_inline)) ColumnVector SplitLogReductionVector(const struct LogReductionVector *pReduction, ColumnVector *pLow)
+{
+    var high = (ColumnVector)((ColumnBitsVector)(pReduction->f - pReduction->halfSquare) & UINT64_C(0xffffffff00000000));
+    *pLow = (pReduction->f - high) - pReduction->halfSquare + pReduction->correction;
+    return high;
+}
+
+/** 用ln的向量版本就地计算一个数据块，误差不超过1 ULP */
+static inline __attribute__((always_inline)) void FastLogColumns(ColumnVector values[], int vectorCount)
+{
+    for(var v = 0; v < vectorCount; v++)
+    {
+        var x = values[v];
+        struct LogReductionVector reduction;
+        ReduceLogVector(&x, &reduction);
+        var k = reduction.exponent;
+        values[v] = k * FAST_LOG_LN2_HI - ((reduction.halfSquare - (reduction.correction + k * FAST_LOG_LN2_LO)) - reduction.f);
+        FixColumnVectorLanes(&values[v], &x, &reduction.isSpecial, &log);
+    }
+}
+
+/** 用log2的向量版本就地计算一个数据块，误差不超过1 ULP。k与ln(1 + f) / ln2的高位部分相加时的舍入误差被单独补偿 */
+static inline __attribute__((always_inline)) void FastLog2Columns(ColumnVector values[], int vectorCount)
+{
+    for(var v = 0; v < vectorCount; v++)
+    {
+        var x = values[v];
+        struct LogReductionVector reduction;
+        ReduceLogVector(&x, &reduction);
+        var k = reduction.exponent;
+        ColumnVector low;
+        var high = SplitLogReductionVector(&reduction, &low);
+        
+        var valueHigh = high * FAST_LOG_INV_LN2_HI;
+        var valueLow = (low + high) * FAST_LOG_INV_LN2_LO + low * FAST_LOG_INV_LN2_HI;
+        var sum = k + valueHigh;
+        valueLow += (k - sum) + valueHigh;
+        values[v] = valueLow + sum;
+        FixColumnVectorLanes(&values[v], &x, &reduction.isSpecial, &log2);
+    }
+}
+
+/** 用log10的向量版本就地计算一个数据块，误差不超过1 ULP */
+static inline __attribute__((always_inline)) void FastLog10Columns(ColumnVector values[], int vectorCount)
+{
+    for(var v = 0; v < vectorCount; v++)
+    {
+        var x = values[v];
+        struct LogReductionVector reduction;
+        ReduceLogVector(&x, &reduction);
+        var k = reduction.exponent;
+        ColumnVector low;
+        var high = SplitLogReductionVector(&reduction, &low);
+        
+        var valueHigh = high * FAST_LOG_INV_LN10_HI;
+        var exponentHigh = k * FAST_LOG_LG2_HI;
+        var valueLow = k * FAST_LOG_LG2_LO + (low + high) * FAST_LOG_INV_LN10_LO + low * FAST_LOG_INV_LN10_HI;
+        var sum = exponentHigh + valueHigh;
+        valueLow += (exponentHigh - sum) + valueHigh;
+        values[v] = valueLow + sum;
+        FixColumnVectorLanes(&values[v], &x, &reduction.isSpecial, &log10);
+    }
+}
+
+/**
+ * 用快速实现的向量版本就地计算一个数据块中的数学函数
+ * @param kernel 快速实现的种类，不能为FAST_MATH_KERNEL_NONE
+ * @param values 数据块
+ * @param vectorCount 数据块中有效的向量个数
+*/
+static inline __attribute__((always_inline)) void EvaluateFastMathColumns(enum FAST_MATH_KERNEL kernel, ColumnVector values[], int vectorCount)
+{
+    switch(kernel)
+    {
+    case FAST_MATH_KERNEL_SIN:
+        FastSinCosColumns(values, vectorCount, 0);
+        break;
+        
+    case FAST_MATH_KERNEL_COS:
+        FastSinCosColumns(values, vectorCount, 1);
+        break;
+        
+    case FAST_MATH_KERNEL_TAN:
+        FastTanCotColumns(values, vectorCount, false);
+        break;
+        
+    case FAST_MATH_KERNEL_COT:
+        FastTanCotColumns(values, vectorCount, true);
+        break;
+        
+    case FAST_MATH_KERNEL_EXP:
+        FastExpColumns(values, vectorCount);
+        break;
+        
+    case FAST_MATH_KERNEL_LN:
+        FastLogColumns(values, vectorCount);
+        break;
+        
+    case FAST_MATH_KERNEL_LOG2:
+        FastLog2Columns(values, vectorCount);
+        break;
+        
+    case FAST_MATH_KERNEL_LOG10:
+        FastLog10Columns(values, vectorCount);
+        break;
+        
+    default:
+        break;
+    }
+}
+
+/**
+ * 对一个数据块执行程序中的所有指令。
+ * 求值栈中的每个元素都是一个完整的数据块，因此每条指令只需分派一次，便可处理整个数据块。
+ * 二元算术操作以及倒数、角度与弧度转换等操作都以向量的形式完成；
+ * 求模、幂运算以及其余的数学函数则在数据块内逐个元素地调用与标量求值相同的函数，
+ * 从而保证按列求值的结果与EvaluateArithmeticProgram逐位相同。
+ * 使用快速实现时，有快速实现的数学函数都以向量形式计算，其中三角函数的结果与标量的快速实现逐位相同
+ * @param program 需要求值的程序
+ * @param columns 各个变量的输入列
+ * @param offset 当前数据块在输入列中的起始位置
+ * @param length 当前数据块的有效元素个数，不超过COLUMN_BLOCK_SIZE
+ * @param stack 求值栈，至少能容纳program->maxStackDepth个数据块，其后紧跟program->temporaryCount个临时单元数据块
+ * @param output 当前数据块结果的输出位置
+ * @param kernelSet 数学函数的实现方式
+*/
+static inline __attribute__((always_inline)) void EvaluateColumnBlockKernel(const struct ArithmeticProgram *program, const double *const columns[], size_t offset, int length, ColumnVector *stack, double output[],
+                                                                            enum MATH_KERNEL_SET kernelSet)
+{
+    var top = stack - COLUMN_BLOCK_VECTORS;
+    var temporaries = stack + COLUMN_BLOCK_VECTORS * program->maxStackDepth;
+    var vectorCount = (length + COLUMN_VECTOR_LENGTH - 1) / COLUMN_VECTOR_LENGTH;
+    
+    const var constants = program->constants;
+    const var instructions = program->instructions;
+    const var count = program->instructionCount;
+    
+    for(var i = 0; i < count; i++)
+    {
+        var instruction = instructions[i];
+        var right = top;
+        double *values = (double*)top;
+        
+        switch(instruction.opcode)
+        {
+        case PROGRAM_OPCODE_PUSH_CONSTANT:
+        {
+            top += COLUMN_BLOCK_VECTORS;
+            var value = constants[instruction.operand];
+            var vector = (ColumnVector){ value, value, value, value };
+            for(var v = 0; v < vectorCount; v++)
+                top[v] = vector;
+            break;
+        }
+            
+        case PROGRAM_OPCODE_PUSH_VARIABLE:
+            top += COLUMN_BLOCK_VECTORS;
+            values = (double*)top;
+            memcpy(values, &columns[instruction.operand][offset], sizeof(double) * length);
+            // 将最后一个向量中的多余元素清零，避免无效数据参与后续计算
+            for(var j = length; j < vectorCount * COLUMN_VECTOR_LENGTH; j++)
+                values[j] = 0.0;
+            break;
+            
+        case PROGRAM_OPCODE_ADD:
+            top -= COLUMN_BLOCK_VECTORS;
+            for(var v = 0; v < vectorCount; v++)
+                top[v] = top[v] + right[v];
+            break;
+            
+        case PROGRAM_OPCODE_MINUS:
+            top -= COLUMN_BLOCK_VECTORS;
+            for(var v = 0; v < vectorCount; v++)
+                top[v] = top[v] - right[v];
+            break;
+            
+        case PROGRAM_OPCODE_MUL:
+            top -= COLUMN_BLOCK_VECTORS;
+            for(var v = 0; v < vectorCount; v++)
+                top[v] = top[v] * right[v];
+            break;
+            
+        case PROGRAM_OPCODE_DIV:
+            top -= COLUMN_BLOCK_VECTORS;
+            for(var v = 0; v < vectorCount; v++)
+                top[v] = top[v] / right[v];
+            break;
+            
+        case PROGRAM_OPCODE_MOD:
+        case PROGRAM_OPCODE_POW:
+        {
+            top -= COLUMN_BLOCK_VECTORS;
+            values = (double*)top;
+            const double *rightValues = (const double*)right;
+            
+            // 求模只能逐个元素进行整数运算，而幂运算直接调用libm的pow以保证结果与标量求值一致
+            if(instruction.opcode == PROGRAM_OPCODE_MOD)
+            {
+                for(var j = 0; j < length; j++)
+                    values[j] = ModOp(values[j], rightValues[j]);
+            }
+            else
+            {
+                for(var j = 0; j < length; j++)
+                    values[j] = pow(values[j], rightValues[j]);
+            }
+            break;
+        }
+            
+        case PROGRAM_OPCODE_NEG:
+            for(var v = 0; v < vectorCount; v++)
+                top[v] = -top[v];
+            break;
+            
+        case PROGRAM_OPCODE_RECIPROCAL:
+        {
+            var one = (ColumnVector){ 1.0, 1.0, 1.0, 1.0 };
+            for(var v = 0; v < vectorCount; v++)
+                top[v] = one / top[v];
+            break;
+        }
+            
+        case PROGRAM_OPCODE_CALL:
+        {
+            var pFunc = mathFuncList[instruction.operand].pFunc;
+            var kernel = (kernelSet == MATH_KERNEL_SET_FAST)? fastMathKernelList[instruction.operand].kernel : FAST_MATH_KERNEL_NONE;
+            
+            // 仅由四则运算构成的函数以向量形式计算，其运算顺序与对应的标量函数完全相同
+            if(kernel != FAST_MATH_KERNEL_NONE)
+                EvaluateFastMathColumns(kernel, top, vectorCount);
+            else if(pFunc == &recp)
+            {
+                var one = (ColumnVector){ 1.0, 1.0, 1.0, 1.0 };
+                for(var v = 0; v < vectorCount; v++)
+                    top[v] = one / top[v];
+            }
+            else if(pFunc == &radian)
+            {
+                for(var v = 0; v < vectorCount; v++)
+                    top[v] = top[v] * M_PI / 180.0;
+            }
+            else if(pFunc == &degree)
+            {
+                for(var v = 0; v < vectorCount; v++)
+                    top[v] = top[v] * 180.0 / M_PI;
+            }
+            else
+            {
+                for(var j = 0; j < length; j++)
+                    values[j] = pFunc(values[j]);
+            }
+            break;
+        }
+            
+        case PROGRAM_OPCODE_LOAD_TEMPORARY:
+        {
+            top += COLUMN_BLOCK_VECTORS;
+            var temporary = temporaries + COLUMN_BLOCK_VECTORS * instruction.operand;
+            for(var v = 0; v < vectorCount; v++)
+                top[v] = temporary[v];
+            break;
+        }
+            
+        case PROGRAM_OPCODE_STORE_TEMPORARY:
+        {
+            var temporary = temporaries + COLUMN_BLOCK_VECTORS * instruction.operand;
+            for(var v = 0; v < vectorCount; v++)
+                temporary[v] = top[v];
+            break;
+        }
+            
+        default:
+            break;
+        }
+    }
+    
+    memcpy(output, top, sizeof(double) * length);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/** 使用AVX2指令集的数据块求值函数 */
+__attribute__((target("avx2"))) static void EvaluateColumnBlockAVX2(const struct ArithmeticProgram *program, const double *const columns[], size_t offset, int length, ColumnVector *stack, double output[],
+                                                                   enum MATH_KERNEL_SET kernelSet)
+{
+    EvaluateColumnBlockKernel(program, columns, offset, length, stack, output, kernelSet);
+}
+#endif
+
+/** 使用目标平台基础指令集的数据块求值函数，对于x86-64而言即为SSE2 */
+static void EvaluateColumnBlockGeneric(const struct ArithmeticProgram *program, const double *const columns[], size_t offset, int length, ColumnVector *stack, double output[],
+                                       enum MATH_KERNEL_SET kernelSet)
+{
+    EvaluateColumnBlockKernel(program, columns, offset, length, stack, output, kernelSet);
+}
+
+/** 按列求值时可选用的指令集 */
+enum COLUMN_INSTRUCTION_SET
+{
+    /** 根据当前处理器自动选择 */
+    COLUMN_INSTRUCTION_SET_AUTO,
+    
+    /** 目标平台的基础指令集，对于x86-64而言即为SSE2 */
+    COLUMN_INSTRUCTION_SET_GENERIC,
+    
+    COLUMN_INSTRUCTION_SET_AVX2
+};
+
+/** 获取当前处理器实际所使用的按列求值指令集 */
+static enum COLUMN_INSTRUCTION_SET GetColumnInstructionSet(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if(__builtin_cpu_supports("avx2"))
+        return COLUMN_INSTRUCTION_SET_AVX2;
+#endif
+    return COLUMN_INSTRUCTION_SET_GENERIC;
+}
+
+/**
+ * 用指定的指令集对一组输入列进行按列求值
+ * @param instructionSet 所使用的指令集，若处理器不支持该指令集，则使用基础指令集
+ * @param kernelSet 数学函数的实现方式
+*/
+static bool EvaluateArithmeticProgramColumnsWithInstructionSet(const struct ArithmeticProgram *program, const double *const columns[], double output[], size_t count, enum COLUMN_INSTRUCTION_SET instructionSet,
+                                                               enum MATH_KERNEL_SET kernelSet)
+{
+    var blockFunc = &EvaluateColumnBlockGeneric;
+    
+#if defined(__x86_64__) || defined(__i386__)
+    if(instructionSet != COLUMN_INSTRUCTION_SET_GENERIC && GetColumnInstructionSet() == COLUMN_INSTRUCTION_SET_AVX2)
+        blockFunc = &EvaluateColumnBlockAVX2;
+#else
+    (void)instructionSet;
+#endif
+    
+    // 求值栈与临时单元中的每个元素都是一个数据块，这里按照AVX的要求做32字节对齐
+    var stack = (ColumnVector*)aligned_alloc(32, sizeof(ColumnVector) * COLUMN_BLOCK_VECTORS * (program->maxStackDepth + program->temporaryCount));
+    if(stack == NULL)
+        return false;
+    
+    for(size_t offset = 0; offset < count; offset += COLUMN_BLOCK_SIZE)
+    {
+        var length = (count - offset < COLUMN_BLOCK_SIZE)? (int)(count - offset) : COLUMN_BLOCK_SIZE;
+        blockFunc(program, columns, offset, length, stack, &output[offset], kernelSet);
+    }
+    
+    free(stack);
+    return true;
+}
+
+/**
+ * 对编译后的程序按列求值：每个变量对应一列输入，每行输入产生一个输出。
+ * 数据以块为单位进行处理，并根据当前处理器自动选用AVX2或SSE2指令，
+ * 其结果与对每一行分别调用EvaluateArithmeticProgram的结果逐位相同
+ * @param program 由CompileArithmeticExpression所生成的程序
+ * @param columns 各个变量的输入列，按槽位索引依次存放，每列都包含count个元素。若程序中没有变量，可传NULL
+ * @param output 输出列，至少包含count个元素
+ * @param count 行数
+ * @return 若求值成功，返回true，若存储空间不足，返回false
+*/
+bool EvaluateArithmeticProgramColumns(const struct ArithmeticProgram *program, const double *const columns[], double output[], size_t count)
+{
+    return EvaluateArithmeticProgramColumnsWithInstructionSet(program, columns, output, count, COLUMN_INSTRUCTION_SET_AUTO, MATH_KERNEL_SET_LIBM);
+}
+
+/**
+ * 用指定的数学函数实现对编译后的程序按列求值，其余参数与返回值的含义与EvaluateArithmeticProgramColumns相同。
+ * 使用快速实现时，有快速实现的函数也以向量形式计算。由于exp与各个对数函数的标量调用仍使用libm，
+ * 它们的结果与对每一行分别调用EvaluateArithmeticProgramWithKernels的结果不一定逐位相同，但都在各自的误差上界以内，其余结果都逐位相同
+ * @param kernelSet 数学函数的实现方式
+*/
+bool EvaluateArithmeticProgramColumnsWithKernels(const struct ArithmeticProgram *program, const double *const columns[], double output[], size_t count, enum MATH_KERNEL_SET kernelSet)
+{
+    return EvaluateArithmeticProgramColumnsWithInstructionSet(program, columns, output, count, COLUMN_INSTRUCTION_SET_AUTO, kernelSet);
+}
+
+/**
+ * 带有任务窃取的工作线程池。
+ * 每次执行任务时，任务索引区间被平均划分给各个工作线程，每个线程从自己区间的头部依次取任务；
+ * 当自己的区间为空时，就从其他线程区间的尾部窃取一半的任务，
+ * 这样即便各个任务的计算量相差悬殊，各线程的负载也能大致均衡。
+ * 调用RunWorkerPoolTasks的线程本身也作为0号工作线程参与计算。
+ * 并行批处理、服务端、表格重算以及区间归约都使用它
+*/
+struct WorkerPool
+{
+    pthread_t *threads;
+    int threadCount;
+    
+    pthread_mutex_t mutex;
+    pthread_cond_t startCondition;
+    pthread_cond_t doneCondition;
+    
+    /** 每启动一批任务，该值加1，用于唤醒工作线程 */
+    unsigned generation;
+    
+    /** 尚未完成当前这批任务的后台线程个数 */
+    int pendingWorkers;
+    
+    bool shouldExit;
+    
+    /** 每个工作线程当前的任务区间，低32位为起始索引，高32位为结束索引 */
+    _Atomic uint64_t *ranges;
+    
+    void (*taskFunc)(void *context, int taskIndex);
+    void *taskContext;
+};
+
+/** 当前线程是否正在执行某个线程池的任务。这样的线程中的区间归约不再并行，以免线程数成倍增加 */
+static _Thread_local bool isWorkerPoolThread;
+
+static inline uint64_t MakeTaskRange(uint32_t begin, uint32_t end)
+{
+    return (uint64_t)begin | ((uint64_t)end << 32);
+}
+
+/** 从指定工作线程自己的任务区间头部取出一个任务 */
+static bool TakeOwnTask(struct WorkerPool *pool, int workerIndex, int *pTask)
+{
+    var pRange = &pool->ranges[workerIndex];
+    var range = atomic_load_explicit(pRange, memory_order_relaxed);
+    
+    for(;;)
+    {
+        var begin = (uint32_t)range;
+        var end = (uint32_t)(range >> 32);
+        if(begin >= end)
+            return false;
+        
+        if(atomic_compare_exchange_weak_explicit(pRange, &range, MakeTaskRange(begin + 1, end), memory_order_relaxed, memory_order_relaxed))
+        {
+            *pTask = (int)begin;
+            return true;
+        }
+    }
+}
+
+/** 从其他工作线程的任务区间尾部窃取一半任务，放入自己的区间 */
+static bool StealTasks(struct WorkerPool *pool, int workerIndex)
+{
+    for(var i = 1; i < pool->threadCount; i++)
+    {
+        var pVictim = &pool->ranges[(workerIndex + i) % pool->threadCount];
+        var range = atomic_load_explicit(pVictim, memory_order_relaxed);
+        
+        for(;;)
+        {
+            var begin = (uint32_t)range;
+            var end = (uint32_t)(range >> 32);
+            if(begin >= end)
+                break;
+            
+            var stolenCount = (end - begin + 1) / 2;
+            if(atomic_compare_exchange_weak_explicit(pVictim, &range, MakeTaskRange(begin, end - stolenCount), memory_order_relaxed, memory_order_relaxed))
+            {
+                // 自己的区间此时为空，其他线程不会对其做修改，所以直接存放即可
+                atomic_store_explicit(&pool->ranges[workerIndex], MakeTaskRange(end - stolenCount, end), memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+    
+    return false;
+}
+
+/** 工作线程执行当前这批任务，直到再也取不到任务为止 */
+static void RunWorkerTasks(struct WorkerPool *pool, int workerIndex)
+{
+    int task;
+    
+    for(;;)
+    {
+        if(TakeOwnTask(pool, workerIndex, &task))
+            pool->taskFunc(pool->taskContext, task);
+        else if(!StealTasks(pool, workerIndex))
+            break;
+    }
+}
+
+struct WorkerThreadArgument
+{
+    struct WorkerPool *pool;
+    int workerIndex;
+};
+
+static void* WorkerThreadMain(void *argument)
+{
+    var pool = ((struct WorkerThreadArgument*)argument)->pool;
+    var workerIndex = ((struct WorkerThreadArgument*)argument)->workerIndex;
+    free(argument);
+    
+    isWorkerPoolThread = true;
+    var generation = 0U;
+    
+    for(;;)
+    {
+        pthread_mutex_lock(&pool->mutex);
+        while(pool->generation == generation && !pool->shouldExit)
+            pthread_cond_wait(&pool->startCondition, &pool->mutex);
+        
+        if(pool->shouldExit)
+        {
+            pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+        generation = pool->generation;
+        pthread_mutex_unlock(&pool->mutex);
+        
+        RunWorkerTasks(pool, workerIndex);
+        
+        pthread_mutex_lock(&pool->mutex);
+        if(--pool->pendingWorkers == 0)
+            pthread_cond_signal(&pool->doneCondition);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    
+    return NULL;
+}
+
+/**
+ * 创建工作线程池
+ * @param pool 需要初始化的线程池对象
+ * @param threadCount 工作线程个数（包括调用线程自身），若不大于0，则使用当前在线的处理器核数
+ * @return 若创建成功，返回true，否则返回false
+*/
+static bool CreateWorkerPool(struct WorkerPool *pool, int threadCount)
+{
+    if(threadCount <= 0)
+        threadCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(threadCount <= 0)
+        threadCount = 1;
+    
+    *pool = (struct WorkerPool){ .threadCount = threadCount };
+    pool->threads = (pthread_t*)calloc(threadCount, sizeof(*pool->threads));
+    pool->ranges = (_Atomic uint64_t*)calloc(threadCount, sizeof(*pool->ranges));
+    if(pool->threads == NULL || pool->ranges == NULL)
+    {
+        free(pool->threads);
+        free((void*)pool->ranges);
+        return false;
+    }
+    
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->startCondition, NULL);
+    pthread_cond_init(&pool->doneCondition, NULL);
+    
+    // 0号工作线程就是调用线程自己，所以只需创建threadCount - 1个后台线程
+    for(var i = 1; i < threadCount; i++)
+    {
+        var argument = (struct WorkerThreadArgument*)malloc(sizeof(struct WorkerThreadArgument));
+        if(argument == NULL)
+        {
+            pool->threadCount = i;
+            break;
+        }
+        *argument = (struct WorkerThreadArgument){ .pool = pool, .workerIndex = i };
+        
+        if(pthread_create(&pool->threads[i], NULL, WorkerThreadMain, argument) != 0)
+        {
+            free(argument);
+            pool->threadCount = i;
+            break;
+        }
+    }
+    
+    return true;
+}
+
+/** 结束所有后台线程并释放线程池 */
+static void DestroyWorkerPool(struct WorkerPool *pool)
+{
+    pthread_mutex_lock(&pool->mutex);
+    pool->shouldExit = true;
+    pthread_cond_broadcast(&pool->startCondition);
+    pthread_mutex_unlock(&pool->mutex);
+    
+    for(var i = 1; i < pool->threadCount; i++)
+        pthread_join(pool->threads[i], NULL);
+    
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->startCondition);
+    pthread_cond_destroy(&pool->doneCondition);
+    
+    free(pool->threads);
+    free((void*)pool->ranges);
+}
+
+/**
+ * 用线程池执行索引为[0, taskCount)的一批任务，所有任务完成之后才返回
+ * @param taskFunc 任务函数，其参数为任务上下文以及任务索引
+ * @param context 任务上下文
+*/
+static void RunWorkerPoolTasks(struct WorkerPool *pool, int taskCount, void (*taskFunc)(void*, int), void *context)
+{
+    pool->taskFunc = taskFunc;
+    pool->taskContext = context;
+    
+    // 将任务区间平均划分给各个工作线程
+    for(var i = 0; i < pool->threadCount; i++)
+    {
+        var begin = (uint32_t)((int64_t)taskCount * i / pool->threadCount);
+        var end = (uint32_t)((int64_t)taskCount * (i + 1) / pool->threadCount);
+        atomic_store_explicit(&pool->ranges[i], MakeTaskRange(begin, end), memory_order_relaxed);
+    }
+    
+    pthread_mutex_lock(&pool->mutex);
+    pool->pendingWorkers = pool->threadCount - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->startCondition);
+    pthread_mutex_unlock(&pool->mutex);
+    
+    var wasWorkerPoolThread = isWorkerPoolThread;
+    isWorkerPoolThread = true;
+    RunWorkerTasks(pool, 0);
+    isWorkerPoolThread = wasWorkerPoolThread;
+    
+    pthread_mutex_lock(&pool->mutex);
+    while(pool->pendingWorkers > 0)
+        pthread_cond_wait(&pool->doneCondition, &pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+/** 归约时每次按列求值的行数 */
+#define REDUCTION_BLOCK_SIZE            1024
+
+/** 每个分段至少包含的块数。分段是各线程领取任务的单位，其划分只取决于项数，所以归约结果与线程数无关 */
+#define REDUCTION_MIN_SEGMENT_BLOCKS    64
+
+/** 分段个数的上限，项数很多时相应地增大每个分段的块数 */
+#define REDUCTION_MAX_SEGMENTS          4096
+
+/** 索引变量的绝对值上限，超过它之后相邻的整数就不能再用double精确表示 */
+#define REDUCTION_MAX_INDEX             9007199254740992.0
+
+/** 归约所使用的线程数，0表示使用全部在线的处理器 */
+static atomic_int reductionThreadCount;
+
+/**
+ * 区间归约所共用的线程池，在第一次并行归约时创建，线程数变化时重建，此后一直保留到进程结束。
+ * 线程池同一时刻只能执行一批任务，所以由reductionPoolMutex保护：
+ * 取不到该锁的归约（其他线程正在并行归约）直接在调用者所在的线程中完成，而不会等待或者另外创建线程
+*/
+static struct WorkerPool reductionPool;
+static bool isReductionPoolCreated;
+
+/** 创建reductionPool时所要求的线程数。部分线程创建失败时线程池的实际线程数会少于它，但不必因此反复重建 */
+static int reductionPoolThreadCount;
+static pthread_mutex_t reductionPoolMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * 设置区间归约所使用的线程数。项数较少的归约、线程池正被其他归约使用时的归约，
+ * 以及在批处理、服务端等线程池任务中进行的归约，都在调用者所在的线程中完成
+ * @param threadCount 线程数，不大于0时使用全部在线的处理器
+*/
+void SetReductionThreadCount(int threadCount)
+{
+    atomic_store_explicit(&reductionThreadCount, threadCount, memory_order_relaxed);
+}
+
+/** 归约的部分结果。求和时带有Neumaier补偿项，其余归约只使用value */
+struct ReductionPartial
+{
+    double value;
+    double compensation;
+};
+
+/** 返回归约的单位元，即空区间的归约结果 */
+static inline struct ReductionPartial GetReductionIdentity(enum REDUCTION_KIND kind)
+{
+    static const double identities[] = {
+        [REDUCTION_KIND_SUM] = 0.0,
+        [REDUCTION_KIND_PROD] = 1.0,
+        [REDUCTION_KIND_MIN] = INFINITY,
+        [REDUCTION_KIND_MAX] = -INFINITY
+    };
+    return (struct ReductionPartial){ identities[kind], 0.0 };
+}
+
+/** 将部分结果other合并到partial中，合并的顺序固定，因此结果可以复现 */
+static inline void CombineReductionPartial(struct ReductionPartial *partial, struct ReductionPartial other, enum REDUCTION_KIND kind)
+{
+    switch(kind)
+    {
+    case REDUCTION_KIND_SUM:
+    {
+        // Neumaier求和：较小加数在相加时被舍去的低位累积到补偿项中
+        var sum = partial->value + other.value;
+        if(fabs(partial->value) >= fabs(other.value))
+            partial->compensation += (partial->value - sum) + other.value;
+        else
+            partial->compensation += (other.value - sum) + partial->value;
+        partial->compensation += other.compensation;
+        partial->value = sum;
+        break;
+    }
+    case REDUCTION_KIND_PROD:
+        partial->value *= other.value;
+        break;
+    case REDUCTION_KIND_MIN:
+        // NaN一旦出现就一直保留，与求和的行为一致
+        if(other.value < partial->value || isnan(other.value))
+            partial->value = other.value;
+        break;
+    case REDUCTION_KIND_MAX:
+        if(other.value > partial->value || isnan(other.value))
+            partial->value = other.value;
+        break;
+    case REDUCTION_KIND_INTEGRATE:
+    case REDUCTION_KIND_SOLVE:
+        // 积分与求根不逐项归约
+        break;
+    }
+}
+
+/** 返回部分结果所对应的最终结果 */
+static inline double GetReductionResult(struct ReductionPartial partial, enum REDUCTION_KIND kind)
+{
+    // 和为无穷大或NaN时补偿项没有意义
+    if(kind == REDUCTION_KIND_SUM && isfinite(partial.value))
+        return partial.value + partial.compensation;
+    
+    return partial.value;
+}
+
+/** 各线程共享的区间归约任务 */
+struct ReductionTask
+{
+    const struct ArithmeticProgram *program;
+    enum REDUCTION_KIND kind;
+    enum MATH_KERNEL_SET kernelSet;
+    
+    /** 索引的起始值以及项数 */
+    int64_t first;
+    size_t count;
+    
+    /** 每个分段的项数以及分段个数 */
+    size_t segmentLength;
+    size_t segmentCount;
+    
+    /** 各分段的部分结果，按分段顺序存放 */
+    struct ReductionPartial *partials;
+    
+    atomic_bool isFailed;
+};
+
+/** 线程池的任务函数，归约第segment个分段 */
+static void ReduceSegmentTask(void *context, int segment)
+{
+    var task = (struct ReductionTask*)context;
+    double indices[REDUCTION_BLOCK_SIZE];
+    double values[REDUCTION_BLOCK_SIZE];
+    const double *const columns[] = { indices };
+    
+    // 已有分段求值失败时整个归约都会失败，剩余的分段不必再计算
+    if(atomic_load_explicit(&task->isFailed, memory_order_relaxed))
+        return;
+    
+    var begin = (size_t)segment * task->segmentLength;
+    var end = (task->count - begin < task->segmentLength)? task->count : begin + task->segmentLength;
+    var partial = GetReductionIdentity(task->kind);
+    for(var offset = begin; offset < end; offset += REDUCTION_BLOCK_SIZE)
+    {
+        var blockLength = (end - offset < REDUCTION_BLOCK_SIZE)? (int)(end - offset) : REDUCTION_BLOCK_SIZE;
+        
+        // 索引都在上下界之间，所以先按整数相加再转换，结果是精确的
+        for(var i = 0; i < blockLength; i++)
+            indices[i] = (double)(task->first + (int64_t)(offset + i));
+        
+        if(!EvaluateArithmeticProgramColumnsWithKernels(task->program, columns, values, blockLength, task->kernelSet))
+        {
+            atomic_store_explicit(&task->isFailed, true, memory_order_relaxed);
+            return;
+        }
+        
+        for(var i = 0; i < blockLength; i++)
+            CombineReductionPartial(&partial, (struct ReductionPartial){ values[i], 0.0 }, task->kind);
+    }
+    task->partials[segment] = partial;
+}
+
+/**
+ * 取得可用于并行归约的线程池，线程数与SetReductionThreadCount的设置保持一致
+ * @return 若取得线程池，返回它，此时调用者持有reductionPoolMutex，用完之后须将其释放；
+ * 若当前线程正在执行线程池的任务、线程池正被其他归约使用、只需一个线程，或者创建失败，返回NULL
+*/
+static struct WorkerPool* AcquireReductionPool(void)
+{
+    if(isWorkerPoolThread)
+        return NULL;
+    
+    var threadCount = atomic_load_explicit(&reductionThreadCount, memory_order_relaxed);
+    if(threadCount <= 0)
+        threadCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(threadCount <= 1 || pthread_mutex_trylock(&reductionPoolMutex) != 0)
+        return NULL;
+    
+    if(isReductionPoolCreated && reductionPoolThreadCount != threadCount)
+    {
+        DestroyWorkerPool(&reductionPool);
+        isReductionPoolCreated = false;
+    }
+    if(!isReductionPoolCreated)
+    {
+        isReductionPoolCreated = CreateWorkerPool(&reductionPool, threadCount);
+        reductionPoolThreadCount = threadCount;
+    }
+    
+    if(!isReductionPoolCreated || reductionPool.threadCount <= 1)
+    {
+        pthread_mutex_unlock(&reductionPoolMutex);
+        return NULL;
+    }
+    return &reductionPool;
+}
+
+/**
+ * 对索引从first开始的连续count个整数求出程序的值并归约。
+ * 索引被划分为若干分段，各分段由多个线程并行地按块按列求值，分段内逐项做补偿求和，各分段的部分结果再按顺序合并，
+ * 分段的划分与合并的顺序都只取决于项数，所以无论使用多少个线程，结果都逐位相同
+ * @param program 以索引变量为唯一变量的程序
+ * @param kind 归约的种类
+ * @param first 索引的起始值
+ * @param count 项数，为0时结果为归约的单位元
+ * @param kernelSet 数学函数的实现方式
+ * @param pValue 输出归约结果
+ * @return 若归约成功，返回true，若存储空间不足，返回false
+*/
+static bool ReduceArithmeticProgramRange(const struct ArithmeticProgram *program, enum REDUCTION_KIND kind, int64_t first, size_t count,
+                                         enum MATH_KERNEL_SET kernelSet, double *pValue)
+{
+    var partial = GetReductionIdentity(kind);
+    if(count > 0)
+    {
+        var blockCount = (count + REDUCTION_BLOCK_SIZE - 1) / REDUCTION_BLOCK_SIZE;
+        var segmentBlocks = (blockCount + REDUCTION_MAX_SEGMENTS - 1) / REDUCTION_MAX_SEGMENTS;
+        if(segmentBlocks < REDUCTION_MIN_SEGMENT_BLOCKS)
+            segmentBlocks = REDUCTION_MIN_SEGMENT_BLOCKS;
+        
+        struct ReductionTask task;
+        task.program = program;
+        task.kind = kind;
+        task.kernelSet = kernelSet;
+        task.first = first;
+        task.count = count;
+        task.segmentLength = segmentBlocks * REDUCTION_BLOCK_SIZE;
+        task.segmentCount = (blockCount + segmentBlocks - 1) / segmentBlocks;
+        task.partials = (struct ReductionPartial*)malloc(task.segmentCount * sizeof(*task.partials));
+        atomic_init(&task.isFailed, false);
+        if(task.partials == NULL)
+            return false;
+        
+        // 只有一个分段时不必动用线程池；调用者所在的线程也作为0号工作线程参与归约
+        var pool = (task.segmentCount > 1)? AcquireReductionPool() : NULL;
+        if(pool != NULL)
+        {
+            RunWorkerPoolTasks(pool, (int)task.segmentCount, ReduceSegmentTask, &task);
+            pthread_mutex_unlock(&reductionPoolMutex);
+        }
+        else
+        {
+            for(size_t i = 0; i < task.segmentCount && !atomic_load_explicit(&task.isFailed, memory_order_relaxed); i++)
+                ReduceSegmentTask(&task, (int)i);
+        }
+        
+        var isFailed = atomic_load_explicit(&task.isFailed, memory_order_relaxed);
+        for(size_t i = 0; !isFailed && i < task.segmentCount; i++)
+            CombineReductionPartial(&partial, task.partials[i], kind);
+        free(task.partials);
+        
+        if(isFailed)
+            return false;
+    }
+    
+    *pValue = GetReductionResult(partial, kind);
+    return true;
+}
+
+/** 自适应积分中子区间个数的上限，达到上限时误差估计仍超过误差限的积分视为不收敛 */
+#define INTEGRATION_MAX_INTERVALS       4096
+
+/** 自适应积分的相对误差限以及绝对误差限。误差估计取G7与K15之差，它通常比K15的实际误差大得多 */
+#define INTEGRATION_RELATIVE_TOLERANCE  1e-12
+#define INTEGRATION_ABSOLUTE_TOLERANCE  1e-15
+
+/** Gauss-Kronrod求积公式每个子区间的节点个数 */
+#define KRONROD_NODE_COUNT              15
+
+/** 求根时先在区间上等距取这么多个点一次性按列求值，找到最左边的变号子区间之后再用Brent方法 */
+#define ROOT_SCAN_POINT_COUNT           64
+
+/** Brent方法的最大迭代次数 */
+#define ROOT_MAX_ITERATIONS             200
+
+/** K15的正节点，按从大到小排列，最后一个为中点；其中下标为奇数的同时也是G7的节点 */
+static const double kronrodNodes[8] = {
+    0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245, 0.0
+};
+
+/** 与kronrodNodes相对应的K15权重 */
+static const double kronrodWeights[8] = {
+    0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649, 0.209482141084727828012999174891714
+};
+
+/** G7的权重，依次对应kronrodNodes[1]、[3]、[5]、[7] */
+static const double gaussWeights[4] = {
+    0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975, 0.417959183673469387755102040816327
+};
+
+/** 自适应积分中的一个子区间 */
+struct IntegrationInterval
+{
+    double lower;
+    double upper;
+    
+    /** K15的积分值以及它与G7之差的绝对值 */
+    double value;
+    double error;
+};
+
+/** 将子区间的15个节点依次写入points */
+static inline void GetKronrodPoints(const struct IntegrationInterval *interval, double points[KRONROD_NODE_COUNT])
+{
+    var center = 0.5 * (interval->lower + interval->upper);
+    var halfWidth = 0.5 * (interval->upper - interval->lower);
+    for(var i = 0; i < 7; i++)
+    {
+        points[2 * i] = center - halfWidth * kronrodNodes[i];
+        points[2 * i + 1] = center + halfWidth * kronrodNodes[i];
+    }
+    points[14] = center;
+}
+
+/** 由GetKronrodPoints所给出节点上的函数值求出子区间的K15积分值以及误差估计 */
+static inline void ApplyKronrodRule(struct IntegrationInterval *interval, const double values[KRONROD_NODE_COUNT])
+{
+    var halfWidth = 0.5 * (interval->upper - interval->lower);
+    var kronrod = kronrodWeights[7] * values[14];
+    var gauss = gaussWeights[3] * values[14];
+    for(var i = 0; i < 7; i++)
+    {
+        var pairSum = values[2 * i] + values[2 * i + 1];
+        kronrod += kronrodWeights[i] * pairSum;
+        if(i % 2 == 1)
+            gauss += gaussWeights[i / 2] * pairSum;
+    }
+    
+    interval->value = kronrod * halfWidth;
+    interval->error = fabs((kronrod - gauss) * halfWidth);
+}
+
+/** 按左端点比较两个子区间，供qsort使用 */
+static int CompareIntegrationIntervals(const void *a, const void *b)
+{
+    var lowerA = ((const struct IntegrationInterval*)a)->lower;
+    var lowerB = ((const struct IntegrationInterval*)b)->lower;
+    return (lowerA > lowerB) - (lowerA < lowerB);
+}
+
+/**
+ * 用自适应的Gauss-Kronrod（G7-K15）求积公式计算程序在[lower, upper]上的积分。
+ * 每一轮把所有误差估计超过其按宽度分得的误差限的子区间一分为二，新子区间的节点一起按列求值，
+ * 因此每轮只调用一次EvaluateArithmeticProgramColumnsWithKernels，并能用上SIMD。
+ * 最终结果按子区间从左到右的顺序做补偿求和
+ * @param program 以积分变量为唯一变量的程序
+ * @param lower 积分下限，必须是有限值
+ * @param upper 积分上限，必须是有限值，可以小于下限
+ * @param kernelSet 数学函数的实现方式
+ * @param pValue 输出积分值；被积函数在某个节点上为NaN或无穷大时，结果也是NaN或无穷大；
+ * 子区间已无法再细分而误差估计仍超过误差限时（比如积分发散），输出NaN
+ * @param pEvaluationCount 若不为NULL，则输出被积函数的求值次数
+ * @return 若计算成功，返回true，若存储空间不足，返回false
+*/
+static bool IntegrateArithmeticProgram(const struct ArithmeticProgram *program, double lower, double upper, enum MATH_KERNEL_SET kernelSet,
+                                       double *pValue, long *pEvaluationCount)
+{
+    var intervals = (struct IntegrationInterval*)malloc(sizeof(struct IntegrationInterval) * INTEGRATION_MAX_INTERVALS);
+    var pendingIndices = (int*)malloc(sizeof(int) * INTEGRATION_MAX_INTERVALS);
+    var points = (double*)malloc(sizeof(double) * KRONROD_NODE_COUNT * INTEGRATION_MAX_INTERVALS);
+    var values = (double*)malloc(sizeof(double) * KRONROD_NODE_COUNT * INTEGRATION_MAX_INTERVALS);
+    var isSuccessful = intervals != NULL && pendingIndices != NULL && points != NULL && values != NULL;
+    long evaluationCount = 0;
+    var isConverged = false;
+    
+    // 第一轮只有整个积分区间
+    var intervalCount = 1;
+    var pendingCount = 1;
+    if(isSuccessful)
+    {
+        intervals[0] = (struct IntegrationInterval){ .lower = fmin(lower, upper), .upper = fmax(lower, upper) };
+        pendingIndices[0] = 0;
+    }
+    
+    while(isSuccessful && pendingCount > 0)
+    {
+        for(var i = 0; i < pendingCount; i++)
+            GetKronrodPoints(&intervals[pendingIndices[i]], &points[KRONROD_NODE_COUNT * i]);
+        
+        const double *const columns[] = { points };
+        if(!EvaluateArithmeticProgramColumnsWithKernels(program, columns, values, (size_t)KRONROD_NODE_COUNT * pendingCount, kernelSet))
+        {
+            isSuccessful = false;
+            break;
+        }
+        evaluationCount += KRONROD_NODE_COUNT * pendingCount;
+        
+        for(var i = 0; i < pendingCount; i++)
+            ApplyKronrodRule(&intervals[pendingIndices[i]], &values[KRONROD_NODE_COUNT * i]);
+        
+        var total = 0.0;
+        var totalError = 0.0;
+        for(var i = 0; i < intervalCount; i++)
+        {
+            total += intervals[i].value;
+            totalError += intervals[i].error;
+        }
+        var tolerance = fmax(INTEGRATION_ABSOLUTE_TOLERANCE, INTEGRATION_RELATIVE_TOLERANCE * fabs(total));
+        if(!(totalError > tolerance) || !isfinite(total))
+        {
+            isConverged = true;
+            break;
+        }
+        
+        // 误差超过其按宽度分得的误差限的子区间被一分为二，左半边原地替换，右半边追加到末尾，两者都在下一轮求值。
+        // 宽度已小到中点无法与端点区分的子区间不再细分；子区间个数达到上限之后，余下的子区间保持原样。
+        // 没有子区间可以细分时循环结束，此时isConverged仍为false
+        pendingCount = 0;
+        var width = fabs(upper - lower);
+        var currentCount = intervalCount;
+        for(var i = 0; i < currentCount && intervalCount < INTEGRATION_MAX_INTERVALS; i++)
+        {
+            var interval = &intervals[i];
+            var center = 0.5 * (interval->lower + interval->upper);
+            if(interval->error <= tolerance * ((interval->upper - interval->lower) / width) || center <= interval->lower || center >= interval->upper)
+                continue;
+            
+            intervals[intervalCount] = (struct IntegrationInterval){ .lower = center, .upper = interval->upper };
+            *interval = (struct IntegrationInterval){ .lower = interval->lower, .upper = center };
+            pendingIndices[pendingCount++] = i;
+            pendingIndices[pendingCount++] = intervalCount++;
+        }
+    }
+    
+    if(isSuccessful && !isConverged)
+        *pValue = NAN;
+    else if(isSuccessful)
+    {
+        // 按左端点排序之后再求和，这样结果与子区间产生的先后无关
+        var partial = GetReductionIdentity(REDUCTION_KIND_SUM);
+        qsort(intervals, intervalCount, sizeof(struct IntegrationInterval), CompareIntegrationIntervals);
+        for(var i = 0; i < intervalCount; i++)
+            CombineReductionPartial(&partial, (struct ReductionPartial){ intervals[i].value, 0.0 }, REDUCTION_KIND_SUM);
+        
+        var value = GetReductionResult(partial, REDUCTION_KIND_SUM);
+        *pValue = (upper < lower)? -value : value;
+    }
+    if(isSuccessful && pEvaluationCount != NULL)
+        *pEvaluationCount = evaluationCount;
+    
+    free(intervals);
+    free(pendingIndices);
+    free(points);
+    free(values);
+    
+    return isSuccessful;
+}
+
+/**
+ * 求程序在[lower, upper]上的一个根。
+ * 先在区间上等距取ROOT_SCAN_POINT_COUNT个点，一次性按列求值，找到最左边的根或者变号子区间，
+ * 再在该子区间中用Brent方法（结合二分、割线与逆二次插值）逐点求值，直到区间宽度达到double的分辨率
+ * @param program 以未知数为唯一变量的程序
+ * @param lower 区间下限，必须是有限值
+ * @param upper 区间上限，必须是有限值，可以小于下限
+ * @param kernelSet 数学函数的实现方式
+ * @param pValue 输出根；若取样点中没有根也没有变号，输出NaN
+ * @param pEvaluationCount 若不为NULL，则输出程序的求值次数
+ * @return 若计算成功，返回true，若存储空间不足，返回false
+*/
+static bool SolveArithmeticProgram(const struct ArithmeticProgram *program, double lower, double upper, enum MATH_KERNEL_SET kernelSet,
+                                   double *pValue, long *pEvaluationCount)
+{
+    double points[ROOT_SCAN_POINT_COUNT];
+    double values[ROOT_SCAN_POINT_COUNT];
+    const double *const columns[] = { points };
+    
+    var a = fmin(lower, upper);
+    var b = fmax(lower, upper);
+    for(var i = 0; i < ROOT_SCAN_POINT_COUNT; i++)
+        points[i] = (i == ROOT_SCAN_POINT_COUNT - 1)? b : a + (b - a) * ((double)i / (ROOT_SCAN_POINT_COUNT - 1));
+    if(!EvaluateArithmeticProgramColumnsWithKernels(program, columns, values, ROOT_SCAN_POINT_COUNT, kernelSet))
+        return false;
+    long evaluationCount = ROOT_SCAN_POINT_COUNT;
+    
+    // 找到最左边的根或者变号的相邻点对，含有NaN的点对被跳过
+    var root = (double)NAN;
+    var scanIndex = -1;
+    for(var i = 0; i < ROOT_SCAN_POINT_COUNT && isnan(root) && scanIndex < 0; i++)
+    {
+        if(values[i] == 0.0)
+            root = points[i];
+        else if(i + 1 < ROOT_SCAN_POINT_COUNT && ((values[i] < 0.0 && values[i + 1] > 0.0) || (values[i] > 0.0 && values[i + 1] < 0.0)))
+            scanIndex = i;
+    }
+    
+    if(scanIndex >= 0)
+    {
+        // Brent方法：b为当前最好的近似，[b, c]始终包含根，a为上一个近似
+        a = points[scanIndex];
+        b = points[scanIndex + 1];
+        var fa = values[scanIndex];
+        var fb = values[scanIndex + 1];
+        var c = a;
+        var fc = fa;
+        var d = b - a;
+        var e = d;
+        
+        for(var iteration = 0; iteration < ROOT_MAX_ITERATIONS; iteration++)
+        {
+            if((fb > 0.0) == (fc > 0.0))
+            {
+                c = a;
+                fc = fa;
+                d = e = b - a;
+            }
+            if(fabs(fc) < fabs(fb))
+            {
+                a = b;
+                b = c;
+                c = a;
+                fa = fb;
+                fb = fc;
+                fc = fa;
+            }
+            
+            var tolerance = 2.0 * DBL_EPSILON * fabs(b) + 0.5 * DBL_TRUE_MIN;
+            var middle = 0.5 * (c - b);
+            if(fabs(middle) <= tolerance || fb == 0.0)
+                break;
+            
+            if(fabs(e) >= tolerance && fabs(fa) > fabs(fb))
+            {
+                // 尝试插值：a与c相同时用割线法，否则用逆二次插值
+                double p, q;
+                var s = fb / fa;
+                if(a == c)
+                {
+                    p = 2.0 * middle * s;
+                    q = 1.0 - s;
+                }
+                else
+                {
+                    var r = fb / fc;
+                    var t = fa / fc;
+                    p = s * (2.0 * middle * t * (t - r) - (b - a) * (r - 1.0));
+                    q = (t - 1.0) * (r - 1.0) * (s - 1.0);
+                }
+                if(p > 0.0)
+                    q = -q;
+                else
+                    p = -p;
+                
+                // 插值点必须落在区间之内，并且收敛得足够快，否则改用二分
+                if(2.0 * p < fmin(3.0 * middle * q - fabs(tolerance * q), fabs(e * q)))
+                {
+                    e = d;
+                    d = p / q;
+                }
+                else
+                    d = e = middle;
+            }
+            else
+                d = e = middle;
+            
+            a = b;
+            fa = fb;
+            b += (fabs(d) > tolerance)? d : copysign(tolerance, middle);
+            fb = EvaluateArithmeticProgramWithKernels(program, &b, kernelSet);
+            evaluationCount++;
+        }
+        root = b;
+    }
+    
+    *pValue = root;
+    if(pEvaluationCount != NULL)
+        *pEvaluationCount = evaluationCount;
+    return true;
+}
+
+/**
+ * 被归约的表达式编译失败时找出原因。把其中的索引变量替换为等长的数字之后按普通表达式求值，
+ * 这样报告的错误原因以及位置都与直接计算时相同；替换之后能够求值的表达式仍报告为非法的归约
+ * @param body 经过过滤并以'\0'结尾的被归约表达式
+ * @param length 表达式的字节数
+ * @param indexName 经过过滤的索引变量名
+ * @return 错误原因以及相对于body的出错位置
+*/
+static struct CalculationError DiagnoseReductionBody(const char *body, size_t length, const char *indexName, enum MATH_KERNEL_SET kernelSet)
+{
+    var text = (char*)malloc(length + 1);
+    if(text == NULL)
+        return (struct CalculationError){ CALCULATION_ERROR_OUT_OF_MEMORY, 0 };
+    memcpy(text, body, length + 1);
+    
+    var indexLength = strlen(indexName);
+    for(size_t i = 0; i < length; )
+    {
+        if(!IsMathFunction(text[i]))
+        {
+            // 数字字面量中的字母（如指数与十六进制数字）不是名字，整个跳过
+            var isNumber = IsDigital(text[i]) || text[i] == '.';
+            i++;
+            while(isNumber && i < length && (IsVariableNameCharacter(text[i]) || text[i] == '.'))
+                i++;
+            continue;
+        }
+        
+        var nameLength = (size_t)1;
+        while(i + nameLength < length && IsVariableNameCharacter(text[i + nameLength]))
+            nameLength++;
+        if(nameLength == indexLength && strncmp(&text[i], indexName, indexLength) == 0 && text[i + nameLength] != '(')
+            memset(&text[i], '1', nameLength);
+        i += nameLength;
+    }
+    
+    double value;
+    struct CalculationError error;
+    if(EvaluateArithmeticSpan(text, length, true, kernelSet, NULL, &value, &error, NULL))
+        error = (struct CalculationError){ CALCULATION_ERROR_INVALID_REDUCTION, 0 };
+    free(text);
+    
+    return error;
+}
+
+/**
+ * 计算一个区间归约，例如sum(i,1,1e8,1/i^2)、prod(k,1,10,k)、min(i,0,99,sin(i))与max(i,0,99,cos(i))。
+ * 第一个参数是索引变量名；第二、三个参数是索引的下界与上界（闭区间），它们可以是任意表达式，但结果必须是整数；
+ * 最后一个参数是只含索引变量的表达式，它只被编译一次，然后按块对整列索引求值。
+ * integrate(x,a,b,f)与solve(x,lo,hi,f)的参数形式相同，只是上下界可以是任意有限的实数，
+ * 它们分别求出f在区间上的积分以及f在区间上的一个根
+ * @param expr 指向归约名的起始字符，它不必经过NormalizeArithmeticExpression过滤
+ * @param length expr之后可供读取的字节数
+ * @param kernelSet 数学函数的实现方式
+ * @param pValue 输出归约结果
+ * @param pLength 输出从归约名到与之匹配的右括号所占用的字节数
+ * @param pError 若不为NULL，则输出错误原因以及相对于expr的出错位置
+ * @return 若归约成功，返回true，否则返回false
+*/
+static bool EvaluateReduction(const char *expr, size_t length, enum MATH_KERNEL_SET kernelSet, double *pValue, size_t *pLength, struct CalculationError *pError)
+{
+    struct CalculationError error = { CALCULATION_ERROR_NONE, 0 };
+    
+    // 找到与归约名之后的左括号相匹配的右括号，以及括号内最外层的三个','
+    size_t open = 0;
+    while(open < length && expr[open] != '(' && expr[open] != '[')
+        open++;
+    
+    size_t commas[3];
+    var commaCount = 0;
+    long depth = 0;
+    var close = open;
+    for(; close < length && error.code == CALCULATION_ERROR_NONE; close++)
+    {
+        var ch = expr[close];
+        if(ch == '(' || ch == '[')
+            depth++;
+        else if((ch == ')' || ch == ']') && --depth == 0)
+            break;
+        else if(ch == ',' && depth == 1)
+        {
+            if(commaCount == 3)
+                error = (struct CalculationError){ CALCULATION_ERROR_INVALID_REDUCTION, close };
+            else
+                commas[commaCount++] = close;
+        }
+    }
+    
+    if(error.code == CALCULATION_ERROR_NONE && close >= length)
+        error = (struct CalculationError){ CALCULATION_ERROR_UNMATCHED_PARENTHESIS, open };
+    else if(error.code == CALCULATION_ERROR_NONE && commaCount < 3)
+        error = (struct CalculationError){ CALCULATION_ERROR_INVALID_REDUCTION, close };
+    
+    // 将参数复制出来，并把分隔它们的','替换为'\0'，这样每个参数都是一个独立的、经过过滤的表达式
+    char *text = NULL;
+    if(error.code == CALCULATION_ERROR_NONE)
+    {
+        text = (char*)malloc(close + 1);
+        if(text == NULL)
+            error = (struct CalculationError){ CALCULATION_ERROR_OUT_OF_MEMORY, 0 };
+    }
+    
+    if(error.code == CALCULATION_ERROR_NONE)
+    {
+        NormalizeArithmeticExpression(text, expr, close);
+        text[open] = '\0';
+        for(var i = 0; i < 3; i++)
+            text[commas[i]] = '\0';
+        text[close] = '\0';
+        
+        var kind = (enum REDUCTION_KIND)FindReductionKind(text, open);
+        const char *indexName = &text[open + 1];
+        if(!IsValidVariableName(indexName))
+            error = (struct CalculationError){ CALCULATION_ERROR_INVALID_REDUCTION, open + 1 };
+        
+        // 上下界中不能出现索引变量，所以直接计算
+        double bounds[2];
+        for(var i = 0; i < 2 && error.code == CALCULATION_ERROR_NONE; i++)
+        {
+            var boundOffset = commas[i] + 1;
+            var boundLength = commas[i + 1] - boundOffset;
+            if(boundLength == 0)
+                error = (struct CalculationError){ CALCULATION_ERROR_INVALID_REDUCTION, boundOffset };
+            else if(!EvaluateArithmeticSpan(&text[boundOffset], boundLength, true, kernelSet, NULL, &bounds[i], &error, NULL))
+                error.offset += boundOffset;
+            else if(kind >= REDUCTION_KIND_INTEGRATE? !isfinite(bounds[i]) : (bounds[i] != floor(bounds[i]) || fabs(bounds[i]) > REDUCTION_MAX_INDEX))
+                error = (struct CalculationError){ CALCULATION_ERROR_INVALID_REDUCTION, boundOffset };
+        }
+        
+        struct ArithmeticProgram *program = NULL;
+        var bodyOffset = commas[2] + 1;
+        if(error.code == CALCULATION_ERROR_NONE)
+        {
+            if(bodyOffset == close)
+                error = (struct CalculationError){ CALCULATION_ERROR_INVALID_REDUCTION, bodyOffset };
+            else if((program = CompileArithmeticExpression(&text[bodyOffset], (const char *const[]){ indexName }, 1)) == NULL)
+            {
+                error = DiagnoseReductionBody(&text[bodyOffset], close - bodyOffset, indexName, kernelSet);
+                error.offset += bodyOffset;
+            }
+        }
+        
+        if(error.code == CALCULATION_ERROR_NONE)
+        {
+            bool isSuccessful;
+            if(kind == REDUCTION_KIND_INTEGRATE)
+                isSuccessful = IntegrateArithmeticProgram(program, bounds[0], bounds[1], kernelSet, pValue, NULL);
+            else if(kind == REDUCTION_KIND_SOLVE)
+                isSuccessful = SolveArithmeticProgram(program, bounds[0], bounds[1], kernelSet, pValue, NULL);
+            else
+            {
+                var first = (int64_t)bounds[0];
+                var last = (int64_t)bounds[1];
+                var count = (last >= first)? (size_t)(last - first) + 1 : 0;
+                isSuccessful = ReduceArithmeticProgramRange(program, kind, first, count, kernelSet, pValue);
+            }
+            if(!isSuccessful)
+                error = (struct CalculationError){ CALCULATION_ERROR_OUT_OF_MEMORY, 0 };
+        }
+        
+        DestroyArithmeticProgram(program);
+    }
+    free(text);
+    
+    if(pError != NULL)
+        *pError = error;
+    
+    if(error.code != CALCULATION_ERROR_NONE)
+        return false;
+    
+    *pLength = close + 1;
+    return true;
+}
+
+/* 以下为各个数学函数的导数，参数为自变量x以及函数值y = f(x)，有些导数用y表示更简单，也更便宜 */
+
+static double SinDerivative(double x, double y)
+{
+    return cos(x);
+}
+
+static double CosDerivative(double x, double y)
+{
+    return -sin(x);
+}
+
+static double TanDerivative(double x, double y)
+{
+    return 1.0 + y * y;
+}
+
+static double CotDerivative(double x, double y)
+{
+    return -(1.0 + y * y);
+}
+
+static double SinhDerivative(double x, double y)
+{
+    return cosh(x);
+}
+
+static double CoshDerivative(double x, double y)
+{
+    return sinh(x);
+}
+
+static double TanhDerivative(double x, double y)
+{
+    return 1.0 - y * y;
+}
+
+static double AsinDerivative(double x, double y)
+{
+    return 1.0 / sqrt(1.0 - x * x);
+}
+
+static double AcosDerivative(double x, double y)
+{
+    return -1.0 / sqrt(1.0 - x * x);
+}
+
+static double AtanDerivative(double x, double y)
+{
+    return 1.0 / (1.0 + x * x);
+}
+
+static double AsinhDerivative(double x, double y)
+{
+    return 1.0 / hypot(x, 1.0);
+}
+
+static double AcoshDerivative(double x, double y)
+{
+    // 分开开方以免x接近1时x * x - 1丢失精度
+    return 1.0 / (sqrt(x - 1.0) * sqrt(x + 1.0));
+}
+
+static double AtanhDerivative(double x, double y)
+{
+    return 1.0 / ((1.0 - x) * (1.0 + x));
+}
+
+static double Log2Derivative(double x, double y)
+{
+    return 1.0 / (x * M_LN2);
+}
+
+static double Log10Derivative(double x, double y)
+{
+    return 1.0 / (x * M_LN10);
+}
+
+static double LnDerivative(double x, double y)
+{
+    return 1.0 / x;
+}
+
+static double SqrtDerivative(double x, double y)
+{
+    return 0.5 / y;
+}
+
+static double CbrtDerivative(double x, double y)
+{
+    return 1.0 / (3.0 * y * y);
+}
+
+static double RecpDerivative(double x, double y)
+{
+    return -y * y;
+}
+
+static double RadianDerivative(double x, double y)
+{
+    return M_PI / 180.0;
+}
+
+static double DegreeDerivative(double x, double y)
+{
+    return 180.0 / M_PI;
+}
+
+static double ExpDerivative(double x, double y)
+{
+    return y;
+}
+
+/** 在mathDerivativeList中定义一个函数的导数，各参数的含义与MATH_FUNCTION_ENTRY相同 */
+#define MATH_DERIVATIVE_ENTRY(first, middle, last, length, pDerivative)  \
+    [MATH_FUNCTION_HASH(first, middle, last, length)] = { pDerivative }
+
+/**
+ * 数学函数的导数，与mathFuncList一一对应，前向自动微分时用于求出CALL指令的导数系数。
+ * 命令行的--bench-gradient选项会用中心差分逐个检查这些导数
+*/
+static const struct MathDerivative
+{
+    double (*pDerivative)(double x, double y);
+} mathDerivativeList[MATH_FUNCTION_TABLE_SIZE] = {
+    MATH_DERIVATIVE_ENTRY('s', 'i', 'n', 3, &SinDerivative),
+    MATH_DERIVATIVE_ENTRY('c', 'o', 's', 3, &CosDerivative),
+    MATH_DERIVATIVE_ENTRY('t', 'a', 'n', 3, &TanDerivative),
+    MATH_DERIVATIVE_ENTRY('c', 'o', 't', 3, &CotDerivative),
+    MATH_DERIVATIVE_ENTRY('s', 'n', 'h', 4, &SinhDerivative),
+    MATH_DERIVATIVE_ENTRY('c', 's', 'h', 4, &CoshDerivative),
+    MATH_DERIVATIVE_ENTRY('t', 'n', 'h', 4, &TanhDerivative),
+    MATH_DERIVATIVE_ENTRY('a', 'i', 'n', 4, &AsinDerivative),
+    MATH_DERIVATIVE_ENTRY('a', 'o', 's', 4, &AcosDerivative),
+    MATH_DERIVATIVE_ENTRY('a', 'a', 'n', 4, &AtanDerivative),
+    MATH_DERIVATIVE_ENTRY('a', 'n', 'h', 4, &AsinhDerivative),
+    MATH_DERIVATIVE_ENTRY('a', 's', 'h', 4, &AcoshDerivative),
+    MATH_DERIVATIVE_ENTRY('l', 'o', 'g', 3, &Log2Derivative),
+    MATH_DERIVATIVE_ENTRY('l', 'g', 'g', 2, &Log10Derivative),
+    MATH_DERIVATIVE_ENTRY('l', 'n', 'n', 2, &LnDerivative),
+    MATH_DERIVATIVE_ENTRY('s', 'r', 't', 4, &SqrtDerivative),
+    MATH_DERIVATIVE_ENTRY('c', 'r', 't', 4, &CbrtDerivative),
+    MATH_DERIVATIVE_ENTRY('r', 'c', 'p', 4, &RecpDerivative),
+    MATH_DERIVATIVE_ENTRY('r', 'a', 'd', 3, &RadianDerivative),
+    MATH_DERIVATIVE_ENTRY('d', 'e', 'g', 3, &DegreeDerivative),
+    MATH_DERIVATIVE_ENTRY('e', 'x', 'p', 3, &ExpDerivative),
+    MATH_DERIVATIVE_ENTRY('a', 'i', 'h', 5, &AsinhDerivative),
+    MATH_DERIVATIVE_ENTRY('a', 'o', 'h', 5, &AcoshDerivative),
+    MATH_DERIVATIVE_ENTRY('a', 'a', 'h', 5, &AtanhDerivative),
+    MATH_DERIVATIVE_ENTRY('a', 's', 'n', 6, &AsinDerivative),
+    MATH_DERIVATIVE_ENTRY('a', 'c', 's', 6, &AcosDerivative),
+    MATH_DERIVATIVE_ENTRY('a', 't', 'n', 6, &AtanDerivative),
+    MATH_DERIVATIVE_ENTRY('a', 's', 'h', 7, &AsinhDerivative),
+    MATH_DERIVATIVE_ENTRY('a', 'c', 'h', 7, &AcoshDerivative),
+    MATH_DERIVATIVE_ENTRY('a', 't', 'h', 7, &AtanhDerivative),
+    MATH_DERIVATIVE_ENTRY('l', 'g', '2', 4, &Log2Derivative),
+    MATH_DERIVATIVE_ENTRY('l', 'g', '0', 5, &Log10Derivative)
+};
+
+/**
+ * 求出幂运算a^b对两个操作数的导数系数。
+ * 对a的系数只在b不为0时计算，对b的系数为y * ln(a)，调用者只在对应的导数不为0时才使用它们，
+ * 这样常数指数（如x^2在x = 0处）与常数底数都不会因为0乘以无穷大而产生NaN
+ * @param pBaseCoefficient 输出对a的系数b * a^(b - 1)
+ * @param pExponentCoefficient 输出对b的系数
+ * @return a^b
+*/
+static inline double GetPowerDerivatives(double a, double b, double *pBaseCoefficient, double *pExponentCoefficient)
+{
+    var y = pow(a, b);
+    *pBaseCoefficient = (b == 0.0)? 0.0 : b * pow(a, b - 1.0);
+    *pExponentCoefficient = y * log(a);
+    return y;
+}
+
+/** 由两个操作数的导数以及幂运算的导数系数求出a^b的导数，见GetPowerDerivatives */
+static inline double CombinePowerDerivative(double baseDerivative, double exponentDerivative, double baseCoefficient, double exponentCoefficient)
+{
+    return ((baseDerivative != 0.0)? baseCoefficient * baseDerivative : 0.0) + ((exponentDerivative != 0.0)? exponentCoefficient * exponentDerivative : 0.0);
+}
+
+/**
+ * 导数系数乘以导数。导数为0表示操作数不依赖该变量，此时乘积总是0，
+ * 这样操作数处于奇点（系数为无穷大或NaN，如sqrt在0处）时，对其他变量的偏导数不会因为0乘以无穷大而变为NaN。
+ * 只有系数不是有限值时0与之的乘积才是NaN，所以只需检查乘积
+*/
+static inline double ScaleDerivative(double coefficient, double derivative)
+{
+    var product = coefficient * derivative;
+    return (product == product || derivative != 0.0)? product : 0.0;
+}
+
+/** 求商的导数时以除数的值去除分子，分子为0时结果总是0，除数为0时也是如此，理由与ScaleDerivative相同 */
+static inline double DivideDerivative(double numerator, double divisor)
+{
+    var quotient = numerator / divisor;
+    return (quotient == quotient || numerator != 0.0)? quotient : 0.0;
+}
+
+/** 前向自动微分时，栈不超过该元素个数的程序直接使用函数栈上的空间 */
+#define GRADIENT_LOCAL_STACK_SIZE   256
+
+/**
+ * 以前向自动微分的方式执行编译后的程序：栈中的每个元素都是一个对偶数，依次存放值以及对各个变量的偏导数，
+ * 每条指令都同时更新值与偏导数。值的计算方式与RunArithmeticProgram完全相同
+ * @param stack 求值栈，至少包含(program->maxStackDepth + program->temporaryCount) * (1 + program->variableCount)个元素，临时单元紧跟在求值栈之后
+ * @param gradient 输出对各个变量的偏导数，至少包含program->variableCount个元素
+ * @return 程序的计算结果
+*/
+static double RunArithmeticProgramGradient(const struct ArithmeticProgram *program, const double bindings[], double stack[], double gradient[])
+{
+    var variableCount = program->variableCount;
+    var slotSize = 1 + variableCount;
+    
+    // top始终指向当前栈顶元素，top[0]为值，top[1 + k]为对第k个变量的偏导数
+    var top = stack - slotSize;
+    var temporaries = stack + slotSize * program->maxStackDepth;
+    
+    const var constants = program->constants;
+    const var instructions = program->instructions;
+    const var count = program->instructionCount;
+    
+    for(var i = 0; i < count; i++)
+    {
+        var instruction = instructions[i];
+        var right = top;
+        
+        switch(instruction.opcode)
+        {
+        case PROGRAM_OPCODE_PUSH_CONSTANT:
+            top += slotSize;
+            top[0] = constants[instruction.operand];
+            for(var k = 1; k < slotSize; k++)
+                top[k] = 0.0;
+            break;
+            
+        case PROGRAM_OPCODE_PUSH_VARIABLE:
+            top += slotSize;
+            top[0] = bindings[instruction.operand];
+            for(var k = 1; k < slotSize; k++)
+                top[k] = 0.0;
+            top[1 + instruction.operand] = 1.0;
+            break;
+            
+        case PROGRAM_OPCODE_ADD:
+            top -= slotSize;
+            for(var k = 0; k < slotSize; k++)
+                top[k] = top[k] + right[k];
+            break;
+            
+        case PROGRAM_OPCODE_MINUS:
+            top -= slotSize;
+            for(var k = 0; k < slotSize; k++)
+                top[k] = top[k] - right[k];
+            break;
+            
+        case PROGRAM_OPCODE_MUL:
+            top -= slotSize;
+            for(var k = 1; k < slotSize; k++)
+                top[k] = ScaleDerivative(right[0], top[k]) + ScaleDerivative(top[0], right[k]);
+            top[0] = top[0] * right[0];
+            break;
+            
+        case PROGRAM_OPCODE_DIV:
+        {
+            top -= slotSize;
+            var quotient = top[0] / right[0];
+            for(var k = 1; k < slotSize; k++)
+                top[k] = DivideDerivative(top[k] - ScaleDerivative(quotient, right[k]), right[0]);
+            top[0] = quotient;
+            break;
+        }
+            
+        case PROGRAM_OPCODE_MOD:
+            // 求模的两个操作数都先被截断为整数，所以结果在局部是常数
+            top -= slotSize;
+            top[0] = ModOp(top[0], right[0]);
+            for(var k = 1; k < slotSize; k++)
+                top[k] = 0.0;
+            break;
+            
+        case PROGRAM_OPCODE_POW:
+        {
+            top -= slotSize;
+            double baseCoefficient, exponentCoefficient;
+            top[0] = GetPowerDerivatives(top[0], right[0], &baseCoefficient, &exponentCoefficient);
+            for(var k = 1; k < slotSize; k++)
+                top[k] = CombinePowerDerivative(top[k], right[k], baseCoefficient, exponentCoefficient);
+            break;
+        }
+            
+        case PROGRAM_OPCODE_NEG:
+            for(var k = 0; k < slotSize; k++)
+                top[k] = -top[k];
+            break;
+            
+        case PROGRAM_OPCODE_RECIPROCAL:
+        {
+            top[0] = 1.0 / top[0];
+            var coefficient = -top[0] * top[0];
+            for(var k = 1; k < slotSize; k++)
+                top[k] = ScaleDerivative(coefficient, top[k]);
+            break;
+        }
+            
+        case PROGRAM_OPCODE_CALL:
+        {
+            var x = top[0];
+            top[0] = mathFuncList[instruction.operand].pFunc(x);
+            var coefficient = mathDerivativeList[instruction.operand].pDerivative(x, top[0]);
+            for(var k = 1; k < slotSize; k++)
+                top[k] = ScaleDerivative(coefficient, top[k]);
+            break;
+        }
+            
+        case PROGRAM_OPCODE_LOAD_TEMPORARY:
+            top += slotSize;
+            memcpy(top, temporaries + slotSize * instruction.operand, sizeof(double) * slotSize);
+            break;
+            
+        case PROGRAM_OPCODE_STORE_TEMPORARY:
+            memcpy(temporaries + slotSize * instruction.operand, top, sizeof(double) * slotSize);
+            break;
+            
+        default:
+            break;
+        }
+    }
+    
+    if(variableCount > 0)
+        memcpy(gradient, top + 1, sizeof(double) * variableCount);
+    return top[0];
+}
+
+/**
+ * 以前向自动微分的方式对编译后的程序求值，一次求出值以及对所有变量的偏导数，
+ * 而不必像有限差分那样对每个变量分别再求值两次。
+ * 四则运算、乘方以及所有数学函数都按各自的求导法则传播导数；求模的结果在局部是常数，其导数为0。
+ * 在导数不存在的点（如sqrt在0处）得到的是对应公式的极限值，可能为无穷大或NaN；
+ * 但子表达式不依赖的变量不受其奇点的影响，比如sqrt(x) + y在x = 0处对y的偏导数仍为1
+ * @param program 由CompileArithmeticExpression所生成的程序
+ * @param bindings 各个变量的值，含义与EvaluateArithmeticProgram相同
+ * @param pValue 输出计算结果，与EvaluateArithmeticProgram的结果逐位相同
+ * @param gradient 输出对各个变量的偏导数，按槽位索引依次存放，至少包含program->variableCount个元素。若程序中没有变量，可传NULL
+ * @return 若求值成功，返回true，若存储空间不足，返回false
+*/
+bool EvaluateArithmeticProgramGradient(const struct ArithmeticProgram *program, const double bindings[], double *pValue, double gradient[])
+{
+    double localStack[GRADIENT_LOCAL_STACK_SIZE];
+    
+    var stackSize = (size_t)(program->maxStackDepth + program->temporaryCount) * (1 + program->variableCount);
+    var stack = (stackSize <= GRADIENT_LOCAL_STACK_SIZE)? localStack : (double*)malloc(sizeof(double) * stackSize);
+    if(stack == NULL)
+        return false;
+    
+    *pValue = RunArithmeticProgramGradient(program, bindings, stack, gradient);
+    
+    if(stack != localStack)
+        free(stack);
+    return true;
+}
+
+/** ScaleDerivative的向量版本，结果逐个元素地与之相同 */
+static inline __attribute__((always_inline)) ColumnVector ScaleDerivativeVector(ColumnVector coefficient, ColumnVector derivative)
+{
+    var product = coefficient * derivative;
+    return (ColumnVector)((ColumnBitsVector)((product == product) | (derivative != 0.0)) & (ColumnBitsVector)product);
+}
+
+/** DivideDerivative的向量版本，结果逐个元素地与之相同 */
+static inline __attribute__((always_inline)) ColumnVector DivideDerivativeVector(ColumnVector numerator, ColumnVector divisor)
+{
+    var quotient = numerator / divisor;
+    return (ColumnVector)((ColumnBitsVector)((quotient == quotient) | (numerator != 0.0)) & (ColumnBitsVector)quotient);
+}
+
+/**
+ * 以前向自动微分的方式对一个数据块求值。栈中的每个元素依次存放值的数据块以及对各个变量偏导数的数据块，
+ * 四则运算与导数的传播都以向量形式进行，乘方与数学函数的值以及导数系数逐个元素计算，所用的公式与RunArithmeticProgramGradient完全相同
+ * @param stack 求值栈，每个元素包含(1 + program->variableCount) * COLUMN_BLOCK_VECTORS个向量
+ * @param values 本数据块的输出值
+ * @param gradients 各个变量的偏导数输出列，为NULL的列不输出
+*/
+static inline __attribute__((always_inline)) void EvaluateGradientColumnBlockKernel(const struct ArithmeticProgram *program, const double *const columns[], size_t offset, int length, ColumnVector *stack,
+                                                                                    double values[], double *const gradients[])
+{
+    var partCount = 1 + program->variableCount;
+    var slotVectors = COLUMN_BLOCK_VECTORS * partCount;
+    var top = stack - slotVectors;
+    var temporaries = stack + slotVectors * program->maxStackDepth;
+    var vectorCount = (length + COLUMN_VECTOR_LENGTH - 1) / COLUMN_VECTOR_LENGTH;
+    
+    // 逐个元素求出的导数系数，再以向量形式乘到各个偏导数上
+    ColumnVector coefficients[COLUMN_BLOCK_VECTORS];
+    var coefficientValues = (double*)coefficients;
+    
+    const var constants = program->constants;
+    const var instructions = program->instructions;
+    const var count = program->instructionCount;
+    
+    for(var i = 0; i < count; i++)
+    {
+        var instruction = instructions[i];
+        var right = top;
+        
+        switch(instruction.opcode)
+        {
+        case PROGRAM_OPCODE_PUSH_CONSTANT:
+        case PROGRAM_OPCODE_PUSH_VARIABLE:
+        {
+            top += slotVectors;
+            var zero = (ColumnVector){ 0.0, 0.0, 0.0, 0.0 };
+            for(var v = COLUMN_BLOCK_VECTORS; v < slotVectors; v++)
+                top[v] = zero;
+            
+            if(instruction.opcode == PROGRAM_OPCODE_PUSH_CONSTANT)
+            {
+                var value = constants[instruction.operand];
+                var vector = (ColumnVector){ value, value, value, value };
+                for(var v = 0; v < vectorCount; v++)
+                    top[v] = vector;
+            }
+            else
+            {
+                var topValues = (double*)top;
+                memcpy(topValues, &columns[instruction.operand][offset], sizeof(double) * length);
+                for(var j = length; j < vectorCount * COLUMN_VECTOR_LENGTH; j++)
+                    topValues[j] = 0.0;
+                
+                var one = (ColumnVector){ 1.0, 1.0, 1.0, 1.0 };
+                var derivative = top + COLUMN_BLOCK_VECTORS * (1 + instruction.operand);
+                for(var v = 0; v < vectorCount; v++)
+                    derivative[v] = one;
+            }
+            break;
+        }
+            
+        case PROGRAM_OPCODE_ADD:
+            top -= slotVectors;
+            for(var p = 0; p < partCount; p++)
+            {
+                for(var v = p * COLUMN_BLOCK_VECTORS; v < p * COLUMN_BLOCK_VECTORS + vectorCount; v++)
+                    top[v] = top[v] + right[v];
+            }
+            break;
+            
+        case PROGRAM_OPCODE_MINUS:
+            top -= slotVectors;
+            for(var p = 0; p < partCount; p++)
+            {
+                for(var v = p * COLUMN_BLOCK_VECTORS; v < p * COLUMN_BLOCK_VECTORS + vectorCount; v++)
+                    top[v] = top[v] - right[v];
+            }
+            break;
+            
+        case PROGRAM_OPCODE_MUL:
+            top -= slotVectors;
+            for(var p = 1; p < partCount; p++)
+            {
+                var derivative = top + p * COLUMN_BLOCK_VECTORS;
+                var rightDerivative = right + p * COLUMN_BLOCK_VECTORS;
+                for(var v = 0; v < vectorCount; v++)
+                    derivative[v] = ScaleDerivativeVector(right[v], derivative[v]) + ScaleDerivativeVector(top[v], rightDerivative[v]);
+            }
+            for(var v = 0; v < vectorCount; v++)
+                top[v] = top[v] * right[v];
+            break;
+            
+        case PROGRAM_OPCODE_DIV:
+            top -= slotVectors;
+            for(var v = 0; v < vectorCount; v++)
+                top[v] = top[v] / right[v];
+            for(var p = 1; p < partCount; p++)
+            {
+                var derivative = top + p * COLUMN_BLOCK_VECTORS;
+                var rightDerivative = right + p * COLUMN_BLOCK_VECTORS;
+                for(var v = 0; v < vectorCount; v++)
+                    derivative[v] = DivideDerivativeVector(derivative[v] - ScaleDerivativeVector(top[v], rightDerivative[v]), right[v]);
+            }
+            break;
+            
+        case PROGRAM_OPCODE_MOD:
+        case PROGRAM_OPCODE_POW:
+        {
+            top -= slotVectors;
+            var topValues = (double*)top;
+            const double *rightValues = (const double*)right;
+            if(instruction.opcode == PROGRAM_OPCODE_MOD)
+            {
+                for(var j = 0; j < length; j++)
+                    topValues[j] = ModOp(topValues[j], rightValues[j]);
+                
+                var zero = (ColumnVector){ 0.0, 0.0, 0.0, 0.0 };
+                for(var v = COLUMN_BLOCK_VECTORS; v < slotVectors; v++)
+                    top[v] = zero;
+                break;
+            }
+            
+            // 对底数的系数暂存在coefficients中，对指数的系数暂存在右操作数的值中
+            var exponentValues = (double*)right;
+            for(var j = 0; j < length; j++)
+                topValues[j] = GetPowerDerivatives(topValues[j], rightValues[j], &coefficientValues[j], &exponentValues[j]);
+            
+            for(var p = 1; p < partCount; p++)
+            {
+                var derivatives = (double*)(top + p * COLUMN_BLOCK_VECTORS);
+                const double *rightDerivatives = (const double*)(right + p * COLUMN_BLOCK_VECTORS);
+                for(var j = 0; j < length; j++)
+                    derivatives[j] = CombinePowerDerivative(derivatives[j], rightDerivatives[j], coefficientValues[j], exponentValues[j]);
+            }
+            break;
+        }
+            
+        case PROGRAM_OPCODE_NEG:
+            for(var p = 0; p < partCount; p++)
+            {
+                for(var v = p * COLUMN_BLOCK_VECTORS; v < p * COLUMN_BLOCK_VECTORS + vectorCount; v++)
+                    top[v] = -top[v];
+            }
+            break;
+            
+        case PROGRAM_OPCODE_RECIPROCAL:
+        case PROGRAM_OPCODE_CALL:
+        {
+            if(instruction.opcode == PROGRAM_OPCODE_RECIPROCAL)
+            {
+                var one = (ColumnVector){ 1.0, 1.0, 1.0, 1.0 };
+                for(var v = 0; v < vectorCount; v++)
+                {
+                    top[v] = one / top[v];
+                    coefficients[v] = -top[v] * top[v];
+                }
+            }
+            else
+            {
+                var topValues = (double*)top;
+                var pFunc = mathFuncList[instruction.operand].pFunc;
+                var pDerivative = mathDerivativeList[instruction.operand].pDerivative;
+                for(var j = 0; j < length; j++)
+                {
+                    var x = topValues[j];
+                    topValues[j] = pFunc(x);
+                    coefficientValues[j] = pDerivative(x, topValues[j]);
+                }
+            }
+            
+            for(var p = 1; p < partCount; p++)
+            {
+                var derivative = top + p * COLUMN_BLOCK_VECTORS;
+                for(var v = 0; v < vectorCount; v++)
+                    derivative[v] = ScaleDerivativeVector(coefficients[v], derivative[v]);
+            }
+            break;
+        }
+            
+        case PROGRAM_OPCODE_LOAD_TEMPORARY:
+            top += slotVectors;
+            memcpy(top, temporaries + slotVectors * instruction.operand, sizeof(ColumnVector) * slotVectors);
+            break;
+            
+        case PROGRAM_OPCODE_STORE_TEMPORARY:
+            memcpy(temporaries + slotVectors * instruction.operand, top, sizeof(ColumnVector) * slotVectors);
+            break;
+            
+        default:
+            break;
+        }
+    }
+    
+    memcpy(values, top, sizeof(double) * length);
+    for(var k = 0; k < program->variableCount; k++)
+    {
+        if(gradients[k] != NULL)
+            memcpy(&gradients[k][offset], top + COLUMN_BLOCK_VECTORS * (1 + k), sizeof(double) * length);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/** 使用AVX2指令集的前向自动微分数据块求值函数 */
+__attribute__((target("avx2"))) static void EvaluateGradientColumnBlockAVX2(const struct ArithmeticProgram *program, const double *const columns[], size_t offset, int length, ColumnVector *stack,
+                                                                           double values[], double *const gradients[])
+{
+    EvaluateGradientColumnBlockKernel(program, columns, offset, length, stack, values, gradients);
+}
+#endif
+
+/** 使用目标平台基础指令集的前向自动微分数据块求值函数 */
+static void EvaluateGradientColumnBlockGeneric(const struct ArithmeticProgram *program, const double *const columns[], size_t offset, int length, ColumnVector *stack,
+                                               double values[], double *const gradients[])
+{
+    EvaluateGradientColumnBlockKernel(program, columns, offset, length, stack, values, gradients);
+}
+
+/**
+ * 以前向自动微分的方式对编译后的程序按列求值，每行输入产生一个值以及对各个变量的偏导数。
+ * 数据的分块方式与指令集的选择都与EvaluateArithmeticProgramColumns相同，
+ * 其结果与对每一行分别调用EvaluateArithmeticProgramGradient的结果逐位相同
+ * @param program 由CompileArithmeticExpression所生成的程序
+ * @param columns 各个变量的输入列，含义与EvaluateArithmeticProgramColumns相同
+ * @param values 输出值的列，至少包含count个元素
+ * @param gradients 各个变量的偏导数输出列，按槽位索引依次存放，每列至少包含count个元素。
+ * 不需要的列可以为NULL；若程序中没有变量，gradients本身也可以为NULL
+ * @param count 行数
+ * @return 若求值成功，返回true，若存储空间不足，返回false
+*/
+bool EvaluateArithmeticProgramGradientColumns(const struct ArithmeticProgram *program, const double *const columns[], double values[], double *const gradients[], size_t count)
+{
+    var blockFunc = &EvaluateGradientColumnBlockGeneric;
+    
+#if defined(__x86_64__) || defined(__i386__)
+    if(GetColumnInstructionSet() == COLUMN_INSTRUCTION_SET_AVX2)
+        blockFunc = &EvaluateGradientColumnBlockAVX2;
+#endif
+    
+    var slotVectors = (size_t)COLUMN_BLOCK_VECTORS * (1 + program->variableCount);
+    var stack = (ColumnVector*)aligned_alloc(32, sizeof(ColumnVector) * slotVectors * (program->maxStackDepth + program->temporaryCount));
+    if(stack == NULL)
+        return false;
+    
+    for(size_t offset = 0; offset < count; offset += COLUMN_BLOCK_SIZE)
+    {
+        var length = (count - offset < COLUMN_BLOCK_SIZE)? (int)(count - offset) : COLUMN_BLOCK_SIZE;
+        blockFunc(program, columns, offset, length, stack, &values[offset], gradients);
+    }
+    
+    free(stack);
+    return true;
+}
+
+/** 预编译程序文件的标识，按本机字节序读出的值与之不同，说明文件来自字节序不同的平台 */
+#define PROGRAM_FILE_MAGIC      UINT64_C(0x31475250434c4353)
+
+/** 映射预编译程序文件时的附加标志。文件通常都会被完整地读一遍，一次性建立所有页表项比逐页触发缺页异常快得多 */
+#if defined(MAP_POPULATE)
+#define PROGRAM_FILE_MAP_FLAGS  MAP_POPULATE
+#else
+#define PROGRAM_FILE_MAP_FLAGS  0
+#endif
+
+/** 预编译程序文件的格式版本，文件布局、指令编码或者优化规则发生变化时都需要递增 */
+#define PROGRAM_FILE_VERSION    1
+
+/**
+ * 预编译程序文件的文件头。文件中的各个区域都用相对于文件起始处的偏移来定位，不含任何指针，
+ * 因此文件可以被直接mmap到任意地址，并被多个进程共享
+*/
+struct ProgramFileHeader
+{
+    uint64_t magic;
+    uint32_t version;
+    
+    /** 文件头的字节数，用于校验 */
+    uint32_t headerSize;
+    
+    /** 函数表的指纹。CALL指令的操作数是mathFuncList中的索引，函数表一旦变化，旧文件就不能再用 */
+    uint64_t functionTableHash;
+    
+    uint64_t fileSize;
+    
+    /** 程序条目个数以及哈希桶个数，哈希桶个数为2的幂 */
+    uint32_t entryCount;
+    uint32_t bucketCount;
+    
+    /** 所有程序共用的变量个数，以及以','分隔、以'\0'结尾的变量名 */
+    int32_t variableCount;
+    uint32_t variableNamesLength;
+    uint64_t variableNamesOffset;
+    
+    /** 哈希桶数组，每个桶存放条目索引加1，0表示空桶，冲突时线性探测 */
+    uint64_t bucketsOffset;
+    
+    uint64_t entriesOffset;
+    
+    /** 所有程序的常量池与指令序列分别首尾相接地存放 */
+    uint64_t constantsOffset;
+    uint64_t instructionsOffset;
+    
+    /** 各程序经过滤之后的源表达式，各以'\0'结尾 */
+    uint64_t sourcesOffset;
+    uint64_t sourcesSize;
+};
+
+/** 预编译程序文件中的一个程序条目 */
+struct ProgramFileEntry
+{
+    /** 经过滤之后的源表达式的哈希值，参见HashNormalizedExpression */
+    uint64_t sourceHash;
+    
+    /** 源表达式相对于源表达式区域起始处的偏移，以及它的字节数 */
+    uint32_t sourceOffset;
+    uint32_t sourceLength;
+    
+    /** 常量池与指令序列的起始索引 */
+    uint32_t constantIndex;
+    uint32_t instructionIndex;
+    
+    int32_t constantCount;
+    int32_t instructionCount;
+    int32_t maxStackDepth;
+    int32_t temporaryCount;
+};
+
+/** 被映射到内存中的预编译程序文件 */
+struct ArithmeticProgramFile
+{
+    const unsigned char *mapping;
+    size_t mappingSize;
+    
+    const struct ProgramFileHeader *header;
+    const uint32_t *buckets;
+    const struct ProgramFileEntry *entries;
+    const char *sources;
+    
+    /** 指向映射区域的程序视图，与各条目一一对应，它们随文件一起分配 */
+    struct ArithmeticProgram programs[];
+};
+
+/** 计算函数表的指纹 */
+static uint64_t GetMathFunctionTableHash(void)
+{
+    var hash = UINT64_C(14695981039346656037);
+    for(var i = 0; i < MATH_FUNCTION_TABLE_SIZE; i++)
+    {
+        const var name = mathFuncList[i].name;
+        for(size_t j = 0; j < sizeof(mathFuncList[i].name); j++)
+        {
+            hash ^= (uint8_t)name[j];
+            hash *= UINT64_C(1099511628211);
+        }
+    }
+    return hash;
+}
+
+/** 以查表的方式返回单个字符经NormalizeArithmeticExpression过滤之后的结果，非法字符保持不变 */
+static inline char NormalizeArithmeticCharacter(char ch)
+{
+    return (char)(ch + prescanCharacters[(uint8_t)ch].adjustment);
+}
+
+/**
+ * 按过滤之后的字符计算表达式的哈希值，它是文件格式的一部分。
+ * 每次混合8个字节，所以比逐字节的FNV-1a快得多，查找时也不必先将表达式过滤到单独的缓存中
+*/
+static uint64_t HashNormalizedExpression(const char *expr, size_t length)
+{
+    var hash = length * UINT64_C(0x9e3779b97f4a7c15);
+    for(size_t i = 0; i < length; i += 8)
+    {
+        uint64_t word = 0;
+        for(size_t j = 0; j < 8 && i + j < length; j++)
+            word |= (uint64_t)(uint8_t)NormalizeArithmeticCharacter(expr[i + j]) << (j * 8);
+        
+        hash = (hash ^ word) * UINT64_C(0xff51afd7ed558ccd);
+        hash ^= hash >> 29;
+    }
+    return hash ^ (hash >> 32);
+}
+
+/** 将x向上对齐到alignment的整数倍，alignment须为2的幂 */
+static inline uint64_t AlignProgramFileOffset(uint64_t x, uint64_t alignment)
+{
+    return (x + alignment - 1) & ~(alignment - 1);
+}
+
+/**
+ * 将编译后的程序写入预编译程序文件。过滤之后相同的表达式只保留第一个。
+ * 文件先写入一个临时文件，然后再改名为path，所以正在使用旧文件的进程不会读到写了一半的内容
+ * @param path 输出文件的路径
+ * @param sources 各程序的源表达式
+ * @param programs 由CompileArithmeticExpression所生成的程序，它们都须以variableNames编译
+ * @param count 程序个数
+ * @param variableNames 编译时所声明的变量名，若没有变量，可传NULL
+ * @param variableCount 变量个数
+ * @param pEntryCount 若不为NULL，则输出去重之后写入的程序个数
+ * @return 若写入成功，返回true，否则返回false
+*/
+bool WriteArithmeticProgramFile(const char *path, const char *const sources[], const struct ArithmeticProgram *const programs[], size_t count,
+                                const char *const variableNames[], int variableCount, size_t *pEntryCount)
+{
+    if(count >= UINT32_MAX / 4 || variableCount < 0)
+        return false;
+    
+    // 哈希桶的个数至少是条目个数的两倍，以保证线性探测的路径足够短
+    uint32_t bucketCount = 16;
+    while(bucketCount < count * 2)
+        bucketCount *= 2;
+    
+    var buckets = (uint32_t*)calloc(bucketCount, sizeof(uint32_t));
+    var entries = (struct ProgramFileEntry*)calloc(count + 1, sizeof(struct ProgramFileEntry));
+    var selected = (size_t*)malloc(sizeof(size_t) * (count + 1));
+    if(buckets == NULL || entries == NULL || selected == NULL)
+    {
+        free(buckets);
+        free(entries);
+        free(selected);
+        return false;
+    }
+    
+    // 先去重并确定各条目的布局
+    uint32_t entryCount = 0;
+    uint64_t constantTotal = 0, instructionTotal = 0, sourcesSize = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        var length = strlen(sources[i]);
+        var hash = HashNormalizedExpression(sources[i], length);
+        var bucket = (uint32_t)hash & (bucketCount - 1);
+        var isDuplicate = false;
+        for(; buckets[bucket] != 0; bucket = (bucket + 1) & (bucketCount - 1))
+        {
+            const var other = &entries[buckets[bucket] - 1];
+            const var otherSource = sources[selected[buckets[bucket] - 1]];
+            if(other->sourceHash != hash || other->sourceLength != length)
+                continue;
+            
+            size_t j = 0;
+            while(j < length && NormalizeArithmeticCharacter(otherSource[j]) == NormalizeArithmeticCharacter(sources[i][j]))
+                j++;
+            if(j == length)
+            {
+                isDuplicate = true;
+                break;
+            }
+        }
+        if(isDuplicate)
+            continue;
+        
+        const var program = programs[i];
+        entries[entryCount] = (struct ProgramFileEntry){
+            hash, (uint32_t)sourcesSize, (uint32_t)length, (uint32_t)constantTotal, (uint32_t)instructionTotal,
+            program->constantCount, program->instructionCount, program->maxStackDepth, program->temporaryCount
+        };
+        selected[entryCount] = i;
+        buckets[bucket] = ++entryCount;
+        constantTotal += program->constantCount;
+        instructionTotal += program->instructionCount;
+        sourcesSize += length + 1;
+    }
+    
+    var variableNamesLength = 1;
+    for(var i = 0; i < variableCount; i++)
+        variableNamesLength += (int)strlen(variableNames[i]) + (i > 0);
+    
+    struct ProgramFileHeader header = {
+        .magic = PROGRAM_FILE_MAGIC, .version = PROGRAM_FILE_VERSION, .headerSize = sizeof(struct ProgramFileHeader),
+        .functionTableHash = GetMathFunctionTableHash(), .entryCount = entryCount, .bucketCount = bucketCount,
+        .variableCount = variableCount, .variableNamesLength = (uint32_t)variableNamesLength
+    };
+    header.variableNamesOffset = sizeof(header);
+    header.bucketsOffset = AlignProgramFileOffset(header.variableNamesOffset + variableNamesLength, 8);
+    header.entriesOffset = AlignProgramFileOffset(header.bucketsOffset + sizeof(uint32_t) * bucketCount, 8);
+    header.constantsOffset = header.entriesOffset + sizeof(struct ProgramFileEntry) * entryCount;
+    header.instructionsOffset = header.constantsOffset + sizeof(double) * constantTotal;
+    header.sourcesOffset = header.instructionsOffset + sizeof(struct ProgramInstruction) * instructionTotal;
+    header.sourcesSize = sourcesSize;
+    header.fileSize = AlignProgramFileOffset(header.sourcesOffset + sourcesSize, 8);
+    
+    var isSuccessful = false;
+    var image = (unsigned char*)calloc(1, header.fileSize);
+    var temporaryPath = (char*)malloc(strlen(path) + 8);
+    if(image != NULL && temporaryPath != NULL && sourcesSize < UINT32_MAX)
+    {
+        memcpy(image, &header, sizeof(header));
+        
+        var names = (char*)image + header.variableNamesOffset;
+        for(var i = 0; i < variableCount; i++)
+            names += sprintf(names, (i > 0)? ",%s" : "%s", variableNames[i]);
+        
+        memcpy(image + header.bucketsOffset, buckets, sizeof(uint32_t) * bucketCount);
+        memcpy(image + header.entriesOffset, entries, sizeof(struct ProgramFileEntry) * entryCount);
+        for(uint32_t i = 0; i < entryCount; i++)
+        {
+            const var entry = &entries[i];
+            const var program = programs[selected[i]];
+            memcpy(image + header.constantsOffset + sizeof(double) * entry->constantIndex, program->constants, sizeof(double) * entry->constantCount);
+            memcpy(image + header.instructionsOffset + sizeof(struct ProgramInstruction) * entry->instructionIndex, program->instructions, sizeof(struct ProgramInstruction) * entry->instructionCount);
+            
+            var source = (char*)image + header.sourcesOffset + entry->sourceOffset;
+            NormalizeArithmeticExpression(source, sources[selected[i]], entry->sourceLength);
+        }
+        
+        sprintf(temporaryPath, "%s.tmp", path);
+        var output = fopen(temporaryPath, "wb");
+        if(output != NULL)
+        {
+            isSuccessful = fwrite(image, 1, header.fileSize, output) == header.fileSize;
+            isSuccessful = fclose(output) == 0 && isSuccessful;
+            isSuccessful = isSuccessful && rename(temporaryPath, path) == 0;
+            if(!isSuccessful)
+                remove(temporaryPath);
+        }
+    }
+    
+    if(isSuccessful && pEntryCount != NULL)
+        *pEntryCount = entryCount;
+    
+    free(temporaryPath);
+    free(image);
+    free(buckets);
+    free(entries);
+    free(selected);
+    
+    return isSuccessful;
+}
+
+/** 判定文件中的区域[offset, offset + size)是否位于文件之内 */
+static inline bool IsProgramFileRangeValid(const struct ProgramFileHeader *header, uint64_t offset, uint64_t size)
+{
+    return offset <= header->fileSize && size <= header->fileSize - offset;
+}
+
+/**
+ * 校验程序条目的指令序列：操作码与操作数都必须在有效范围内，栈不能下溢，其最大深度须与所记录的相同，
+ * 并且执行完毕之后恰好剩下一个结果。这样，即使文件被损坏或篡改，求值时也不会越界访问
+*/
+static bool ValidateProgramFileEntry(const struct ProgramFileHeader *header, const struct ProgramFileEntry *entry, const struct ProgramInstruction *instructions)
+{
+    // 每个临时单元都至少需要一条STORE_TEMPORARY指令，这也防止了损坏的文件让求值时分配过大的栈
+    if(entry->constantCount < 0 || entry->instructionCount <= 0 || entry->temporaryCount < 0 || entry->temporaryCount > entry->instructionCount)
+        return false;
+    
+    var depth = 0;
+    var peakDepth = 0;
+    for(var i = 0; i < entry->instructionCount; i++)
+    {
+        const var instruction = instructions[i];
+        switch(instruction.opcode)
+        {
+        case PROGRAM_OPCODE_PUSH_CONSTANT:
+            if((int)instruction.operand >= entry->constantCount)
+                return false;
+            break;
+            
+        case PROGRAM_OPCODE_PUSH_VARIABLE:
+            if((int)instruction.operand >= header->variableCount)
+                return false;
+            break;
+            
+        case PROGRAM_OPCODE_ADD ... PROGRAM_OPCODE_RECIPROCAL:
+            break;
+            
+        case PROGRAM_OPCODE_CALL:
+            if(instruction.operand >= MATH_FUNCTION_TABLE_SIZE || mathFuncList[instruction.operand].pFunc == NULL)
+                return false;
+            break;
+            
+        case PROGRAM_OPCODE_LOAD_TEMPORARY:
+        case PROGRAM_OPCODE_STORE_TEMPORARY:
+            if((int)instruction.operand >= entry->temporaryCount)
+                return false;
+            break;
+            
+        default:
+            return false;
+        }
+        
+        // 一元操作与STORE_TEMPORARY需要一个操作数，二元操作需要两个
+        var effect = GetOpcodeStackEffect((enum PROGRAM_OPCODE)instruction.opcode);
+        if(depth < ((effect < 0)? 2 : (effect == 0)? 1 : 0))
+            return false;
+        
+        depth += effect;
+        if(depth > peakDepth)
+            peakDepth = depth;
+    }
+    
+    // 生成程序时所记录的最大栈深度就是按指令逐条模拟所得的最大深度
+    return depth == 1 && peakDepth == entry->maxStackDepth;
+}
+
+/**
+ * 打开预编译程序文件。文件被只读地映射到内存中，打开时只校验文件头与各条目，
+ * 之后的查找与求值都直接读取映射区域，不需要解析，也不会为各个程序分别分配存储空间
+ * @param path 由WriteArithmeticProgramFile所生成的文件
+ * @return 若打开成功，返回文件对象，使用完毕后需用CloseArithmeticProgramFile关闭；
+ * 若文件不存在、已损坏，或者其版本以及函数表与当前程序不一致，返回NULL
+*/
+struct ArithmeticProgramFile* OpenArithmeticProgramFile(const char *path)
+{
+    var fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return NULL;
+    
+    struct stat status;
+    if(fstat(fd, &status) != 0 || status.st_size < (off_t)sizeof(struct ProgramFileHeader))
+    {
+        close(fd);
+        return NULL;
+    }
+    
+    var mappingSize = (size_t)status.st_size;
+    var mapping = mmap(NULL, mappingSize, PROT_READ, MAP_PRIVATE | PROGRAM_FILE_MAP_FLAGS, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED)
+        return NULL;
+    
+    const var header = (const struct ProgramFileHeader*)mapping;
+    var isValid = header->magic == PROGRAM_FILE_MAGIC && header->version == PROGRAM_FILE_VERSION &&
+                  header->headerSize == sizeof(struct ProgramFileHeader) && header->fileSize == mappingSize &&
+                  header->functionTableHash == GetMathFunctionTableHash() && header->variableCount >= 0 &&
+                  header->bucketCount != 0 && (header->bucketCount & (header->bucketCount - 1)) == 0 && header->entryCount < header->bucketCount &&
+                  header->bucketsOffset % alignof(uint32_t) == 0 && header->entriesOffset % alignof(struct ProgramFileEntry) == 0 &&
+                  header->constantsOffset % alignof(double) == 0 && header->instructionsOffset % alignof(struct ProgramInstruction) == 0 &&
+                  IsProgramFileRangeValid(header, header->variableNamesOffset, header->variableNamesLength) && header->variableNamesLength > 0 &&
+                  IsProgramFileRangeValid(header, header->bucketsOffset, sizeof(uint32_t) * (uint64_t)header->bucketCount) &&
+                  IsProgramFileRangeValid(header, header->entriesOffset, sizeof(struct ProgramFileEntry) * (uint64_t)header->entryCount) &&
+                  IsProgramFileRangeValid(header, header->constantsOffset, 0) && IsProgramFileRangeValid(header, header->instructionsOffset, 0) &&
+                  IsProgramFileRangeValid(header, header->sourcesOffset, header->sourcesSize) &&
+                  ((const char*)mapping)[header->variableNamesOffset + header->variableNamesLength - 1] == '\0';
+    
+    struct ArithmeticProgramFile *file = NULL;
+    if(isValid)
+        file = (struct ArithmeticProgramFile*)malloc(sizeof(*file) + sizeof(struct ArithmeticProgram) * header->entryCount);
+    if(file == NULL)
+    {
+        munmap(mapping, mappingSize);
+        return NULL;
+    }
+    
+    const var base = (const unsigned char*)mapping;
+    file->mapping = base;
+    file->mappingSize = mappingSize;
+    file->header = header;
+    file->buckets = (const uint32_t*)(base + header->bucketsOffset);
+    file->entries = (const struct ProgramFileEntry*)(base + header->entriesOffset);
+    file->sources = (const char*)(base + header->sourcesOffset);
+    
+    // 变量个数必须与变量名列表一致，调用者按变量名列表所准备的绑定值数组才足够长
+    const var variableNames = GetArithmeticProgramFileVariables(file);
+    var variableCount = (variableNames[0] != '\0')? 1 : 0;
+    for(var name = variableNames; *name != '\0'; name++)
+        variableCount += *name == ',';
+    
+    var constantLimit = (header->instructionsOffset - header->constantsOffset) / sizeof(double);
+    var instructionLimit = (header->sourcesOffset - header->instructionsOffset) / sizeof(struct ProgramInstruction);
+    isValid = variableCount == header->variableCount && header->constantsOffset <= header->instructionsOffset && header->instructionsOffset <= header->sourcesOffset;
+    
+    // 非空桶不能多于条目个数，这样查找时的线性探测总会碰到空桶而结束
+    uint32_t usedBucketCount = 0;
+    for(uint32_t i = 0; isValid && i < header->bucketCount; i++)
+    {
+        isValid = file->buckets[i] <= header->entryCount;
+        usedBucketCount += file->buckets[i] != 0;
+    }
+    isValid = isValid && usedBucketCount <= header->entryCount;
+    
+    for(uint32_t i = 0; isValid && i < header->entryCount; i++)
+    {
+        const var entry = &file->entries[i];
+        const var constants = (const double*)(base + header->constantsOffset) + entry->constantIndex;
+        const var instructions = (const struct ProgramInstruction*)(base + header->instructionsOffset) + entry->instructionIndex;
+        
+        isValid = (uint64_t)entry->constantIndex + (uint32_t)entry->constantCount <= constantLimit &&
+                  (uint64_t)entry->instructionIndex + (uint32_t)entry->instructionCount <= instructionLimit &&
+                  (uint64_t)entry->sourceOffset + entry->sourceLength < header->sourcesSize &&
+                  file->sources[entry->sourceOffset + entry->sourceLength] == '\0' &&
+                  ValidateProgramFileEntry(header, entry, instructions);
+        
+        file->programs[i] = (struct ArithmeticProgram){
+            header->variableCount, entry->constantCount, entry->instructionCount, entry->maxStackDepth, entry->temporaryCount,
+            constants, instructions
+        };
+    }
+    
+    if(!isValid)
+    {
+        CloseArithmeticProgramFile(file);
+        return NULL;
+    }
+    
+    return file;
+}
+
+/** 关闭预编译程序文件，由它所查找到的程序随之失效 */
+void CloseArithmeticProgramFile(struct ArithmeticProgramFile *file)
+{
+    if(file == NULL)
+        return;
+    
+    munmap((void*)file->mapping, file->mappingSize);
+    free(file);
+}
+
+/**
+ * 获取预编译时所声明的变量名，求值时的绑定值数组须按这一顺序存放
+ * @return 以','分隔的变量名，没有变量时为空字符串
+*/
+const char* GetArithmeticProgramFileVariables(const struct ArithmeticProgramFile *file)
+{
+    return (const char*)file->mapping + file->header->variableNamesOffset;
+}
+
+/**
+ * 在预编译程序文件中查找表达式所对应的程序。表达式按过滤之后的形式比较，所以"PI*[2]"与"pi*(2)"对应于同一个程序
+ * @param file 预编译程序文件
+ * @param expr 需要查找的算术表达式，该函数不会修改它
+ * @return 若找到，返回对应的程序，它可以传给EvaluateArithmeticProgram等各个求值函数以及CreateArithmeticJitProgram，
+ * 但不能用DestroyArithmeticProgram释放，它在文件关闭之前一直有效；若没有找到，返回NULL
+*/
+const struct ArithmeticProgram* FindArithmeticProgram(const struct ArithmeticProgramFile *file, const char *expr)
+{
+    var length = strlen(expr);
+    var hash = HashNormalizedExpression(expr, length);
+    var mask = file->header->bucketCount - 1;
+    
+    for(var bucket = (uint32_t)hash & mask; file->buckets[bucket] != 0; bucket = (bucket + 1) & mask)
+    {
+        var index = file->buckets[bucket] - 1;
+        const var entry = &file->entries[index];
+        if(entry->sourceHash != hash || entry->sourceLength != length)
+            continue;
+        
+        const var source = &file->sources[entry->sourceOffset];
+        size_t i = 0;
+        while(i < length && source[i] == NormalizeArithmeticCharacter(expr[i]))
+            i++;
+        if(i == length)
+            return &file->programs[index];
+    }
+    
+    return NULL;
+}
+
+/** JIT生成本机代码时可用于存放求值栈元素的XMM寄存器个数，xmm14与xmm15留作临时寄存器 */
+#define JIT_MAX_STACK_DEPTH     14
+
+/** JIT生成本机代码时栈帧中最多能存放的临时单元个数 */
+#define JIT_MAX_TEMPORARY_COUNT 4096
+
+/** 由JIT生成的本机代码函数，其参数为各个变量的绑定值数组 */
+typedef double (*ArithmeticJitFunction)(const double bindings[]);
+
+/**
+ * 经过JIT编译的程序。
+ * 若当前平台不支持JIT，或者程序超出了JIT的处理能力，则function为NULL，
+ * 此时EvaluateArithmeticJitProgram会自动回退到解释执行
+*/
+struct ArithmeticJitProgram
+{
+    /** 原先的程序，JIT程序并不拥有它，它必须在JIT程序销毁之前保持有效 */
+    const struct ArithmeticProgram *program;
+    
+    /** 本机代码的入口，为NULL表示使用解释执行 */
+    ArithmeticJitFunction function;
+    
+    /** 存放本机代码与数据的可执行存储页 */
+    void *code;
+    size_t codeSize;
+};
+
+#if defined(__x86_64__) && !defined(_WIN32)
+
+/** 生成本机代码时所使用的上下文 */
+struct JitAssembler
+{
+    uint8_t *code;
+    size_t length;
+    size_t capacity;
+    
+    /** 需要在代码生成结束后回填的RIP相对寻址偏移 */
+    struct
+    {
+        /** 32位偏移量在代码中的位置 */
+        size_t offset;
+        
+        /** 所引用的数据在数据区中的索引，每个数据占8字节 */
+        int dataIndex;
+    } *fixups;
+    int fixupCount;
+    int fixupCapacity;
+    
+    bool isOutOfMemory;
+};
+
+/**
+ * 数据区中的固定数据，紧随其后的是程序的常量池。
+ * 数据区的起始地址按16字节对齐，以满足xorpd对内存操作数的对齐要求
+*/
+enum JIT_DATA_INDEX
+{
+    /** 符号位掩码，占用16字节 */
+    JIT_DATA_INDEX_SIGN_MASK = 0,
+    JIT_DATA_INDEX_ONE = 2,
+    JIT_DATA_INDEX_PI,
+    JIT_DATA_INDEX_180,
+    JIT_DATA_INDEX_CONSTANTS
+};
+
+/** SSE2标量双精度指令的操作码，均位于0F转义码之后 */
+enum JIT_SSE_OPCODE
+{
+    JIT_SSE_OPCODE_MOVSD_LOAD = 0x10,
+    JIT_SSE_OPCODE_MOVSD_STORE = 0x11,
+    JIT_SSE_OPCODE_MOVAPD = 0x28,
+    JIT_SSE_OPCODE_SQRTSD = 0x51,
+    JIT_SSE_OPCODE_XORPD = 0x57,
+    JIT_SSE_OPCODE_ADDSD = 0x58,
+    JIT_SSE_OPCODE_MULSD = 0x59,
+    JIT_SSE_OPCODE_SUBSD = 0x5C,
+    JIT_SSE_OPCODE_DIVSD = 0x5E
+};
+
+/** x86-64的基址寄存器编号 */
+enum JIT_BASE_REGISTER
+{
+    JIT_BASE_REGISTER_RSP = 4,
+    JIT_BASE_REGISTER_RBX = 3,
+    
+    /** 用于表示RIP相对寻址 */
+    JIT_BASE_REGISTER_RIP = -1
+};
+
+static void JitEmitBytes(struct JitAssembler *assembler, const void *bytes, size_t count)
+{
+    if(assembler->isOutOfMemory)
+        return;
+    
+    if(assembler->length + count > assembler->capacity)
+    {
+        var capacity = assembler->capacity == 0? 256 : assembler->capacity * 2;
+        while(capacity < assembler->length + count)
+            capacity *= 2;
+        
+        var code = (uint8_t*)realloc(assembler->code, capacity);
+        if(code == NULL)
+        {
+            assembler->isOutOfMemory = true;
+            return;
+        }
+        assembler->code = code;
+        assembler->capacity = capacity;
+    }
+    
+    memcpy(&assembler->code[assembler->length], bytes, count);
+    assembler->length += count;
+}
+
+static inline void JitEmitByte(struct JitAssembler *assembler, uint8_t byte)
+{
+    JitEmitBytes(assembler, &byte, 1);
+}
+
+static inline void JitEmitInt32(struct JitAssembler *assembler, int32_t value)
+{
+    JitEmitBytes(assembler, &value, sizeof(value));
+}
+
+/** SSE指令的前缀：标量双精度指令为F2，紧缩双精度指令为66 */
+static inline uint8_t JitGetSsePrefix(enum JIT_SSE_OPCODE opcode)
+{
+    return (opcode == JIT_SSE_OPCODE_MOVAPD || opcode == JIT_SSE_OPCODE_XORPD)? 0x66 : 0xF2;
+}
+
+/** 生成寄存器到寄存器的SSE指令，dst为ModRM.reg字段，src为ModRM.rm字段 */
+static void JitEmitSseRegister(struct JitAssembler *assembler, enum JIT_SSE_OPCODE opcode, int dst, int src)
+{
+    JitEmitByte(assembler, JitGetSsePrefix(opcode));
+    if(dst >= 8 || src >= 8)
+        JitEmitByte(assembler, 0x40 | ((dst >> 3) << 2) | (src >> 3));
+    JitEmitByte(assembler, 0x0F);
+    JitEmitByte(assembler, opcode);
+    JitEmitByte(assembler, 0xC0 | ((dst & 7) << 3) | (src & 7));
+}
+
+/**
+ * 生成带有内存操作数的SSE指令
+ * @param reg XMM寄存器编号
+ * @param base 基址寄存器，若为JIT_BASE_REGISTER_RIP，则displacement为数据区中的数据索引
+ * @param displacement 相对于基址寄存器的偏移
+*/
+static void JitEmitSseMemory(struct JitAssembler *assembler, enum JIT_SSE_OPCODE opcode, int reg, enum JIT_BASE_REGISTER base, int32_t displacement)
+{
+    JitEmitByte(assembler, JitGetSsePrefix(opcode));
+    if(reg >= 8)
+        JitEmitByte(assembler, 0x44);
+    JitEmitByte(assembler, 0x0F);
+    JitEmitByte(assembler, opcode);
+    
+    if(base == JIT_BASE_REGISTER_RIP)
+    {
+        JitEmitByte(assembler, 0x05 | ((reg & 7) << 3));
+        
+        if(assembler->fixupCount == assembler->fixupCapacity)
+        {
+            var capacity = assembler->fixupCapacity == 0? 32 : assembler->fixupCapacity * 2;
+            var fixups = realloc(assembler->fixups, sizeof(assembler->fixups[0]) * capacity);
+            if(fixups == NULL)
+            {
+                assembler->isOutOfMemory = true;
+                return;
+            }
+            assembler->fixups = fixups;
+            assembler->fixupCapacity = capacity;
+        }
+        assembler->fixups[assembler->fixupCount].offset = assembler->length;
+        assembler->fixups[assembler->fixupCount].dataIndex = displacement;
+        assembler->fixupCount++;
+        
+        JitEmitInt32(assembler, 0);
+    }
+    else
+    {
+        JitEmitByte(assembler, 0x80 | ((reg & 7) << 3) | base);
+        if(base == JIT_BASE_REGISTER_RSP)
+            JitEmitByte(assembler, 0x24);
+        JitEmitInt32(assembler, displacement);
+    }
+}
+
+/** 将XMM寄存器之间的数据传送，源与目的相同时不生成任何指令 */
+static inline void JitEmitMove(struct JitAssembler *assembler, int dst, int src)
+{
+    if(dst != src)
+        JitEmitSseRegister(assembler, JIT_SSE_OPCODE_MOVAPD, dst, src);
+}
+
+/**
+ * 将xmm0至xmm(liveCount - 1)保存到栈帧中，或者从栈帧中恢复。
+ * 在System V ABI中所有XMM寄存器都由调用者保存，所以调用外部函数前后需要保存与恢复栈中位于参数之下的元素
+*/
+static void JitEmitSpill(struct JitAssembler *assembler, int liveCount, bool isRestore)
+{
+    for(var i = 0; i < liveCount; i++)
+        JitEmitSseMemory(assembler, isRestore? JIT_SSE_OPCODE_MOVSD_LOAD : JIT_SSE_OPCODE_MOVSD_STORE, i, JIT_BASE_REGISTER_RSP, i * 8);
+}
+
+/** 生成对外部函数的直接调用，参数与返回值都使用XMM寄存器传递 */
+static void JitEmitCall(struct JitAssembler *assembler, const void *function)
+{
+    // mov rax, imm64
+    var address = (uint64_t)(uintptr_t)function;
+    JitEmitBytes(assembler, (const uint8_t[]){ 0x48, 0xB8 }, 2);
+    JitEmitBytes(assembler, &address, sizeof(address));
+    
+    // call rax
+    JitEmitBytes(assembler, (const uint8_t[]){ 0xFF, 0xD0 }, 2);
+}
+
+/**
+ * 将程序翻译为x86-64本机代码。
+ * 求值栈中第k个元素固定存放在xmmk中，最终结果位于xmm0，恰好是System V ABI的返回值寄存器。
+ * 二元算术操作直接生成相应的SSE2指令，sqrt、recp、rad与deg也以内联指令实现，
+ * 它们的运算顺序与对应的C函数完全相同；其余数学函数则直接调用其函数地址
+ * @return 若生成成功，返回true
+*/
+static bool JitAssembleProgram(struct JitAssembler *assembler, const struct ArithmeticProgram *program)
+{
+    // 栈帧：保存rbx，再为求值栈的溢出保存以及临时单元分配空间，使得调用外部函数时rsp保持16字节对齐
+    const int32_t FRAME_SIZE = (JIT_MAX_STACK_DEPTH + program->temporaryCount + 1) / 2 * 16;
+    const int32_t TEMPORARY_OFFSET = JIT_MAX_STACK_DEPTH * 8;
+    
+    // push rbx; sub rsp, FRAME_SIZE; mov rbx, rdi
+    JitEmitByte(assembler, 0x53);
+    JitEmitBytes(assembler, (const uint8_t[]){ 0x48, 0x81, 0xEC }, 3);
+    JitEmitInt32(assembler, FRAME_SIZE);
+    JitEmitBytes(assembler, (const uint8_t[]){ 0x48, 0x89, 0xFB }, 3);
+    
+    // top为当前栈顶元素所在的XMM寄存器编号
+    var top = -1;
+    
+    for(var i = 0; i < program->instructionCount; i++)
+    {
+        var instruction = program->instructions[i];
+        
+        switch(instruction.opcode)
+        {
+        case PROGRAM_OPCODE_PUSH_CONSTANT:
+            top++;
+            JitEmitSseMemory(assembler, JIT_SSE_OPCODE_MOVSD_LOAD, top, JIT_BASE_REGISTER_RIP, JIT_DATA_INDEX_CONSTANTS + instruction.operand);
+            break;
+            
+        case PROGRAM_OPCODE_PUSH_VARIABLE:
+            top++;
+            JitEmitSseMemory(assembler, JIT_SSE_OPCODE_MOVSD_LOAD, top, JIT_BASE_REGISTER_RBX, instruction.operand * 8);
+            break;
+            
+        case PROGRAM_OPCODE_ADD:
+        case PROGRAM_OPCODE_MINUS:
+        case PROGRAM_OPCODE_MUL:
+        case PROGRAM_OPCODE_DIV:
+        {
+            static const uint8_t sseOpcodes[] = {
+                [PROGRAM_OPCODE_ADD] = JIT_SSE_OPCODE_ADDSD,
+                [PROGRAM_OPCODE_MINUS] = JIT_SSE_OPCODE_SUBSD,
+                [PROGRAM_OPCODE_MUL] = JIT_SSE_OPCODE_MULSD,
+                [PROGRAM_OPCODE_DIV] = JIT_SSE_OPCODE_DIVSD
+            };
+            JitEmitSseRegister(assembler, sseOpcodes[instruction.opcode], top - 1, top);
+            top--;
+            break;
+        }
+            
+        case PROGRAM_OPCODE_MOD:
+        case PROGRAM_OPCODE_POW:
+        {
+            // 左操作数放入xmm0，右操作数放入xmm1。由于top - 1 >= 0，先传送xmm0不会覆盖右操作数
+            JitEmitSpill(assembler, top - 1, false);
+            JitEmitMove(assembler, 0, top - 1);
+            JitEmitMove(assembler, 1, top);
+            JitEmitCall(assembler, instruction.opcode == PROGRAM_OPCODE_MOD? (const void*)&ModOp : (const void*)&pow);
+            JitEmitMove(assembler, top - 1, 0);
+            JitEmitSpill(assembler, top - 1, true);
+            top--;
+            break;
+        }
+            
+        case PROGRAM_OPCODE_NEG:
+            JitEmitSseMemory(assembler, JIT_SSE_OPCODE_XORPD, top, JIT_BASE_REGISTER_RIP, JIT_DATA_INDEX_SIGN_MASK);
+            break;
+            
+        case PROGRAM_OPCODE_RECIPROCAL:
+            JitEmitSseMemory(assembler, JIT_SSE_OPCODE_MOVSD_LOAD, 15, JIT_BASE_REGISTER_RIP, JIT_DATA_INDEX_ONE);
+            JitEmitSseRegister(assembler, JIT_SSE_OPCODE_DIVSD, 15, top);
+            JitEmitMove(assembler, top, 15);
+            break;
+            
+        case PROGRAM_OPCODE_CALL:
+        {
+            var pFunc = mathFuncList[instruction.operand].pFunc;
+            
+            if(pFunc == &sqrt)
+                JitEmitSseRegister(assembler, JIT_SSE_OPCODE_SQRTSD, top, top);
+            else if(pFunc == &recp)
+            {
+                JitEmitSseMemory(assembler, JIT_SSE_OPCODE_MOVSD_LOAD, 15, JIT_BASE_REGISTER_RIP, JIT_DATA_INDEX_ONE);
+                JitEmitSseRegister(assembler, JIT_SSE_OPCODE_DIVSD, 15, top);
+                JitEmitMove(assembler, top, 15);
+            }
+            else if(pFunc == &radian)
+            {
+                JitEmitSseMemory(assembler, JIT_SSE_OPCODE_MULSD, top, JIT_BASE_REGISTER_RIP, JIT_DATA_INDEX_PI);
+                JitEmitSseMemory(assembler, JIT_SSE_OPCODE_DIVSD, top, JIT_BASE_REGISTER_RIP, JIT_DATA_INDEX_180);
+            }
+            else if(pFunc == &degree)
+            {
+                JitEmitSseMemory(assembler, JIT_SSE_OPCODE_MULSD, top, JIT_BASE_REGISTER_RIP, JIT_DATA_INDEX_180);
+                JitEmitSseMemory(assembler, JIT_SSE_OPCODE_DIVSD, top, JIT_BASE_REGISTER_RIP, JIT_DATA_INDEX_PI);
+            }
+            else
+            {
+                JitEmitSpill(assembler, top, false);
+                JitEmitMove(assembler, 0, top);
+                JitEmitCall(assembler, (const void*)pFunc);
+                JitEmitMove(assembler, top, 0);
+                JitEmitSpill(assembler, top, true);
+            }
+            break;
+        }
+            
+        case PROGRAM_OPCODE_LOAD_TEMPORARY:
+            top++;
+            JitEmitSseMemory(assembler, JIT_SSE_OPCODE_MOVSD_LOAD, top, JIT_BASE_REGISTER_RSP, TEMPORARY_OFFSET + instruction.operand * 8);
+            break;
+            
+        case PROGRAM_OPCODE_STORE_TEMPORARY:
+            JitEmitSseMemory(assembler, JIT_SSE_OPCODE_MOVSD_STORE, top, JIT_BASE_REGISTER_RSP, TEMPORARY_OFFSET + instruction.operand * 8);
+            break;
+            
+        default:
+            return false;
+        }
+    }
+    
+    // add rsp, FRAME_SIZE; pop rbx; ret
+    JitEmitBytes(assembler, (const uint8_t[]){ 0x48, 0x81, 0xC4 }, 3);
+    JitEmitInt32(assembler, FRAME_SIZE);
+    JitEmitBytes(assembler, (const uint8_t[]){ 0x5B, 0xC3 }, 2);
+    
+    return !assembler->isOutOfMemory && top == 0;
+}
+
+/**
+ * 为程序生成本机代码，并将其放入一块可执行的存储页中。
+ * 存储页在写入代码时只可读写，写入完成之后再改为只可读与执行
+ * @return 若生成成功，返回true，否则jit中的本机代码入口保持为NULL
+*/
+static bool JitCompileProgram(struct ArithmeticJitProgram *jit)
+{
+    var program = jit->program;
+    if(program->maxStackDepth > JIT_MAX_STACK_DEPTH || program->temporaryCount > JIT_MAX_TEMPORARY_COUNT)
+        return false;
+    
+    struct JitAssembler assembler = { 0 };
+    var isSuccessful = JitAssembleProgram(&assembler, program);
+    
+    void *code = MAP_FAILED;
+    size_t codeSize = 0;
+    
+    if(isSuccessful)
+    {
+        // 数据区紧跟在代码之后，并按16字节对齐
+        var dataOffset = (assembler.length + 15) & ~(size_t)15;
+        var dataCount = JIT_DATA_INDEX_CONSTANTS + program->constantCount;
+        var pageSize = (size_t)sysconf(_SC_PAGESIZE);
+        codeSize = (dataOffset + dataCount * sizeof(double) + pageSize - 1) / pageSize * pageSize;
+        
+        code = mmap(NULL, codeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        isSuccessful = code != MAP_FAILED;
+        
+        if(isSuccessful)
+        {
+            var bytes = (uint8_t*)code;
+            memcpy(bytes, assembler.code, assembler.length);
+            
+            var data = (uint64_t*)(bytes + dataOffset);
+            data[JIT_DATA_INDEX_SIGN_MASK] = UINT64_C(0x8000000000000000);
+            data[JIT_DATA_INDEX_SIGN_MASK + 1] = 0;
+            memcpy(&data[JIT_DATA_INDEX_ONE], &(double){ 1.0 }, sizeof(double));
+            memcpy(&data[JIT_DATA_INDEX_PI], &(double){ M_PI }, sizeof(double));
+            memcpy(&data[JIT_DATA_INDEX_180], &(double){ 180.0 }, sizeof(double));
+            memcpy(&data[JIT_DATA_INDEX_CONSTANTS], program->constants, sizeof(double) * program->constantCount);
+            
+            // 回填RIP相对寻址的偏移量，RIP为该偏移量之后下一条指令的地址
+            for(var i = 0; i < assembler.fixupCount; i++)
+            {
+                var offset = assembler.fixups[i].offset;
+                var displacement = (int32_t)(dataOffset + assembler.fixups[i].dataIndex * sizeof(double) - (offset + 4));
+                memcpy(&bytes[offset], &displacement, sizeof(displacement));
+            }
+            
+            isSuccessful = mprotect(code, codeSize, PROT_READ | PROT_EXEC) == 0;
+            if(!isSuccessful)
+                munmap(code, codeSize);
+        }
+    }
+    
+    free(assembler.code);
+    free(assembler.fixups);
+    
+    if(!isSuccessful)
+        return false;
+    
+    jit->code = code;
+    jit->codeSize = codeSize;
+    jit->function = (ArithmeticJitFunction)code;
+    return true;
+}
+
+#else
+
+static bool JitCompileProgram(struct ArithmeticJitProgram *jit)
+{
+    (void)jit;
+    return false;
+}
+
+#endif
+
+/**
+ * 对编译后的程序做JIT编译
+ * @param program 由CompileArithmeticExpression所生成的程序，它必须在JIT程序销毁之前保持有效
+ * @return JIT程序，使用完毕后需用DestroyArithmeticJitProgram释放；若存储空间不足，返回NULL。
+ * 若当前平台不支持JIT，仍然返回有效的JIT程序，只不过其求值会回退到解释执行
+*/
+struct ArithmeticJitProgram* CreateArithmeticJitProgram(const struct ArithmeticProgram *program)
+{
+    var jit = (struct ArithmeticJitProgram*)calloc(1, sizeof(struct ArithmeticJitProgram));
+    if(jit == NULL)
+        return NULL;
+    
+    jit->program = program;
+    JitCompileProgram(jit);
+    
+    return jit;
+}
+
+/** 释放JIT程序，但不会释放其所对应的原先程序 */
+void DestroyArithmeticJitProgram(struct ArithmeticJitProgram *jit)
+{
+    if(jit == NULL)
+        return;
+    
+#if defined(__x86_64__) && !defined(_WIN32)
+    if(jit->code != NULL)
+        munmap(jit->code, jit->codeSize);
+#endif
+    
+    free(jit);
+}
+
+/** 判定JIT程序是否确实生成了本机代码 */
+static inline bool IsArithmeticJitProgramNative(const struct ArithmeticJitProgram *jit)
+{
+    return jit->function != NULL;
+}
+
+/**
+ * 对JIT程序进行求值
+ * @param bindings 各个变量的值，含义与EvaluateArithmeticProgram相同
+ * @return 计算结果，与EvaluateArithmeticProgram的结果逐位相同
+*/
+double EvaluateArithmeticJitProgram(const struct ArithmeticJitProgram *jit, const double bindings[])
+{
+    if(jit->function != NULL)
+        return jit->function(bindings);
+    
+    return EvaluateArithmeticProgram(jit->program, bindings);
+}
+
+// 以下为命令行程序所使用的性能测试、校验、批处理以及main函数。
+// 构建库libsimplecalc时会定义SIMPLE_CALCULATOR_LIBRARY，从而只保留上面的计算接口
+#ifndef SIMPLE_CALCULATOR_LIBRARY
+
+/** 获取当前单调时钟的时间，以秒为单位 */
+static double GetCurrentTimeInSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/** 以可读的形式逐条输出程序中的指令 */
+static void PrintProgramInstructions(const struct ArithmeticProgram *program, const char *const variableNames[])
+{
+    static const char *const opcodeNames[] = {
+        [PROGRAM_OPCODE_ADD] = "add", [PROGRAM_OPCODE_MINUS] = "sub", [PROGRAM_OPCODE_MUL] = "mul",
+        [PROGRAM_OPCODE_DIV] = "div", [PROGRAM_OPCODE_MOD] = "mod", [PROGRAM_OPCODE_POW] = "pow",
+        [PROGRAM_OPCODE_NEG] = "neg", [PROGRAM_OPCODE_RECIPROCAL] = "recp"
+    };
+    
+    for(var i = 0; i < program->instructionCount; i++)
+    {
+        const var instruction = program->instructions[i];
+        printf("  %4d  ", i);
+        
+        switch(instruction.opcode)
+        {
+        case PROGRAM_OPCODE_PUSH_CONSTANT:
+            printf("push  %.17g\n", program->constants[instruction.operand]);
+            break;
+            
+        case PROGRAM_OPCODE_PUSH_VARIABLE:
+            printf("push  %s\n", variableNames[instruction.operand]);
+            break;
+            
+        case PROGRAM_OPCODE_CALL:
+            printf("call  %s\n", mathFuncList[instruction.operand].name);
+            break;
+            
+        case PROGRAM_OPCODE_LOAD_TEMPORARY:
+            printf("load  t%d\n", (int)instruction.operand);
+            break;
+            
+        case PROGRAM_OPCODE_STORE_TEMPORARY:
+            printf("store t%d\n", (int)instruction.operand);
+            break;
+            
+        default:
+            puts(opcodeNames[instruction.opcode]);
+            break;
+        }
+    }
+}
+
+/**
+ * 输出表达式在优化前后的中间表示，包括表达式节点个数以及指令序列
+ * @param expr 算术表达式
+ * @param variableNames 表达式中可以使用的变量名
+ * @param variableCount 变量个数
+ * @return 若表达式合法，返回0，否则返回1
+*/
+static int DumpIntermediateRepresentation(const char *expr, const char *const variableNames[], int variableCount)
+{
+    int nodeCounts[2];
+    var original = CompileArithmeticProgram(expr, variableNames, variableCount, false, NULL);
+    var optimized = CompileArithmeticProgram(expr, variableNames, variableCount, true, nodeCounts);
+    
+    if(original == NULL || optimized == NULL)
+    {
+        DestroyArithmeticProgram(original);
+        DestroyArithmeticProgram(optimized);
+        puts("Invalid expression!");
+        return 1;
+    }
+    
+    const struct ArithmeticProgram *programs[] = { original, optimized };
+    const char *const titles[] = { "Before", "After" };
+    
+    for(var i = 0; i < 2; i++)
+    {
+        printf("%s optimization: %d nodes, %d instructions, %d constants, %d temporaries, max stack depth %d\n", titles[i],
+               nodeCounts[i], programs[i]->instructionCount, programs[i]->constantCount, programs[i]->temporaryCount, programs[i]->maxStackDepth);
+        PrintProgramInstructions(programs[i], variableNames);
+    }
+    
+    DestroyArithmeticProgram(original);
+    DestroyArithmeticProgram(optimized);
+    
+    return 0;
+}
+
+/**
+ * 比较每次都重新解析表达式与先编译再反复求值这两种方式的性能
+ * @param expr 用于测试的算术表达式
+ * @param iterations 求值次数
+ * @return 若表达式合法，返回0，否则返回1
+*/
+static int BenchmarkCompiledEvaluation(const char *expr, long iterations)
+{
+    var length = (int)strlen(expr);
+    var buffer = (char*)malloc(length + 1);
+    if(buffer == NULL)
+        return 1;
+    
+    memcpy(buffer, expr, length + 1);
+    NormalizeArithmeticExpression(buffer, buffer, length);
+    
+    var beginTime = GetCurrentTimeInSeconds();
+    var program = CompileArithmeticExpression(expr, NULL, 0);
+    var compileTime = GetCurrentTimeInSeconds() - beginTime;
+    
+    if(program == NULL)
+    {
+        free(buffer);
+        puts("Invalid expression!");
+        return 1;
+    }
+    
+    // 用volatile变量累加计算结果，防止编译器将整个循环优化掉
+    volatile double sink = 0.0;
+    bool state = false;
+    
+    beginTime = GetCurrentTimeInSeconds();
+    for(long i = 0; i < iterations; i++)
+    {
+        const char *cursor = buffer;
+        sink += ParseArithmeticExpression(&cursor, 0.0, PARSE_PHASE_STATUS_LEFT_OPERAND, OPERATOR_PRIORITY_ADD, &state, NULL);
+    }
+    var parseTime = GetCurrentTimeInSeconds() - beginTime;
+    
+    beginTime = GetCurrentTimeInSeconds();
+    for(long i = 0; i < iterations; i++)
+        sink += EvaluateArithmeticProgram(program, NULL);
+    var evaluateTime = GetCurrentTimeInSeconds() - beginTime;
+    
+    const char *cursor = buffer;
+    var parsedValue = ParseArithmeticExpression(&cursor, 0.0, PARSE_PHASE_STATUS_LEFT_OPERAND, OPERATOR_PRIORITY_ADD, &state, NULL);
+    var evaluatedValue = EvaluateArithmeticProgram(program, NULL);
+    
+    printf("Expression: %s\n", buffer);
+    printf("Program: %d instructions, %d constants, max stack depth %d\n", program->instructionCount, program->constantCount, program->maxStackDepth);
+    printf("Compile once: %.3f us\n", compileTime * 1e6);
+    printf("Re-parse:     %.2f ns/eval\n", parseTime * 1e9 / iterations);
+    printf("Compiled:     %.2f ns/eval\n", evaluateTime * 1e9 / iterations);
+    printf("Speedup:      %.2fx\n", parseTime / evaluateTime);
+    printf("Results identical: %s\n", memcmp(&parsedValue, &evaluatedValue, sizeof(double)) == 0? "yes" : "no");
+    
+    DestroyArithmeticProgram(program);
+    free(buffer);
+    
+    return 0;
+}
+
+/**
+ * 比较逐行标量求值与按列求值的性能。
+ * 表达式中可以使用变量x与y，x的取值均匀分布在[0.5, 1.5)，y的取值均匀分布在[1, 3)
+ * @param expr 用于测试的算术表达式
+ * @param count 每列的行数
+ * @return 若测试成功完成，返回0，否则返回1
+*/
+static int BenchmarkColumnEvaluation(const char *expr, long count)
+{
+    static const char *const variableNames[] = { "x", "y" };
+    
+    var program = CompileArithmeticExpression(expr, variableNames, 2);
+    if(program == NULL)
+    {
+        puts("Invalid expression!");
+        return 1;
+    }
+    
+    var x = (double*)malloc(sizeof(double) * count);
+    var y = (double*)malloc(sizeof(double) * count);
+    var scalarOutput = (double*)malloc(sizeof(double) * count);
+    var columnOutput = (double*)malloc(sizeof(double) * count);
+    if(x == NULL || y == NULL || scalarOutput == NULL || columnOutput == NULL)
+    {
+        free(x);
+        free(y);
+        free(scalarOutput);
+        free(columnOutput);
+        DestroyArithmeticProgram(program);
+        return 1;
+    }
+    
+    for(long i = 0; i < count; i++)
+    {
+        x[i] = 0.5 + (double)i / count;
+        y[i] = 1.0 + (double)((i * 7919) % count) * 2.0 / count;
+    }
+    const double *const columns[] = { x, y };
+    
+    var beginTime = GetCurrentTimeInSeconds();
+    for(long i = 0; i < count; i++)
+    {
+        double bindings[] = { x[i], y[i] };
+        scalarOutput[i] = EvaluateArithmeticProgram(program, bindings);
+    }
+    var scalarTime = GetCurrentTimeInSeconds() - beginTime;
+    
+    printf("Expression: %s\n", expr);
+    printf("Rows: %ld\n", count);
+    printf("Scalar:         %.2f ns/row\n", scalarTime * 1e9 / count);
+    
+    static const struct
+    {
+        const char *name;
+        enum COLUMN_INSTRUCTION_SET instructionSet;
+    } instructionSets[] = {
+        { "Columns (base)", COLUMN_INSTRUCTION_SET_GENERIC },
+        { "Columns (AVX2)", COLUMN_INSTRUCTION_SET_AVX2 }
+    };
+    
+    for(var i = 0; i < (int)(sizeof(instructionSets) / sizeof(instructionSets[0])); i++)
+    {
+        if(instructionSets[i].instructionSet == COLUMN_INSTRUCTION_SET_AVX2 && GetColumnInstructionSet() != COLUMN_INSTRUCTION_SET_AVX2)
+        {
+            printf("%s: not supported by this processor\n", instructionSets[i].name);
+            continue;
+        }
+        
+        beginTime = GetCurrentTimeInSeconds();
+        EvaluateArithmeticProgramColumnsWithInstructionSet(program, columns, columnOutput, count, instructionSets[i].instructionSet, MATH_KERNEL_SET_LIBM);
+        var columnTime = GetCurrentTimeInSeconds() - beginTime;
+        
+        long mismatchCount = 0;
+        for(long j = 0; j < count; j++)
+        {
+            if(memcmp(&scalarOutput[j], &columnOutput[j], sizeof(double)) != 0)
+                mismatchCount++;
+        }
+        
+        printf("%s: %.2f ns/row, speedup %.2fx, %ld mismatches\n", instructionSets[i].name, columnTime * 1e9 / count, scalarTime / columnTime, mismatchCount);
+    }
+    
+    free(x);
+    free(y);
+    free(scalarOutput);
+    free(columnOutput);
+    DestroyArithmeticProgram(program);
+    
+    return 0;
+}
+
+/** 生成随机数的简单状态机（xorshift64），用于生成可复现的测试表达式 */
+static uint32_t NextRandomNumber(uint64_t *pState)
+{
+    var x = *pState;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *pState = x;
+    return (uint32_t)(x >> 32);
+}
+
+/**
+ * 随机生成一个合法的算术表达式，并追加到buffer中。
+ * 表达式会随机使用方括号、$以及大写字母，以覆盖输入过滤的各种情况。
+ * 为了避免除数为零的整数求模使程序崩溃，求模的右操作数总是一个正整数字面量，且其后不会紧跟幂运算
+ * @param buffer 输出缓存
+ * @param pLength 当前已写入的长度，它既是输入又是输出
+ * @param capacity 输出缓存的容量，生成的内容会被截断以保证不越界
+ * @param depth 允许的最大括号嵌套深度
+ * @param hasVariables 是否使用变量x与y
+*/
+static void GenerateRandomExpression(char buffer[], size_t *pLength, size_t capacity, uint64_t *pState, int depth, bool hasVariables)
+{
+    var length = *pLength;
+    var termCount = 1 + NextRandomNumber(pState) % 4;
+    var lastOpIsMod = false;
+    
+#define APPEND_TEXT(...)    do { if(length < capacity) length += snprintf(&buffer[length], capacity - length, __VA_ARGS__); if(length >= capacity) length = capacity - 1; } while(0)
+    
+    for(var t = 0U; t < termCount; t++)
+    {
+        if(t > 0)
+        {
+            static const char operators[] = "+-*/^$%";
+            var op = operators[NextRandomNumber(pState) % (sizeof(operators) - 1)];
+            if(lastOpIsMod && (op == '^' || op == '$'))
+                op = '*';
+            APPEND_TEXT("%c", op);
+            
+            if(op == '%')
+            {
+                APPEND_TEXT("%u", 1 + NextRandomNumber(pState) % 9);
+                lastOpIsMod = true;
+                continue;
+            }
+        }
+        lastOpIsMod = false;
+        
+        var kind = NextRandomNumber(pState) % 8;
+        if(depth <= 0 && kind >= 5)
+            kind %= 5;
+        
+        var isBracket = (NextRandomNumber(pState) & 1) != 0;
+        
+        switch(kind)
+        {
+        case 0:
+            APPEND_TEXT("%u", NextRandomNumber(pState) % 100);
+            break;
+            
+        case 1:
+            APPEND_TEXT("%u.%u", NextRandomNumber(pState) % 10, NextRandomNumber(pState) % 1000);
+            break;
+            
+        case 2:
+            APPEND_TEXT("-%u", 1 + NextRandomNumber(pState) % 20);
+            break;
+            
+        case 3:
+        {
+            static const char *const names[] = { "pi", "E", "x", "Y" };
+            APPEND_TEXT("%s", names[NextRandomNumber(pState) % (hasVariables? 4 : 2)]);
+            break;
+        }
+            
+        case 4:
+            APPEND_TEXT("%u.", NextRandomNumber(pState) % 10);
+            break;
+            
+        default:
+        {
+            // 函数调用或者括号子表达式
+            if(kind >= 6)
+            {
+                // 函数表中有空位，所以反复抽取直到选中一个函数为止
+                const char *name;
+                do
+                    name = mathFuncList[NextRandomNumber(pState) % MATH_FUNCTION_TABLE_SIZE].name;
+                while(name[0] == '\0');
+                APPEND_TEXT("%s", name);
+            }
+            APPEND_TEXT("%c", isBracket? '[' : '(');
+            *pLength = length;
+            GenerateRandomExpression(buffer, pLength, capacity, pState, depth - 1, hasVariables);
+            length = *pLength;
+            APPEND_TEXT("%c", isBracket? ']' : ')');
+            break;
+        }
+        }
+    }
+    
+#undef APPEND_TEXT
+    
+    *pLength = length;
+}
+
+/** 判定两个计算结果是否相同：要么逐位相同，要么都是NaN */
+static inline bool IsSameResult(double a, double b)
+{
+    return memcmp(&a, &b, sizeof(double)) == 0 || (isnan(a) && isnan(b));
+}
+
+/**
+ * 检查同一个含有变量的表达式在各种求值方式下的结果是否一致。
+ * 优化后程序的JIT本机代码以及按列求值的结果必须与其解释执行的结果逐位相同，
+ * 而优化前后的结果除NaN的符号位以外也必须相同
+ * @return 若结果全部一致，返回true
+*/
+static bool VerifyProgramWithVariables(const char *expr, uint64_t *pState, bool *pIsNative)
+{
+    static const char *const variableNames[] = { "x", "y" };
+    
+    var reference = CompileArithmeticProgram(expr, variableNames, 2, false, NULL);
+    var program = CompileArithmeticExpression(expr, variableNames, 2);
+    var jit = (program != NULL)? CreateArithmeticJitProgram(program) : NULL;
+    var isSuccessful = (reference != NULL) == (program != NULL);
+    
+    if(isSuccessful && jit != NULL)
+    {
+        *pIsNative = IsArithmeticJitProgramNative(jit);
+        
+        for(var i = 0; i < 4 && isSuccessful; i++)
+        {
+            double bindings[] = { (double)(int)NextRandomNumber(pState) * 0x1p-28, (double)(NextRandomNumber(pState) % 64) * 0.25 - 8.0 };
+            const double *const columns[] = { &bindings[0], &bindings[1] };
+            
+            double results[4];
+            results[0] = EvaluateArithmeticProgram(reference, bindings);
+            results[1] = EvaluateArithmeticProgram(program, bindings);
+            results[2] = EvaluateArithmeticJitProgram(jit, bindings);
+            EvaluateArithmeticProgramColumns(program, columns, &results[3], 1);
+            
+            isSuccessful = IsSameResult(results[0], results[1]) &&
+                    memcmp(&results[1], &results[2], sizeof(double)) == 0 && memcmp(&results[1], &results[3], sizeof(double)) == 0;
+        }
+    }
+    
+    DestroyArithmeticJitProgram(jit);
+    DestroyArithmeticProgram(program);
+    DestroyArithmeticProgram(reference);
+    
+    return isSuccessful;
+}
+
+/**
+ * JIT差分测试：随机生成大量表达式（其中一部分被故意破坏）。
+ * 对于只含常量的表达式，分别用ParseArithmeticExpression直接计算、解释执行编译后的程序以及执行JIT生成的本机代码，
+ * 检查三者对表达式合法性的判定是否一致，并检查三者的计算结果是否逐位相同；
+ * 对于含有变量的表达式，则检查优化前后的程序在各种求值方式下的结果是否逐位相同
+ * @param count 测试的表达式个数
+ * @param seed 随机数种子
+ * @return 若全部一致，返回0，否则返回1
+*/
+static int VerifyJitProgram(long count, uint64_t seed)
+{
+    var state = seed | 1;
+    long validCount = 0;
+    long nativeCount = 0;
+    long mismatchCount = 0;
+    
+    for(long i = 0; i < count; i++)
+    {
+        // 奇数编号的表达式使用变量
+        var hasVariables = (i & 1) != 0;
+        
+        char expr[512];
+        size_t length = 0;
+        GenerateRandomExpression(expr, &length, sizeof(expr), &state, 3, hasVariables);
+        
+        // 对一部分表达式随机插入一个字符，以检验非法表达式的判定。
+        // 含有求模的表达式不做破坏，以免构造出除数为零的整数求模
+        if(NextRandomNumber(&state) % 4 == 0 && strchr(expr, '%') == NULL && length + 1 < sizeof(expr))
+        {
+            static const char noise[] = "+-*/^()[]1.ex";
+            var position = NextRandomNumber(&state) % (length + 1);
+            memmove(&expr[position + 1], &expr[position], length - position + 1);
+            expr[position] = noise[NextRandomNumber(&state) % (sizeof(noise) - 1)];
+            length++;
+        }
+        
+        if(hasVariables)
+        {
+            bool isNative = false;
+            if(!VerifyProgramWithVariables(expr, &state, &isNative))
+            {
+                if(mismatchCount++ < 10)
+                    printf("Mismatch with variables: %s\n", expr);
+            }
+            if(isNative)
+                nativeCount++;
+            continue;
+        }
+        
+        char normalized[sizeof(expr)];
+        memcpy(normalized, expr, length + 1);
+        NormalizeArithmeticExpression(normalized, normalized, length);
+        
+        bool isValid = false;
+        const char *cursor = normalized;
+        var expected = ParseArithmeticExpression(&cursor, 0.0, PARSE_PHASE_STATUS_LEFT_OPERAND, OPERATOR_PRIORITY_ADD, &isValid, NULL);
+        
+        // 这里使用未经优化的程序，使得JIT本机代码确实包含了各种运算，而不仅仅是一个折叠后的常量
+        var program = CompileArithmeticProgram(expr, NULL, 0, false, NULL);
+        if((program != NULL) != isValid)
+        {
+            if(mismatchCount++ < 10)
+                printf("Validity mismatch: %s (direct parse: %s)\n", expr, isValid? "valid" : "invalid");
+            DestroyArithmeticProgram(program);
+            continue;
+        }
+        if(program == NULL)
+            continue;
+        
+        validCount++;
+        
+        var jit = CreateArithmeticJitProgram(program);
+        var optimized = CompileArithmeticExpression(expr, NULL, 0);
+        if(jit == NULL || optimized == NULL)
+        {
+            DestroyArithmeticJitProgram(jit);
+            DestroyArithmeticProgram(optimized);
+            DestroyArithmeticProgram(program);
+            return 1;
+        }
+        if(IsArithmeticJitProgramNative(jit))
+            nativeCount++;
+        
+        var interpreted = EvaluateArithmeticProgram(program, NULL);
+        var native = EvaluateArithmeticJitProgram(jit, NULL);
+        var folded = EvaluateArithmeticProgram(optimized, NULL);
+        
+        if(memcmp(&expected, &interpreted, sizeof(double)) != 0 || memcmp(&expected, &native, sizeof(double)) != 0 ||
+           !IsSameResult(expected, folded))
+        {
+            if(mismatchCount++ < 10)
+                printf("Result mismatch: %s = %.17g (interpreter: %.17g, JIT: %.17g, optimized: %.17g)\n", expr, expected, interpreted, native, folded);
+        }
+        
+        DestroyArithmeticJitProgram(jit);
+        DestroyArithmeticProgram(optimized);
+        DestroyArithmeticProgram(program);
+    }
+    
+    printf("Checked %ld expressions: %ld valid without variables, %ld compiled to native code, %ld mismatches\n", count, validCount, nativeCount, mismatchCount);
+    
+    return mismatchCount > 0? 1 : 0;
+}
+
+/**
+ * 比较解释执行与JIT本机代码的性能，表达式中可以使用变量x与y
+ * @param expr 用于测试的算术表达式
+ * @param iterations 求值次数
+ * @return 若表达式合法，返回0，否则返回1
+*/
+static int BenchmarkJitEvaluation(const char *expr, long iterations)
+{
+    static const char *const variableNames[] = { "x", "y" };
+    
+    var program = CompileArithmeticExpression(expr, variableNames, 2);
+    if(program == NULL)
+    {
+        puts("Invalid expression!");
+        return 1;
+    }
+    
+    var beginTime = GetCurrentTimeInSeconds();
+    var jit = CreateArithmeticJitProgram(program);
+    var jitTime = GetCurrentTimeInSeconds() - beginTime;
+    if(jit == NULL)
+    {
+        DestroyArithmeticProgram(program);
+        return 1;
+    }
+    
+    volatile double sink = 0.0;
+    double bindings[] = { 1.25, 2.5 };
+    
+    beginTime = GetCurrentTimeInSeconds();
+    for(long i = 0; i < iterations; i++)
+    {
+        bindings[0] = 1.0 + (double)(i & 1023) * 0x1p-10;
+        sink += EvaluateArithmeticProgram(program, bindings);
+    }
+    var interpretTime = GetCurrentTimeInSeconds() - beginTime;
+    
+    beginTime = GetCurrentTimeInSeconds();
+    for(long i = 0; i < iterations; i++)
+    {
+        bindings[0] = 1.0 + (double)(i & 1023) * 0x1p-10;
+        sink += EvaluateArithmeticJitProgram(jit, bindings);
+    }
+    var nativeTime = GetCurrentTimeInSeconds() - beginTime;
+    
+    printf("Expression: %s\n", expr);
+    if(IsArithmeticJitProgramNative(jit))
+        printf("JIT: %zu bytes of native code and data, generated in %.3f us\n", jit->codeSize, jitTime * 1e6);
+    else
+        puts("JIT: not available for this program, falling back to the interpreter");
+    printf("Interpreter: %.2f ns/eval\n", interpretTime * 1e9 / iterations);
+    printf("JIT:         %.2f ns/eval\n", nativeTime * 1e9 / iterations);
+    printf("Speedup:     %.2fx\n", interpretTime / nativeTime);
+    
+    DestroyArithmeticJitProgram(jit);
+    DestroyArithmeticProgram(program);
+    
+    return 0;
+}
+
+/**
+ * 原先的数字解析方式：先将数字字面量拷贝到栈上的缓存中，再用atof转换。
+ * 仅用于与ParseNumberLiteral做性能比较
+*/
+static double ParseDigitalWithAtof(const char *cursor, int *pRetLength)
+{
+    // 旧版本中输入表达式的长度不超过2047字节，所以该缓存也只有这么大
+    char value[2048];
+    
+    char ch;
+    var index = 0;
+    var hasDot = false;
+    
+    do
+    {
+        ch = cursor[index];
+        if(ch == '.')
+        {
+            if(hasDot)
+                break;
+            hasDot = true;
+        }
+        else if(!IsDigital(ch))
+            break;
+        
+        value[index++] = ch;
+    }
+    while(ch != '\0');
+    
+    value[index] = '\0';
+    
+    *pRetLength = index;
+    
+    return atof(value);
+}
+
+/**
+ * 生成一个随机的数字字面量
+ * @param buffer 存放字面量的缓存，其容量不小于1024字节
+ * @param kind 字面量的种类：0为不超过6位的整数，1为不超过17位有效数字的小数，
+ * 2为带指数的小数，3为恰好落在两个相邻double正中间（或与之相差一个末位）的长数字，
+ * 4为不超过16位有效数字的十六进制浮点数
+ * @return 字面量的长度
+*/
+static int GenerateNumberLiteral(char buffer[], uint64_t *pState, int kind)
+{
+    switch(kind)
+    {
+    case 0:
+        return sprintf(buffer, "%u", NextRandomNumber(pState) % 1000000U);
+        
+    case 1:
+    {
+        var digitCount = (int)(NextRandomNumber(pState) % 17) + 1;
+        var dotIndex = (int)(NextRandomNumber(pState) % digitCount);
+        var length = 0;
+        for(var i = 0; i < digitCount; i++)
+        {
+            if(i == dotIndex && i > 0)
+                buffer[length++] = '.';
+            buffer[length++] = '0' + NextRandomNumber(pState) % 10;
+        }
+        buffer[length] = '\0';
+        return length;
+    }
+        
+    case 2:
+    {
+        var length = GenerateNumberLiteral(buffer, pState, 1);
+        var exponent = (int)(NextRandomNumber(pState) % 701) - 350;
+        return length + sprintf(&buffer[length], (NextRandomNumber(pState) & 1) != 0? "e%d" : "e%+d", exponent);
+    }
+        
+    case 3:
+    {
+        // 取两个相邻double的中点，它可以被long double精确表示，并被printf精确地输出为十进制
+        uint64_t bits = ((uint64_t)NextRandomNumber(pState) << 32 | NextRandomNumber(pState)) % UINT64_C(0x7fe0000000000000);
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        var midpoint = ((long double)value + (long double)nextafter(value, INFINITY)) / 2;
+        sprintf(buffer, "%.800Le", midpoint);
+        
+        // 去掉末尾的零之后，有三分之一的概率将最后一位数字加一或减一
+        var exponentText = strchr(buffer, 'e');
+        char suffix[16];
+        strcpy(suffix, exponentText);
+        var last = exponentText - 1;
+        while(*last == '0' || *last == '.')
+            last--;
+        var adjust = NextRandomNumber(pState) % 3;
+        if(adjust == 1 && *last < '9')
+            (*last)++;
+        else if(adjust == 2 && *last > '1')
+            (*last)--;
+        return (int)(last + 1 - buffer) + sprintf(last + 1, "%s", suffix);
+    }
+        
+    default:
+    {
+        var length = sprintf(buffer, "0x");
+        var digitCount = (int)(NextRandomNumber(pState) % 16) + 1;
+        var dotIndex = (int)(NextRandomNumber(pState) % (digitCount + 1));
+        for(var i = 0; i < digitCount; i++)
+        {
+            if(i == dotIndex)
+                buffer[length++] = '.';
+            buffer[length++] = "0123456789abcdef"[NextRandomNumber(pState) % 16];
+        }
+        var exponent = (int)(NextRandomNumber(pState) % 2201) - 1100;
+        return length + sprintf(&buffer[length], "p%d", exponent);
+    }
+    }
+}
+
+/**
+ * 用随机的数字字面量校验ParseNumberLiteral的结果与strtod是否逐位相同，
+ * 然后比较原先的拷贝加atof方式与ParseNumberLiteral的性能
+ * @param count 参与性能测试的字面量个数
+ * @return 若校验全部通过，返回0，否则返回1
+*/
+static int BenchmarkNumberParsing(long count)
+{
+    uint64_t state = 20161220U;
+    char buffer[1024];
+    long mismatchCount = 0;
+    const int kindCount = 5;
+    const long verifyCount = 200000;
+    
+    for(long i = 0; i < verifyCount * kindCount; i++)
+    {
+        var length = GenerateNumberLiteral(buffer, &state, (int)(i % kindCount));
+        int parsedLength;
+        var parsed = ParseNumberLiteral(buffer, &parsedLength);
+        
+        // glibc的strtod对某些次正规的十六进制浮点数舍入有误，而不超过64位的十六进制有效数字能被long double精确表示，
+        // 再转换为double时只经过一次正确舍入
+        var expected = (i % kindCount == 4)? (double)strtold(buffer, NULL) : strtod(buffer, NULL);
+        
+        if(parsedLength != length || memcmp(&parsed, &expected, sizeof(double)) != 0)
+        {
+            if(mismatchCount++ < 10)
+                printf("Mismatch: %.60s: %.17g, expected %.17g\n", buffer, parsed, expected);
+        }
+    }
+    printf("Verified %ld literals against strtod: %ld mismatches\n", verifyCount * kindCount, mismatchCount);
+    
+    // 性能测试只使用两种方式都支持的十进制字面量，所有字面量以'+'分隔，存放在一段连续的文本中
+    var text = (char*)malloc((size_t)count * 20 + 1);
+    if(text == NULL)
+        return 1;
+    
+    size_t textLength = 0;
+    for(long i = 0; i < count; i++)
+    {
+        textLength += GenerateNumberLiteral(&text[textLength], &state, (int)(i & 1));
+        text[textLength++] = '+';
+    }
+    text[textLength] = '\0';
+    
+    volatile double sink = 0.0;
+    double sums[2] = { 0.0, 0.0 };
+    double times[2];
+    
+    for(var method = 0; method < 2; method++)
+    {
+        var beginTime = GetCurrentTimeInSeconds();
+        var sum = 0.0;
+        for(const char *cursor = text; *cursor != '\0'; cursor++)
+        {
+            int length;
+            sum += (method == 0)? ParseDigitalWithAtof(cursor, &length) : ParseNumberLiteral(cursor, &length);
+            cursor += length;
+        }
+        times[method] = GetCurrentTimeInSeconds() - beginTime;
+        sums[method] = sum;
+        sink += sum;
+    }
+    
+    printf("Literals: %ld, %zu bytes\n", count, textLength);
+    printf("Copy + atof:        %.2f ns/literal\n", times[0] * 1e9 / count);
+    printf("ParseNumberLiteral: %.2f ns/literal\n", times[1] * 1e9 / count);
+    printf("Speedup:            %.2fx\n", times[0] / times[1]);
+    printf("Results identical: %s\n", memcmp(&sums[0], &sums[1], sizeof(double)) == 0? "yes" : "no");
+    
+    free(text);
+    
+    return mismatchCount == 0? 0 : 1;
+}
+
+/**
+ * 原先的结果格式化方式：用sprintf输出小数点后8位，再去掉末尾多余的零。
+ * 仅用于与FormatArithmeticResult做性能比较以及校验
+*/
+static int FormatResultWithSprintf(double value, char result[static RESULT_STRING_SIZE])
+{
+    // 绝对值不小于1e21的数用"%.8f"输出会超出缓存长度，这类数不参与比较
+    sprintf(result, "%.8f", value);
+    
+    var length = (int)strlen(result);
+    var dotIndex = -1;
+    var hasE = false;
+    for(var i = 0; i < length; i++)
+    {
+        if(result[i] == '.')
+            dotIndex = i;
+        else if(result[i] == 'e')
+            hasE = true;
+    }
+    if(dotIndex >= 0 && !hasE)
+    {
+        var index = length;
+        
+        while(--index > 0)
+        {
+            if(result[index] != '0')
+                break;
+            
+            result[index] = '\0';
+            length--;
+        }
+        if(result[dotIndex + 1] == '\0')
+        {
+            result[dotIndex] = '\0';
+            length--;
+        }
+    }
+    
+    return length;
+}
+
+/**
+ * 校验FormatArithmeticResult的结果，然后比较原先的sprintf方式与各种格式的性能。
+ * 测试数据一部分是典型的计算结果（小整数以及两个整数的商），另一部分是随机的位模式
+ * @param count 参与性能测试的数值个数
+ * @return 若校验全部通过，返回0，否则返回1
+*/
+static int BenchmarkResultFormatting(long count)
+{
+    var values = (double*)malloc(sizeof(double) * count);
+    if(values == NULL)
+        return 1;
+    
+    uint64_t state = 20161220U;
+    for(long i = 0; i < count; i++)
+    {
+        switch(i % 4)
+        {
+        case 0:
+            values[i] = NextRandomNumber(&state) % 10000;
+            break;
+        case 1:
+            values[i] = (double)(NextRandomNumber(&state) % 100000) / (NextRandomNumber(&state) % 999 + 1);
+            break;
+        case 2:
+            values[i] = ldexp(NextRandomNumber(&state), (int)(NextRandomNumber(&state) % 100) - 60);
+            break;
+        default:
+        {
+            // 随机的位模式，只保留有限值
+            uint64_t bits = (uint64_t)NextRandomNumber(&state) << 32 | NextRandomNumber(&state);
+            memcpy(&values[i], &bits, sizeof(double));
+            if(!isfinite(values[i]))
+                values[i] = 0.0;
+            break;
+        }
+        }
+    }
+    
+    // 最短表示必须能被精确读回，而小数点后8位的定点格式必须与原先的输出完全相同
+    const struct ResultFormat fixedFormat = { RESULT_FORMAT_MODE_FIXED, 8, false, MATH_KERNEL_SET_LIBM };
+    char buffer[RESULT_STRING_SIZE];
+    char expected[RESULT_STRING_SIZE];
+    long mismatchCount = 0;
+    for(long i = 0; i < count; i++)
+    {
+        FormatArithmeticResult(values[i], NULL, buffer);
+        var parsed = strtod(buffer, NULL);
+        var isMismatch = memcmp(&parsed, &values[i], sizeof(double)) != 0;
+        
+        if(fabs(values[i]) < 1e21)
+        {
+            FormatArithmeticResult(values[i], &fixedFormat, buffer);
+            FormatResultWithSprintf(values[i], expected);
+            isMismatch = isMismatch || strcmp(buffer, expected) != 0;
+        }
+        
+        if(isMismatch && mismatchCount++ < 10)
+            printf("Mismatch: %a: %s, expected %s\n", values[i], buffer, expected);
+    }
+    printf("Verified %ld values: %ld mismatches\n", count, mismatchCount);
+    
+    static const char *const methodNames[] = {
+        "sprintf(\"%.8f\") + trim", "shortest", "fixed:8", "scientific"
+    };
+    const struct ResultFormat formats[] = {
+        { RESULT_FORMAT_MODE_SHORTEST, 0, false, MATH_KERNEL_SET_LIBM }, fixedFormat, { RESULT_FORMAT_MODE_SCIENTIFIC, 0, false, MATH_KERNEL_SET_LIBM }
+    };
+    
+    // 绝对值不小于1e21的数无法用原先的方式安全地输出，所有方式都跳过它们
+    long formattedCount = 0;
+    for(long i = 0; i < count; i++)
+        formattedCount += fabs(values[i]) < 1e21;
+    
+    volatile size_t sink = 0;
+    double baseTime = 0.0;
+    
+    for(var method = 0; method < 4; method++)
+    {
+        var beginTime = GetCurrentTimeInSeconds();
+        size_t totalLength = 0;
+        for(long i = 0; i < count; i++)
+        {
+            if(fabs(values[i]) >= 1e21)
+                continue;
+            
+            if(method == 0)
+                totalLength += FormatResultWithSprintf(values[i], buffer);
+            else
+                totalLength += FormatArithmeticResult(values[i], &formats[method - 1], buffer);
+        }
+        var elapsedTime = GetCurrentTimeInSeconds() - beginTime;
+        sink += totalLength;
+        
+        if(method == 0)
+            baseTime = elapsedTime;
+        
+        printf("%-24s %12.0f results/sec, %.2fx\n", methodNames[method], formattedCount / elapsedTime, baseTime / elapsedTime);
+    }
+    
+    free(values);
+    
+    return mismatchCount == 0? 0 : 1;
+}
+
+/**
+ * 用递归版本的解析计算表达式，作为迭代求值的参照。
+ * 出错时输出与EvaluateArithmeticSpan相同形式的错误信息
+*/
+static bool EvaluateArithmeticExpressionRecursively(const char *expr, size_t length, double *pValue, struct CalculationError *pError)
+{
+    var buffer = (char*)malloc(length + 1);
+    if(buffer == NULL)
+    {
+        *pError = (struct CalculationError){ CALCULATION_ERROR_OUT_OF_MEMORY, 0 };
+        return false;
+    }
+    NormalizeArithmeticExpression(buffer, expr, length);
+    buffer[length] = '\0';
+    
+    struct ParseContext context = { NULL, CALCULATION_ERROR_NONE };
+    const char *cursor = buffer;
+    bool isSuccessful = false;
+    
+    var value = ParseArithmeticExpression(&cursor, 0.0, PARSE_PHASE_STATUS_LEFT_OPERAND, OPERATOR_PRIORITY_ADD, &isSuccessful, &context);
+    if(isSuccessful)
+        *pValue = value;
+    else if(context.errorCode != CALCULATION_ERROR_NONE)
+        *pError = (struct CalculationError){ context.errorCode, (size_t)(context.errorCursor - buffer) };
+    else
+    {
+        // 解析在最外层碰到')'时会直接返回且不输出解析状态，此时游标正指向这个多余的')'
+        *pError = (struct CalculationError){ CALCULATION_ERROR_UNMATCHED_PARENTHESIS, (size_t)(cursor - buffer) };
+    }
+    
+    free(buffer);
+    
+    return isSuccessful;
+}
+
+/**
+ * 用随机生成的表达式校验迭代求值与递归求值的结果、合法性判定以及错误信息是否完全相同。
+ * 每个表达式由若干个随机表达式与随机数字字面量拼接而成，长度常常超过预读窗口，
+ * 其中一部分还会被随机改动几个字符，以覆盖各种非法输入
+*/
+static int VerifyIterativeEvaluation(long count, uint64_t seed)
+{
+    enum { EXPRESSION_CAPACITY = 16384 };
+    
+    var expr = (char*)malloc(EXPRESSION_CAPACITY);
+    var arenaMemory = malloc(1 << 20);
+    if(expr == NULL || arenaMemory == NULL)
+    {
+        free(expr);
+        free(arenaMemory);
+        return 2;
+    }
+    
+    var state = seed | 1;
+    long invalidCount = 0;
+    long mismatchCount = 0;
+    size_t totalLength = 0;
+    
+    for(long i = 0; i < count; i++)
+    {
+        size_t length = 0;
+        var partCount = 1 + NextRandomNumber(&state) % 16;
+        for(var part = 0U; part < partCount; part++)
+        {
+            // 拼接时不使用^和/，以免在前一部分末尾的求模运算中构造出为零的除数
+            if(part > 0)
+                expr[length++] = "+-*"[NextRandomNumber(&state) % 3];
+            
+            if(NextRandomNumber(&state) % 4 == 0)
+                length += GenerateNumberLiteral(&expr[length], &state, NextRandomNumber(&state) % 4);
+            else
+                GenerateRandomExpression(expr, &length, length + 1536, &state, NextRandomNumber(&state) % 4, false);
+        }
+        expr[length] = '\0';
+        
+        // 含有求模的表达式不做改动，以免构造出除数为零的整数求模
+        var mutationCount = NextRandomNumber(&state) % 3;
+        for(var m = 0U; m < mutationCount && length > 0 && strchr(expr, '%') == NULL; m++)
+        {
+            static const char noise[] = "+-*/^()[]$.,1ex pSIN";
+            var position = NextRandomNumber(&state) % length;
+            if((NextRandomNumber(&state) & 1) != 0)
+                expr[position] = noise[NextRandomNumber(&state) % (sizeof(noise) - 1)];
+            else
+                memmove(&expr[position], &expr[position + 1], length-- - position);
+        }
+        
+        double expected = 0.0, value = 0.0;
+        struct CalculationError expectedError = { CALCULATION_ERROR_NONE, 0 };
+        struct CalculationError error = { CALCULATION_ERROR_NONE, 0 };
+        var isExpectedValid = EvaluateArithmeticExpressionRecursively(expr, length, &expected, &expectedError);
+        
+        // 交替使用工作区与堆存储空间
+        struct CalculationArena arena;
+        InitCalculationArena(&arena, arenaMemory, 1 << 20);
+        var isValid = EvaluateArithmeticSpan(expr, length, false, MATH_KERNEL_SET_LIBM, (i & 1) != 0? &arena : NULL, &value, &error, NULL);
+        
+        if(isValid != isExpectedValid || (isValid && !IsSameResult(value, expected)) ||
+           (!isValid && (error.code != expectedError.code || error.offset != expectedError.offset)))
+        {
+            if(mismatchCount++ < 10)
+            {
+                printf("Mismatch: %.*s%s\n", length > 200? 200 : (int)length, expr, length > 200? "..." : "");
+                printf("  iterative: %s %.17g (%s at %zu), recursive: %s %.17g (%s at %zu)\n",
+                       isValid? "valid" : "invalid", value, GetCalculationErrorMessage(error.code), error.offset,
+                       isExpectedValid? "valid" : "invalid", expected, GetCalculationErrorMessage(expectedError.code), expectedError.offset);
+            }
+        }
+        
+        if(!isValid)
+            invalidCount++;
+        totalLength += length;
+    }
+    
+    printf("Checked %ld expressions (%ld invalid, %.0f bytes on average): %ld mismatches\n",
+           count, invalidCount, count > 0? (double)totalLength / count : 0.0, mismatchCount);
+    
+    free(expr);
+    free(arenaMemory);
+    
+    return mismatchCount == 0? 0 : 1;
+}
+
+/** 压力测试中所使用的表达式种类 */
+enum STRESS_EXPRESSION_KIND
+{
+    /** 由同一优先级的加法组成：1+1+...+1 */
+    STRESS_EXPRESSION_KIND_FLAT_SUM,
+    
+    /** 加减与乘法交替出现：3*4-2*5+...，每次优先级的提升都会留下一个尚待归约的左操作数 */
+    STRESS_EXPRESSION_KIND_SUM_OF_PRODUCTS,
+    
+    /** 深度嵌套的括号：(1+(1+(...(1)...))) */
+    STRESS_EXPRESSION_KIND_NESTED_PARENTHESES,
+    
+    /** 深度嵌套的函数调用：recp(recp(...(2)...)) */
+    STRESS_EXPRESSION_KIND_NESTED_FUNCTIONS,
+    
+    /** 一个很长的数字字面量：1.234... */
+    STRESS_EXPRESSION_KIND_LONG_LITERAL,
+    
+    STRESS_EXPRESSION_KIND_COUNT
+};
+
+/**
+ * 生成压力测试所使用的表达式
+ * @param size 线性表达式的大致字节数
+ * @param depth 嵌套表达式的嵌套深度
+ * @param pLength 输出表达式的长度
+ * @param pExpected 输出表达式的精确结果
+ * @return 表达式字符串，使用完毕后需用free释放；若存储空间不足，返回NULL
+*/
+static char* GenerateStressExpression(enum STRESS_EXPRESSION_KIND kind, size_t size, long depth, size_t *pLength, double *pExpected)
+{
+    var capacity = (kind == STRESS_EXPRESSION_KIND_NESTED_PARENTHESES || kind == STRESS_EXPRESSION_KIND_NESTED_FUNCTIONS)? (size_t)depth * 6 + 16 : size + 16;
+    var expr = (char*)malloc(capacity);
+    if(expr == NULL)
+        return NULL;
+    
+    size_t length = 0;
+    uint64_t state = 20161220U;
+    
+    switch(kind)
+    {
+    case STRESS_EXPRESSION_KIND_FLAT_SUM:
+        expr[length++] = '1';
+        while(length + 2 <= size)
+        {
+            memcpy(&expr[length], "+1", 2);
+            length += 2;
+        }
+        *pExpected = (double)(length / 2 + 1);
+        break;
+        
+    case STRESS_EXPRESSION_KIND_SUM_OF_PRODUCTS:
+    {
+        // 各项都是较小的整数，所以无论按什么顺序归约，结果都是精确的
+        int64_t sum = 0;
+        for(var sign = 1; length + 4 <= size; sign = -sign)
+        {
+            var a = 1 + (int)(NextRandomNumber(&state) % 9);
+            var b = 1 + (int)(NextRandomNumber(&state) % 9);
+            if(length > 0)
+                expr[length++] = (sign > 0)? '+' : '-';
+            expr[length++] = (char)('0' + a);
+            expr[length++] = '*';
+            expr[length++] = (char)('0' + b);
+            sum += sign * a * b;
+        }
+        *pExpected = (double)sum;
+        break;
+    }
+        
+    case STRESS_EXPRESSION_KIND_NESTED_PARENTHESES:
+        for(long i = 0; i < depth; i++)
+        {
+            memcpy(&expr[length], "(1+", 3);
+            length += 3;
+        }
+        expr[length++] = '1';
+        memset(&expr[length], ')', depth);
+        length += depth;
+        *pExpected = (double)(depth + 1);
+        break;
+        
+    case STRESS_EXPRESSION_KIND_NESTED_FUNCTIONS:
+        for(long i = 0; i < depth; i++)
+        {
+            memcpy(&expr[length], "recp(", 5);
+            length += 5;
+        }
+        expr[length++] = '2';
+        memset(&expr[length], ')', depth);
+        length += depth;
+        *pExpected = (depth % 2 == 0)? 2.0 : 0.5;
+        break;
+        
+    case STRESS_EXPRESSION_KIND_LONG_LITERAL:
+        expr[length++] = '1';
+        expr[length++] = '.';
+        while(length < size)
+            expr[length++] = (char)('0' + NextRandomNumber(&state) % 10);
+        expr[length] = '\0';
+        *pExpected = strtod(expr, NULL);
+        break;
+        
+    default:
+        break;
+    }
+    
+    *pLength = length;
+    return expr;
+}
+
+/**
+ * 对迭代求值做压力测试：分别计算约为megabytes兆字节的线性表达式，以及嵌套深度为depth的表达式，
+ * 输出耗时以及预读窗口与求值栈所占用的最大存储空间，并检验结果是否正确
+*/
+static int RunEvaluationStressTest(long megabytes, long depth)
+{
+    static const char *const kindNames[] = {
+        [STRESS_EXPRESSION_KIND_FLAT_SUM] = "flat sum",
+        [STRESS_EXPRESSION_KIND_SUM_OF_PRODUCTS] = "sum of products",
+        [STRESS_EXPRESSION_KIND_NESTED_PARENTHESES] = "nested parentheses",
+        [STRESS_EXPRESSION_KIND_NESTED_FUNCTIONS] = "nested functions",
+        [STRESS_EXPRESSION_KIND_LONG_LITERAL] = "long literal"
+    };
+    
+    var size = (size_t)megabytes << 20;
+    long failureCount = 0;
+    
+    printf("%-20s %12s %10s %10s %14s  %s\n", "expression", "bytes", "seconds", "MB/s", "peak memory", "result");
+    
+    for(var kind = 0; kind < STRESS_EXPRESSION_KIND_COUNT; kind++)
+    {
+        size_t length = 0;
+        var expected = 0.0;
+        var expr = GenerateStressExpression(kind, size, depth, &length, &expected);
+        if(expr == NULL)
+        {
+            puts("Not enough memory!");
+            return 2;
+        }
+        
+        var value = 0.0;
+        size_t peakMemory = 0;
+        struct CalculationError error;
+        
+        var beginTime = GetCurrentTimeInSeconds();
+        var isValid = EvaluateArithmeticSpan(expr, length, false, MATH_KERNEL_SET_LIBM, NULL, &value, &error, &peakMemory);
+        var elapsedTime = GetCurrentTimeInSeconds() - beginTime;
+        
+        var isCorrect = isValid && value == expected;
+        if(!isCorrect)
+            failureCount++;
+        
+        char result[RESULT_STRING_SIZE];
+        FormatArithmeticResult(value, NULL, result);
+        printf("%-20s %12zu %10.3f %10.1f %14zu  %s", kindNames[kind], length, elapsedTime, length / elapsedTime / (1 << 20), peakMemory, isValid? result : GetCalculationErrorMessage(error.code));
+        puts(isCorrect? "" : " (wrong)");
+        
+        free(expr);
+    }
+    
+    return failureCount == 0? 0 : 1;
+}
+
+/**
+ * 原先的数学函数名表：函数名的前4个字节与原先存放在int中的多字符常量相同，不足4个字符的部分以'\0'填充。
+ * 这里用字符串写出，避免了-Wmultichar警告
+*/
+static const char legacyMathFuncNames[][sizeof(int) + 1] = {
+    "sin", "cos", "tan", "cot", "sinh", "cosh", "tanh", "asin", "acos", "atan", "asnh",
+    "acsh", "log", "lg", "ln", "sqrt", "cbrt", "recp", "rad", "deg", "exp"
+};
+
+/**
+ * 原先查找数学函数名的方式：取出至多4个字母，再到函数名表中顺序查找。
+ * 仅用于与ParseMathFunctionIndex做性能比较
+ * @return 若解析成功，返回该函数在legacyMathFuncNames中的索引，否则返回-1
+*/
+static int ParseMathFunctionIndexLinearly(const char *cursor, int *pLength)
+{
+    char alignas(4) buffer[8] = { '\0' };
+    var index = 0;
+    
+    for(var count = 0; count < 4; count++, index++)
+    {
+        var ch = cursor[index];
+        if(!IsMathFunction(ch))
+            break;
+        
+        buffer[index] = ch;
+    }
+    buffer[index] = '\0';
+    
+    // 与原先比较int的方式一样，每个函数名只做一次4字节的比较
+    const var length = sizeof(legacyMathFuncNames) / sizeof(legacyMathFuncNames[0]);
+    for(typeof(length + 0) i = 0; i < length; i++)
+    {
+        if(memcmp(legacyMathFuncNames[i], buffer, sizeof(int)) == 0)
+        {
+            *pLength = index;
+            return (int)i;
+        }
+    }
+    
+    return -1;
+}
+
+/**
+ * 检查mathFuncList中的每个函数名是否都位于其哈希值所对应的位置，
+ * 然后在以函数调用为主的表达式上比较原先的顺序查找与完美哈希查找的性能，并测量整个表达式的求值速度
+ * @param count 参与性能测试的函数调用个数
+ * @return 若检查全部通过，返回0，否则返回1
+*/
+static int BenchmarkFunctionLookup(long count)
+{
+    long misplacedCount = 0;
+    var nameCount = 0;
+    for(var i = 0; i < MATH_FUNCTION_TABLE_SIZE; i++)
+    {
+        const var entry = &mathFuncList[i];
+        if(entry->length == 0)
+            continue;
+        
+        nameCount++;
+        var length = 0;
+        if(entry->length != (int)strlen(entry->name) || ParseMathFunctionIndex(entry->name, &length) != i || length != entry->length)
+        {
+            misplacedCount++;
+            printf("Function name %s does not match its hash slot %d\n", entry->name, i);
+        }
+    }
+    printf("Checked %d function names: %ld misplaced\n", nameCount, misplacedCount);
+    
+    // 为了比较两种查找方式，这里只使用原先就支持的函数名。每个调用形如sin(0.5)，调用之间以'+'分隔
+    const var legacyCount = sizeof(legacyMathFuncNames) / sizeof(legacyMathFuncNames[0]);
+    var text = (char*)malloc((size_t)count * 12 + 1);
+    var tokens = (const char**)malloc(sizeof(const char*) * count);
+    if(text == NULL || tokens == NULL)
+    {
+        free(text);
+        free(tokens);
+        return 1;
+    }
+    
+    uint64_t state = 20161220U;
+    size_t textLength = 0;
+    for(long i = 0; i < count; i++)
+    {
+        char name[sizeof(int) + 1] = { '\0' };
+        memcpy(name, legacyMathFuncNames[NextRandomNumber(&state) % legacyCount], sizeof(int));
+        
+        tokens[i] = &text[textLength];
+        textLength += sprintf(&text[textLength], "%s(0.%u)+", name, NextRandomNumber(&state) % 10);
+    }
+    text[--textLength] = '\0';
+    
+    long lengthSums[2] = { 0, 0 };
+    double times[2];
+    
+    for(var method = 0; method < 2; method++)
+    {
+        var beginTime = GetCurrentTimeInSeconds();
+        long sum = 0;
+        for(long i = 0; i < count; i++)
+        {
+            var length = 0;
+            var index = (method == 0)? ParseMathFunctionIndexLinearly(tokens[i], &length) : ParseMathFunctionIndex(tokens[i], &length);
+            if(index >= 0)
+                sum += length;
+        }
+        times[method] = GetCurrentTimeInSeconds() - beginTime;
+        lengthSums[method] = sum;
+    }
+    
+    var value = 0.0;
+    var beginTime = GetCurrentTimeInSeconds();
+    var isValid = EvaluateArithmeticSpan(text, textLength, false, MATH_KERNEL_SET_LIBM, NULL, &value, NULL, NULL);
+    var evaluationTime = GetCurrentTimeInSeconds() - beginTime;
+    
+    printf("Function calls: %ld, %zu bytes\n", count, textLength);
+    printf("Linear lookup:       %.2f ns/name\n", times[0] * 1e9 / count);
+    printf("Perfect hash lookup: %.2f ns/name\n", times[1] * 1e9 / count);
+    printf("Speedup:             %.2fx\n", times[0] / times[1]);
+    printf("Lookups identical: %s\n", lengthSums[0] == lengthSums[1]? "yes" : "no");
+    printf("Whole expression: %.2f ns/call, %.1f MB/s (%s)\n", evaluationTime * 1e9 / count, textLength / evaluationTime / (1 << 20), isValid? "valid" : "invalid");
+    
+    free(text);
+    free(tokens);
+    
+    return (misplacedCount == 0 && lengthSums[0] == lengthSums[1] && isValid)? 0 : 1;
+}
+
+/** 快速实现的一个测试区间 */
+static const struct MathKernelDomain
+{
+    const char *name;
+    double lower;
+    double upper;
+    
+    /** 是否按对数均匀分布抽样，否则按线性均匀分布抽样 */
+    bool isLogarithmic;
+    
+    /** 快速实现在该区间上的误差上界（ULP），与各实现的文档相符 */
+    double errorBound;
+} mathKernelDomains[] = {
+    { "sin", -M_PI, M_PI, false, 1.0 },
+    { "sin", -1e6, 1e6, false, 1.0 },
+    { "cos", -M_PI, M_PI, false, 1.0 },
+    { "cos", -1e6, 1e6, false, 1.0 },
+    { "tan", -M_PI_2, M_PI_2, false, 3.0 },
+    { "tan", -1e6, 1e6, false, 3.0 },
+    { "cot", -M_PI_2, M_PI_2, false, 3.0 },
+    { "cot", -1e6, 1e6, false, 3.0 },
+    { "exp", -1.0, 1.0, false, 1.0 },
+    { "exp", -745.0, 709.78, false, 1.0 },
+    { "ln", 0.5, 2.0, false, 1.0 },
+    { "ln", 1e-300, 1e300, true, 1.0 },
+    { "ln", 5e-324, 2.2e-308, true, 1.0 },
+    { "log2", 0.5, 2.0, false, 1.0 },
+    { "log2", 1e-300, 1e300, true, 1.0 },
+    { "lg", 0.5, 2.0, false, 1.0 },
+    { "lg", 1e-300, 1e300, true, 1.0 }
+};
+
+/** 以long double计算快速实现所对应的函数值，作为误差的参照 */
+static long double EvaluateMathKernelReference(enum FAST_MATH_KERNEL kernel, double x)
+{
+    switch(kernel)
+    {
+    case FAST_MATH_KERNEL_SIN:
+        return sinl(x);
+        
+    case FAST_MATH_KERNEL_COS:
+        return cosl(x);
+        
+    case FAST_MATH_KERNEL_TAN:
+        return tanl(x);
+        
+    case FAST_MATH_KERNEL_COT:
+        return cosl(x) / sinl(x);
+        
+    case FAST_MATH_KERNEL_EXP:
+        return expl(x);
+        
+    case FAST_MATH_KERNEL_LN:
+        return logl(x);
+        
+    case FAST_MATH_KERNEL_LOG2:
+        return log2l(x);
+        
+    case FAST_MATH_KERNEL_LOG10:
+        return log10l(x);
+        
+    default:
+        return NAN;
+    }
+}
+
+/** 计算value相对于参照值的误差，以参照值舍入到double之后的ULP为单位 */
+static double GetUlpError(double value, long double reference)
+{
+    if(isnan(value) || isnan(reference))
+        return (isnan(value) && isnan(reference))? 0.0 : INFINITY;
+    
+    var rounded = (double)reference;
+    if(isinf(rounded))
+        return (value == rounded)? 0.0 : INFINITY;
+    
+    var magnitude = fabs(rounded);
+    var ulp = nextafter(magnitude, INFINITY) - magnitude;
+    return (double)(fabsl((long double)value - reference) / ulp);
+}
+
+/**
+ * 在各个函数的定义域上抽样，以long double的结果为参照，比较libm与快速实现在标量调用以及按列求值时的最大误差与速度。
+ * 没有标量版本的函数在标量调用时仍使用libm；有标量版本的函数，其按列求值的结果还必须与标量版本逐位相同
+ * @param count 每个区间上的抽样个数
+ * @return 若快速实现的误差都不超过各自的上界，并且按列求值的结果一致，返回0，否则返回1
+*/
+static int BenchmarkMathKernels(long count)
+{
+    static const char *const variableNames[] = { "x" };
+    
+    var inputs = (double*)malloc(sizeof(double) * count);
+    var outputs = (double*)malloc(sizeof(double) * count);
+    var columnOutputs = (double*)malloc(sizeof(double) * count);
+    if(inputs == NULL || outputs == NULL || columnOutputs == NULL)
+    {
+        free(inputs);
+        free(outputs);
+        free(columnOutputs);
+        return 1;
+    }
+    
+    printf("Samples per domain: %ld, columns: %s\n", count, GetColumnInstructionSet() == COLUMN_INSTRUCTION_SET_AVX2? "AVX2" : "base instruction set");
+    printf("%-5s %-26s %9s %9s %9s %6s %8s %8s %8s %9s %9s %8s\n", "Func", "Domain", "libm ULP", "fast ULP", "col ULP", "bound",
+           "libm ns", "fast ns", "speedup", "col libm", "col fast", "speedup");
+    
+    var failureCount = 0;
+    uint64_t state = 20161220U;
+    for(size_t d = 0; d < sizeof(mathKernelDomains) / sizeof(mathKernelDomains[0]); d++)
+    {
+        const var domain = &mathKernelDomains[d];
+        var length = 0;
+        var index = ParseMathFunctionIndex(domain->name, &length);
+        const var kernel = &fastMathKernelList[index];
+        var libmFunc = mathFuncList[index].pFunc;
+        var fastFunc = GetMathFunction(index, MATH_KERNEL_SET_FAST);
+        
+        for(long i = 0; i < count; i++)
+        {
+            var fraction = (double)(((uint64_t)NextRandomNumber(&state) << 32 | NextRandomNumber(&state)) >> 11) * 0x1p-53;
+            if(domain->isLogarithmic)
+                inputs[i] = exp(log(domain->lower) + (log(domain->upper) - log(domain->lower)) * fraction);
+            else
+                inputs[i] = domain->lower + (domain->upper - domain->lower) * fraction;
+        }
+        
+        // 取3次中最快的一次，依次为libm与快速实现的标量调用、libm与快速实现的按列求值
+        double times[4] = { INFINITY, INFINITY, INFINITY, INFINITY };
+        char text[16];
+        snprintf(text, sizeof(text), "%s(x)", domain->name);
+        var program = CompileArithmeticExpression(text, variableNames, 1);
+        const double *columns[] = { inputs };
+        long mismatchCount = 0;
+        
+        for(var round = 0; round < 3 && program != NULL; round++)
+        {
+            for(var method = 0; method < 4; method++)
+            {
+                var beginTime = GetCurrentTimeInSeconds();
+                if(method < 2)
+                {
+                    var pFunc = (method == 0)? libmFunc : fastFunc;
+                    for(long i = 0; i < count; i++)
+                        outputs[i] = pFunc(inputs[i]);
+                }
+                else
+                    EvaluateArithmeticProgramColumnsWithKernels(program, columns, columnOutputs, count, (method == 2)? MATH_KERNEL_SET_LIBM : MATH_KERNEL_SET_FAST);
+                
+                var elapsedTime = GetCurrentTimeInSeconds() - beginTime;
+                if(elapsedTime < times[method])
+                    times[method] = elapsedTime;
+            }
+            
+            // 此时outputs与columnOutputs分别是快速实现的标量调用与按列求值结果
+            for(long i = 0; i < count && kernel->pFunc != NULL; i++)
+                mismatchCount += !IsSameResult(outputs[i], columnOutputs[i]);
+        }
+        
+        var libmError = 0.0;
+        var fastError = 0.0;
+        var columnError = 0.0;
+        for(long i = 0; i < count; i++)
+        {
+            var reference = EvaluateMathKernelReference(kernel->kernel, inputs[i]);
+            libmError = fmax(libmError, GetUlpError(libmFunc(inputs[i]), reference));
+            fastError = fmax(fastError, GetUlpError(outputs[i], reference));
+            columnError = fmax(columnError, GetUlpError(columnOutputs[i], reference));
+        }
+        
+        // 没有标量版本的函数在标量调用时使用libm，不受快速实现的误差上界约束
+        var isPassed = program != NULL && columnError <= domain->errorBound && mismatchCount == 0 &&
+                       (kernel->pFunc == NULL || fastError <= domain->errorBound);
+        if(!isPassed)
+            failureCount++;
+        
+        char range[64];
+        snprintf(range, sizeof(range), "[%.6g, %.6g]%s", domain->lower, domain->upper, domain->isLogarithmic? " log" : "");
+        printf("%-5s %-26s %9.3f %9.3f %9.3f %6.1f %8.2f %8.2f %7.2fx %9.2f %9.2f %7.2fx%s\n", domain->name, range, libmError, fastError, columnError, domain->errorBound,
+               times[0] * 1e9 / count, times[1] * 1e9 / count, times[0] / times[1], times[2] * 1e9 / count, times[3] * 1e9 / count, times[2] / times[3],
+               isPassed? "" : (mismatchCount != 0? "  (columns differ)" : "  (FAILED)"));
+        
+        DestroyArithmeticProgram(program);
+    }
+    
+    free(inputs);
+    free(outputs);
+    free(columnOutputs);
+    
+    printf("%s\n", failureCount == 0? "All fast kernels are within their error bounds" : "Some fast kernels exceed their error bounds");
+    return failureCount == 0? 0 : 1;
+}
+
+/** --bench-gradient所生成的表达式中各项的模板，每项引用两个相邻的变量，变量的取值都在0.5到2之间 */
+static const char *const gradientBenchTemplates[] = {
+    "sin(%s)*%s", "exp(%s/8)*cbrt(%s)", "sqrt(%s*%s+1)", "atan(%s/(1+%s^2))",
+    "ln(1+%s^2)*tanh(%s)", "%s^%s", "asinh(%s)/recp(2+%s)", "deg(%s)*cos(rad(%s))"
+};
+
+/**
+ * 用中心差分检查mathDerivativeList中的每个导数，每个函数在定义域内至少要检查一个点
+ * @return 不符合的函数个数
+*/
+static int CheckMathDerivatives(void)
+{
+    static const double points[] = { 0.35, 0.8, 1.7, 2.9 };
+    var failureCount = 0;
+    var functionCount = 0;
+    var pointCount = 0;
+    
+    for(var i = 0; i < MATH_FUNCTION_TABLE_SIZE; i++)
+    {
+        if(mathFuncList[i].length == 0)
+            continue;
+        
+        var pFunc = mathFuncList[i].pFunc;
+        var checkedCount = 0;
+        var isFailed = false;
+        for(var j = 0; j < (int)(sizeof(points) / sizeof(points[0])); j++)
+        {
+            var x = points[j];
+            var h = 1e-5 * x;
+            var forward = pFunc(x + h);
+            var backward = pFunc(x - h);
+            if(!isfinite(forward) || !isfinite(backward))
+                continue;
+            
+            var expected = (forward - backward) / (2.0 * h);
+            var derivative = mathDerivativeList[i].pDerivative(x, pFunc(x));
+            if(!(fabs(derivative - expected) <= 1e-7 * fmax(1.0, fabs(expected))))
+            {
+                printf("Derivative of %s at %g: %.17g, central difference %.17g\n", mathFuncList[i].name, x, derivative, expected);
+                isFailed = true;
+            }
+            checkedCount++;
+        }
+        
+        if(checkedCount == 0)
+        {
+            printf("Derivative of %s: no point checked\n", mathFuncList[i].name);
+            isFailed = true;
+        }
+        functionCount++;
+        pointCount += checkedCount;
+        failureCount += isFailed;
+    }
+    
+    printf("Derivative table: %d functions, %d points checked against central differences, %d failures\n", functionCount, pointCount, failureCount);
+    return failureCount;
+}
+
+/**
+ * 比较前向自动微分与中心差分求梯度的速度与精度。
+ * 表达式由gradientBenchTemplates中的各项轮流相加而成，共有variableCount个变量；
+ * 中心差分对每行需要求值2 * variableCount + 1次，自动微分则只需一次
+ * @param variableCount 变量个数
+ * @param rowCount 行数
+ * @return 若导数表、值以及按列求值的结果都正确，返回0，否则返回1，若存储空间不足，返回2
+*/
+static int BenchmarkGradient(int variableCount, long rowCount)
+{
+    var status = (CheckMathDerivatives() == 0)? 0 : 1;
+    
+    var templateCount = (int)(sizeof(gradientBenchTemplates) / sizeof(gradientBenchTemplates[0]));
+    var names = (char(*)[16])malloc(sizeof(char[16]) * variableCount);
+    var namePointers = (const char**)malloc(sizeof(char*) * variableCount);
+    var expr = (char*)malloc(64 * (size_t)variableCount + 1);
+    var inputs = (double*)malloc(sizeof(double) * rowCount * variableCount);
+    var values = (double*)malloc(sizeof(double) * rowCount);
+    var gradients = (double*)malloc(sizeof(double) * rowCount * variableCount);
+    var columnValues = (double*)malloc(sizeof(double) * rowCount);
+    var columnGradients = (double*)malloc(sizeof(double) * rowCount * variableCount);
+    var columns = (const double**)malloc(sizeof(double*) * variableCount);
+    var gradientColumns = (double**)malloc(sizeof(double*) * variableCount);
+    var bindings = (double*)malloc(sizeof(double) * variableCount);
+    var gradient = (double*)malloc(sizeof(double) * variableCount);
+    struct ArithmeticProgram *program = NULL;
+    if(names == NULL || namePointers == NULL || expr == NULL || inputs == NULL || values == NULL || gradients == NULL ||
+       columnValues == NULL || columnGradients == NULL || columns == NULL || gradientColumns == NULL || bindings == NULL || gradient == NULL)
+        status = 2;
+    
+    if(status != 2)
+    {
+        var length = 0;
+        for(var k = 0; k < variableCount; k++)
+        {
+            snprintf(names[k], sizeof(names[k]), "x%d", k + 1);
+            namePointers[k] = names[k];
+        }
+        for(var k = 0; k < variableCount; k++)
+        {
+            if(k > 0)
+                expr[length++] = '+';
+            length += sprintf(&expr[length], gradientBenchTemplates[k % templateCount], names[k], names[(k + 1) % variableCount]);
+        }
+        
+        program = CompileArithmeticExpression(expr, namePointers, variableCount);
+        if(program == NULL)
+            status = 2;
+    }
+    
+    if(status != 2)
+    {
+        // 输入按列存放，第k列为第k个变量
+        uint64_t state = 20161220U;
+        for(var k = 0; k < variableCount; k++)
+        {
+            columns[k] = &inputs[rowCount * k];
+            gradientColumns[k] = &columnGradients[rowCount * k];
+            for(long i = 0; i < rowCount; i++)
+                inputs[rowCount * k + i] = 0.5 + NextRandomNumber(&state) / 4294967296.0 * 1.5;
+        }
+        
+        printf("Expression: %s\n", variableCount <= 8? expr : "(generated)");
+        printf("Variables: %d, rows: %ld\n", variableCount, rowCount);
+        
+        // 前向自动微分
+        var beginTime = GetCurrentTimeInSeconds();
+        for(long i = 0; i < rowCount && status != 2; i++)
+        {
+            for(var k = 0; k < variableCount; k++)
+                bindings[k] = columns[k][i];
+            if(!EvaluateArithmeticProgramGradient(program, bindings, &values[i], &gradients[variableCount * i]))
+                status = 2;
+        }
+        var dualTime = GetCurrentTimeInSeconds() - beginTime;
+        
+        // 中心差分，步长取机器精度的立方根，使截断误差与舍入误差大致相当
+        var maxError = 0.0;
+        long valueMismatchCount = 0;
+        beginTime = GetCurrentTimeInSeconds();
+        for(long i = 0; i < rowCount; i++)
+        {
+            for(var k = 0; k < variableCount; k++)
+                bindings[k] = columns[k][i];
+            var value = EvaluateArithmeticProgram(program, bindings);
+            valueMismatchCount += !IsSameResult(value, values[i]);
+            
+            for(var k = 0; k < variableCount; k++)
+            {
+                var x = bindings[k];
+                var h = cbrt(DBL_EPSILON) * fmax(1.0, fabs(x));
+                bindings[k] = x + h;
+                var forward = EvaluateArithmeticProgram(program, bindings);
+                bindings[k] = x - h;
+                var backward = EvaluateArithmeticProgram(program, bindings);
+                bindings[k] = x;
+                gradient[k] = (forward - backward) / (2.0 * h);
+            }
+            
+            for(var k = 0; k < variableCount; k++)
+            {
+                var exact = gradients[variableCount * i + k];
+                var error = fabs(gradient[k] - exact) / fmax(1.0, fabs(exact));
+                if(error > maxError)
+                    maxError = error;
+            }
+        }
+        var differenceTime = GetCurrentTimeInSeconds() - beginTime;
+        
+        beginTime = GetCurrentTimeInSeconds();
+        if(!EvaluateArithmeticProgramGradientColumns(program, columns, columnValues, gradientColumns, rowCount))
+            status = 2;
+        var columnTime = GetCurrentTimeInSeconds() - beginTime;
+        
+        long columnMismatchCount = 0;
+        for(long i = 0; i < rowCount && status != 2; i++)
+        {
+            columnMismatchCount += !IsSameResult(columnValues[i], values[i]);
+            for(var k = 0; k < variableCount; k++)
+                columnMismatchCount += !IsSameResult(gradientColumns[k][i], gradients[variableCount * i + k]);
+        }
+        
+        printf("central differences (%d evaluations): %10.1f ns/gradient, max relative error %.1e\n", 2 * variableCount + 1, differenceTime * 1e9 / rowCount, maxError);
+        printf("forward-mode, one row at a time:   %10.1f ns/gradient, %.1fx faster\n", dualTime * 1e9 / rowCount, differenceTime / dualTime);
+        printf("forward-mode, columns:             %10.1f ns/gradient, %.1fx faster\n", columnTime * 1e9 / rowCount, differenceTime / columnTime);
+        printf("Values identical to EvaluateArithmeticProgram: %s, columns identical to rows: %s\n",
+               valueMismatchCount == 0? "yes" : "no", columnMismatchCount == 0? "yes" : "no");
+        if(status == 0 && (valueMismatchCount > 0 || columnMismatchCount > 0))
+            status = 1;
+    }
+    
+    if(status == 2)
+        fputs("Out of memory!\n", stderr);
+    
+    DestroyArithmeticProgram(program);
+    free(names);
+    free(namePointers);
+    free(expr);
+    free(inputs);
+    free(values);
+    free(gradients);
+    free(columnValues);
+    free(columnGradients);
+    free(columns);
+    free(gradientColumns);
+    free(bindings);
+    free(gradient);
+    
+    return status;
+}
+
+/** 批处理模式下输入输出缓存的大小 */
+#define BATCH_STREAM_BUFFER_SIZE    (1 << 20)
+
+/** 批处理模式所使用的输出缓存，所有结果先写入缓存，缓存满了之后再一次性写出 */
+struct OutputBuffer
+{
+    FILE *stream;
+    char *data;
+    size_t length;
+    size_t capacity;
+};
+
+/** 将输出缓存中的内容全部写出 */
+static void FlushOutputBuffer(struct OutputBuffer *buffer)
+{
+    if(buffer->length > 0)
+    {
+        fwrite(buffer->data, 1, buffer->length, buffer->stream);
+        buffer->length = 0;
+    }
+    fflush(buffer->stream);
+}
+
+/** 往输出缓存中追加指定长度的文本 */
+static void AppendOutput(struct OutputBuffer *buffer, const char *text, size_t length)
+{
+    if(buffer->length + length > buffer->capacity)
+    {
+        FlushOutputBuffer(buffer);
+        
+        // 超过整个缓存容量的文本直接写出
+        if(length > buffer->capacity)
+        {
+            fwrite(text, 1, length, buffer->stream);
+            return;
+        }
+    }
+    
+    memcpy(&buffer->data[buffer->length], text, length);
+    buffer->length += length;
+}
+
+/**
+ * 计算一行算术表达式，并将结果或者错误信息作为一行输出
+ * @param line 当前行的内容，计算过程中会被修改
+ * @param length 当前行的长度，不包括换行符
+ * @param lineNumber 当前行的行号，从1开始
+ * @param format 结果的格式化方式，若使用了结果缓存，则以缓存所指定的格式化方式为准
+ * @param cache 结果缓存，若为NULL，则不使用缓存
+ * @param output 输出缓存
+ * @return 若表达式计算成功，返回true，否则返回false
+*/
+static bool ProcessBatchLine(char line[], size_t length, long lineNumber, const struct ResultFormat *format, struct ResultCache *cache, struct OutputBuffer *output)
+{
+    // 去掉行末的回车符，以兼容Windows格式的换行
+    if(length > 0 && line[length - 1] == '\r')
+        line[--length] = '\0';
+    
+    char result[64];
+    const char *errorMessage = NULL;
+    
+    if(!(cache != NULL? CalculateArithmeticExpressionCached(cache, line, result) : CalculateArithmeticExpressionWithFormat(line, format, result)))
+        errorMessage = (length == 0)? "empty expression" : "invalid expression";
+    
+    if(errorMessage == NULL)
+    {
+        var resultLength = strlen(result);
+        result[resultLength++] = '\n';
+        AppendOutput(output, result, resultLength);
+        return true;
+    }
+    
+    var messageLength = snprintf(result, sizeof(result), "error: line %ld: %s\n", lineNumber, errorMessage);
+    AppendOutput(output, result, messageLength);
+    return false;
+}
+
+/** 在标准错误输出中打印结果缓存的统计信息 */
+static void PrintResultCacheStatistics(struct ResultCache *cache)
+{
+    if(cache == NULL)
+        return;
+    
+    struct ResultCacheStatistics statistics;
+    GetResultCacheStatistics(cache, &statistics);
+    
+    var lookupCount = statistics.hitCount + statistics.missCount;
+    fprintf(stderr, "Cache: %ld hits, %ld misses, %ld evictions, hit rate %.1f%%, %ld/%ld entries\n",
+            statistics.hitCount, statistics.missCount, statistics.evictionCount,
+            lookupCount > 0? statistics.hitCount * 100.0 / lookupCount : 0.0, statistics.entryCount, statistics.capacity);
+}
+
+/**
+ * 批处理模式：逐行读取算术表达式并计算，每行输出一个结果。
+ * 非法的表达式不会中断处理，而是在对应的输出行中给出错误信息。
+ * 处理结束后，在标准错误输出中打印行数以及吞吐量
+ * @param path 输入文件的路径，若为NULL或者"-"，则从标准输入读取
+ * @param format 结果的格式化方式
+ * @param cache 结果缓存，若为NULL，则不使用缓存
+ * @return 若所有行均计算成功，返回0；若存在非法行，返回1；若无法打开文件，返回2
+*/
+static int RunBatchMode(const char *path, const struct ResultFormat *format, struct ResultCache *cache)
+{
+    var input = stdin;
+    if(path != NULL && strcmp(path, "-") != 0)
+    {
+        input = fopen(path, "r");
+        if(input == NULL)
+        {
+            fprintf(stderr, "Cannot open file: %s\n", path);
+            return 2;
+        }
+    }
+    setvbuf(input, NULL, _IOFBF, BATCH_STREAM_BUFFER_SIZE);
+    
+    struct OutputBuffer output = { .stream = stdout, .capacity = BATCH_STREAM_BUFFER_SIZE };
+    output.data = (char*)malloc(output.capacity);
+    if(output.data == NULL)
+    {
+        if(input != stdin)
+            fclose(input);
+        return 2;
+    }
+    
+    char *line = NULL;
+    size_t lineCapacity = 0;
+    ssize_t lineLength;
+    long lineCount = 0;
+    long invalidCount = 0;
+    
+    var beginTime = GetCurrentTimeInSeconds();
+    
+    while((lineLength = getline(&line, &lineCapacity, input)) >= 0)
+    {
+        if(lineLength > 0 && line[lineLength - 1] == '\n')
+            line[--lineLength] = '\0';
+        
+        if(!ProcessBatchLine(line, lineLength, ++lineCount, format, cache, &output))
+            invalidCount++;
+    }
+    
+    FlushOutputBuffer(&output);
+    
+    var elapsedTime = GetCurrentTimeInSeconds() - beginTime;
+    
+    fprintf(stderr, "Processed %ld lines (%ld invalid) in %.3f s, %.0f lines/sec\n",
+            lineCount, invalidCount, elapsedTime, elapsedTime > 0.0? lineCount / elapsedTime : 0.0);
+    PrintResultCacheStatistics(cache);
+    
+    free(line);
+    free(output.data);
+    if(input != stdin)
+        fclose(input);
+    
+    return invalidCount > 0? 1 : 0;
+}
+
+/** 并行批处理时每个任务块所包含的行数 */
+#define PARALLEL_BATCH_CHUNK_LINES      256
+
+/** 并行批处理时每次从输入中读取的数据量 */
+#define PARALLEL_BATCH_WINDOW_SIZE      (16 << 20)
+
+/** ProcessBatchLine每次输出的一行文本（包括错误信息）都不会超过该长度 */
+#define BATCH_MAX_OUTPUT_LINE_LENGTH    64
+
+/** 并行批处理中的一个任务块 */
+struct BatchChunk
+{
+    /** 该块第一行在当前窗口行表中的索引 */
+    int firstLine;
+    int lineCount;
+    
+    /** 该块第一行的行号，用于错误信息 */
+    long firstLineNumber;
+    
+    /** 该块中非法行的个数 */
+    long invalidCount;
+    
+    /** 该块的输出，其容量足以容纳整块的结果，因此不会关联任何输出流 */
+    struct OutputBuffer output;
+};
+
+/** 并行批处理的上下文，描述当前窗口中已切分好的各行以及任务块 */
+struct ParallelBatch
+{
+    /** 各行的起始地址，每行都已经以'\0'结尾 */
+    char **lines;
+    int lineCount;
+    int lineCapacity;
+    
+    /** 当前窗口第一行的行号 */
+    long firstLineNumber;
+    
+    struct BatchChunk *chunks;
+    int chunkCount;
+    int chunkCapacity;
+    
+    /** 结果的格式化方式 */
+    const struct ResultFormat *format;
+    
+    /** 各工作线程共用的结果缓存，若为NULL，则不使用缓存 */
+    struct ResultCache *cache;
+};
+
+static void ProcessBatchChunk(void *context, int taskIndex)
+{
+    var batch = (struct ParallelBatch*)context;
+    var chunk = &batch->chunks[taskIndex];
+    
+    chunk->output.length = 0;
+    chunk->invalidCount = 0;
+    
+    for(var i = 0; i < chunk->lineCount; i++)
+    {
+        var lineIndex = chunk->firstLine + i;
+        var line = batch->lines[lineIndex];
+        if(!ProcessBatchLine(line, strlen(line), chunk->firstLineNumber + i, batch->format, batch->cache, &chunk->output))
+            chunk->invalidCount++;
+    }
+}
+
+/**
+ * 确保批处理上下文中至少有chunkCount个任务块，每个任务块的输出缓存都足以容纳整块的结果
+ * @return 若存储空间不足，返回false
+*/
+static bool ReserveBatchChunks(struct ParallelBatch *batch, int chunkCount)
+{
+    if(chunkCount <= batch->chunkCapacity)
+        return true;
+    
+    var chunks = (struct BatchChunk*)realloc(batch->chunks, sizeof(struct BatchChunk) * chunkCount);
+    if(chunks == NULL)
+        return false;
+    
+    for(var i = batch->chunkCapacity; i < chunkCount; i++)
+    {
+        chunks[i] = (struct BatchChunk){ .output.capacity = PARALLEL_BATCH_CHUNK_LINES * BATCH_MAX_OUTPUT_LINE_LENGTH };
+        chunks[i].output.data = (char*)malloc(chunks[i].output.capacity);
+        if(chunks[i].output.data == NULL)
+        {
+            batch->chunks = chunks;
+            batch->chunkCapacity = i;
+            return false;
+        }
+    }
+    batch->chunks = chunks;
+    batch->chunkCapacity = chunkCount;
+    
+    return true;
+}
+
+/**
+ * 用线程池并行计算批处理上下文中当前的所有行，并按输入顺序将结果写入输出缓存
+ * @return 非法行的个数，若存储空间不足，返回-1
+*/
+static long EvaluateParallelBatch(struct WorkerPool *pool, struct ParallelBatch *batch, struct OutputBuffer *output)
+{
+    var chunkCount = (batch->lineCount + PARALLEL_BATCH_CHUNK_LINES - 1) / PARALLEL_BATCH_CHUNK_LINES;
+    if(!ReserveBatchChunks(batch, chunkCount))
+        return -1;
+    
+    for(var i = 0; i < chunkCount; i++)
+    {
+        batch->chunks[i].firstLine = i * PARALLEL_BATCH_CHUNK_LINES;
+        batch->chunks[i].lineCount = (i == chunkCount - 1)? batch->lineCount - i * PARALLEL_BATCH_CHUNK_LINES : PARALLEL_BATCH_CHUNK_LINES;
+        batch->chunks[i].firstLineNumber = batch->firstLineNumber + batch->chunks[i].firstLine;
+    }
+    batch->chunkCount = chunkCount;
+    
+    RunWorkerPoolTasks(pool, chunkCount, ProcessBatchChunk, batch);
+    
+    // 按块的顺序输出，从而保证输出顺序与输入顺序一致
+    var invalidCount = 0L;
+    for(var i = 0; i < chunkCount; i++)
+    {
+        var chunk = &batch->chunks[i];
+        if(output != NULL)
+            AppendOutput(output, chunk->output.data, chunk->output.length);
+        invalidCount += chunk->invalidCount;
+    }
+    
+    return invalidCount;
+}
+
+/** 释放批处理上下文中的行表以及任务块 */
+static void DestroyParallelBatch(struct ParallelBatch *batch)
+{
+    for(var i = 0; i < batch->chunkCapacity; i++)
+        free(batch->chunks[i].output.data);
+    free(batch->chunks);
+    free(batch->lines);
+}
+
+/**
+ * 将data中的内容按换行符切分成行，追加到批处理上下文的行表中。
+ * 每个换行符都会被替换为'\0'
+ * @param data 需要切分的数据
+ * @param length 数据长度，其中最后一个字符必须是换行符
+ * @return 若成功，返回true，若存储空间不足，返回false
+*/
+static bool SplitBatchLines(struct ParallelBatch *batch, char *data, size_t length)
+{
+    var cursor = data;
+    var end = data + length;
+    
+    while(cursor < end)
+    {
+        var newline = (char*)memchr(cursor, '\n', end - cursor);
+        
+        if(batch->lineCount == batch->lineCapacity)
+        {
+            var capacity = batch->lineCapacity == 0? 4096 : batch->lineCapacity * 2;
+            var lines = (char**)realloc(batch->lines, sizeof(char*) * capacity);
+            if(lines == NULL)
+                return false;
+            batch->lines = lines;
+            batch->lineCapacity = capacity;
+        }
+        
+        *newline = '\0';
+        batch->lines[batch->lineCount++] = cursor;
+        cursor = newline + 1;
+    }
+    
+    return true;
+}
+
+/**
+ * 并行批处理模式：与RunBatchMode的输入输出格式完全相同，
+ * 但每次读入一大块数据，切分成若干任务块之后交由工作线程池并行计算
+ * @param path 输入文件的路径，若为NULL或者"-"，则从标准输入读取
+ * @param threadCount 工作线程个数，若不大于0，则使用当前在线的处理器核数
+ * @param format 结果的格式化方式
+ * @param cache 结果缓存，若为NULL，则不使用缓存
+ * @return 若所有行均计算成功，返回0；若存在非法行，返回1；若无法打开文件或者存储空间不足，返回2
+*/
+static int RunParallelBatchMode(const char *path, int threadCount, const struct ResultFormat *format, struct ResultCache *cache)
+{
+    var input = stdin;
+    if(path != NULL && strcmp(path, "-") != 0)
+    {
+        input = fopen(path, "rb");
+        if(input == NULL)
+        {
+            fprintf(stderr, "Cannot open file: %s\n", path);
+            return 2;
+        }
+    }
+    
+    struct WorkerPool pool;
+    struct ParallelBatch batch = { .firstLineNumber = 1, .format = format, .cache = cache };
+    struct OutputBuffer output = { .stream = stdout, .capacity = BATCH_STREAM_BUFFER_SIZE };
+    
+    size_t windowCapacity = PARALLEL_BATCH_WINDOW_SIZE;
+    var window = (char*)malloc(windowCapacity + 1);
+    output.data = (char*)malloc(output.capacity);
+    
+    if(window == NULL || output.data == NULL || !CreateWorkerPool(&pool, threadCount))
+    {
+        free(window);
+        free(output.data);
+        if(input != stdin)
+            fclose(input);
+        return 2;
+    }
+    
+    // 上一个窗口末尾尚不完整的那一行会被移到窗口起始处，其长度记录在carryLength中
+    size_t carryLength = 0;
+    long lineCount = 0;
+    long invalidCount = 0;
+    var isEndOfFile = false;
+    var isOutOfMemory = false;
+    
+    var beginTime = GetCurrentTimeInSeconds();
+    
+    while(!isEndOfFile && !isOutOfMemory)
+    {
+        var readLength = fread(window + carryLength, 1, windowCapacity - carryLength, input);
+        var dataLength = carryLength + readLength;
+        isEndOfFile = readLength < windowCapacity - carryLength;
+        
+        // 最后一行可能没有换行符，这里为其补上一个
+        if(isEndOfFile && dataLength > 0 && window[dataLength - 1] != '\n')
+            window[dataLength++] = '\n';
+        
+        // 找到当前窗口中最后一个换行符，其后的内容留到下一个窗口处理
+        var completeLength = dataLength;
+        while(completeLength > 0 && window[completeLength - 1] != '\n')
+            completeLength--;
+        
+        if(completeLength == 0 && !isEndOfFile)
+        {
+            // 整个窗口里都没有一个完整的行，那么扩大窗口后继续读取
+            var newWindow = (char*)realloc(window, windowCapacity * 2 + 1);
+            if(newWindow == NULL)
+            {
+                isOutOfMemory = true;
+                break;
+            }
+            window = newWindow;
+            windowCapacity *= 2;
+            carryLength = dataLength;
+            continue;
+        }
+        
+        batch.lineCount = 0;
+        if(!SplitBatchLines(&batch, window, completeLength))
+        {
+            isOutOfMemory = true;
+            break;
+        }
+        
+        var count = EvaluateParallelBatch(&pool, &batch, &output);
+        if(count < 0)
+        {
+            isOutOfMemory = true;
+            break;
+        }
+        invalidCount += count;
+        lineCount += batch.lineCount;
+        batch.firstLineNumber += batch.lineCount;
+        
+        carryLength = dataLength - completeLength;
+        memmove(window, window + completeLength, carryLength);
+    }
+    
+    FlushOutputBuffer(&output);
+    
+    var elapsedTime = GetCurrentTimeInSeconds() - beginTime;
+    
+    if(isOutOfMemory)
+        fputs("Out of memory!\n", stderr);
+    
+    fprintf(stderr, "Processed %ld lines (%ld invalid) with %d threads in %.3f s, %.0f lines/sec\n",
+            lineCount, invalidCount, pool.threadCount, elapsedTime, elapsedTime > 0.0? lineCount / elapsedTime : 0.0);
+    PrintResultCacheStatistics(cache);
+    
+    DestroyWorkerPool(&pool);
+    DestroyParallelBatch(&batch);
+    free(window);
+    free(output.data);
+    if(input != stdin)
+        fclose(input);
+    
+    if(isOutOfMemory)
+        return 2;
+    
+    return invalidCount > 0? 1 : 0;
+}
+
+/**
+ * 生成用于性能测试的算术表达式语料，每行一个表达式，各行的计算量相差悬殊，
+ * 既有1+2这样的简单表达式，也有多层嵌套的pow与sin调用
+ * @param lineCount 需要生成的行数
+ * @param pLength 输出语料的总长度
+ * @return 语料内容，使用完毕后需用free释放
+*/
+static char* GenerateBatchBenchmarkCorpus(long lineCount, size_t *pLength)
+{
+    size_t capacity = (size_t)lineCount * 160 + 1;
+    var corpus = (char*)malloc(capacity);
+    if(corpus == NULL)
+        return NULL;
+    
+    size_t length = 0;
+    var seed = 20161220U;
+    
+    for(long i = 0; i < lineCount; i++)
+    {
+        seed = seed * 1103515245U + 12345U;
+        var kind = (seed >> 16) % 8;
+        var a = (int)((seed >> 8) % 97) + 1;
+        var b = (int)((seed >> 4) % 89) + 2;
+        
+        if(kind < 5)
+            length += sprintf(corpus + length, "%d+%d\n", a, b);
+        else if(kind < 7)
+            length += sprintf(corpus + length, "%d*[%d-%d]/%d+%d%%7\n", a, b, a, b, a);
+        else
+        {
+            // 嵌套的幂运算与三角函数调用，计算量大约是简单表达式的数十倍
+            length += sprintf(corpus + length, "sin[cos[sqrt[%d]$1.5]]*exp[ln[%d]]+tanh[sin[%d.5$0.5]]$2-cbrt[%d]*asnh[sin[rad[%d]]]\n", a, b, a, b, a);
+        }
+    }
+    
+    *pLength = length;
+    return corpus;
+}
+
+/**
+ * 并行批处理的扩展性测试：对同一份语料分别使用1、2、4……直到最大线程数个线程进行计算，
+ * 并报告各自的吞吐量以及相对于单线程的加速比
+ * @param lineCount 语料的行数
+ * @param maxThreadCount 最大线程数，若不大于0，则使用当前在线的处理器核数
+ * @return 若测试成功完成，返回0，否则返回2
+*/
+static int BenchmarkParallelBatch(long lineCount, int maxThreadCount)
+{
+    size_t length = 0;
+    var corpus = GenerateBatchBenchmarkCorpus(lineCount, &length);
+    if(corpus == NULL)
+        return 2;
+    
+    var processorCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(maxThreadCount <= 0)
+        maxThreadCount = processorCount > 0? processorCount : 1;
+    
+    printf("Corpus: %ld lines, %zu bytes, %d online processors\n", lineCount, length, processorCount);
+    
+    struct ParallelBatch batch = { .firstLineNumber = 1 };
+    if(!SplitBatchLines(&batch, corpus, length))
+    {
+        free(corpus);
+        return 2;
+    }
+    
+    var singleThreadRate = 0.0;
+    
+    for(var threadCount = 1; ; threadCount *= 2)
+    {
+        if(threadCount > maxThreadCount)
+            threadCount = maxThreadCount;
+        
+        struct WorkerPool pool;
+        if(!CreateWorkerPool(&pool, threadCount))
+            break;
+        
+        // 表达式的过滤操作会原地修改语料，但它是幂等的，所以同一份语料可以被反复计算
+        var beginTime = GetCurrentTimeInSeconds();
+        var invalidCount = EvaluateParallelBatch(&pool, &batch, NULL);
+        var elapsedTime = GetCurrentTimeInSeconds() - beginTime;
+        
+        DestroyWorkerPool(&pool);
+        
+        if(invalidCount < 0)
+            break;
+        
+        var rate = lineCount / elapsedTime;
+        if(threadCount == 1)
+            singleThreadRate = rate;
+        
+        printf("%3d threads: %.3f s, %12.0f lines/sec, speedup %.2fx, efficiency %.0f%%\n",
+               threadCount, elapsedTime, rate, rate / singleThreadRate, rate / singleThreadRate / threadCount * 100.0);
+        
+        if(threadCount == maxThreadCount)
+            break;
+    }
+    
+    DestroyParallelBatch(&batch);
+    free(corpus);
+    
+    return 0;
+}
+
+#if defined(__linux__)
+
+/** 守护进程每轮事件中从一个连接最多读取的字节数，以免一个连接独占事件循环 */
+#define SERVER_READ_SIZE                (64 << 10)
+
+/** 一行请求的最大长度，超出时返回错误信息并关闭连接 */
+#define SERVER_MAX_LINE_LENGTH          (16 << 20)
+
+/** 连接中尚未发出的结果超过该字节数时，暂停读取该连接的请求，直到对端取走结果 */
+#define SERVER_MAX_PENDING_OUTPUT       (4 << 20)
+
+/** epoll_wait每次最多返回的事件个数 */
+#define SERVER_MAX_EVENTS               256
+
+/** 守护进程默认的结果缓存容量 */
+#define SERVER_DEFAULT_CACHE_CAPACITY   65536
+
+/** 守护进程的一个客户端连接 */
+struct ServerConnection
+{
+    int fd;
+    
+    /** 已经处理过的请求行数，用于错误信息中的行号 */
+    long lineCount;
+    
+    /** 已经读入但尚未处理的请求，末尾可能是一行不完整的请求 */
+    char *input;
+    size_t inputLength;
+    size_t inputCapacity;
+    
+    /** 尚未发出的结果，[outputOffset, outputLength)之间的部分有待发送 */
+    char *output;
+    size_t outputOffset;
+    size_t outputLength;
+    size_t outputCapacity;
+    
+    /** 本轮事件中已经切分到行表中的字节数，计算完成之后再从输入缓存中移走 */
+    size_t processedLength;
+    
+    /** 当前在epoll中所关注的事件 */
+    uint32_t events;
+    
+    /** 对端已经关闭了写入，发送完所有结果之后即关闭连接 */
+    bool isEndOfInput;
+    
+    /** 本轮事件中是否读到了新的请求 */
+    bool isReady;
+    
+    /** 存储空间不足，无法继续处理该连接的请求 */
+    bool isBroken;
+    
+    /** 所有连接组成的双向链表 */
+    struct ServerConnection *previous;
+    struct ServerConnection *next;
+};
+
+/** 守护进程的状态 */
+struct EvaluationServer
+{
+    int listenFd;
+    int epollFd;
+    
+    struct WorkerPool pool;
+    
+    /** 每轮事件中所有连接的完整请求行以及任务块，每个任务块只含有同一个连接的请求 */
+    struct ParallelBatch batch;
+    
+    /** 各个任务块所属的连接 */
+    struct ServerConnection **chunkConnections;
+    int chunkConnectionCapacity;
+    
+    /** 本轮事件中读到了新请求的连接 */
+    struct ServerConnection **readyConnections;
+    int readyCount;
+    int readyCapacity;
+    
+    /** 所有尚未关闭的连接 */
+    struct ServerConnection *connections;
+    
+    long connectionCount;
+    long requestCount;
+};
+
+/** 收到SIGINT或者SIGTERM之后，守护进程结束事件循环 */
+static volatile sig_atomic_t isServerStopping;
+
+static void StopEvaluationServer(int signalNumber)
+{
+    (void)signalNumber;
+    isServerStopping = 1;
+}
+
+/** 关闭连接并释放其资源 */
+static void CloseServerConnection(struct EvaluationServer *server, struct ServerConnection *connection)
+{
+    epoll_ctl(server->epollFd, EPOLL_CTL_DEL, connection->fd, NULL);
+    close(connection->fd);
+    
+    if(connection->previous != NULL)
+        connection->previous->next = connection->next;
+    else
+        server->connections = connection->next;
+    if(connection->next != NULL)
+        connection->next->previous = connection->previous;
+    
+    free(connection->input);
+    free(connection->output);
+    free(connection);
+}
+
+/** 根据连接的当前状态更新它在epoll中所关注的事件 */
+static void UpdateServerConnectionEvents(struct EvaluationServer *server, struct ServerConnection *connection)
+{
+    var pendingLength = connection->outputLength - connection->outputOffset;
+    uint32_t events = 0;
+    if(!connection->isEndOfInput && pendingLength <= SERVER_MAX_PENDING_OUTPUT)
+        events |= EPOLLIN;
+    if(pendingLength > 0)
+        events |= EPOLLOUT;
+    
+    if(events != connection->events)
+    {
+        var event = (struct epoll_event){ .events = events, .data.ptr = connection };
+        epoll_ctl(server->epollFd, EPOLL_CTL_MOD, connection->fd, &event);
+        connection->events = events;
+    }
+}
+
+/** 往连接的输出缓存中追加结果 */
+static bool AppendServerOutput(struct ServerConnection *connection, const char *data, size_t length)
+{
+    // 已经发出的部分不再需要，先将其丢弃
+    if(connection->outputOffset > 0 && connection->outputLength + length > connection->outputCapacity)
+    {
+        connection->outputLength -= connection->outputOffset;
+        memmove(connection->output, connection->output + connection->outputOffset, connection->outputLength);
+        connection->outputOffset = 0;
+    }
+    
+    if(connection->outputLength + length > connection->outputCapacity)
+    {
+        var capacity = connection->outputCapacity == 0? 4096 : connection->outputCapacity * 2;
+        while(capacity < connection->outputLength + length)
+            capacity *= 2;
+        var output = (char*)realloc(connection->output, capacity);
+        if(output == NULL)
+            return false;
+        connection->output = output;
+        connection->outputCapacity = capacity;
+    }
+    
+    memcpy(connection->output + connection->outputLength, data, length);
+    connection->outputLength += length;
+    return true;
+}
+
+/**
+ * 尽可能多地发出连接中尚未发出的结果，并更新其所关注的事件
+ * @return 若连接已被关闭，返回false
+*/
+static bool FlushServerConnection(struct EvaluationServer *server, struct ServerConnection *connection)
+{
+    while(connection->outputOffset < connection->outputLength)
+    {
+        var count = send(connection->fd, connection->output + connection->outputOffset,
+                         connection->outputLength - connection->outputOffset, MSG_NOSIGNAL);
+        if(count < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            
+            CloseServerConnection(server, connection);
+            return false;
+        }
+        connection->outputOffset += count;
+    }
+    
+    if(connection->outputOffset == connection->outputLength)
+        connection->outputOffset = connection->outputLength = 0;
+    
+    // 对端不再发送请求，并且所有结果都已发出
+    if(connection->isEndOfInput && connection->outputLength == 0 && connection->inputLength == 0)
+    {
+        CloseServerConnection(server, connection);
+        return false;
+    }
+    
+    UpdateServerConnectionEvents(server, connection);
+    return true;
+}
+
+/** 接受所有等待中的新连接 */
+static void AcceptServerConnections(struct EvaluationServer *server)
+{
+    for(;;)
+    {
+        var fd = accept(server->listenFd, NULL, NULL);
+        if(fd < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            break;
+        }
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        
+        var connection = (struct ServerConnection*)calloc(1, sizeof(struct ServerConnection));
+        if(connection == NULL)
+        {
+            close(fd);
+            continue;
+        }
+        connection->fd = fd;
+        connection->events = EPOLLIN;
+        
+        var event = (struct epoll_event){ .events = EPOLLIN, .data.ptr = connection };
+        if(epoll_ctl(server->epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+        {
+            close(fd);
+            free(connection);
+            continue;
+        }
+        connection->next = server->connections;
+        if(server->connections != NULL)
+            server->connections->previous = connection;
+        server->connections = connection;
+        server->connectionCount++;
+    }
+}
+
+/**
+ * 读取连接中的新请求，每轮最多读取SERVER_READ_SIZE个字节，余下的留到下一轮
+ * @return 若连接已被关闭，返回false
+*/
+static bool ReadServerConnection(struct EvaluationServer *server, struct ServerConnection *connection)
+{
+    size_t totalCount = 0;
+    
+    while(totalCount < SERVER_READ_SIZE)
+    {
+        // 多预留一个字节，以便在对端关闭时给最后一行补上换行符
+        if(connection->inputCapacity - connection->inputLength < SERVER_READ_SIZE / 4 + 1)
+        {
+            if(connection->inputLength > SERVER_MAX_LINE_LENGTH)
+            {
+                static const char message[] = "error: line too long\n";
+                send(connection->fd, message, sizeof(message) - 1, MSG_NOSIGNAL);
+                CloseServerConnection(server, connection);
+                return false;
+            }
+            var capacity = connection->inputCapacity == 0? SERVER_READ_SIZE : connection->inputCapacity * 2;
+            var input = (char*)realloc(connection->input, capacity);
+            if(input == NULL)
+            {
+                CloseServerConnection(server, connection);
+                return false;
+            }
+            connection->input = input;
+            connection->inputCapacity = capacity;
+        }
+        
+        var count = read(connection->fd, connection->input + connection->inputLength, connection->inputCapacity - connection->inputLength - 1);
+        if(count < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            
+            CloseServerConnection(server, connection);
+            return false;
+        }
+        
+        if(count == 0)
+        {
+            // 与批处理模式一样，最后一行可能没有换行符，这里为其补上一个
+            connection->isEndOfInput = true;
+            if(connection->inputLength > 0 && connection->input[connection->inputLength - 1] != '\n')
+                connection->input[connection->inputLength++] = '\n';
+            break;
+        }
+        connection->inputLength += count;
+        totalCount += count;
+    }
+    
+    if(!connection->isReady)
+    {
+        if(server->readyCount == server->readyCapacity)
+        {
+            var capacity = server->readyCapacity == 0? 64 : server->readyCapacity * 2;
+            var connections = (struct ServerConnection**)realloc(server->readyConnections, sizeof(struct ServerConnection*) * capacity);
+            if(connections == NULL)
+            {
+                CloseServerConnection(server, connection);
+                return false;
+            }
+            server->readyConnections = connections;
+            server->readyCapacity = capacity;
+        }
+        server->readyConnections[server->readyCount++] = connection;
+        connection->isReady = true;
+    }
+    
+    return true;
+}
+
+/**
+ * 计算本轮事件中所有连接已读入的完整请求，并按请求的顺序将结果写入各自的输出缓存。
+ * 同一连接的请求按顺序切分成任务块，所有连接的任务块一起交给工作线程池计算，
+ * 所以单个连接中流水线式发来的大量请求同样能被并行计算，而结果仍按请求的顺序返回
+*/
+static void ProcessServerRequests(struct EvaluationServer *server)
+{
+    var batch = &server->batch;
+    batch->lineCount = 0;
+    var chunkCount = 0;
+    
+    for(var i = 0; i < server->readyCount; i++)
+    {
+        var connection = server->readyConnections[i];
+        
+        // 只处理到最后一个换行符为止，其后不完整的一行留待后续的数据
+        var completeLength = connection->inputLength;
+        while(completeLength > 0 && connection->input[completeLength - 1] != '\n')
+            completeLength--;
+        if(completeLength == 0)
+            continue;
+        
+        // 切分时换行符已被替换为'\0'，之后若存储空间不足，该连接的请求便无法恢复，只能关闭连接
+        var firstLine = batch->lineCount;
+        var isSplit = SplitBatchLines(batch, connection->input, completeLength);
+        var lineCount = batch->lineCount - firstLine;
+        var connectionChunkCount = (lineCount + PARALLEL_BATCH_CHUNK_LINES - 1) / PARALLEL_BATCH_CHUNK_LINES;
+        var isReserved = isSplit && ReserveBatchChunks(batch, chunkCount + connectionChunkCount);
+        if(isReserved && batch->chunkCapacity > server->chunkConnectionCapacity)
+        {
+            var capacity = batch->chunkCapacity;
+            var connections = (struct ServerConnection**)realloc(server->chunkConnections, sizeof(struct ServerConnection*) * capacity);
+            if(connections != NULL)
+            {
+                server->chunkConnections = connections;
+                server->chunkConnectionCapacity = capacity;
+            }
+            else
+                isReserved = false;
+        }
+        if(!isReserved)
+        {
+            batch->lineCount = firstLine;
+            connection->isBroken = true;
+            continue;
+        }
+        
+        for(var offset = 0; offset < lineCount; offset += PARALLEL_BATCH_CHUNK_LINES)
+        {
+            var chunk = &batch->chunks[chunkCount];
+            chunk->firstLine = firstLine + offset;
+            chunk->lineCount = (lineCount - offset < PARALLEL_BATCH_CHUNK_LINES)? lineCount - offset : PARALLEL_BATCH_CHUNK_LINES;
+            chunk->firstLineNumber = connection->lineCount + offset + 1;
+            server->chunkConnections[chunkCount++] = connection;
+        }
+        
+        connection->lineCount += lineCount;
+        connection->processedLength = completeLength;
+        server->requestCount += lineCount;
+    }
+    batch->chunkCount = chunkCount;
+    
+    // 只有一个任务块时直接在事件循环中计算，以免唤醒工作线程所带来的延迟
+    if(chunkCount == 1)
+        ProcessBatchChunk(batch, 0);
+    else if(chunkCount > 1)
+        RunWorkerPoolTasks(&server->pool, chunkCount, ProcessBatchChunk, batch);
+    
+    for(var i = 0; i < chunkCount; i++)
+    {
+        var chunk = &batch->chunks[i];
+        if(!AppendServerOutput(server->chunkConnections[i], chunk->output.data, chunk->output.length))
+            server->chunkConnections[i]->isBroken = true;
+    }
+    
+    for(var i = 0; i < server->readyCount; i++)
+    {
+        var connection = server->readyConnections[i];
+        connection->isReady = false;
+        if(connection->isBroken)
+        {
+            CloseServerConnection(server, connection);
+            continue;
+        }
+        
+        // 将不完整的最后一行移到输入缓存的起始处
+        connection->inputLength -= connection->processedLength;
+        memmove(connection->input, connection->input + connection->processedLength, connection->inputLength);
+        connection->processedLength = 0;
+        
+        FlushServerConnection(server, connection);
+    }
+    server->readyCount = 0;
+}
+
+/**
+ * 计算守护进程：在Unix域套接字上监听，每个连接中的每一行都是一个算术表达式请求，
+ * 每个请求对应一行结果，格式与批处理模式相同。同一连接可以不等结果返回就连续发送多个请求，结果总是按请求的顺序返回。
+ * 事件循环基于epoll，各连接的请求由固定个数的工作线程计算，所有连接共用同一个结果缓存。
+ * 收到SIGINT或者SIGTERM之后停止服务，删除套接字文件并打印统计信息
+ * @param path 套接字文件的路径，若该路径上已有套接字文件，则将其替换
+ * @param threadCount 工作线程个数（包括事件循环线程自身），若不大于0，则使用当前在线的处理器核数
+ * @param format 结果的格式化方式
+ * @param cache 结果缓存，若为NULL，则不使用缓存
+ * @return 若正常结束，返回0，否则返回2
+*/
+static int RunEvaluationServer(const char *path, int threadCount, const struct ResultFormat *format, struct ResultCache *cache)
+{
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if(strlen(path) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return 2;
+    }
+    strcpy(address.sun_path, path);
+    
+    // 只删除遗留的套接字文件，而不会误删同名的普通文件
+    struct stat fileStatus;
+    if(stat(path, &fileStatus) == 0 && S_ISSOCK(fileStatus.st_mode))
+        unlink(path);
+    
+    struct EvaluationServer server = { .batch = { .format = format, .cache = cache } };
+    server.listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(server.listenFd < 0 || bind(server.listenFd, (const struct sockaddr*)&address, sizeof(address)) != 0 || listen(server.listenFd, SOMAXCONN) != 0)
+    {
+        fprintf(stderr, "Cannot listen on %s: %s\n", path, strerror(errno));
+        if(server.listenFd >= 0)
+            close(server.listenFd);
+        return 2;
+    }
+    
+    server.epollFd = epoll_create1(EPOLL_CLOEXEC);
+    var listenEvent = (struct epoll_event){ .events = EPOLLIN, .data.ptr = NULL };
+    if(server.epollFd < 0 || epoll_ctl(server.epollFd, EPOLL_CTL_ADD, server.listenFd, &listenEvent) != 0 || !CreateWorkerPool(&server.pool, threadCount))
+    {
+        fputs("Cannot start the event loop!\n", stderr);
+        if(server.epollFd >= 0)
+            close(server.epollFd);
+        close(server.listenFd);
+        unlink(path);
+        return 2;
+    }
+    
+    // 不使用SA_RESTART，使得epoll_wait能被信号打断
+    struct sigaction action = { .sa_handler = StopEvaluationServer };
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    
+    fprintf(stderr, "Listening on %s with %d threads\n", path, server.pool.threadCount);
+    var beginTime = GetCurrentTimeInSeconds();
+    
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    while(!isServerStopping)
+    {
+        var eventCount = epoll_wait(server.epollFd, events, SERVER_MAX_EVENTS, -1);
+        if(eventCount < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            break;
+        }
+        
+        for(var i = 0; i < eventCount; i++)
+        {
+            var connection = (struct ServerConnection*)events[i].data.ptr;
+            if(connection == NULL)
+            {
+                AcceptServerConnections(&server);
+                continue;
+            }
+            
+            if((events[i].events & EPOLLOUT) != 0 && !FlushServerConnection(&server, connection))
+                continue;
+            if((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0 && (connection->events & EPOLLIN) != 0)
+                ReadServerConnection(&server, connection);
+        }
+        
+        ProcessServerRequests(&server);
+    }
+    
+    var elapsedTime = GetCurrentTimeInSeconds() - beginTime;
+    fprintf(stderr, "Served %ld requests on %ld connections in %.3f s\n", server.requestCount, server.connectionCount, elapsedTime);
+    PrintResultCacheStatistics(cache);
+    
+    while(server.connections != NULL)
+        CloseServerConnection(&server, server.connections);
+    
+    DestroyWorkerPool(&server.pool);
+    DestroyParallelBatch(&server.batch);
+    free(server.chunkConnections);
+    free(server.readyConnections);
+    close(server.epollFd);
+    close(server.listenFd);
+    unlink(path);
+    
+    return 0;
+}
+
+/** 负载测试中一个客户端线程的参数与统计结果 */
+struct LoadClient
+{
+    const char *path;
+    
+    /** 请求所使用的表达式以及本地计算的期望结果，各客户端从不同的位置开始循环使用 */
+    char *const *lines;
+    char *const *expectedResults;
+    long lineCount;
+    long firstLine;
+    
+    long requestCount;
+    int pipelineDepth;
+    
+    /** 每个请求从发出到收到结果的秒数 */
+    double *latencies;
+    
+    long mismatchCount;
+    bool isFailed;
+};
+
+/** 将数据全部写入阻塞的套接字 */
+static bool SendAll(int fd, const char *data, size_t length)
+{
+    while(length > 0)
+    {
+        var count = send(fd, data, length, MSG_NOSIGNAL);
+        if(count < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            return false;
+        }
+        data += count;
+        length -= count;
+    }
+    return true;
+}
+
+/** 负载测试的客户端线程：始终保持pipelineDepth个请求在途，每收到一个结果就发出下一个请求 */
+static void* RunLoadClient(void *argument)
+{
+    var client = (struct LoadClient*)argument;
+    
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    strncpy(address.sun_path, client->path, sizeof(address.sun_path) - 1);
+    var fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    
+    var sendTimes = (double*)malloc(sizeof(double) * client->pipelineDepth);
+    size_t requestCapacity = (size_t)client->pipelineDepth * 256;
+    var requests = (char*)malloc(requestCapacity);
+    char response[65536];
+    
+    if(fd < 0 || sendTimes == NULL || requests == NULL || connect(fd, (const struct sockaddr*)&address, sizeof(address)) != 0)
+    {
+        client->isFailed = true;
+        if(fd >= 0)
+            close(fd);
+        free(sendTimes);
+        free(requests);
+        return NULL;
+    }
+    
+    long sentCount = 0;
+    long receivedCount = 0;
+    size_t responseLength = 0;
+    
+    while(receivedCount < client->requestCount)
+    {
+        // 补足在途的请求，一次写出
+        size_t requestLength = 0;
+        var now = GetCurrentTimeInSeconds();
+        while(sentCount < client->requestCount && sentCount - receivedCount < client->pipelineDepth)
+        {
+            var line = client->lines[(client->firstLine + sentCount) % client->lineCount];
+            var length = strlen(line);
+            if(requestLength + length + 1 > requestCapacity)
+                break;
+            memcpy(requests + requestLength, line, length);
+            requests[requestLength + length] = '\n';
+            requestLength += length + 1;
+            sendTimes[sentCount % client->pipelineDepth] = now;
+            sentCount++;
+        }
+        if(requestLength > 0 && !SendAll(fd, requests, requestLength))
+        {
+            client->isFailed = true;
+            break;
+        }
+        
+        var count = read(fd, response + responseLength, sizeof(response) - responseLength);
+        if(count <= 0)
+        {
+            if(count < 0 && errno == EINTR)
+                continue;
+            client->isFailed = true;
+            break;
+        }
+        responseLength += count;
+        now = GetCurrentTimeInSeconds();
+        
+        // 结果按请求的顺序返回，所以第receivedCount个结果对应第receivedCount个请求
+        var cursor = response;
+        var end = response + responseLength;
+        char *newline;
+        while((newline = (char*)memchr(cursor, '\n', end - cursor)) != NULL)
+        {
+            *newline = '\0';
+            var expected = client->expectedResults[(client->firstLine + receivedCount) % client->lineCount];
+            if(strcmp(cursor, expected) != 0 && client->mismatchCount++ < 3)
+                fprintf(stderr, "Unexpected response: %s (expected %s)\n", cursor, expected);
+            
+            client->latencies[receivedCount] = now - sendTimes[receivedCount % client->pipelineDepth];
+            receivedCount++;
+            cursor = newline + 1;
+        }
+        responseLength = (size_t)(end - cursor);
+        memmove(response, cursor, responseLength);
+    }
+    
+    close(fd);
+    free(sendTimes);
+    free(requests);
+    return NULL;
+}
+
+static int CompareDoubles(const void *a, const void *b)
+{
+    var x = *(const double*)a;
+    var y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * 计算守护进程的负载测试：多个客户端各自建立连接，以流水线方式发送--bench-parallel所用的语料，
+ * 并校验每个结果是否与本地计算的结果相同（服务端需使用默认的结果格式），最后报告吞吐量以及延迟的分布
+ * @param path 守护进程的套接字路径
+ * @param clientCount 客户端个数
+ * @param requestCount 每个客户端发送的请求个数
+ * @param pipelineDepth 每个客户端在途请求的最大个数
+ * @return 若所有结果都正确，返回0；若结果有误，返回1；若无法连接，返回2
+*/
+static int RunLoadGenerator(const char *path, int clientCount, long requestCount, int pipelineDepth)
+{
+    const long lineCount = 4096;
+    size_t corpusLength = 0;
+    var corpus = GenerateBatchBenchmarkCorpus(lineCount, &corpusLength);
+    var lines = (char**)malloc(sizeof(char*) * lineCount * 2);
+    var expectedData = (char*)malloc((size_t)lineCount * RESULT_STRING_SIZE);
+    var clients = (struct LoadClient*)calloc(clientCount, sizeof(struct LoadClient));
+    var threads = (pthread_t*)calloc(clientCount, sizeof(pthread_t));
+    var latencies = (double*)malloc(sizeof(double) * requestCount * clientCount);
+    if(corpus == NULL || lines == NULL || expectedData == NULL || clients == NULL || threads == NULL || latencies == NULL)
+    {
+        free(corpus);
+        free(lines);
+        free(expectedData);
+        free(clients);
+        free(threads);
+        free(latencies);
+        return 2;
+    }
+    
+    // 前lineCount个为请求，后lineCount个为期望的结果
+    var expectedResults = &lines[lineCount];
+    var cursor = corpus;
+    for(long i = 0; i < lineCount; i++)
+    {
+        var end = strchr(cursor, '\n');
+        *end = '\0';
+        lines[i] = cursor;
+        cursor = end + 1;
+        
+        char buffer[256];
+        strcpy(buffer, lines[i]);
+        expectedResults[i] = &expectedData[i * RESULT_STRING_SIZE];
+        CalculateArithmeticExpressionWithFormat(buffer, NULL, expectedResults[i]);
+    }
+    
+    var beginTime = GetCurrentTimeInSeconds();
+    var startedCount = 0;
+    for(; startedCount < clientCount; startedCount++)
+    {
+        clients[startedCount] = (struct LoadClient){
+            .path = path, .lines = lines, .expectedResults = expectedResults, .lineCount = lineCount,
+            .firstLine = startedCount * 997L, .requestCount = requestCount, .pipelineDepth = pipelineDepth,
+            .latencies = &latencies[startedCount * requestCount]
+        };
+        if(pthread_create(&threads[startedCount], NULL, RunLoadClient, &clients[startedCount]) != 0)
+            break;
+    }
+    
+    var isFailed = startedCount < clientCount;
+    var mismatchCount = 0L;
+    for(var i = 0; i < startedCount; i++)
+    {
+        pthread_join(threads[i], NULL);
+        isFailed |= clients[i].isFailed;
+        mismatchCount += clients[i].mismatchCount;
+    }
+    var elapsedTime = GetCurrentTimeInSeconds() - beginTime;
+    
+    if(isFailed)
+        fprintf(stderr, "Cannot complete the requests on %s\n", path);
+    else
+    {
+        var totalCount = requestCount * clientCount;
+        qsort(latencies, totalCount, sizeof(double), CompareDoubles);
+        
+        printf("Requests: %ld from %d clients, pipeline depth %d\n", totalCount, clientCount, pipelineDepth);
+        printf("Throughput: %.0f requests/sec in %.3f s\n", totalCount / elapsedTime, elapsedTime);
+        printf("Latency: p50 %.1f us, p99 %.1f us, max %.1f us\n",
+               latencies[totalCount / 2] * 1e6, latencies[totalCount * 99 / 100] * 1e6, latencies[totalCount - 1] * 1e6);
+        printf("Mismatched responses: %ld\n", mismatchCount);
+    }
+    
+    free(corpus);
+    free(lines);
+    free(expectedData);
+    free(clients);
+    free(threads);
+    free(latencies);
+    
+    if(isFailed)
+        return 2;
+    return mismatchCount > 0? 1 : 0;
+}
+
+#else
+
+static int RunEvaluationServer(const char *path, int threadCount, const struct ResultFormat *format, struct ResultCache *cache)
+{
+    (void)path;
+    (void)threadCount;
+    (void)format;
+    (void)cache;
+    fputs("The evaluation server requires epoll and is only available on Linux.\n", stderr);
+    return 2;
+}
+
+static int RunLoadGenerator(const char *path, int clientCount, long requestCount, int pipelineDepth)
+{
+    (void)path;
+    (void)clientCount;
+    (void)requestCount;
+    (void)pipelineDepth;
+    fputs("The load generator is only available on Linux.\n", stderr);
+    return 2;
+}
+
+#endif  // __linux__
+
+/** 判定表达式中是否只含有合法字符并且括号配对，它是PrevalidateArithmeticExpression的逐字节参照实现 */
+static bool IsPrevalidExpression(const char *expr, size_t length)
+{
+    long depth = 0;
+    for(size_t i = 0; i < length; i++)
+    {
+        var ch = expr[i];
+        if(ch == '(' || ch == '[')
+            depth++;
+        else if(ch == ')' || ch == ']')
+        {
+            if(--depth < 0)
+                return false;
+        }
+        else if(!IsDigital(ch) && !IsMathFunction(ch | 0x20) && strchr("$%*+,-./^_", ch) == NULL)
+            return false;
+    }
+    return depth == 0;
+}
+
+/** 计时并计算一组表达式，每个表达式都先被复制到行缓存中，再用预检或者逐字节过滤的方式计算，返回每行的平均纳秒数 */
+static double TimePrevalidatedLines(char *const lines[], long lineCount, bool usePrevalidation, long *pValidCount)
+{
+    char line[256];
+    char result[RESULT_STRING_SIZE];
+    long validCount = 0;
+    
+    var beginTime = GetCurrentTimeInSeconds();
+    for(long i = 0; i < lineCount; i++)
+    {
+        strcpy(line, lines[i]);
+        if(usePrevalidation)
+            validCount += CalculateArithmeticExpressionWithFormat(line, NULL, result);
+        else
+        {
+            NormalizeArithmeticExpression(line, line, strlen(line));
+            validCount += CalculateNormalizedArithmeticExpression(line, NULL, result);
+        }
+    }
+    var elapsedTime = GetCurrentTimeInSeconds() - beginTime;
+    
+    *pValidCount = validCount;
+    return elapsedTime * 1e9 / lineCount;
+}
+
+/**
+ * 校验向量化的预检，并比较它与原先的逐字节过滤在合法行以及垃圾行上的开销。
+ * 校验部分检查预检的结果是否与逐字节的参照实现一致、过滤结果是否相同，以及被拒绝的表达式是否确实不合法；
+ * 性能部分使用与--bench-parallel相同的语料，垃圾行则是在每行中插入空格、非法字符或者删掉一个']'得到的
+ * @param lineCount 语料的行数
+ * @return 若校验全部通过，返回0，否则返回1
+*/
+static int BenchmarkPrevalidation(long lineCount)
+{
+    enum { EXPRESSION_CAPACITY = 4096 };
+    static char expr[EXPRESSION_CAPACITY], normalized[EXPRESSION_CAPACITY], prescanned[EXPRESSION_CAPACITY];
+    
+    uint64_t state = 20161220U;
+    const long verifyCount = 300000;
+    long rejectedCount = 0;
+    long mismatchCount = 0;
+    
+    for(long i = 0; i < verifyCount; i++)
+    {
+        size_t length = 0;
+        // 有四分之一的表达式被包在多层括号中，使得括号深度跨越多个向量
+        var wrapCount = (NextRandomNumber(&state) % 4 == 0)? NextRandomNumber(&state) % 40 : 0;
+        memset(expr, '[', wrapCount);
+        length = wrapCount;
+        GenerateRandomExpression(expr, &length, EXPRESSION_CAPACITY - 64, &state, NextRandomNumber(&state) % 4, false);
+        memset(&expr[length], ']', wrapCount);
+        length += wrapCount;
+        
+        // 含有求模的表达式不做改动，以免构造出除数为零的整数求模
+        var mutationCount = NextRandomNumber(&state) % 3;
+        for(var m = 0U; m < mutationCount && length > 0 && strchr(expr, '%') == NULL; m++)
+        {
+            static const char noise[] = " \t#,&@!~\"'\\_[]()$AZaz";
+            var position = NextRandomNumber(&state) % length;
+            if((NextRandomNumber(&state) & 1) != 0)
+                expr[position] = noise[NextRandomNumber(&state) % (sizeof(noise) - 1)];
+            else
+                memmove(&expr[position], &expr[position + 1], length-- - position);
+        }
+        expr[length] = '\0';
+        
+        NormalizeArithmeticExpression(normalized, expr, length + 1);
+        var isExpected = IsPrevalidExpression(expr, length);
+        var isAccepted = PrevalidateArithmeticExpression(prescanned, expr, length);
+        
+        double value;
+        if(isAccepted != isExpected || (isAccepted && memcmp(prescanned, normalized, length) != 0) ||
+           (!isAccepted && EvaluateArithmeticSpan(normalized, length, true, MATH_KERNEL_SET_LIBM, NULL, &value, NULL, NULL)))
+        {
+            if(mismatchCount++ < 10)
+                printf("Mismatch: %s (prescan %s, expected %s)\n", expr, isAccepted? "accepted" : "rejected", isExpected? "accepted" : "rejected");
+        }
+        rejectedCount += !isAccepted;
+    }
+    printf("Verified %ld expressions (%ld rejected by the prescan): %ld mismatches\n", verifyCount, rejectedCount, mismatchCount);
+    
+    size_t corpusLength = 0;
+    var corpus = GenerateBatchBenchmarkCorpus(lineCount, &corpusLength);
+    var garbage = (char*)malloc(corpusLength + lineCount * 2);
+    var lines = (char**)malloc(sizeof(char*) * lineCount * 2);
+    if(corpus == NULL || garbage == NULL || lines == NULL)
+    {
+        free(corpus);
+        free(garbage);
+        free(lines);
+        return 2;
+    }
+    
+    // 前lineCount个为合法行，后lineCount个为对应的垃圾行
+    var garbageLines = &lines[lineCount];
+    var cursor = corpus;
+    var garbageCursor = garbage;
+    for(long i = 0; i < lineCount; i++)
+    {
+        var end = strchr(cursor, '\n');
+        *end = '\0';
+        lines[i] = cursor;
+        
+        var length = (size_t)(end - cursor);
+        var position = length / 2;
+        garbageLines[i] = garbageCursor;
+        memcpy(garbageCursor, cursor, length + 1);
+        switch(i % 3)
+        {
+        case 0:
+            // 行中多了一个空格
+            memmove(&garbageCursor[position + 1], &garbageCursor[position], length - position + 1);
+            garbageCursor[position] = ' ';
+            length++;
+            break;
+            
+        case 1:
+            // 行中混入了非法字符
+            garbageCursor[position] = '#';
+            break;
+            
+        default:
+        {
+            // 删掉最后一个']'，若没有括号，则在行首加上一个'['
+            var bracket = strrchr(garbageCursor, ']');
+            if(bracket != NULL)
+                memmove(bracket, bracket + 1, strlen(bracket));
+            else
+            {
+                memmove(&garbageCursor[1], garbageCursor, length + 1);
+                garbageCursor[0] = '[';
+            }
+            break;
+        }
+        }
+        garbageCursor += strlen(garbageCursor) + 1;
+        cursor = end + 1;
+    }
+    
+    long validCounts[4];
+    double times[4];
+    for(var kind = 0; kind < 4; kind++)
+    {
+        // 取3次中最快的一次，以减少其他进程的干扰
+        times[kind] = INFINITY;
+        for(var round = 0; round < 3; round++)
+            times[kind] = fmin(times[kind], TimePrevalidatedLines(kind < 2? lines : garbageLines, lineCount, (kind & 1) != 0, &validCounts[kind]));
+    }
+    
+    printf("Corpus: %ld valid lines and %ld garbage lines\n", lineCount, lineCount);
+    printf("%-14s %16s %16s\n", "", "byte-by-byte", "prescan");
+    printf("%-14s %13.1f ns %13.1f ns\n", "valid lines", times[0], times[1]);
+    printf("%-14s %13.1f ns %13.1f ns\n", "garbage lines", times[2], times[3]);
+    printf("Results identical: %s\n", (validCounts[0] == validCounts[1] && validCounts[2] == 0 && validCounts[3] == 0)? "yes" : "no");
+    
+    free(corpus);
+    free(garbage);
+    free(lines);
+    
+    return mismatchCount == 0? 0 : 1;
+}
+
+/**
+ * 生成一个只含整数字面量的随机表达式，字面量在1到maxLiteral之间，其中可能有一元负号、
+ * 一次指数不超过2的乘方以及括号，'%'之后只会紧跟一个字面量，因此求模的除数不会为0
+ * @param literalCount 字面量的个数，不包括乘方的指数
+ * @param hasDivision 是否可以出现除法
+ * @return 表达式的长度
+*/
+static int GenerateIntegerExpression(char buffer[], uint64_t *pState, int literalCount, uint32_t maxLiteral, bool hasDivision)
+{
+    static const char operators[] = "+-*%/";
+    var length = 0;
+    var openCount = 0;
+    var hasPower = false;
+    var previousOperator = '+';
+    
+    for(var i = 0; i < literalCount; i++)
+    {
+        if(i > 0)
+        {
+            previousOperator = operators[NextRandomNumber(pState) % (hasDivision? 5 : 4)];
+            buffer[length++] = previousOperator;
+        }
+        if(previousOperator != '%' && openCount < 3 && i + 1 < literalCount && NextRandomNumber(pState) % 4 == 0)
+        {
+            buffer[length++] = '[';
+            openCount++;
+        }
+        if(NextRandomNumber(pState) % 8 == 0)
+            buffer[length++] = '-';
+        length += sprintf(&buffer[length], "%u", NextRandomNumber(pState) % maxLiteral + 1);
+        // 乘方会使之后同一括号层中的运算都归入求模的除数，因此'%'之后不做乘方
+        if(!hasPower && previousOperator != '%' && NextRandomNumber(pState) % 8 == 0)
+        {
+            length += sprintf(&buffer[length], "^%u", NextRandomNumber(pState) % 3);
+            hasPower = true;
+        }
+        if(openCount > 0 && NextRandomNumber(pState) % 3 == 0)
+        {
+            buffer[length++] = ']';
+            openCount--;
+        }
+    }
+    for(; openCount > 0; openCount--)
+        buffer[length++] = ']';
+    buffer[length] = '\0';
+    
+    return length;
+}
+
+/** 计时并按指定的方式计算一组表达式，每个表达式都先被复制到行缓存中，返回每行的平均纳秒数 */
+static double TimeFormattedLines(char *const lines[], long lineCount, const struct ResultFormat *format, long *pValidCount)
+{
+    char line[256];
+    char result[RESULT_STRING_SIZE];
+    long validCount = 0;
+    
+    var beginTime = GetCurrentTimeInSeconds();
+    for(long i = 0; i < lineCount; i++)
+    {
+        strcpy(line, lines[i]);
+        validCount += CalculateArithmeticExpressionWithFormat(line, format, result);
+    }
+    var elapsedTime = GetCurrentTimeInSeconds() - beginTime;
+    
+    *pValidCount = validCount;
+    return elapsedTime * 1e9 / lineCount;
+}
+
+/**
+ * 校验精确整数模式，并比较它与全部使用double的求值在整数为主的语料以及--bench-parallel的语料上的开销。
+ * 校验部分包括：一组已知结果的边界情况；中间结果都不超过2^53的随机整数表达式，其结果必须与double求值相等（整数没有-0）；
+ * 以及随机的大整数加减乘与乘方，其结果必须与128位整数的参照结果一致，并且只在超出int64_t时才转为double
+ * @param lineCount 每份语料的行数
+ * @return 若校验全部通过，返回0，否则返回1
+*/
+static int BenchmarkExactIntegers(long lineCount)
+{
+    static const struct
+    {
+        const char *expr;
+        const char *expected;
+    } knownCases[] = {
+        { "2^53+1", "9007199254740993" },
+        { "9223372036854775807", "9223372036854775807" },
+        { "-9223372036854775807-1", "-9223372036854775808" },
+        { "9223372036854775807+1", "9223372036854776000" },
+        { "3037000499*3037000499", "9223372030926249001" },
+        { "2^62+[2^62-1]", "9223372036854775807" },
+        { "2^63", "9223372036854776000" },
+        { "3^39", "4052555153018976267" },
+        { "-2^63", "-9223372036854775808" },
+        { "123456789123456789%1000000007", "259259273" },
+        { "-7%3", "-1" },
+        { "5%0", "nan" },
+        { "9007199254740993/3", "3002399751580331" },
+        { "10/4", "2.5" },
+        { "1-2^2", "5" },
+        { "8/2^2", "2" },
+        { "2^-1", "0.5" },
+        { "1e3+1", "1001" },
+        { "99999999999999999999-1", "100000000000000000000" },
+        { "pi*0+9007199254740993", "9007199254740992" },
+        { "sqrt(16)*2^53+1", "36028797018963970" }
+    };
+    
+    long mismatchCount = 0;
+    char buffer[256];
+    char result[RESULT_STRING_SIZE];
+    for(size_t i = 0; i < sizeof(knownCases) / sizeof(knownCases[0]); i++)
+    {
+        strcpy(buffer, knownCases[i].expr);
+        if(!CalculateArithmeticExpressionWithFormat(buffer, &(struct ResultFormat){ RESULT_FORMAT_MODE_SHORTEST, 0, true, MATH_KERNEL_SET_LIBM }, result) ||
+           strcmp(result, knownCases[i].expected) != 0)
+        {
+            if(mismatchCount++ < 10)
+                printf("Mismatch: %s = %s (expected %s)\n", knownCases[i].expr, result, knownCases[i].expected);
+        }
+    }
+    
+    uint64_t state = 20161220U;
+    const long verifyCount = 300000;
+    long integerCount = 0;
+    for(long i = 0; i < verifyCount; i++)
+    {
+        // 至多5个不超过999的字面量，乘方的指数至多为2，所以中间结果的绝对值都小于2^53
+        var length = GenerateIntegerExpression(buffer, &state, (int)(NextRandomNumber(&state) % 5) + 1, 999, true);
+        PrevalidateArithmeticExpression(buffer, buffer, (size_t)length);
+        
+        struct ExactNumber number;
+        double value;
+        if(!EvaluateExactArithmeticSpan(buffer, (size_t)length, true, MATH_KERNEL_SET_LIBM, NULL, &number, NULL) ||
+           !EvaluateArithmeticSpan(buffer, (size_t)length, true, MATH_KERNEL_SET_LIBM, NULL, &value, NULL, NULL) ||
+           !(GetExactNumberReal(number) == value || IsSameResult(GetExactNumberReal(number), value)) ||
+           (!number.isInteger && strchr(buffer, '/') == NULL))
+        {
+            if(mismatchCount++ < 10)
+                printf("Mismatch: %s = %.17g (expected %.17g)\n", buffer, GetExactNumberReal(number), value);
+        }
+        integerCount += number.isInteger;
+    }
+    
+    for(long i = 0; i < verifyCount; i++)
+    {
+        // 随机的大整数运算，操作数的位数也是随机的，使得一部分结果恰好溢出
+        var kind = NextRandomNumber(&state) % 4;
+        __int128 expected;
+        int64_t a, b;
+        if(kind < 3)
+        {
+            var aBits = NextRandomNumber(&state) % 63 + 1;
+            var bBits = (kind == 2)? 64 - aBits + NextRandomNumber(&state) % 3 - 1 : NextRandomNumber(&state) % 63 + 1;
+            // 移位数必须小于64，否则结果未定义，语料就会随编译器与优化级别而不同
+            if(bBits > 63)
+                bBits = 63;
+            else if(bBits < 1)
+                bBits = 1;
+            a = (int64_t)((((uint64_t)NextRandomNumber(&state) << 32) | NextRandomNumber(&state)) >> (64 - aBits));
+            b = (int64_t)((((uint64_t)NextRandomNumber(&state) << 32) | NextRandomNumber(&state)) >> (64 - bBits));
+            if((NextRandomNumber(&state) & 1) != 0)
+                a = -a;
+            expected = (kind == 0)? (__int128)a + b : (kind == 1)? (__int128)a - b : (__int128)a * b;
+            sprintf(buffer, "%lld%c%lld", (long long)a, "+-*"[kind], (long long)b);
+        }
+        else
+        {
+            a = (int64_t)(NextRandomNumber(&state) % 41) - 20;
+            b = NextRandomNumber(&state) % 70;
+            expected = 1;
+            for(var e = 0; e < b && expected <= INT64_MAX && expected >= INT64_MIN; e++)
+                expected *= a;
+            sprintf(buffer, "[%lld]^%lld", (long long)a, (long long)b);
+        }
+        
+        var length = strlen(buffer);
+        PrevalidateArithmeticExpression(buffer, buffer, length);
+        // 两个负数相减的写法"a--b"不合法，这种情况直接跳过
+        struct ExactNumber number;
+        if(!EvaluateExactArithmeticSpan(buffer, length, true, MATH_KERNEL_SET_LIBM, NULL, &number, NULL))
+            continue;
+        
+        var isInRange = expected >= INT64_MIN && expected <= INT64_MAX;
+        if(number.isInteger != isInRange || (isInRange && number.integer != (int64_t)expected))
+        {
+            if(mismatchCount++ < 10)
+                printf("Mismatch: %s = %.17g (%s)\n", buffer, GetExactNumberReal(number), number.isInteger? "integer" : "double");
+        }
+    }
+    printf("Verified %ld expressions (%ld with integer results): %ld mismatches\n", verifyCount * 2 + (long)(sizeof(knownCases) / sizeof(knownCases[0])), integerCount, mismatchCount);
+    
+    // 整数为主的语料：每行3到12个不超过6位的整数字面量
+    size_t corpusLength = 0;
+    var mixedCorpus = GenerateBatchBenchmarkCorpus(lineCount, &corpusLength);
+    var integerCorpus = (char*)malloc((size_t)lineCount * 128);
+    var lines = (char**)malloc(sizeof(char*) * lineCount * 2);
+    if(mixedCorpus == NULL || integerCorpus == NULL || lines == NULL)
+    {
+        free(mixedCorpus);
+        free(integerCorpus);
+        free(lines);
+        return 2;
+    }
+    
+    var mixedLines = &lines[lineCount];
+    var integerCursor = integerCorpus;
+    var mixedCursor = mixedCorpus;
+    for(long i = 0; i < lineCount; i++)
+    {
+        lines[i] = integerCursor;
+        integerCursor += GenerateIntegerExpression(integerCursor, &state, (int)(NextRandomNumber(&state) % 10) + 3, 999999, false) + 1;
+        
+        var end = strchr(mixedCursor, '\n');
+        *end = '\0';
+        mixedLines[i] = mixedCursor;
+        mixedCursor = end + 1;
+    }
+    
+    const struct ResultFormat formats[] = {
+        { RESULT_FORMAT_MODE_SHORTEST, 0, false, MATH_KERNEL_SET_LIBM },
+        { RESULT_FORMAT_MODE_SHORTEST, 0, true, MATH_KERNEL_SET_LIBM }
+    };
+    long validCounts[4];
+    double times[4];
+    for(var kind = 0; kind < 4; kind++)
+    {
+        // 取3次中最快的一次，以减少其他进程的干扰
+        times[kind] = INFINITY;
+        for(var round = 0; round < 3; round++)
+            times[kind] = fmin(times[kind], TimeFormattedLines(kind < 2? lines : mixedLines, lineCount, &formats[kind & 1], &validCounts[kind]));
+    }
+    
+    // 统计整数语料中因超出2^53而使两种模式的结果不同的行数
+    long differentCount = 0;
+    for(long i = 0; i < lineCount; i++)
+    {
+        char doubleResult[RESULT_STRING_SIZE], exactResult[RESULT_STRING_SIZE];
+        strcpy(buffer, lines[i]);
+        CalculateArithmeticExpressionWithFormat(buffer, &formats[0], doubleResult);
+        strcpy(buffer, lines[i]);
+        CalculateArithmeticExpressionWithFormat(buffer, &formats[1], exactResult);
+        differentCount += strcmp(doubleResult, exactResult) != 0;
+    }
+    
+    printf("Corpus: %ld integer lines and %ld mixed lines\n", lineCount, lineCount);
+    printf("%-14s %16s %16s\n", "", "double", "exact integer");
+    printf("%-14s %13.1f ns %13.1f ns\n", "integer lines", times[0], times[1]);
+    printf("%-14s %13.1f ns %13.1f ns\n", "mixed lines", times[2], times[3]);
+    printf("Integer lines whose exact result differs from the double result: %ld\n", differentCount);
+    
+    free(mixedCorpus);
+    free(integerCorpus);
+    free(lines);
+    
+    return (mismatchCount == 0 && validCounts[0] == validCounts[1] && validCounts[2] == validCounts[3])? 0 : 1;
+}
+
+/** 基准测试语料的生成参数 */
+struct CorpusParameters
+{
+    uint64_t seed;
+    long count;
+    
+    /** 括号以及函数调用的最大嵌套深度 */
+    int depth;
+    
+    /** 二元操作符的取值范围，每个操作符被选中的概率与其在字符串中出现的次数成正比 */
+    const char *operators;
+    
+    /** 操作数为数学函数调用的百分比 */
+    int functionPercent;
+    
+    /** 数字字面量的最大有效数字位数 */
+    int literalDigits;
+    
+    /** 非法表达式所占的百分比 */
+    int invalidPercent;
+};
+
+/** 基准测试语料中嵌套深度的上限，以免表达式的长度随深度指数增长 */
+#define CORPUS_MAX_DEPTH        8
+
+/** 基准测试语料中单个表达式的最大长度 */
+#define CORPUS_MAX_EXPRESSION   65536
+
+/**
+ * 按生成参数随机生成一个合法的算术表达式，并追加到buffer中。
+ * 与GenerateRandomExpression一样，求模的右操作数总是一个正整数字面量，且其后不会紧跟幂运算
+ * @param depth 剩余允许的嵌套深度
+*/
+static void GenerateCorpusExpression(char buffer[], size_t *pLength, size_t capacity, const struct CorpusParameters *parameters, uint64_t *pState, int depth)
+{
+    var length = *pLength;
+    var termCount = 1 + NextRandomNumber(pState) % 4;
+    var operatorCount = strlen(parameters->operators);
+    var lastOpIsMod = false;
+    
+#define APPEND_TEXT(...)    do { if(length < capacity) length += snprintf(&buffer[length], capacity - length, __VA_ARGS__); if(length >= capacity) length = capacity - 1; } while(0)
+    
+    for(var t = 0U; t < termCount; t++)
+    {
+        if(t > 0)
+        {
+            var op = parameters->operators[NextRandomNumber(pState) % operatorCount];
+            if(lastOpIsMod && (op == '^' || op == '$'))
+                op = '*';
+            APPEND_TEXT("%c", op);
+            
+            if(op == '%')
+            {
+                APPEND_TEXT("%u", 1 + NextRandomNumber(pState) % 9);
+                lastOpIsMod = true;
+                continue;
+            }
+        }
+        lastOpIsMod = false;
+        
+        var percent = (int)(NextRandomNumber(pState) % 100);
+        if(depth > 0 && percent < parameters->functionPercent)
+        {
+            // 函数表中有空位，所以反复抽取直到选中一个函数为止
+            const char *name;
+            do
+                name = mathFuncList[NextRandomNumber(pState) % MATH_FUNCTION_TABLE_SIZE].name;
+            while(name[0] == '\0');
+            APPEND_TEXT("%s(", name);
+            *pLength = length;
+            GenerateCorpusExpression(buffer, pLength, capacity, parameters, pState, depth - 1);
+            length = *pLength;
+            APPEND_TEXT(")");
+        }
+        else if(depth > 0 && percent < parameters->functionPercent + 15)
+        {
+            APPEND_TEXT("(");
+            *pLength = length;
+            GenerateCorpusExpression(buffer, pLength, capacity, parameters, pState, depth - 1);
+            length = *pLength;
+            APPEND_TEXT(")");
+        }
+        else if(percent >= 95)
+            APPEND_TEXT("%s", (percent & 1) != 0? "pi" : "e");
+        else
+        {
+            // 有效数字为1到literalDigits位，其中一部分带有负号或者小数点
+            if(percent % 7 == 0)
+                APPEND_TEXT("-");
+            var digitCount = 1 + (int)(NextRandomNumber(pState) % parameters->literalDigits);
+            var pointIndex = (percent % 3 == 0 && digitCount > 1)? 1 + (int)(NextRandomNumber(pState) % (digitCount - 1)) : -1;
+            for(var i = 0; i < digitCount; i++)
+            {
+                if(i == pointIndex)
+                    APPEND_TEXT(".");
+                APPEND_TEXT("%c", (char)((i == 0? '1' : '0') + NextRandomNumber(pState) % (i == 0? 9 : 10)));
+            }
+        }
+    }
+    
+#undef APPEND_TEXT
+    
+    *pLength = length;
+}
+
+/**
+ * 按生成参数生成基准测试语料，各表达式以'\0'分隔。
+ * 非法表达式由合法表达式变换而来：混入非法字符、去掉最后一个右括号或者套上未知的函数名，
+ * 前两种会被预检拒绝，最后一种则要到解析时才能发现
+ * @param pLines 输出各表达式的起始地址，使用完毕后需用free释放
+ * @param pTotalLength 输出所有表达式的总字节数，不包括分隔符
+ * @return 语料内容，使用完毕后需用free释放
+*/
+static char* GenerateBenchmarkCorpus(const struct CorpusParameters *parameters, char ***pLines, size_t *pTotalLength)
+{
+    var expression = (char*)malloc(CORPUS_MAX_EXPRESSION);
+    var lines = (char**)malloc(sizeof(char*) * parameters->count);
+    size_t capacity = (size_t)parameters->count * 64 + CORPUS_MAX_EXPRESSION;
+    var corpus = (char*)malloc(capacity);
+    if(expression == NULL || lines == NULL || corpus == NULL)
+    {
+        free(expression);
+        free(lines);
+        free(corpus);
+        return NULL;
+    }
+    
+    var state = parameters->seed;
+    size_t corpusLength = 0;
+    size_t totalLength = 0;
+    
+    for(long i = 0; i < parameters->count; i++)
+    {
+        size_t length = 0;
+        GenerateCorpusExpression(expression, &length, CORPUS_MAX_EXPRESSION - 8, parameters, &state, parameters->depth);
+        
+        if((int)(NextRandomNumber(&state) % 100) < parameters->invalidPercent)
+        {
+            switch(NextRandomNumber(&state) % 3)
+            {
+            case 0:
+                expression[NextRandomNumber(&state) % length] = '#';
+                break;
+                
+            case 1:
+            {
+                var parenthesis = (char*)memchr(expression, ')', length);
+                if(parenthesis != NULL)
+                    memmove(parenthesis, parenthesis + 1, length-- - (size_t)(parenthesis - expression));
+                else
+                {
+                    memmove(&expression[1], expression, length++);
+                    expression[0] = '(';
+                }
+                break;
+            }
+                
+            default:
+                memmove(&expression[3], expression, length);
+                memcpy(expression, "qq(", 3);
+                expression[length + 3] = ')';
+                length += 4;
+                break;
+            }
+        }
+        
+        if(corpusLength + length + 1 > capacity)
+        {
+            capacity = capacity * 2 + length + 1;
+            var newCorpus = (char*)realloc(corpus, capacity);
+            if(newCorpus == NULL)
+            {
+                free(expression);
+                free(lines);
+                free(corpus);
+                return NULL;
+            }
+            corpus = newCorpus;
+        }
+        
+        // 先记录偏移，语料全部生成之后再转换为地址，因为realloc可能会移动语料
+        lines[i] = (char*)(uintptr_t)corpusLength;
+        memcpy(&corpus[corpusLength], expression, length);
+        corpus[corpusLength + length] = '\0';
+        corpusLength += length + 1;
+        totalLength += length;
+    }
+    
+    for(long i = 0; i < parameters->count; i++)
+        lines[i] = corpus + (uintptr_t)lines[i];
+    
+    free(expression);
+    *pLines = lines;
+    *pTotalLength = totalLength;
+    return corpus;
+}
+
+/** 基准测试套件中的各个阶段 */
+enum BENCHMARK_PHASE
+{
+    /** 向量化预检与字符改写 */
+    BENCHMARK_PHASE_PRESCAN,
+    
+    /** 解析为未经优化的程序 */
+    BENCHMARK_PHASE_PARSE,
+    
+    /** 对解析所得的程序求值 */
+    BENCHMARK_PHASE_EVALUATE,
+    
+    /** 将求值结果格式化为最短表示 */
+    BENCHMARK_PHASE_FORMAT,
+    
+    /** CalculateArithmeticExpressionWithFormat的完整流程，即预检之后一遍解析并求值，再格式化结果 */
+    BENCHMARK_PHASE_END_TO_END,
+    
+    BENCHMARK_PHASE_COUNT
+};
+
+/** 一个阶段的测量结果 */
+struct BenchmarkPhaseResult
+{
+    /** 该阶段所处理的表达式个数以及这些表达式的字节数，每字节的周期数总是相对于表达式的字节数而言 */
+    long count;
+    size_t byteCount;
+    
+    double seconds;
+    uint64_t cycles;
+};
+
+/** 基准测试套件的上下文，它保存着语料以及各阶段之间传递的中间结果 */
+struct BenchmarkSuite
+{
+    char **lines;
+    size_t *lengths;
+    long count;
+    
+    /** 预检与完整流程所使用的行缓存，可以容纳语料中最长的表达式 */
+    char *buffer;
+    
+    /** 各表达式解析所得的程序，非法表达式为NULL */
+    struct ArithmeticProgram **programs;
+    double *values;
+};
+
+/** 执行一遍指定的阶段，并测量其耗时 */
+static struct BenchmarkPhaseResult RunBenchmarkPhase(struct BenchmarkSuite *suite, enum BENCHMARK_PHASE phase)
+{
+    struct BenchmarkPhaseResult result = { 0 };
+    char formatted[RESULT_STRING_SIZE];
+    var checksum = 0;
+    
+    if(phase == BENCHMARK_PHASE_PARSE)
+    {
+        for(long i = 0; i < suite->count; i++)
+        {
+            DestroyArithmeticProgram(suite->programs[i]);
+            suite->programs[i] = NULL;
+        }
+    }
+    
+    var beginTime = GetCurrentTimeInSeconds();
+    var beginCycles = ReadCycleCounter();
+    
+    for(long i = 0; i < suite->count; i++)
+    {
+        var line = suite->lines[i];
+        var length = suite->lengths[i];
+        
+        switch(phase)
+        {
+        case BENCHMARK_PHASE_PRESCAN:
+            checksum += PrevalidateArithmeticExpression(suite->buffer, line, length);
+            break;
+            
+        case BENCHMARK_PHASE_PARSE:
+            suite->programs[i] = CompileArithmeticProgram(line, NULL, 0, false, NULL);
+            break;
+            
+        case BENCHMARK_PHASE_EVALUATE:
+            if(suite->programs[i] == NULL)
+                continue;
+            suite->values[i] = EvaluateArithmeticProgram(suite->programs[i], NULL);
+            break;
+            
+        case BENCHMARK_PHASE_FORMAT:
+            if(suite->programs[i] == NULL)
+                continue;
+            checksum += FormatArithmeticResult(suite->values[i], NULL, formatted);
+            break;
+            
+        default:
+            memcpy(suite->buffer, line, length + 1);
+            checksum += CalculateArithmeticExpressionWithFormat(suite->buffer, NULL, formatted);
+            break;
+        }
+        result.count++;
+        result.byteCount += length;
+    }
+    
+    result.cycles = ReadCycleCounter() - beginCycles;
+    result.seconds = GetCurrentTimeInSeconds() - beginTime;
+    
+    // 使校验和参与一次不可省略的比较，以免计算被编译器当作无用代码删除
+    if(checksum == -1)
+        puts("");
+    
+    return result;
+}
+
+/**
+ * 测量基准测试套件的各个阶段，输出报告，并按需导出JSON
+ * @param suite 已载入语料的基准测试上下文
+ * @param totalLength 语料的总字节数
+ * @return 参见RunBenchmarkSuite
+*/
+static int MeasureBenchmarkSuite(struct BenchmarkSuite *suite, const struct CorpusParameters *parameters, size_t totalLength, int rounds, const char *jsonPath)
+{
+    static const char *const phaseNames[] = {
+        [BENCHMARK_PHASE_PRESCAN] = "prescan",
+        [BENCHMARK_PHASE_PARSE] = "parse",
+        [BENCHMARK_PHASE_EVALUATE] = "evaluate",
+        [BENCHMARK_PHASE_FORMAT] = "format",
+        [BENCHMARK_PHASE_END_TO_END] = "end_to_end"
+    };
+    
+    struct BenchmarkPhaseResult results[BENCHMARK_PHASE_COUNT];
+    for(var phase = 0; phase < BENCHMARK_PHASE_COUNT; phase++)
+    {
+        for(var round = 0; round < rounds; round++)
+        {
+            var result = RunBenchmarkPhase(suite, (enum BENCHMARK_PHASE)phase);
+            if(round == 0 || result.seconds < results[phase].seconds)
+                results[phase] = result;
+        }
+    }
+    
+    // 核对解析所得程序的求值结果与一遍解析求值的结果
+    var mismatchCount = 0L;
+    var invalidCount = 0L;
+    for(long i = 0; i < suite->count; i++)
+    {
+        double value;
+        memcpy(suite->buffer, suite->lines[i], suite->lengths[i] + 1);
+        var isValid = PrevalidateArithmeticExpression(suite->buffer, suite->buffer, suite->lengths[i]) &&
+                      EvaluateArithmeticSpan(suite->buffer, suite->lengths[i], true, MATH_KERNEL_SET_LIBM, NULL, &value, NULL, NULL);
+        invalidCount += !isValid;
+        if(isValid != (suite->programs[i] != NULL) || (isValid && !IsSameResult(value, suite->values[i])))
+        {
+            if(mismatchCount++ < 5)
+                printf("Mismatch: %s\n", suite->lines[i]);
+        }
+    }
+    
+    var hasCycles = results[0].cycles != 0;
+    printf("Corpus: %ld expressions, %zu bytes, %ld invalid, seed %llu\n", suite->count, totalLength, invalidCount, (unsigned long long)parameters->seed);
+    printf("%-12s %12s %14s %14s\n", "phase", "ns/expr", "expr/sec", "cycles/byte");
+    for(var phase = 0; phase < BENCHMARK_PHASE_COUNT; phase++)
+    {
+        var result = &results[phase];
+        if(result->count == 0)
+        {
+            printf("%-12s %12s %14s %14s\n", phaseNames[phase], "n/a", "n/a", "n/a");
+            continue;
+        }
+        printf("%-12s %12.1f %14.0f", phaseNames[phase], result->seconds * 1e9 / result->count, result->count / result->seconds);
+        if(hasCycles)
+            printf(" %14.2f\n", (double)result->cycles / result->byteCount);
+        else
+            printf(" %14s\n", "n/a");
+    }
+    printf("Program results identical to direct evaluation: %s\n", mismatchCount == 0? "yes" : "no");
+    
+    if(jsonPath == NULL)
+        return mismatchCount == 0? 0 : 1;
+    
+    var output = (strcmp(jsonPath, "-") == 0)? stdout : fopen(jsonPath, "w");
+    if(output == NULL)
+    {
+        fprintf(stderr, "Cannot write %s\n", jsonPath);
+        return 2;
+    }
+    
+    fprintf(output, "{\n  \"benchmark\": \"SimpleCalculator\",\n  \"timestamp\": %lld,\n", (long long)time(NULL));
+#if defined(__VERSION__)
+    fprintf(output, "  \"compiler\": \"%s\",\n", __VERSION__);
+#endif
+    fprintf(output, "  \"parameters\": { \"seed\": %llu, \"count\": %ld, \"depth\": %d, \"operators\": \"%s\", \"function_percent\": %d, \"literal_digits\": %d, \"invalid_percent\": %d, \"rounds\": %d },\n",
+            (unsigned long long)parameters->seed, parameters->count, parameters->depth, parameters->operators,
+            parameters->functionPercent, parameters->literalDigits, parameters->invalidPercent, rounds);
+    fprintf(output, "  \"corpus\": { \"expressions\": %ld, \"bytes\": %zu, \"invalid\": %ld },\n", suite->count, totalLength, invalidCount);
+    fputs("  \"phases\": [\n", output);
+    for(var phase = 0; phase < BENCHMARK_PHASE_COUNT; phase++)
+    {
+        var result = &results[phase];
+        fprintf(output, "    { \"name\": \"%s\", \"expressions\": %ld, \"bytes\": %zu, ", phaseNames[phase], result->count, result->byteCount);
+        if(result->count == 0)
+            fputs("\"ns_per_expr\": null, \"expr_per_sec\": null, \"cycles_per_byte\": null }", output);
+        else
+        {
+            fprintf(output, "\"ns_per_expr\": %.2f, \"expr_per_sec\": %.0f, ", result->seconds * 1e9 / result->count, result->count / result->seconds);
+            if(hasCycles)
+                fprintf(output, "\"cycles_per_byte\": %.3f }", (double)result->cycles / result->byteCount);
+            else
+                fputs("\"cycles_per_byte\": null }", output);
+        }
+        fputs(phase + 1 < BENCHMARK_PHASE_COUNT? ",\n" : "\n", output);
+    }
+    fprintf(output, "  ],\n  \"mismatches\": %ld\n}\n", mismatchCount);
+    
+    if(output != stdout)
+        fclose(output);
+    
+    return mismatchCount == 0? 0 : 1;
+}
+
+/**
+ * 基准测试套件：按生成参数生成带种子的随机语料，分别测量预检、解析、求值、格式化以及完整流程的开销，
+ * 报告每个表达式的纳秒数、每秒表达式个数以及每字节的时间戳周期数，并可将结果导出为JSON，以便在不同提交之间比较。
+ * 各阶段都取rounds遍中最快的一遍。求值阶段的结果还会与一遍解析求值的结果逐一比对
+ * @param parameters 语料的生成参数
+ * @param rounds 每个阶段的测量遍数
+ * @param jsonPath JSON结果的输出路径，若为NULL，则不导出，若为"-"，则输出到标准输出
+ * @return 若测量完成并且结果一致，返回0；若结果不一致，返回1；若存储空间不足或者无法写入JSON，返回2
+*/
+static int RunBenchmarkSuite(const struct CorpusParameters *parameters, int rounds, const char *jsonPath)
+{
+    size_t totalLength = 0;
+    struct BenchmarkSuite suite = { .count = parameters->count };
+    var corpus = GenerateBenchmarkCorpus(parameters, &suite.lines, &totalLength);
+    suite.lengths = (size_t*)malloc(sizeof(size_t) * suite.count);
+    suite.programs = (struct ArithmeticProgram**)calloc(suite.count, sizeof(struct ArithmeticProgram*));
+    suite.values = (double*)malloc(sizeof(double) * suite.count);
+    suite.buffer = (char*)malloc(CORPUS_MAX_EXPRESSION + 16);
+    
+    var status = 2;
+    if(corpus != NULL && suite.lengths != NULL && suite.programs != NULL && suite.values != NULL && suite.buffer != NULL)
+    {
+        for(long i = 0; i < suite.count; i++)
+            suite.lengths[i] = strlen(suite.lines[i]);
+        
+        status = MeasureBenchmarkSuite(&suite, parameters, totalLength, rounds, jsonPath);
+        
+        for(long i = 0; i < suite.count; i++)
+            DestroyArithmeticProgram(suite.programs[i]);
+    }
+    else
+        fputs("Out of memory!\n", stderr);
+    
+    free(corpus);
+    free(suite.lines);
+    free(suite.lengths);
+    free(suite.programs);
+    free(suite.values);
+    free(suite.buffer);
+    
+    return status;
+}
+
+/** 命令行中最多能声明的变量个数 */
+#define PRECOMPILE_MAX_VARIABLES    64
+
+/**
+ * 将以','分隔的变量名列表拆分为变量名数组，list会被就地修改
+ * @return 变量个数，若变量过多或者变量名为空，返回-1
+*/
+static int SplitVariableNames(char *list, const char *names[PRECOMPILE_MAX_VARIABLES])
+{
+    if(list == NULL || list[0] == '\0')
+        return 0;
+    
+    var count = 0;
+    for(var name = strtok(list, ","); name != NULL; name = strtok(NULL, ","))
+    {
+        if(count == PRECOMPILE_MAX_VARIABLES)
+            return -1;
+        names[count++] = name;
+    }
+    return count;
+}
+
+/**
+ * 预编译模式：将表达式列表中的每一行编译为程序，并写入预编译程序文件。空行被忽略，非法的行会被报告并跳过
+ * @param listPath 表达式列表文件的路径，若为"-"，则从标准输入读取
+ * @param outputPath 预编译程序文件的路径
+ * @param variableList 以','分隔的变量名，若为NULL，则表达式中没有变量
+ * @return 若全部编译成功，返回0；若有非法的行，返回1；若无法读写文件或者存储空间不足，返回2
+*/
+static int RunPrecompileMode(const char *listPath, const char *outputPath, const char *variableList)
+{
+    const char *variableNames[PRECOMPILE_MAX_VARIABLES];
+    var variableBuffer = (variableList != NULL)? strdup(variableList) : NULL;
+    var variableCount = SplitVariableNames(variableBuffer, variableNames);
+    if(variableCount < 0)
+    {
+        fprintf(stderr, "At most %d variables can be declared!\n", PRECOMPILE_MAX_VARIABLES);
+        free(variableBuffer);
+        return 2;
+    }
+    
+    var input = (strcmp(listPath, "-") == 0)? stdin : fopen(listPath, "r");
+    if(input == NULL)
+    {
+        fprintf(stderr, "Cannot open %s\n", listPath);
+        free(variableBuffer);
+        return 2;
+    }
+    
+    var beginTime = GetCurrentTimeInSeconds();
+    
+    char **sources = NULL;
+    struct ArithmeticProgram **programs = NULL;
+    size_t count = 0, capacity = 0;
+    char *line = NULL;
+    size_t lineCapacity = 0;
+    ssize_t lineLength;
+    long lineCount = 0;
+    long invalidCount = 0;
+    var isOutOfMemory = false;
+    
+    while(!isOutOfMemory && (lineLength = getline(&line, &lineCapacity, input)) >= 0)
+    {
+        lineCount++;
+        if(lineLength > 0 && line[lineLength - 1] == '\n')
+            line[--lineLength] = '\0';
+        if(lineLength == 0)
+            continue;
+        
+        var program = CompileArithmeticExpression(line, variableNames, variableCount);
+        if(program == NULL)
+        {
+            fprintf(stderr, "error: line %ld: invalid expression\n", lineCount);
+            invalidCount++;
+            continue;
+        }
+        
+        if(count == capacity)
+        {
+            capacity = (capacity == 0)? 256 : capacity * 2;
+            var newSources = (char**)realloc(sources, sizeof(char*) * capacity);
+            if(newSources != NULL)
+                sources = newSources;
+            var newPrograms = (struct ArithmeticProgram**)realloc(programs, sizeof(struct ArithmeticProgram*) * capacity);
+            if(newPrograms != NULL)
+                programs = newPrograms;
+            isOutOfMemory = newSources == NULL || newPrograms == NULL;
+        }
+        
+        var source = isOutOfMemory? NULL : strdup(line);
+        if(source == NULL)
+        {
+            DestroyArithmeticProgram(program);
+            isOutOfMemory = true;
+            break;
+        }
+        sources[count] = source;
+        programs[count++] = program;
+    }
+    
+    size_t entryCount = 0;
+    var status = 2;
+    if(isOutOfMemory)
+        fputs("Out of memory!\n", stderr);
+    else if(!WriteArithmeticProgramFile(outputPath, (const char *const*)sources, (const struct ArithmeticProgram *const*)programs, count, variableNames, variableCount, &entryCount))
+        fprintf(stderr, "Cannot write %s\n", outputPath);
+    else
+    {
+        var elapsedTime = GetCurrentTimeInSeconds() - beginTime;
+        fprintf(stderr, "Precompiled %zu programs (%ld invalid lines, %zu duplicates) into %s in %.3f s\n",
+                entryCount, invalidCount, count - entryCount, outputPath, elapsedTime);
+        status = invalidCount > 0? 1 : 0;
+    }
+    
+    for(size_t i = 0; i < count; i++)
+    {
+        free(sources[i]);
+        DestroyArithmeticProgram(programs[i]);
+    }
+    free(sources);
+    free(programs);
+    free(line);
+    free(variableBuffer);
+    if(input != stdin)
+        fclose(input);
+    
+    return status;
+}
+
+/**
+ * 启动时间测试：模拟短生命周期的进程载入同一批带变量的公式并各求值一次的过程，
+ * 比较逐个从文本解析编译与打开预编译程序文件之后直接查找两种方式的耗时，并校验两者的结果逐位相同。
+ * 各方式均取5遍中最快的一遍，此时文件已在页缓存中，正如同一台机器上反复启动的进程所见
+ * @param formulaCount 公式个数
+ * @return 若结果一致，返回0，否则返回1；若无法生成文件，返回2
+*/
+static int BenchmarkStartup(long formulaCount)
+{
+    static const char *const variableNames[] = { "x", "y" };
+    static const double bindings[] = { 1.25, -2.5 };
+    enum { ROUND_COUNT = 5 };
+    
+    var sources = (char**)calloc(formulaCount, sizeof(char*));
+    var programs = (struct ArithmeticProgram**)calloc(formulaCount, sizeof(struct ArithmeticProgram*));
+    var textResults = (double*)malloc(sizeof(double) * formulaCount);
+    var fileResults = (double*)malloc(sizeof(double) * formulaCount);
+    char path[] = "/tmp/simplecalc-startup-XXXXXX";
+    var fd = -1;
+    var status = 2;
+    
+    if(sources != NULL && programs != NULL && textResults != NULL && fileResults != NULL && (fd = mkstemp(path)) >= 0)
+    {
+        close(fd);
+        
+        // 生成公式，编译失败的公式（比如过长的）用一个简单的公式代替，以保证两种方式处理的是同一批公式
+        uint64_t state = 20161220;
+        char buffer[4096];
+        size_t totalLength = 0;
+        for(long i = 0; i < formulaCount; i++)
+        {
+            size_t length = 0;
+            GenerateRandomExpression(buffer, &length, sizeof(buffer), &state, 3, true);
+            buffer[length] = '\0';
+            programs[i] = CompileArithmeticExpression(buffer, variableNames, 2);
+            if(programs[i] == NULL)
+            {
+                strcpy(buffer, "x+y");
+                programs[i] = CompileArithmeticExpression(buffer, variableNames, 2);
+            }
+            sources[i] = strdup(buffer);
+            totalLength += strlen(buffer);
+        }
+        
+        size_t entryCount = 0;
+        if(WriteArithmeticProgramFile(path, (const char *const*)sources, (const struct ArithmeticProgram *const*)programs, formulaCount, variableNames, 2, &entryCount))
+        {
+            var textTime = INFINITY;
+            var fileTime = INFINITY;
+            var openTime = INFINITY;
+            long missingCount = 0;
+            
+            for(var round = 0; round < ROUND_COUNT; round++)
+            {
+                var beginTime = GetCurrentTimeInSeconds();
+                for(long i = 0; i < formulaCount; i++)
+                {
+                    var program = CompileArithmeticExpression(sources[i], variableNames, 2);
+                    textResults[i] = (program != NULL)? EvaluateArithmeticProgram(program, bindings) : NAN;
+                    DestroyArithmeticProgram(program);
+                }
+                var elapsedTime = GetCurrentTimeInSeconds() - beginTime;
+                if(elapsedTime < textTime)
+                    textTime = elapsedTime;
+                
+                beginTime = GetCurrentTimeInSeconds();
+                var file = OpenArithmeticProgramFile(path);
+                var openedTime = GetCurrentTimeInSeconds();
+                missingCount = 0;
+                for(long i = 0; i < formulaCount && file != NULL; i++)
+                {
+                    const var program = FindArithmeticProgram(file, sources[i]);
+                    missingCount += program == NULL;
+                    fileResults[i] = (program != NULL)? EvaluateArithmeticProgram(program, bindings) : NAN;
+                }
+                CloseArithmeticProgramFile(file);
+                elapsedTime = GetCurrentTimeInSeconds() - beginTime;
+                if(file == NULL)
+                    missingCount = formulaCount;
+                if(elapsedTime < fileTime)
+                {
+                    fileTime = elapsedTime;
+                    openTime = openedTime - beginTime;
+                }
+            }
+            
+            long mismatchCount = 0;
+            for(long i = 0; i < formulaCount; i++)
+                mismatchCount += !IsSameResult(textResults[i], fileResults[i]);
+            
+            struct stat fileStatus;
+            stat(path, &fileStatus);
+            
+            printf("%ld formulas (%zu distinct, %.1f bytes on average), program file %lld bytes\n",
+                   formulaCount, entryCount, (double)totalLength / formulaCount, (long long)fileStatus.st_size);
+            printf("%-26s %10.3f ms %10.1f ns/formula\n", "parse from text:", textTime * 1e3, textTime * 1e9 / formulaCount);
+            printf("%-26s %10.3f ms %10.1f ns/formula (open %.3f ms)\n", "precompiled program file:", fileTime * 1e3, fileTime * 1e9 / formulaCount, openTime * 1e3);
+            printf("Speedup: %.1fx\n", textTime / fileTime);
+            printf("Missing formulas: %ld, results identical: %s\n", missingCount, mismatchCount == 0? "yes" : "no");
+            
+            status = (missingCount == 0 && mismatchCount == 0)? 0 : 1;
+        }
+        remove(path);
+    }
+    
+    if(status == 2)
+        fputs("Cannot create the program file!\n", stderr);
+    
+    for(long i = 0; sources != NULL && i < formulaCount; i++)
+        free(sources[i]);
+    for(long i = 0; programs != NULL && i < formulaCount; i++)
+        DestroyArithmeticProgram(programs[i]);
+    free(sources);
+    free(programs);
+    free(textResults);
+    free(fileResults);
+    
+    return status;
+}
+
+/** 扫描公式中的名字时最多记录的归约索引变量个数，超过的索引变量会被当作普通的名字 */
+#define FORMULA_MAX_INDEX_NAMES     16
+
+/**
+ * 判定公式中的名字是否为归约调用，即归约名后面紧跟'('，若是，则取得其索引变量名。
+ * 归约体中的索引变量既不是单元名也不是字段名，扫描公式中的名字时需要跳过它
+ * @param cursor 指向名字的起始字符，它不必经过NormalizeArithmeticExpression过滤
+ * @param length 名字的字符个数
+ * @param pIndexLength 输出紧跟在'('之后的索引变量名的字符个数，若'('之后不是名字，输出0
+ * @return 若是归约调用，返回true
+*/
+static bool ParseFormulaReduction(const char *cursor, size_t length, size_t *pIndexLength)
+{
+    char lowerName[REDUCTION_NAME_MAX_LENGTH + 1] = { '\0' };
+    if(length > REDUCTION_NAME_MAX_LENGTH || cursor[length] != '(')
+        return false;
+    for(size_t i = 0; i < length; i++)
+        lowerName[i] = NormalizeArithmeticCharacter(cursor[i]);
+    if(FindReductionKind(lowerName, length) < 0)
+        return false;
+    
+    var index = cursor + length + 1;
+    size_t indexLength = 0;
+    if(IsMathFunction(NormalizeArithmeticCharacter(index[0])))
+    {
+        indexLength = 1;
+        while(IsVariableNameCharacter(NormalizeArithmeticCharacter(index[indexLength])))
+            indexLength++;
+    }
+    *pIndexLength = indexLength;
+    return true;
+}
+
+/** 单个公式最多能引用的单元个数 */
+#define SHEET_MAX_DEPENDENCIES      256
+
+/** 某一拓扑层级中待重算的单元不少于该值时，才将它们交给线程池并行求值 */
+#define SHEET_PARALLEL_MIN_CELLS    256
+
+/** 并行求值时每个任务所包含的单元个数 */
+#define SHEET_TASK_CELLS            64
+
+/** 编译后的公式 */
+struct SheetFormula
+{
+    /** 编译后的程序，程序中的第i个变量即为所引用的第i个单元 */
+    struct ArithmeticProgram *program;
+    
+    /** 所引用的各个单元的索引，其中没有重复 */
+    int *dependencies;
+    
+    /** 求值时所用的绑定值数组，与dependencies位于同一块存储空间中 */
+    double *bindings;
+    
+    int dependencyCount;
+};
+
+/** 表格中的一个单元，即一条形如name=formula的命名定义 */
+struct SheetCell
+{
+    char *name;
+    struct SheetFormula formula;
+    
+    /** 拓扑层级：不引用其他单元的单元位于0层，其余单元比它所引用的单元的最大层级高1层 */
+    int level;
+    
+    /** 重算或者检查环时，该单元是否已被访问过 */
+    bool isDirty;
+    
+    double value;
+};
+
+/**
+ * 由命名定义组成的表格以及它们之间的依赖图。
+ * 修改某个单元的定义之后，只需重算它以及直接或间接引用它的单元。
+ * 这些单元按拓扑层级依次求值，同一层级中的单元互不引用，所以可以交给线程池并行求值
+*/
+struct Sheet
+{
+    struct SheetCell *cells;
+    int cellCount;
+    int cellCapacity;
+    
+    /** 按名字查找单元的开放寻址哈希表，存放单元索引，-1表示空位。名字不区分大小写 */
+    int *nameBuckets;
+    int bucketCount;
+    
+    /** 依赖图的反向边：单元i被dependents[dependentOffsets[i]]到dependents[dependentOffsets[i + 1] - 1]这些单元所引用 */
+    int *dependentOffsets;
+    int *dependents;
+    
+    int levelCount;
+    
+    /** 待重算的单元，在遍历依赖图时也用作队列。若出现了环，环上的单元依次存放于其中，每个单元都引用下一个单元 */
+    int *dirtyCells;
+    
+    /** 按层级排好序的待重算单元，第l层位于orderedCells[levelOffsets[l]]到orderedCells[levelOffsets[l + 1] - 1] */
+    int *orderedCells;
+    int *levelOffsets;
+    
+    /** 线程池，若为NULL，则总是串行求值 */
+    struct WorkerPool *pool;
+};
+
+/** 计算单元名的哈希值（FNV-1a），名字不区分大小写 */
+static uint32_t HashSheetCellName(const char *name, size_t length)
+{
+    var hash = 2166136261U;
+    for(size_t i = 0; i < length; i++)
+    {
+        hash ^= (uint8_t)NormalizeArithmeticCharacter(name[i]);
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+/**
+ * 查找指定名字的单元
+ * @param name 单元名，不必以'\0'结尾
+ * @param length 单元名的长度
+ * @return 若找到，返回单元索引，否则返回-1
+*/
+static int FindSheetCell(const struct Sheet *sheet, const char *name, size_t length)
+{
+    if(sheet->bucketCount == 0)
+        return -1;
+    
+    uint32_t mask = sheet->bucketCount - 1;
+    for(var bucket = HashSheetCellName(name, length) & mask; ; bucket = (bucket + 1) & mask)
+    {
+        var index = sheet->nameBuckets[bucket];
+        if(index < 0)
+            return -1;
+        
+        const char *cellName = sheet->cells[index].name;
+        if(strncasecmp(cellName, name, length) == 0 && cellName[length] == '\0')
+            return index;
+    }
+}
+
+/**
+ * 往表格中登记一个尚未定义公式的单元，调用者须保证名字合法且不与已有的单元重名
+ * @param name 单元名，表格直接保存该指针而不做拷贝
+ * @return 新单元的索引，若存储空间不足，返回-1
+*/
+static int InsertSheetCell(struct Sheet *sheet, char *name)
+{
+    if(sheet->cellCount == sheet->cellCapacity)
+    {
+        var capacity = sheet->cellCapacity == 0? 64 : sheet->cellCapacity * 2;
+        var cells = (struct SheetCell*)realloc(sheet->cells, sizeof(struct SheetCell) * capacity);
+        if(cells == NULL)
+            return -1;
+        sheet->cells = cells;
+        sheet->cellCapacity = capacity;
+    }
+    
+    // 哈希表的装载因子保持在1/2以下，扩容时重新放入所有单元
+    if((sheet->cellCount + 1) * 2 > sheet->bucketCount)
+    {
+        var bucketCount = sheet->bucketCount == 0? 128 : sheet->bucketCount * 2;
+        var buckets = (int*)malloc(sizeof(int) * bucketCount);
+        if(buckets == NULL)
+            return -1;
+        memset(buckets, -1, sizeof(int) * bucketCount);
+        
+        for(var i = 0; i < sheet->cellCount; i++)
+        {
+            var bucket = HashSheetCellName(sheet->cells[i].name, strlen(sheet->cells[i].name)) & (bucketCount - 1);
+            while(buckets[bucket] >= 0)
+                bucket = (bucket + 1) & (bucketCount - 1);
+            buckets[bucket] = i;
+        }
+        
+        free(sheet->nameBuckets);
+        sheet->nameBuckets = buckets;
+        sheet->bucketCount = bucketCount;
+    }
+    
+    var index = sheet->cellCount++;
+    sheet->cells[index] = (struct SheetCell){ .name = name };
+    
+    var bucket = HashSheetCellName(name, strlen(name)) & (sheet->bucketCount - 1);
+    while(sheet->nameBuckets[bucket] >= 0)
+        bucket = (bucket + 1) & (sheet->bucketCount - 1);
+    sheet->nameBuckets[bucket] = index;
+    
+    return index;
+}
+
+/**
+ * 撤销最后一次InsertSheetCell，但不释放单元名。
+ * 其他名字都在它之前登记（扩容时也先放入原有的名字），那时它所在的位置还是空的，
+ * 所以其他名字的探查序列都不会经过这里，直接清空该位置不会影响它们的查找
+*/
+static void RemoveLastSheetCell(struct Sheet *sheet)
+{
+    var index = --sheet->cellCount;
+    const char *name = sheet->cells[index].name;
+    var bucket = HashSheetCellName(name, strlen(name)) & (sheet->bucketCount - 1);
+    while(sheet->nameBuckets[bucket] != index)
+        bucket = (bucket + 1) & (sheet->bucketCount - 1);
+    sheet->nameBuckets[bucket] = -1;
+}
+
+/**
+ * 往表格中添加一个尚未定义公式的单元，单元名会被拷贝
+ * @return 新单元的索引，若存储空间不足，返回-1
+*/
+static int AddSheetCell(struct Sheet *sheet, const char *name)
+{
+    var copy = strdup(name);
+    if(copy == NULL)
+        return -1;
+    
+    var index = InsertSheetCell(sheet, copy);
+    if(index < 0)
+        free(copy);
+    
+    return index;
+}
+
+static void DestroySheetFormula(struct SheetFormula *formula)
+{
+    DestroyArithmeticProgram(formula->program);
+    free(formula->bindings);
+}
+
+/**
+ * 编译公式，并找出其中所引用的单元
+ * @param text 公式，其中不能含有空白字符
+ * @param pFormula 输出编译后的公式，使用完毕后需用DestroySheetFormula释放
+ * @return 若编译成功，返回NULL，否则返回错误信息
+*/
+static const char* CompileSheetFormula(const struct Sheet *sheet, const char *text, struct SheetFormula *pFormula)
+{
+    const char *names[SHEET_MAX_DEPENDENCIES];
+    int dependencies[SHEET_MAX_DEPENDENCIES];
+    var dependencyCount = 0;
+    const char *indexNames[FORMULA_MAX_INDEX_NAMES];
+    size_t indexLengths[FORMULA_MAX_INDEX_NAMES];
+    var indexCount = 0;
+    
+    for(var cursor = text; *cursor != '\0'; )
+    {
+        var ch = NormalizeArithmeticCharacter(*cursor);
+        if(IsDigital(ch) || ch == '.')
+        {
+            // 跳过数字字面量，包括其中十六进制的数字以及指数部分，其中的字母不是单元名
+            var end = cursor + 1;
+            while(IsVariableNameCharacter(NormalizeArithmeticCharacter(*end)) || *end == '.')
+                end++;
+            if(NormalizeArithmeticCharacter(end[-1]) == 'e' && (*end == '+' || *end == '-'))
+            {
+                end++;
+                while(IsDigital(*end))
+                    end++;
+            }
+            cursor = end;
+            continue;
+        }
+        if(!IsMathFunction(ch))
+        {
+            cursor++;
+            continue;
+        }
+        
+        size_t length = 1;
+        while(IsVariableNameCharacter(NormalizeArithmeticCharacter(cursor[length])))
+            length++;
+        
+        // 归约名以及归约的索引变量都不是单元名
+        size_t indexLength;
+        if(ParseFormulaReduction(cursor, length, &indexLength))
+        {
+            if(indexLength > 0 && indexCount < FORMULA_MAX_INDEX_NAMES)
+            {
+                indexNames[indexCount] = cursor + length + 1;
+                indexLengths[indexCount++] = indexLength;
+            }
+            cursor += length;
+            continue;
+        }
+        var isIndexName = false;
+        for(var i = 0; i < indexCount && !isIndexName; i++)
+            isIndexName = indexLengths[i] == length && strncasecmp(indexNames[i], cursor, length) == 0;
+        if(isIndexName)
+        {
+            cursor += length;
+            continue;
+        }
+        
+        var index = FindSheetCell(sheet, cursor, length);
+        if(index < 0)
+        {
+            // 既不是单元名，也不是数学常量或数学函数名
+            char lowerName[MATH_FUNCTION_NAME_MAX_LENGTH + 1] = { '\0' };
+            var funcLength = 0;
+            if(length <= MATH_FUNCTION_NAME_MAX_LENGTH)
+            {
+                for(size_t i = 0; i < length; i++)
+                    lowerName[i] = NormalizeArithmeticCharacter(cursor[i]);
+            }
+            if(length > MATH_FUNCTION_NAME_MAX_LENGTH ||
+               (IsMathConstant(lowerName) != (int)length && (ParseMathFunctionIndex(lowerName, &funcLength) < 0 || funcLength != (int)length)))
+                return "unknown name";
+        }
+        else
+        {
+            var slot = 0;
+            while(slot < dependencyCount && dependencies[slot] != index)
+                slot++;
+            if(slot == dependencyCount)
+            {
+                if(dependencyCount == SHEET_MAX_DEPENDENCIES)
+                    return "too many references";
+                names[dependencyCount] = sheet->cells[index].name;
+                dependencies[dependencyCount++] = index;
+            }
+        }
+        cursor += length;
+    }
+    
+    var program = CompileArithmeticExpression(text, dependencyCount > 0? names : NULL, dependencyCount);
+    if(program == NULL)
+        return "invalid formula";
+    
+    // 绑定值数组在前，以保证其8字节对齐
+    var bindings = (double*)malloc((sizeof(double) + sizeof(int)) * (dependencyCount > 0? dependencyCount : 1));
+    if(bindings == NULL)
+    {
+        DestroyArithmeticProgram(program);
+        return "out of memory";
+    }
+    
+    *pFormula = (struct SheetFormula){ .program = program, .dependencies = (int*)(bindings + dependencyCount), .bindings = bindings, .dependencyCount = dependencyCount };
+    memcpy(pFormula->dependencies, dependencies, sizeof(int) * dependencyCount);
+    
+    return NULL;
+}
+
+/** 返回单元所引用的单元中第一个在拓扑排序中尚未被处理的单元 */
+static int FindPendingDependency(const struct SheetCell *cell, const int pendingCounts[])
+{
+    for(var i = 0; i < cell->formula.dependencyCount; i++)
+    {
+        if(pendingCounts[cell->formula.dependencies[i]] > 0)
+            return cell->formula.dependencies[i];
+    }
+    return -1;
+}
+
+/**
+ * 根据各单元的公式重建依赖图的反向边，并求出各单元的拓扑层级
+ * @param pCycleLength 若出现了环，输出环的长度，环上的单元存放于sheet->dirtyCells中
+ * @return 若成功，返回NULL，否则返回错误信息
+*/
+static const char* BuildSheetGraph(struct Sheet *sheet, int *pCycleLength)
+{
+    var cells = sheet->cells;
+    var cellCount = sheet->cellCount;
+    var edgeCount = 0;
+    for(var i = 0; i < cellCount; i++)
+        edgeCount += cells[i].formula.dependencyCount;
+    
+    free(sheet->dependentOffsets);
+    free(sheet->dependents);
+    free(sheet->dirtyCells);
+    free(sheet->orderedCells);
+    free(sheet->levelOffsets);
+    sheet->dependentOffsets = (int*)calloc(cellCount + 1, sizeof(int));
+    sheet->dependents = (int*)malloc(sizeof(int) * (edgeCount > 0? edgeCount : 1));
+    sheet->dirtyCells = (int*)malloc(sizeof(int) * (cellCount + 1));
+    sheet->orderedCells = (int*)malloc(sizeof(int) * (cellCount + 1));
+    sheet->levelOffsets = (int*)malloc(sizeof(int) * (cellCount + 1));
+    var pendingCounts = (int*)malloc(sizeof(int) * (cellCount + 1));
+    if(sheet->dependentOffsets == NULL || sheet->dependents == NULL || sheet->dirtyCells == NULL ||
+       sheet->orderedCells == NULL || sheet->levelOffsets == NULL || pendingCounts == NULL)
+    {
+        free(pendingCounts);
+        return "out of memory";
+    }
+    
+    // 先统计每个单元被引用的次数，再将引用者依次填入各自的区间
+    var offsets = sheet->dependentOffsets;
+    for(var i = 0; i < cellCount; i++)
+    {
+        for(var k = 0; k < cells[i].formula.dependencyCount; k++)
+            offsets[cells[i].formula.dependencies[k] + 1]++;
+    }
+    for(var i = 0; i < cellCount; i++)
+    {
+        offsets[i + 1] += offsets[i];
+        pendingCounts[i] = offsets[i];
+    }
+    for(var i = 0; i < cellCount; i++)
+    {
+        for(var k = 0; k < cells[i].formula.dependencyCount; k++)
+            sheet->dependents[pendingCounts[cells[i].formula.dependencies[k]]++] = i;
+    }
+    
+    // 用Kahn算法做拓扑排序，pendingCounts为各单元尚未处理的引用个数，dirtyCells用作队列
+    var queue = sheet->dirtyCells;
+    var tail = 0;
+    for(var i = 0; i < cellCount; i++)
+    {
+        cells[i].level = 0;
+        pendingCounts[i] = cells[i].formula.dependencyCount;
+        if(pendingCounts[i] == 0)
+            queue[tail++] = i;
+    }
+    
+    var levelCount = 0;
+    for(var head = 0; head < tail; head++)
+    {
+        var cell = queue[head];
+        var level = cells[cell].level + 1;
+        if(level > levelCount)
+            levelCount = level;
+        
+        for(var k = offsets[cell]; k < offsets[cell + 1]; k++)
+        {
+            var dependent = sheet->dependents[k];
+            if(cells[dependent].level < level)
+                cells[dependent].level = level;
+            if(--pendingCounts[dependent] == 0)
+                queue[tail++] = dependent;
+        }
+    }
+    sheet->levelCount = levelCount;
+    
+    const char *error = NULL;
+    if(tail < cellCount)
+    {
+        // 未被处理的单元必定引用了另一个未被处理的单元，所以从任一未被处理的单元出发，
+        // 沿着这样的引用走cellCount步之后必定位于环上，再绕环一周即可得到环上的所有单元
+        var cell = 0;
+        while(pendingCounts[cell] == 0)
+            cell++;
+        for(var i = 0; i < cellCount; i++)
+            cell = FindPendingDependency(&cells[cell], pendingCounts);
+        
+        var length = 0;
+        var start = cell;
+        do
+        {
+            queue[length++] = cell;
+            cell = FindPendingDependency(&cells[cell], pendingCounts);
+        }
+        while(cell != start);
+        
+        *pCycleLength = length;
+        error = "circular reference";
+    }
+    
+    free(pendingCounts);
+    return error;
+}
+
+/**
+ * 判定将单元index的公式替换为formula之后是否会形成环。
+ * 当前的依赖图中没有环，所以只有新公式所引用的某个单元直接或间接地引用了index时才会形成环
+ * @return 若会形成环，返回环的长度，环上的单元从index开始依次存放于sheet->dirtyCells中；否则返回0
+*/
+static int FindSheetCycle(struct Sheet *sheet, int index, const struct SheetFormula *formula)
+{
+    var cells = sheet->cells;
+    var queue = sheet->dirtyCells;
+    var parents = sheet->orderedCells;
+    
+    // 从index出发沿反向边做广度优先遍历，parents记录每个单元是经由它所引用的哪个单元到达的
+    var count = 0;
+    cells[index].isDirty = true;
+    queue[count++] = index;
+    for(var head = 0; head < count; head++)
+    {
+        var cell = queue[head];
+        for(var k = sheet->dependentOffsets[cell]; k < sheet->dependentOffsets[cell + 1]; k++)
+        {
+            var dependent = sheet->dependents[k];
+            if(!cells[dependent].isDirty)
+            {
+                cells[dependent].isDirty = true;
+                parents[dependent] = cell;
+                queue[count++] = dependent;
+            }
+        }
+    }
+    
+    var cycleCell = -1;
+    for(var i = 0; i < formula->dependencyCount && cycleCell < 0; i++)
+    {
+        if(cells[formula->dependencies[i]].isDirty)
+            cycleCell = formula->dependencies[i];
+    }
+    for(var i = 0; i < count; i++)
+        cells[queue[i]].isDirty = false;
+    
+    if(cycleCell < 0)
+        return 0;
+    
+    var length = 0;
+    queue[length++] = index;
+    for(var cell = cycleCell; cell != index; cell = parents[cell])
+        queue[length++] = cell;
+    
+    return length;
+}
+
+/** 用单元所引用的单元的当前值计算该单元的值 */
+static inline void EvaluateSheetCell(struct SheetCell cells[], int index)
+{
+    var formula = &cells[index].formula;
+    for(var i = 0; i < formula->dependencyCount; i++)
+        formula->bindings[i] = cells[formula->dependencies[i]].value;
+    
+    cells[index].value = EvaluateArithmeticProgram(formula->program, formula->bindings);
+}
+
+/** 并行求值时同一层级中待重算的单元 */
+struct SheetLevel
+{
+    struct SheetCell *cells;
+    const int *levelCells;
+    int count;
+};
+
+/** 线程池的任务函数，求出一个层级中第taskIndex组单元的值 */
+static void EvaluateSheetLevelTask(void *context, int taskIndex)
+{
+    var level = (const struct SheetLevel*)context;
+    var end = (taskIndex + 1) * SHEET_TASK_CELLS;
+    if(end > level->count)
+        end = level->count;
+    
+    for(var i = taskIndex * SHEET_TASK_CELLS; i < end; i++)
+        EvaluateSheetCell(level->cells, level->levelCells[i]);
+}
+
+/**
+ * 重算指定的单元以及所有直接或间接引用了它们的单元。
+ * 待重算的单元按拓扑层级依次求值，单元个数足够多的层级交给线程池并行求值
+ * @param roots 定义发生了变化的单元，若为NULL，则重算所有单元
+ * @param rootCount roots中的单元个数
+ * @return 被重算的单元个数，这些单元按拓扑顺序存放于sheet->orderedCells中
+*/
+static int RecomputeSheet(struct Sheet *sheet, const int roots[], int rootCount)
+{
+    var cells = sheet->cells;
+    var dirtyCells = sheet->dirtyCells;
+    var dirtyCount = 0;
+    
+    if(roots == NULL)
+    {
+        for(var i = 0; i < sheet->cellCount; i++)
+            dirtyCells[dirtyCount++] = i;
+    }
+    else
+    {
+        for(var i = 0; i < rootCount; i++)
+        {
+            if(!cells[roots[i]].isDirty)
+            {
+                cells[roots[i]].isDirty = true;
+                dirtyCells[dirtyCount++] = roots[i];
+            }
+        }
+        
+        // 以dirtyCells作为队列沿反向边做广度优先遍历
+        for(var head = 0; head < dirtyCount; head++)
+        {
+            var cell = dirtyCells[head];
+            for(var k = sheet->dependentOffsets[cell]; k < sheet->dependentOffsets[cell + 1]; k++)
+            {
+                var dependent = sheet->dependents[k];
+                if(!cells[dependent].isDirty)
+                {
+                    cells[dependent].isDirty = true;
+                    dirtyCells[dirtyCount++] = dependent;
+                }
+            }
+        }
+        
+        for(var i = 0; i < dirtyCount; i++)
+            cells[dirtyCells[i]].isDirty = false;
+    }
+    
+    // 按层级对待重算的单元做计数排序
+    var levelOffsets = sheet->levelOffsets;
+    var levelCount = sheet->levelCount;
+    memset(levelOffsets, 0, sizeof(int) * (levelCount + 1));
+    for(var i = 0; i < dirtyCount; i++)
+        levelOffsets[cells[dirtyCells[i]].level + 1]++;
+    for(var level = 0; level < levelCount; level++)
+        levelOffsets[level + 1] += levelOffsets[level];
+    for(var i = 0; i < dirtyCount; i++)
+        sheet->orderedCells[levelOffsets[cells[dirtyCells[i]].level]++] = dirtyCells[i];
+    
+    // 此时levelOffsets[l]为第l层的结束位置，将其整体后移一位即为各层的起始位置
+    for(var level = levelCount; level > 0; level--)
+        levelOffsets[level] = levelOffsets[level - 1];
+    levelOffsets[0] = 0;
+    
+    var isParallel = sheet->pool != NULL && sheet->pool->threadCount > 1;
+    for(var level = 0; level < levelCount; level++)
+    {
+        var levelCells = &sheet->orderedCells[levelOffsets[level]];
+        var count = levelOffsets[level + 1] - levelOffsets[level];
+        
+        if(isParallel && count >= SHEET_PARALLEL_MIN_CELLS)
+        {
+            // 同一层级中的单元互不引用，每个单元只写入自己的值，而它们所读取的值都在之前的层级中算好了
+            struct SheetLevel context = { .cells = cells, .levelCells = levelCells, .count = count };
+            RunWorkerPoolTasks(sheet->pool, (count + SHEET_TASK_CELLS - 1) / SHEET_TASK_CELLS, EvaluateSheetLevelTask, &context);
+        }
+        else
+        {
+            for(var i = 0; i < count; i++)
+                EvaluateSheetCell(cells, levelCells[i]);
+        }
+    }
+    
+    return dirtyCount;
+}
+
+/**
+ * 修改或者新增一个单元的定义，并重算受影响的单元
+ * @param name 单元名，表格会保存它的拷贝。新单元的定义因形成环而被拒绝时，环上的该单元名就是name本身
+ * @param text 公式，其中不能含有空白字符
+ * @param pCycleLength 若新的定义会形成环，输出环的长度，环上的单元存放于sheet->dirtyCells中
+ * @param pRecomputedCount 输出被重算的单元个数，这些单元按拓扑顺序存放于sheet->orderedCells中
+ * @return 若成功，返回NULL，否则返回错误信息，此时表格保持不变
+*/
+static const char* DefineSheetCell(struct Sheet *sheet, char *name, const char *text, int *pCycleLength, int *pRecomputedCount)
+{
+    // 新的单元先以调用者的name登记，再编译公式，这样公式中对它自身的引用会被当作环报告，而不是未知的名字。
+    // 定义被拒绝时撤销登记，此时cells[index].name仍指向name，调用者可以用它输出环
+    var index = FindSheetCell(sheet, name, strlen(name));
+    var isNewCell = index < 0;
+    if(isNewCell)
+    {
+        if(!IsValidVariableName(name))
+            return "invalid name";
+        if((index = InsertSheetCell(sheet, name)) < 0)
+            return "out of memory";
+    }
+    
+    struct SheetFormula formula;
+    var error = CompileSheetFormula(sheet, text, &formula);
+    if(error != NULL)
+    {
+        if(isNewCell)
+            RemoveLastSheetCell(sheet);
+        return error;
+    }
+    
+    // 新的单元不可能被其他单元引用，所以只有引用它自身时才会形成环；
+    // 已有的单元若所引用的单元没有变化，则依赖图保持不变，只需重算
+    var isGraphChanged = true;
+    if(isNewCell)
+    {
+        for(var i = 0; i < formula.dependencyCount; i++)
+        {
+            if(formula.dependencies[i] == index)
+            {
+                sheet->dirtyCells[0] = index;
+                *pCycleLength = 1;
+                error = "circular reference";
+            }
+        }
+        if(error == NULL && (sheet->cells[index].name = strdup(name)) == NULL)
+        {
+            sheet->cells[index].name = name;
+            error = "out of memory";
+        }
+    }
+    else
+    {
+        var oldFormula = &sheet->cells[index].formula;
+        isGraphChanged = formula.dependencyCount != oldFormula->dependencyCount ||
+                         memcmp(formula.dependencies, oldFormula->dependencies, sizeof(int) * formula.dependencyCount) != 0;
+        if(isGraphChanged && (*pCycleLength = FindSheetCycle(sheet, index, &formula)) > 0)
+            error = "circular reference";
+    }
+    
+    if(error != NULL)
+    {
+        DestroySheetFormula(&formula);
+        if(isNewCell)
+            RemoveLastSheetCell(sheet);
+        return error;
+    }
+    
+    DestroySheetFormula(&sheet->cells[index].formula);
+    sheet->cells[index].formula = formula;
+    
+    if(isGraphChanged && (error = BuildSheetGraph(sheet, pCycleLength)) != NULL)
+        return error;
+    
+    *pRecomputedCount = RecomputeSheet(sheet, &index, 1);
+    return NULL;
+}
+
+static void DestroySheet(struct Sheet *sheet)
+{
+    for(var i = 0; i < sheet->cellCount; i++)
+    {
+        free(sheet->cells[i].name);
+        DestroySheetFormula(&sheet->cells[i].formula);
+    }
+    free(sheet->cells);
+    free(sheet->nameBuckets);
+    free(sheet->dependentOffsets);
+    free(sheet->dependents);
+    free(sheet->dirtyCells);
+    free(sheet->orderedCells);
+    free(sheet->levelOffsets);
+}
+
+/** 输出环上的单元，形如a -> b -> a，每个单元都引用了其后的单元 */
+static void PrintSheetCycle(const struct Sheet *sheet, int length, FILE *stream)
+{
+    for(var i = 0; i < length; i++)
+        fprintf(stream, "%s -> ", sheet->cells[sheet->dirtyCells[i]].name);
+    fprintf(stream, "%s\n", sheet->cells[sheet->dirtyCells[0]].name);
+}
+
+/**
+ * 去掉一行定义中的空白字符，并在'='处将其拆分为名字与公式
+ * @param line 一行定义，会被就地修改
+ * @param pText 输出公式，若该行中没有'='，则输出NULL
+ * @return 去掉空白字符之后该行的长度
+*/
+static size_t SplitSheetDefinition(char line[], char **pText)
+{
+    size_t length = 0;
+    for(var cursor = line; *cursor != '\0'; cursor++)
+    {
+        if(*cursor != ' ' && *cursor != '\t' && *cursor != '\r' && *cursor != '\n')
+            line[length++] = *cursor;
+    }
+    line[length] = '\0';
+    
+    *pText = strchr(line, '=');
+    if(*pText != NULL)
+        *(*pText)++ = '\0';
+    
+    return length;
+}
+
+/** 输出一个单元的名字与值，形如name = value */
+static void PrintSheetCell(const struct Sheet *sheet, int index, const struct ResultFormat *format)
+{
+    char result[RESULT_STRING_SIZE];
+    FormatArithmeticResult(sheet->cells[index].value, format, result);
+    printf("%s = %s\n", sheet->cells[index].name, result);
+}
+
+/**
+ * 从定义文件中载入整张表格。
+ * 公式可以引用文件中位于其后的单元，所以先登记所有单元名，再逐个编译公式
+ * @return 若成功，返回0；若有非法的定义或者出现了环，返回1；若存储空间不足，返回2
+*/
+static int LoadSheetDefinitions(struct Sheet *sheet, FILE *input)
+{
+    char **texts = NULL;
+    long *lineNumbers = NULL;
+    char *line = NULL;
+    size_t lineCapacity = 0;
+    long lineCount = 0;
+    var status = 0;
+    
+    while(status != 2 && getline(&line, &lineCapacity, input) >= 0)
+    {
+        lineCount++;
+        char *text;
+        if(SplitSheetDefinition(line, &text) == 0 || line[0] == '#')
+            continue;
+        
+        const char *error = NULL;
+        if(text == NULL)
+            error = "expected name=formula";
+        else if(!IsValidVariableName(line))
+            error = "invalid name";
+        else if(FindSheetCell(sheet, line, strlen(line)) >= 0)
+            error = "duplicate name";
+        if(error != NULL)
+        {
+            fprintf(stderr, "error: line %ld: %s\n", lineCount, error);
+            status = 1;
+            continue;
+        }
+        
+        if(sheet->cellCount % 64 == 0)
+        {
+            var newTexts = (char**)realloc(texts, sizeof(char*) * (sheet->cellCount + 64));
+            if(newTexts != NULL)
+                texts = newTexts;
+            var newLineNumbers = (long*)realloc(lineNumbers, sizeof(long) * (sheet->cellCount + 64));
+            if(newLineNumbers != NULL)
+                lineNumbers = newLineNumbers;
+            if(newTexts == NULL || newLineNumbers == NULL)
+            {
+                status = 2;
+                break;
+            }
+        }
+        
+        var copy = strdup(text);
+        var index = (copy != NULL)? AddSheetCell(sheet, line) : -1;
+        if(index < 0)
+        {
+            free(copy);
+            status = 2;
+            break;
+        }
+        texts[index] = copy;
+        lineNumbers[index] = lineCount;
+    }
+    
+    for(var i = 0; i < sheet->cellCount && status != 2; i++)
+    {
+        var error = CompileSheetFormula(sheet, texts[i], &sheet->cells[i].formula);
+        if(error != NULL)
+        {
+            fprintf(stderr, "error: line %ld: %s: %s\n", lineNumbers[i], error, texts[i]);
+            status = 1;
+        }
+    }
+    
+    if(status == 0)
+    {
+        var cycleLength = 0;
+        var error = BuildSheetGraph(sheet, &cycleLength);
+        if(cycleLength > 0)
+        {
+            fprintf(stderr, "error: %s: ", error);
+            PrintSheetCycle(sheet, cycleLength, stderr);
+            status = 1;
+        }
+        else if(error != NULL)
+            status = 2;
+    }
+    
+    if(status == 2)
+        fputs("Out of memory!\n", stderr);
+    
+    for(var i = 0; texts != NULL && i < sheet->cellCount; i++)
+        free(texts[i]);
+    free(texts);
+    free(lineNumbers);
+    free(line);
+    
+    return status;
+}
+
+/**
+ * 表格模式：从定义文件中载入形如name=formula的命名定义，求出并输出所有单元的值，
+ * 然后从标准输入逐行读取新的定义，只重算受影响的单元，并按拓扑顺序输出它们的新值。
+ * 只有名字的一行输出该单元的当前值。定义中的空白字符被忽略，以'#'开头的行为注释
+ * @param path 定义文件的路径
+ * @param threadCount 并行求值的线程数，若为0，则使用所有处理器核；若小于0，则串行求值
+ * @param format 结果的格式化方式
+ * @return 若所有定义均合法，返回0；若存在非法的定义，返回1；若无法打开文件或者存储空间不足，返回2
+*/
+static int RunSheetMode(const char *path, int threadCount, const struct ResultFormat *format)
+{
+    var input = fopen(path, "r");
+    if(input == NULL)
+    {
+        fprintf(stderr, "Cannot open file: %s\n", path);
+        return 2;
+    }
+    
+    struct Sheet sheet = { 0 };
+    struct WorkerPool pool;
+    if(threadCount >= 0 && CreateWorkerPool(&pool, threadCount))
+        sheet.pool = &pool;
+    
+    var beginTime = GetCurrentTimeInSeconds();
+    var status = LoadSheetDefinitions(&sheet, input);
+    var isLoaded = status == 0;
+    fclose(input);
+    
+    if(isLoaded)
+    {
+        var loadTime = GetCurrentTimeInSeconds() - beginTime;
+        beginTime = GetCurrentTimeInSeconds();
+        RecomputeSheet(&sheet, NULL, 0);
+        var evaluationTime = GetCurrentTimeInSeconds() - beginTime;
+        
+        for(var i = 0; i < sheet.cellCount; i++)
+            PrintSheetCell(&sheet, i, format);
+        fflush(stdout);
+        fprintf(stderr, "Loaded %d cells in %d levels in %.3f ms, evaluated in %.1f us\n",
+                sheet.cellCount, sheet.levelCount, loadTime * 1e3, evaluationTime * 1e6);
+    }
+    
+    char *line = NULL;
+    size_t lineCapacity = 0;
+    long lineCount = 0;
+    
+    while(isLoaded && status != 2 && getline(&line, &lineCapacity, stdin) >= 0)
+    {
+        lineCount++;
+        char *text;
+        if(SplitSheetDefinition(line, &text) == 0 || line[0] == '#')
+            continue;
+        
+        if(text == NULL)
+        {
+            var index = FindSheetCell(&sheet, line, strlen(line));
+            if(index >= 0)
+                PrintSheetCell(&sheet, index, format);
+            else
+            {
+                printf("error: line %ld: unknown name\n", lineCount);
+                status = 1;
+            }
+        }
+        else
+        {
+            var cycleLength = 0;
+            var recomputedCount = 0;
+            beginTime = GetCurrentTimeInSeconds();
+            var error = DefineSheetCell(&sheet, line, text, &cycleLength, &recomputedCount);
+            var elapsedTime = GetCurrentTimeInSeconds() - beginTime;
+            
+            if(error == NULL)
+            {
+                for(var i = 0; i < recomputedCount; i++)
+                    PrintSheetCell(&sheet, sheet.orderedCells[i], format);
+                fprintf(stderr, "Recomputed %d of %d cells in %.1f us\n", recomputedCount, sheet.cellCount, elapsedTime * 1e6);
+            }
+            else
+            {
+                printf("error: line %ld: %s", lineCount, error);
+                if(cycleLength > 0)
+                {
+                    fputs(": ", stdout);
+                    PrintSheetCycle(&sheet, cycleLength, stdout);
+                }
+                else
+                    putchar('\n');
+                
+                status = strcmp(error, "out of memory") == 0? 2 : 1;
+            }
+        }
+        fflush(stdout);
+    }
+    
+    free(line);
+    DestroySheet(&sheet);
+    if(sheet.pool != NULL)
+        DestroyWorkerPool(&pool);
+    
+    return status;
+}
+
+/** 表格重算测试中公式所在的层数，不包括输入单元所在的0层 */
+#define SHEET_BENCH_LEVELS          8
+
+/** 表格重算测试中，公式所引用的上一层单元与它自身的位置最多相差多少 */
+#define SHEET_BENCH_WINDOW          3
+
+/** 表格重算测试中修改输入单元的次数 */
+#define SHEET_BENCH_UPDATES         1000
+
+/**
+ * 表格重算测试：生成一张分层的表格，每个公式引用上一层中位置相近的两个单元，然后比较某个输入单元改变之后以下几种做法的耗时：
+ * 像原来那样把每个公式展开为只含字面量的表达式再全部重新计算、按依赖图重算全部单元，以及只重算受影响的单元。
+ * 最后校验按依赖图求出的值与展开后的表达式逐位相同，以及增量重算与全部重算的结果逐位相同
+ * @param cellCount 单元总数
+ * @param threadCount 并行重算的线程数，若不大于0，则使用当前在线的处理器核数
+ * @return 若结果一致，返回0，否则返回1；若存储空间不足，返回2
+*/
+static int BenchmarkSheetRecomputation(long cellCount, int threadCount)
+{
+    // 输入单元都是正数，这些公式的结果也都是正数
+    static const char *const templates[] = {
+        "%s+%s*0.5", "(%s+%s)*0.75", "sqrt(%s*%s)", "cos(%s)*0.5+%s", "%s/(1+%s)"
+    };
+    var templateCount = (int)(sizeof(templates) / sizeof(templates[0]));
+    
+    var perLevel = (int)(cellCount / (SHEET_BENCH_LEVELS + 1));
+    if(perLevel < 2 * SHEET_BENCH_WINDOW + 1)
+        perLevel = 2 * SHEET_BENCH_WINDOW + 1;
+    cellCount = (long)perLevel * (SHEET_BENCH_LEVELS + 1);
+    
+    struct Sheet sheet = { 0 };
+    var expanded = (char**)calloc(cellCount, sizeof(char*));
+    var values = (double*)malloc(sizeof(double) * cellCount);
+    var status = (expanded != NULL && values != NULL)? 0 : 2;
+    
+    // 展开后的表达式总是带有一对括号，以便直接代入引用它的表达式中
+    uint64_t state = 20161220U;
+    size_t expandedLength = 0;
+    long referenceCount = 0;
+    char name[32], refNames[2][32], text[128];
+    for(long i = 0; i < cellCount && status == 0; i++)
+    {
+        var level = (int)(i / perLevel);
+        snprintf(name, sizeof(name), "c%ld", i);
+        
+        if(level == 0)
+        {
+            snprintf(text, sizeof(text), "%.17g", 0.5 + NextRandomNumber(&state) / 4294967296.0 * 2.0);
+            expanded[i] = (char*)malloc(strlen(text) + 3);
+            if(expanded[i] != NULL)
+                sprintf(expanded[i], "(%s)", text);
+        }
+        else
+        {
+            var template = templates[NextRandomNumber(&state) % templateCount];
+            long refs[2];
+            for(var k = 0; k < 2; k++)
+            {
+                var offset = (int)(NextRandomNumber(&state) % (2 * SHEET_BENCH_WINDOW + 1)) - SHEET_BENCH_WINDOW;
+                refs[k] = (long)(level - 1) * perLevel + (i % perLevel + offset + perLevel) % perLevel;
+                snprintf(refNames[k], sizeof(refNames[k]), "c%ld", refs[k]);
+            }
+            snprintf(text, sizeof(text), template, refNames[0], refNames[1]);
+            
+            var length = (size_t)snprintf(NULL, 0, template, expanded[refs[0]], expanded[refs[1]]) + 2;
+            expanded[i] = (char*)malloc(length + 1);
+            if(expanded[i] != NULL)
+            {
+                expanded[i][0] = '(';
+                sprintf(expanded[i] + 1, template, expanded[refs[0]], expanded[refs[1]]);
+                strcpy(expanded[i] + length - 1, ")");
+            }
+            referenceCount += 2;
+        }
+        
+        var index = AddSheetCell(&sheet, name);
+        if(expanded[i] == NULL || index < 0 || CompileSheetFormula(&sheet, text, &sheet.cells[index].formula) != NULL)
+            status = 2;
+        else
+            expandedLength += strlen(expanded[i]);
+    }
+    
+    var cycleLength = 0;
+    if(status == 0 && BuildSheetGraph(&sheet, &cycleLength) != NULL)
+        status = 2;
+    
+    struct WorkerPool pool;
+    var hasPool = status == 0 && CreateWorkerPool(&pool, threadCount);
+    
+    if(status == 0)
+    {
+        printf("Sheet: %ld cells in %d levels, %d inputs, %ld references, expanded formulas %.1f MB\n",
+               cellCount, sheet.levelCount, perLevel, referenceCount, expandedLength / 1048576.0);
+        
+        // 原来的做法：任何输入改变之后，都要重新计算每个公式展开后的表达式。这里不计展开所需的时间
+        var expandedTime = INFINITY;
+        for(var round = 0; round < 3; round++)
+        {
+            var beginTime = GetCurrentTimeInSeconds();
+            for(long i = 0; i < cellCount; i++)
+            {
+                struct CalculationError error;
+                if(!EvaluateArithmeticExpression(expanded[i], strlen(expanded[i]), NULL, &values[i], &error))
+                    values[i] = NAN;
+            }
+            var elapsedTime = GetCurrentTimeInSeconds() - beginTime;
+            if(elapsedTime < expandedTime)
+                expandedTime = elapsedTime;
+        }
+        
+        double fullTimes[2] = { INFINITY, INFINITY };
+        for(var pass = 0; pass < (hasPool && pool.threadCount > 1? 2 : 1); pass++)
+        {
+            sheet.pool = (pass == 0)? NULL : &pool;
+            for(var round = 0; round < 5; round++)
+            {
+                var beginTime = GetCurrentTimeInSeconds();
+                RecomputeSheet(&sheet, NULL, 0);
+                var elapsedTime = GetCurrentTimeInSeconds() - beginTime;
+                if(elapsedTime < fullTimes[pass])
+                    fullTimes[pass] = elapsedTime;
+            }
+        }
+        
+        long expandedMismatchCount = 0;
+        for(long i = 0; i < cellCount; i++)
+            expandedMismatchCount += !IsSameResult(values[i], sheet.cells[i].value);
+        
+        printf("%-44s %10.3f ms\n", "re-evaluate all expanded formulas:", expandedTime * 1e3);
+        printf("%-44s %10.3f ms\n", "recompute all cells (serial):", fullTimes[0] * 1e3);
+        if(fullTimes[1] < INFINITY)
+        {
+            snprintf(text, sizeof(text), "recompute all cells (%d threads):", pool.threadCount);
+            printf("%-44s %10.3f ms\n", text, fullTimes[1] * 1e3);
+        }
+        
+        // 每次随机修改一个输入单元，只重算受影响的单元
+        for(var pass = 0; pass < (fullTimes[1] < INFINITY? 2 : 1); pass++)
+        {
+            sheet.pool = (pass == 0)? NULL : &pool;
+            var totalTime = 0.0;
+            var maxTime = 0.0;
+            long recomputedTotal = 0;
+            
+            for(var update = 0; update < SHEET_BENCH_UPDATES && status == 0; update++)
+            {
+                snprintf(name, sizeof(name), "c%u", NextRandomNumber(&state) % perLevel);
+                snprintf(text, sizeof(text), "%.17g", 0.5 + NextRandomNumber(&state) / 4294967296.0 * 2.0);
+                
+                var recomputedCount = 0;
+                var beginTime = GetCurrentTimeInSeconds();
+                if(DefineSheetCell(&sheet, name, text, &cycleLength, &recomputedCount) != NULL)
+                    status = 2;
+                var elapsedTime = GetCurrentTimeInSeconds() - beginTime;
+                
+                totalTime += elapsedTime;
+                if(elapsedTime > maxTime)
+                    maxTime = elapsedTime;
+                recomputedTotal += recomputedCount;
+            }
+            
+            if(pass == 0)
+                strcpy(text, "incremental update (serial):");
+            else
+                snprintf(text, sizeof(text), "incremental update (%d threads):", pool.threadCount);
+            printf("%-44s %10.1f us mean, %.1f us max, %.1f cells recomputed on average\n",
+                   text, totalTime / SHEET_BENCH_UPDATES * 1e6, maxTime * 1e6, (double)recomputedTotal / SHEET_BENCH_UPDATES);
+            if(pass == 0)
+                printf("Speedup of incremental updates: %.0fx over expanded formulas, %.1fx over recomputing all cells\n",
+                       expandedTime / (totalTime / SHEET_BENCH_UPDATES), fullTimes[0] / (totalTime / SHEET_BENCH_UPDATES));
+        }
+        
+        // 增量重算之后的值应当与重新全部重算的结果逐位相同
+        long incrementalMismatchCount = 0;
+        for(long i = 0; i < cellCount; i++)
+            values[i] = sheet.cells[i].value;
+        RecomputeSheet(&sheet, NULL, 0);
+        for(long i = 0; i < cellCount; i++)
+            incrementalMismatchCount += !IsSameResult(values[i], sheet.cells[i].value);
+        
+        printf("Identical to expanded formulas: %s, incremental identical to full recomputation: %s\n",
+               expandedMismatchCount == 0? "yes" : "no", incrementalMismatchCount == 0? "yes" : "no");
+        if(status == 0 && (expandedMismatchCount > 0 || incrementalMismatchCount > 0))
+            status = 1;
+    }
+    
+    if(status == 2)
+        fputs("Out of memory!\n", stderr);
+    
+    if(hasPool)
+        DestroyWorkerPool(&pool);
+    DestroySheet(&sheet);
+    for(long i = 0; expanded != NULL && i < cellCount; i++)
+        free(expanded[i]);
+    free(expanded);
+    free(values);
+    
+    return status;
+}
+
+/**
+ * 比较区间归约与逐项调用EvaluateArithmeticProgram并直接累加的做法：
+ * 计时sum(i,1,N,1/i^2)在不同线程数下每秒归约的项数，检查各线程数下的结果逐位相同，
+ * 并以long double补偿求和的结果为参照，比较补偿求和与直接累加的误差
+ * @param termCount 项数
+ * @param maxThreadCount 最多使用的线程数，不大于0时使用全部在线的处理器
+ * @return 若结果一致并且补偿求和的误差不超过1 ULP，返回0，若结果不一致，返回1，若存储空间不足，返回2
+*/
+static int BenchmarkRangeReduction(long termCount, int maxThreadCount)
+{
+    if(maxThreadCount <= 0)
+        maxThreadCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(maxThreadCount < 1)
+        maxThreadCount = 1;
+    
+    char expr[64];
+    var exprLength = (size_t)snprintf(expr, sizeof(expr), "sum(i,1,%ld,1/i^2)", termCount);
+    static const char *const variableNames[] = { "i" };
+    var program = CompileArithmeticExpression("1/i^2", variableNames, 1);
+    if(program == NULL)
+    {
+        fputs("Out of memory!\n", stderr);
+        return 2;
+    }
+    
+    // 以前的做法：逐项求值并直接累加。参照值用long double做补偿求和，所累加的是同样的double项
+    var naiveSum = 0.0;
+    long double referenceSum = 0.0L;
+    long double referenceCompensation = 0.0L;
+    var beginTime = GetCurrentTimeInSeconds();
+    for(long i = 1; i <= termCount; i++)
+        naiveSum += EvaluateArithmeticProgram(program, (const double[]){ (double)i });
+    var naiveTime = GetCurrentTimeInSeconds() - beginTime;
+    for(long i = 1; i <= termCount; i++)
+    {
+        long double term = EvaluateArithmeticProgram(program, (const double[]){ (double)i });
+        var sum = referenceSum + term;
+        if(fabsl(referenceSum) >= fabsl(term))
+            referenceCompensation += (referenceSum - sum) + term;
+        else
+            referenceCompensation += (term - sum) + referenceSum;
+        referenceSum = sum;
+    }
+    var reference = (double)(referenceSum + referenceCompensation);
+    DestroyArithmeticProgram(program);
+    
+    printf("Expression: %s\n", expr);
+    printf("%-36s %12.1f M terms/s\n", "per-term evaluation, naive sum:", termCount / naiveTime * 1e-6);
+    
+    var status = 0;
+    var firstValue = 0.0;
+    var firstTime = 0.0;
+    for(var threadCount = 1; status != 2; threadCount = (threadCount * 2 < maxThreadCount)? threadCount * 2 : maxThreadCount)
+    {
+        SetReductionThreadCount(threadCount);
+        double value;
+        struct CalculationError error;
+        beginTime = GetCurrentTimeInSeconds();
+        if(!EvaluateArithmeticExpression(expr, exprLength, NULL, &value, &error))
+        {
+            fprintf(stderr, "%s\n", GetCalculationErrorMessage(error.code));
+            status = 2;
+            break;
+        }
+        var elapsedTime = GetCurrentTimeInSeconds() - beginTime;
+        
+        if(threadCount == 1)
+        {
+            firstValue = value;
+            firstTime = elapsedTime;
+        }
+        else if(!IsSameResult(value, firstValue))
+            status = 1;
+        
+        char label[64];
+        snprintf(label, sizeof(label), "sum reduction, %d thread%s:", threadCount, threadCount > 1? "s" : "");
+        printf("%-36s %12.1f M terms/s, %.1fx over per-term evaluation, %.2fx over 1 thread\n",
+               label, termCount / elapsedTime * 1e-6, naiveTime / elapsedTime, firstTime / elapsedTime);
+        
+        if(threadCount == maxThreadCount)
+            break;
+    }
+    SetReductionThreadCount(0);
+    
+    if(status != 2)
+    {
+        // 以参照值处的ULP为单位衡量误差
+        var ulp = nextafter(reference, INFINITY) - reference;
+        var reductionError = fabs(firstValue - reference) / ulp;
+        printf("Reference (long double compensated): %.17g\n", reference);
+        printf("Naive sum:                           %.17g (%.0f ULP off)\n", naiveSum, fabs(naiveSum - reference) / ulp);
+        printf("Compensated reduction:               %.17g (%.0f ULP off)\n", firstValue, reductionError);
+        printf("Identical across thread counts: %s\n", status == 0? "yes" : "no");
+        if(reductionError > 1.0)
+            status = 1;
+    }
+    
+    return status;
+}
+
+/**
+ * 将表达式中单独出现的变量名替换为带括号的数值，用于模拟从外部逐点拼接表达式并计算的做法
+ * @return 替换之后的长度，若超出缓存容量，返回0
+*/
+static size_t SubstituteVariable(const char *expr, const char *name, double value, char buffer[], size_t capacity)
+{
+    char text[RESULT_STRING_SIZE + 2];
+    var textLength = (size_t)FormatArithmeticResult(value, NULL, &text[1]) + 2;
+    text[0] = '(';
+    text[textLength - 1] = ')';
+    
+    var nameLength = strlen(name);
+    size_t length = 0;
+    for(var cursor = expr; *cursor != '\0'; )
+    {
+        var isName = strncmp(cursor, name, nameLength) == 0 && (cursor == expr || !IsMathFunctionNameCharacter(cursor[-1])) &&
+                     !IsMathFunctionNameCharacter(cursor[nameLength]) && cursor[nameLength] != '_';
+        var pieceLength = isName? textLength : 1;
+        if(length + pieceLength >= capacity)
+            return 0;
+        memcpy(&buffer[length], isName? text : cursor, pieceLength);
+        length += pieceLength;
+        cursor += isName? nameLength : 1;
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
+/**
+ * 数值积分与求根的测试：对一组已知精确值的问题，报告被积函数或者方程的求值次数、结果的误差以及整个调用的耗时，
+ * 并与从外部逐点拼接表达式再计算的做法相比较。后者的耗时按同样的求值次数估算，且不包括启动进程的开销
+ * @param repeatCount 每个问题重复计算的次数，取平均耗时
+ * @return 若所有结果的相对误差都不超过1e-9，返回0，否则返回1；若存储空间不足，返回2
+*/
+static int BenchmarkQuadrature(long repeatCount)
+{
+    enum { SAMPLE_POINT_COUNT = 20000 };
+    static const struct
+    {
+        enum REDUCTION_KIND kind;
+        const char *body;
+        double lower;
+        double upper;
+        double exact;
+    } problems[] = {
+        { REDUCTION_KIND_INTEGRATE, "sin(x)", 0.0, M_PI, 2.0 },
+        { REDUCTION_KIND_INTEGRATE, "exp(x)", 0.0, 1.0, M_E - 1.0 },
+        { REDUCTION_KIND_INTEGRATE, "1/x", 1.0, M_E, 1.0 },
+        { REDUCTION_KIND_INTEGRATE, "sin(x)^2", 0.0, 100.0, 50.21832432430349 },
+        { REDUCTION_KIND_INTEGRATE, "exp(0-(x^2))", -3.0, 3.0, 1.7724146965190428 },
+        { REDUCTION_KIND_INTEGRATE, "sqrt(x)", 0.0, 1.0, 2.0 / 3.0 },
+        { REDUCTION_KIND_INTEGRATE, "sqrt(1-(x^2))", -1.0, 1.0, M_PI / 2.0 },
+        { REDUCTION_KIND_INTEGRATE, "ln(x)", 0.0, 1.0, -1.0 },
+        { REDUCTION_KIND_SOLVE, "x^2-2", 0.0, 2.0, M_SQRT2 },
+        { REDUCTION_KIND_SOLVE, "cos(x)-x", 0.0, 1.0, 0.7390851332151607 },
+        { REDUCTION_KIND_SOLVE, "x^3-2*x-5", -5.0, 5.0, 2.0945514815423265 },
+        { REDUCTION_KIND_SOLVE, "sin(x)", 3.0, 4.0, M_PI },
+        { REDUCTION_KIND_SOLVE, "exp(x)-10", 0.0, 5.0, M_LN10 }
+    };
+    static const char *const variableNames[] = { "x" };
+    
+    printf("%-40s %6s %22s %9s %10s %12s %8s\n", "Problem", "Evals", "Result", "Rel. err", "Call (us)", "Per point (us)", "Speedup");
+    
+    var status = 0;
+    for(size_t i = 0; i < sizeof(problems) / sizeof(problems[0]) && status != 2; i++)
+    {
+        const var problem = &problems[i];
+        char expr[256];
+        char bounds[2][RESULT_STRING_SIZE];
+        bounds[0][FormatArithmeticResult(problem->lower, NULL, bounds[0])] = '\0';
+        bounds[1][FormatArithmeticResult(problem->upper, NULL, bounds[1])] = '\0';
+        var exprLength = (size_t)snprintf(expr, sizeof(expr), "%s(x,%s,%s,%s)", reductionNames[problem->kind], bounds[0], bounds[1], problem->body);
+        
+        var program = CompileArithmeticExpression(problem->body, variableNames, 1);
+        double value = NAN;
+        long evaluationCount = 0;
+        if(program == NULL ||
+           !(problem->kind == REDUCTION_KIND_INTEGRATE? IntegrateArithmeticProgram : SolveArithmeticProgram)(program, problem->lower, problem->upper, MATH_KERNEL_SET_LIBM, &value, &evaluationCount))
+        {
+            fputs("Out of memory!\n", stderr);
+            DestroyArithmeticProgram(program);
+            status = 2;
+            break;
+        }
+        DestroyArithmeticProgram(program);
+        
+        // 整个调用的耗时，包括解析与编译
+        var isSuccessful = true;
+        var beginTime = GetCurrentTimeInSeconds();
+        for(long k = 0; k < repeatCount && isSuccessful; k++)
+        {
+            double result;
+            struct CalculationError error;
+            isSuccessful = EvaluateArithmeticExpression(expr, exprLength, NULL, &result, &error) && IsSameResult(result, value);
+        }
+        var callTime = (GetCurrentTimeInSeconds() - beginTime) / repeatCount;
+        
+        // 外部循环的做法：每个取样点都把数值拼接进表达式文本，再从头解析计算
+        var checksum = 0.0;
+        beginTime = GetCurrentTimeInSeconds();
+        for(var k = 0; k < SAMPLE_POINT_COUNT; k++)
+        {
+            char text[512];
+            var x = problem->lower + (problem->upper - problem->lower) * (k + 0.5) / SAMPLE_POINT_COUNT;
+            var textLength = SubstituteVariable(problem->body, "x", x, text, sizeof(text));
+            double result;
+            struct CalculationError error;
+            if(EvaluateArithmeticExpression(text, textLength, NULL, &result, &error))
+                checksum += result;
+        }
+        var pointTime = (GetCurrentTimeInSeconds() - beginTime) / SAMPLE_POINT_COUNT;
+        (void)checksum;
+        
+        var relativeError = fabs(value - problem->exact) / fmax(1.0, fabs(problem->exact));
+        if(!isSuccessful || !(relativeError <= 1e-9))
+            status = 1;
+        
+        printf("%-40s %6ld %22.17g %9.1e %10.2f %12.3f %7.0fx%s\n", expr, evaluationCount, value, relativeError, callTime * 1e6, pointTime * 1e6,
+               pointTime * evaluationCount / callTime, isSuccessful? "" : " (mismatch)");
+    }
+    
+    return status;
+}
+
+/** 按列文件模式中每个任务块所处理的输入数据量 */
+#define COLUMN_FILE_CHUNK_SIZE          (4 << 20)
+
+/** 按列文件模式中每次交给EvaluateArithmeticProgramColumns求值的行数 */
+#define COLUMN_FILE_BLOCK_ROWS          4096
+
+/** 按列文件模式中每轮交给线程池的任务块个数是线程数的这么多倍，每轮结束之后按顺序写出各块的结果 */
+#define COLUMN_FILE_CHUNKS_PER_THREAD   4
+
+/** CSV文件的表头中最多能有的字段个数 */
+#define COLUMN_FILE_MAX_FIELDS          4096
+
+/** 按列文件模式的输入格式 */
+enum COLUMN_FILE_KIND
+{
+    /** 以','分隔的文本，第一行为表头，合法的字段名都可以作为变量名在表达式中使用 */
+    COLUMN_FILE_KIND_CSV = 0,
+    
+    /** 不带文件头的小端double，每行依次存放各个字段，只有一个字段时就是一整列 */
+    COLUMN_FILE_KIND_BINARY
+};
+
+/** 按列文件模式中的一个任务块，即输入中连续的若干完整行 */
+struct ColumnFileChunk
+{
+    const char *begin;
+    const char *end;
+    
+    long rowCount;
+    long invalidCount;
+    
+    /** 块中第一个非法行相对于块起始处的行索引，-1表示没有非法行 */
+    long firstInvalidRow;
+    
+    /** 该块的输出，各轮之间复用 */
+    char *output;
+    size_t outputLength;
+    size_t outputCapacity;
+    
+    bool isOutOfMemory;
+};
+
+/** 按列文件模式中各个任务块共享的只读上下文 */
+struct ColumnFileJob
+{
+    enum COLUMN_FILE_KIND kind;
+    const struct ArithmeticProgram *program;
+    const struct ResultFormat *format;
+    
+    /** 每行的字段个数 */
+    int fieldCount;
+    
+    /** 各个字段所绑定的变量槽位，-1表示表达式没有用到该字段，因此无需解析 */
+    int *fieldSlots;
+    
+    /** 最后一个被用到的字段的索引，其后的字段都直接跳过；-1表示表达式中没有变量 */
+    int lastUsedField;
+    
+    struct ColumnFileChunk *chunks;
+};
+
+/** 按列文件模式的统计信息 */
+struct ColumnFileStatistics
+{
+    long rowCount;
+    long invalidCount;
+    size_t inputSize;
+    int threadCount;
+    double elapsedTime;
+};
+
+/** 从不一定对齐的地址读取一个小端double */
+static inline double ReadLittleEndianDouble(const char *data)
+{
+    uint64_t bits;
+    memcpy(&bits, data, sizeof(bits));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    bits = __builtin_bswap64(bits);
+#endif
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/** 确保任务块的输出缓存至少还能容纳extraLength个字节 */
+static bool ReserveColumnFileOutput(struct ColumnFileChunk *chunk, size_t extraLength)
+{
+    if(chunk->outputLength + extraLength <= chunk->outputCapacity)
+        return true;
+    
+    var capacity = chunk->outputCapacity * 2;
+    if(capacity < chunk->outputLength + extraLength)
+        capacity = chunk->outputLength + extraLength;
+    var output = (char*)realloc(chunk->output, capacity);
+    if(output == NULL)
+        return false;
+    
+    chunk->output = output;
+    chunk->outputCapacity = capacity;
+    return true;
+}
+
+/**
+ * 直接在CSV数据上解析一个数值字段，字段前后可以有空格或制表符，数字前可以有正负号
+ * @param cursor 指向字段的第一个字符
+ * @param pValue 输出字段的值
+ * @return 若字段合法，返回字段之后的','或者换行符的位置，否则返回NULL
+*/
+static const char* ParseCsvNumber(const char *cursor, double *pValue)
+{
+    while(*cursor == ' ' || *cursor == '\t')
+        cursor++;
+    
+    var isNegative = *cursor == '-';
+    if(*cursor == '-' || *cursor == '+')
+        cursor++;
+    if(!IsDigital(*cursor))
+        return NULL;
+    
+    // 数字之后一定跟着','或者换行符，因此ParseNumberLiteral不会越过当前行
+    int length;
+    var value = ParseNumberLiteral(cursor, &length);
+    cursor += length;
+    
+    while(*cursor == ' ' || *cursor == '\t' || *cursor == '\r')
+        cursor++;
+    if(*cursor != ',' && *cursor != '\n')
+        return NULL;
+    
+    *pValue = isNegative? -value : value;
+    return cursor;
+}
+
+/**
+ * 解析CSV中的一行，只解析表达式所用到的字段，其余字段直接跳过
+ * @param cursor 指向行首，该行必须以换行符结尾
+ * @param columns 各个变量槽位的输入列，被用到的字段的值写入其第row个元素
+ * @param pIsValid 输出被用到的字段是否都是合法的数值
+ * @return 下一行的行首
+*/
+static const char* ParseCsvRow(const struct ColumnFileJob *job, const char *cursor, const char *end, double *const columns[], int row, bool *pIsValid)
+{
+    var isValid = true;
+    
+    for(var field = 0; field <= job->lastUsedField; field++)
+    {
+        if(field > 0)
+        {
+            // 字段不足
+            if(*cursor != ',')
+            {
+                isValid = false;
+                break;
+            }
+            cursor++;
+        }
+        
+        var slot = job->fieldSlots[field];
+        if(slot < 0)
+        {
+            while(*cursor != ',' && *cursor != '\n')
+                cursor++;
+            continue;
+        }
+        
+        double value;
+        var next = ParseCsvNumber(cursor, &value);
+        if(next == NULL)
+        {
+            isValid = false;
+            break;
+        }
+        columns[slot][row] = value;
+        cursor = next;
+    }
+    
+    *pIsValid = isValid;
+    return (const char*)memchr(cursor, '\n', end - cursor) + 1;
+}
+
+/** 对CSV任务块中的各行求值，每行输出一行文本结果，非法行输出空行 */
+static void ProcessCsvChunk(const struct ColumnFileJob *job, struct ColumnFileChunk *chunk)
+{
+    const var variableCount = job->program->variableCount;
+    var columns = (double**)calloc(variableCount + 1, sizeof(double*));
+    var values = (double*)malloc(sizeof(double) * COLUMN_FILE_BLOCK_ROWS * (job->lastUsedField + 2));
+    var validFlags = (bool*)malloc(sizeof(bool) * COLUMN_FILE_BLOCK_ROWS);
+    if(columns == NULL || values == NULL || validFlags == NULL)
+    {
+        chunk->isOutOfMemory = true;
+        free(columns);
+        free(values);
+        free(validFlags);
+        return;
+    }
+    
+    // 只为被用到的变量准备输入列，最后一块用作输出列
+    var output = values;
+    var index = 1;
+    for(var field = 0; field <= job->lastUsedField; field++)
+    {
+        if(job->fieldSlots[field] >= 0)
+            columns[job->fieldSlots[field]] = &values[COLUMN_FILE_BLOCK_ROWS * index++];
+    }
+    
+    var cursor = chunk->begin;
+    while(cursor < chunk->end && !chunk->isOutOfMemory)
+    {
+        var rowCount = 0;
+        while(rowCount < COLUMN_FILE_BLOCK_ROWS && cursor < chunk->end)
+        {
+            // 跳过空行
+            if(*cursor == '\n' || (cursor[0] == '\r' && cursor[1] == '\n'))
+            {
+                cursor += (*cursor == '\n')? 1 : 2;
+                continue;
+            }
+            
+            cursor = ParseCsvRow(job, cursor, chunk->end, columns, rowCount, &validFlags[rowCount]);
+            if(!validFlags[rowCount])
+            {
+                for(var slot = 0; slot < variableCount; slot++)
+                {
+                    if(columns[slot] != NULL)
+                        columns[slot][rowCount] = 0.0;
+                }
+            }
+            rowCount++;
+        }
+        
+        if(!EvaluateArithmeticProgramColumnsWithKernels(job->program, (const double *const*)columns, output, rowCount, job->format->kernelSet) ||
+           !ReserveColumnFileOutput(chunk, (size_t)rowCount * RESULT_STRING_SIZE))
+        {
+            chunk->isOutOfMemory = true;
+            break;
+        }
+        
+        for(var row = 0; row < rowCount; row++)
+        {
+            if(validFlags[row])
+                chunk->outputLength += FormatArithmeticResult(output[row], job->format, &chunk->output[chunk->outputLength]);
+            else
+            {
+                if(chunk->firstInvalidRow < 0)
+                    chunk->firstInvalidRow = chunk->rowCount + row;
+                chunk->invalidCount++;
+            }
+            chunk->output[chunk->outputLength++] = '\n';
+        }
+        chunk->rowCount += rowCount;
+    }
+    
+    free(columns);
+    free(values);
+    free(validFlags);
+}
+
+/**
+ * 对二进制任务块中的各行求值，每行输出一个小端double。
+ * 只有一个字段并且本机为小端时，映射区域本身就是输入列，不做任何拷贝
+*/
+static void ProcessBinaryChunk(const struct ColumnFileJob *job, struct ColumnFileChunk *chunk)
+{
+    const var rowSize = sizeof(double) * job->fieldCount;
+    const var rowCount = (size_t)(chunk->end - chunk->begin) / rowSize;
+    if(!ReserveColumnFileOutput(chunk, rowCount * sizeof(double)))
+    {
+        chunk->isOutOfMemory = true;
+        return;
+    }
+    var output = (double*)chunk->output;
+    
+    var isDirect = job->fieldCount == 1 && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+    const double *directColumns[] = { (const double*)chunk->begin };
+    var columns = isDirect? NULL : (double**)calloc(job->fieldCount, sizeof(double*));
+    var values = isDirect? NULL : (double*)malloc(sizeof(double) * COLUMN_FILE_BLOCK_ROWS * job->fieldCount);
+    
+    if(isDirect)
+        chunk->isOutOfMemory = !EvaluateArithmeticProgramColumnsWithKernels(job->program, directColumns, output, rowCount, job->format->kernelSet);
+    else if(columns == NULL || values == NULL)
+        chunk->isOutOfMemory = true;
+    else
+    {
+        for(var field = 0; field <= job->lastUsedField; field++)
+        {
+            if(job->fieldSlots[field] >= 0)
+                columns[field] = &values[COLUMN_FILE_BLOCK_ROWS * field];
+        }
+        
+        for(size_t first = 0; first < rowCount && !chunk->isOutOfMemory; first += COLUMN_FILE_BLOCK_ROWS)
+        {
+            var blockRowCount = (rowCount - first < COLUMN_FILE_BLOCK_ROWS)? (int)(rowCount - first) : COLUMN_FILE_BLOCK_ROWS;
+            
+            // 将各行中被用到的字段拆分到各自的输入列中
+            for(var field = 0; field <= job->lastUsedField; field++)
+            {
+                if(columns[field] == NULL)
+                    continue;
+                const var source = chunk->begin + first * rowSize + sizeof(double) * field;
+                for(var row = 0; row < blockRowCount; row++)
+                    columns[field][row] = ReadLittleEndianDouble(source + row * rowSize);
+            }
+            
+            chunk->isOutOfMemory = !EvaluateArithmeticProgramColumnsWithKernels(job->program, (const double *const*)columns, &output[first], blockRowCount, job->format->kernelSet);
+        }
+    }
+    
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for(size_t row = 0; row < rowCount; row++)
+    {
+        uint64_t bits;
+        memcpy(&bits, &output[row], sizeof(bits));
+        bits = __builtin_bswap64(bits);
+        memcpy(&output[row], &bits, sizeof(bits));
+    }
+#endif
+    
+    chunk->rowCount = (long)rowCount;
+    chunk->outputLength = rowCount * sizeof(double);
+    free(columns);
+    free(values);
+}
+
+static void ProcessColumnFileChunk(void *context, int taskIndex)
+{
+    const var job = (const struct ColumnFileJob*)context;
+    var chunk = &job->chunks[taskIndex];
+    
+    chunk->rowCount = 0;
+    chunk->invalidCount = 0;
+    chunk->firstInvalidRow = -1;
+    chunk->outputLength = 0;
+    chunk->isOutOfMemory = false;
+    
+    if(job->kind == COLUMN_FILE_KIND_CSV)
+        ProcessCsvChunk(job, chunk);
+    else
+        ProcessBinaryChunk(job, chunk);
+}
+
+/**
+ * 将CSV的表头拆分为字段名，字段名前后的空白以及包围它的双引号都会被去掉
+ * @param header 表头，不包括换行符
+ * @param names 输出各个字段名，每个字段名都需用free释放
+ * @return 字段个数，若字段过多或者存储空间不足，返回-1
+*/
+static int SplitCsvHeader(const char *header, size_t length, char *names[COLUMN_FILE_MAX_FIELDS])
+{
+    var count = 0;
+    var end = header + length;
+    
+    for(var cursor = header; ; cursor++)
+    {
+        var fieldEnd = (const char*)memchr(cursor, ',', end - cursor);
+        if(fieldEnd == NULL)
+            fieldEnd = end;
+        
+        while(cursor < fieldEnd && (*cursor == ' ' || *cursor == '\t' || *cursor == '"'))
+            cursor++;
+        var nameEnd = fieldEnd;
+        while(nameEnd > cursor && (nameEnd[-1] == ' ' || nameEnd[-1] == '\t' || nameEnd[-1] == '\r' || nameEnd[-1] == '"'))
+            nameEnd--;
+        
+        if(count == COLUMN_FILE_MAX_FIELDS || (names[count] = strndup(cursor, nameEnd - cursor)) == NULL)
+        {
+            while(count > 0)
+                free(names[--count]);
+            return -1;
+        }
+        count++;
+        
+        cursor = fieldEnd;
+        if(cursor == end)
+            break;
+    }
+    
+    return count;
+}
+
+/**
+ * 判定表达式中是否把某个字段名当作一个完整的名字使用，忽略大小写。
+ * 后面紧跟'('的是函数调用，不算对字段的引用
+*/
+static bool IsColumnNameUsed(const char *expr, const char *name)
+{
+    var length = strlen(name);
+    if(length == 0)
+        return false;
+    
+    for(var cursor = expr; *cursor != '\0'; cursor++)
+    {
+        if(strncasecmp(cursor, name, length) == 0 &&
+           (cursor == expr || !IsVariableNameCharacter(NormalizeArithmeticCharacter(cursor[-1]))) &&
+           !IsVariableNameCharacter(NormalizeArithmeticCharacter(cursor[length])) && cursor[length] != '(')
+            return true;
+    }
+    return false;
+}
+
+/**
+ * 表达式编译失败时报告原因：表达式用到了不能作为变量名的字段，或者用到了表头中没有的名字，
+ * 否则只报告表达式非法
+ * @param names 各个字段名
+ * @param variableFields 各个变量所绑定的字段的索引
+*/
+static void ReportColumnFileExpressionError(const char *expr, char *const names[], int fieldCount, const int variableFields[], int variableCount)
+{
+    for(int field = 0, variable = 0; field < fieldCount; field++)
+    {
+        if(variable < variableCount && variableFields[variable] == field)
+            variable++;
+        else if(IsColumnNameUsed(expr, names[field]))
+        {
+            fprintf(stderr, "Column \"%s\" is not a valid variable name: %s\n", names[field], expr);
+            return;
+        }
+    }
+    
+    // 归约的索引变量不是字段，记下它们以免误报
+    const char *indexNames[FORMULA_MAX_INDEX_NAMES];
+    size_t indexLengths[FORMULA_MAX_INDEX_NAMES];
+    var indexCount = 0;
+    
+    for(var cursor = expr; *cursor != '\0'; )
+    {
+        var ch = NormalizeArithmeticCharacter(*cursor);
+        if(IsDigital(ch) || ch == '.')
+        {
+            // 跳过数字字面量，其中的字母不是名字
+            var end = cursor + 1;
+            while(IsVariableNameCharacter(NormalizeArithmeticCharacter(*end)) || *end == '.')
+                end++;
+            if(NormalizeArithmeticCharacter(end[-1]) == 'e' && (*end == '+' || *end == '-'))
+            {
+                end++;
+                while(IsDigital(*end))
+                    end++;
+            }
+            cursor = end;
+            continue;
+        }
+        if(!IsMathFunction(ch))
+        {
+            cursor++;
+            continue;
+        }
+        
+        size_t length = 1;
+        while(IsVariableNameCharacter(NormalizeArithmeticCharacter(cursor[length])))
+            length++;
+        
+        char lowerName[MATH_FUNCTION_NAME_MAX_LENGTH + 1] = { '\0' };
+        if(length <= MATH_FUNCTION_NAME_MAX_LENGTH)
+        {
+            for(size_t i = 0; i < length; i++)
+                lowerName[i] = NormalizeArithmeticCharacter(cursor[i]);
+        }
+        
+        var isKnown = false;
+        for(var i = 0; i < variableCount && !isKnown; i++)
+            isKnown = strncasecmp(names[variableFields[i]], cursor, length) == 0 && names[variableFields[i]][length] == '\0';
+        for(var i = 0; i < indexCount && !isKnown; i++)
+            isKnown = indexLengths[i] == length && strncasecmp(indexNames[i], cursor, length) == 0;
+        
+        var funcLength = 0;
+        size_t indexLength;
+        if(!isKnown && length <= MATH_FUNCTION_NAME_MAX_LENGTH)
+            isKnown = IsMathConstant(lowerName) == (int)length || (ParseMathFunctionIndex(lowerName, &funcLength) >= 0 && funcLength == (int)length);
+        if(!isKnown && ParseFormulaReduction(cursor, length, &indexLength))
+        {
+            isKnown = true;
+            if(indexLength > 0 && indexCount < FORMULA_MAX_INDEX_NAMES)
+            {
+                indexNames[indexCount] = cursor + length + 1;
+                indexLengths[indexCount++] = indexLength;
+            }
+        }
+        
+        if(!isKnown)
+        {
+            fprintf(stderr, "Unknown column %.*s: %s\n", (int)length, cursor, expr);
+            return;
+        }
+        cursor += length;
+    }
+    
+    fprintf(stderr, "Invalid expression: %s\n", expr);
+}
+
+/**
+ * 按列文件模式：将CSV文件或者二进制double文件只读地映射到内存中，把字段名绑定为表达式中的变量，
+ * 对每一行求值，并按输入的顺序将结果写入输出文件。
+ * 数值字段直接在映射区域上解析，不做拷贝；输入被切分成若干任务块交由线程池并行处理
+ * @param expr 对每一行求值的表达式
+ * @param inputPath 输入文件的路径
+ * @param outputPath 输出文件的路径，若为"-"，则写到标准输出。CSV输入的每行结果输出为一行文本，非法行输出空行；二进制输入的每行结果输出为一个小端double
+ * @param binaryFields 若为NULL，则输入为CSV；否则输入为二进制文件，它是以','分隔的各个字段名
+ * @param threadCount 工作线程个数，若不大于0，则使用当前在线的处理器核数
+ * @param format CSV输出结果的格式化方式，以及计算时数学函数的实现方式
+ * @param pStatistics 输出统计信息，可为NULL
+ * @return 若所有行均计算成功，返回0；若表达式或者某些行非法，返回1；若无法读写文件或者存储空间不足，返回2
+*/
+static int RunColumnFileMode(const char *expr, const char *inputPath, const char *outputPath, const char *binaryFields, int threadCount,
+                             const struct ResultFormat *format, struct ColumnFileStatistics *pStatistics)
+{
+    var fd = open(inputPath, O_RDONLY);
+    struct stat status;
+    if(fd < 0 || fstat(fd, &status) != 0)
+    {
+        fprintf(stderr, "Cannot open file: %s\n", inputPath);
+        if(fd >= 0)
+            close(fd);
+        return 2;
+    }
+    
+    var mappingSize = (size_t)status.st_size;
+    var mapping = (mappingSize > 0)? mmap(NULL, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if(mapping == MAP_FAILED)
+    {
+        fprintf(stderr, "Cannot map file: %s\n", inputPath);
+        return 2;
+    }
+    if(mapping != NULL)
+        madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+    
+    const var data = (const char*)mapping;
+    const char *dataBegin = data;
+    const char *dataEnd = data + mappingSize;
+    
+    // 取得字段名
+    char *names[COLUMN_FILE_MAX_FIELDS];
+    var fieldCount = 0;
+    var kind = (binaryFields != NULL)? COLUMN_FILE_KIND_BINARY : COLUMN_FILE_KIND_CSV;
+    if(kind == COLUMN_FILE_KIND_CSV)
+    {
+        var headerEnd = (mappingSize > 0)? (const char*)memchr(data, '\n', mappingSize) : NULL;
+        dataBegin = (headerEnd != NULL)? headerEnd + 1 : dataEnd;
+        fieldCount = (mappingSize > 0)? SplitCsvHeader(data, ((headerEnd != NULL)? headerEnd : dataEnd) - data, names) : 0;
+        if(mappingSize == 0)
+            fprintf(stderr, "%s has no header line\n", inputPath);
+    }
+    else
+    {
+        var fieldBuffer = strdup(binaryFields);
+        const char *fieldNames[PRECOMPILE_MAX_VARIABLES];
+        fieldCount = (fieldBuffer != NULL)? SplitVariableNames(fieldBuffer, fieldNames) : -1;
+        for(var i = 0; i < fieldCount; i++)
+        {
+            if((names[i] = strdup(fieldNames[i])) == NULL)
+            {
+                while(i > 0)
+                    free(names[--i]);
+                fieldCount = -1;
+                break;
+            }
+        }
+        free(fieldBuffer);
+        
+        if(fieldCount == 0)
+            fputs("At least one field must be named for a binary input!\n", stderr);
+        else if(fieldCount > 0 && mappingSize % (sizeof(double) * fieldCount) != 0)
+        {
+            fprintf(stderr, "The size of %s is not a multiple of %d doubles\n", inputPath, fieldCount);
+            while(fieldCount > 0)
+                free(names[--fieldCount]);
+        }
+    }
+    if(fieldCount <= 0)
+    {
+        if(fieldCount < 0)
+            fputs("Too many fields or out of memory!\n", stderr);
+        if(mapping != NULL)
+            munmap(mapping, mappingSize);
+        return 2;
+    }
+    
+    // 表头中可能有不能作为变量名的字段（比如含有空格、与函数同名或者为空），它们不绑定为变量，表达式不用到它们就不影响计算
+    const char *variableNames[COLUMN_FILE_MAX_FIELDS];
+    int variableFields[COLUMN_FILE_MAX_FIELDS];
+    var variableCount = 0;
+    for(var i = 0; i < fieldCount; i++)
+    {
+        if(IsValidVariableName(names[i]))
+        {
+            variableNames[variableCount] = names[i];
+            variableFields[variableCount++] = i;
+        }
+    }
+    
+    var program = CompileArithmeticExpression(expr, variableNames, variableCount);
+    struct WorkerPool pool;
+    struct ColumnFileJob job = { .kind = kind, .program = program, .format = format, .fieldCount = fieldCount, .lastUsedField = -1 };
+    job.fieldSlots = (int*)malloc(sizeof(int) * fieldCount);
+    var output = (strcmp(outputPath, "-") == 0)? stdout : fopen(outputPath, "wb");
+    var hasPool = false;
+    var exitStatus = 2;
+    
+    // 若CSV的最后一行没有换行符，就将其拷贝出来并补上换行符，这样解析时永远不会越过映射区域
+    char *tail = NULL;
+    size_t tailLength = 0;
+    
+    if(program == NULL)
+    {
+        ReportColumnFileExpressionError(expr, names, fieldCount, variableFields, variableCount);
+        exitStatus = 1;
+    }
+    else if(output == NULL)
+        fprintf(stderr, "Cannot open file: %s\n", outputPath);
+    else if(job.fieldSlots == NULL || !(hasPool = CreateWorkerPool(&pool, threadCount)))
+        fputs("Out of memory!\n", stderr);
+    else
+    {
+        // 只有被指令引用到的变量才需要解析
+        for(var i = 0; i < fieldCount; i++)
+            job.fieldSlots[i] = -1;
+        for(var i = 0; i < program->instructionCount; i++)
+        {
+            if(program->instructions[i].opcode == PROGRAM_OPCODE_PUSH_VARIABLE)
+                job.fieldSlots[variableFields[program->instructions[i].operand]] = (int)program->instructions[i].operand;
+        }
+        for(var i = 0; i < fieldCount; i++)
+        {
+            if(job.fieldSlots[i] >= 0)
+                job.lastUsedField = i;
+        }
+        
+        if(kind == COLUMN_FILE_KIND_CSV && dataEnd > dataBegin && dataEnd[-1] != '\n')
+        {
+            var lastLine = dataEnd;
+            while(lastLine > dataBegin && lastLine[-1] != '\n')
+                lastLine--;
+            tailLength = dataEnd - lastLine + 1;
+            if((tail = (char*)malloc(tailLength)) != NULL)
+            {
+                memcpy(tail, lastLine, tailLength - 1);
+                tail[tailLength - 1] = '\n';
+                dataEnd = lastLine;
+            }
+        }
+        
+        var chunkCount = pool.threadCount * COLUMN_FILE_CHUNKS_PER_THREAD;
+        job.chunks = (struct ColumnFileChunk*)calloc(chunkCount, sizeof(struct ColumnFileChunk));
+        if(job.chunks == NULL || (tailLength > 0 && tail == NULL))
+            fputs("Out of memory!\n", stderr);
+        else
+        {
+            var beginTime = GetCurrentTimeInSeconds();
+            
+            // 二进制输入的任务块按整行划分
+            const var rowSize = sizeof(double) * fieldCount;
+            const var binaryChunkSize = (COLUMN_FILE_CHUNK_SIZE / rowSize + 1) * rowSize;
+            
+            long rowCount = 0;
+            long invalidCount = 0;
+            long firstInvalidRow = -1;
+            var isOutOfMemory = false;
+            var isWriteFailed = false;
+            var cursor = dataBegin;
+            var isTailPending = tail != NULL;
+            
+            while((cursor < dataEnd || isTailPending) && !isOutOfMemory && !isWriteFailed)
+            {
+                var taskCount = 0;
+                for(; taskCount < chunkCount && cursor < dataEnd; taskCount++)
+                {
+                    var chunk = &job.chunks[taskCount];
+                    chunk->begin = cursor;
+                    if(kind == COLUMN_FILE_KIND_BINARY)
+                        cursor = ((size_t)(dataEnd - cursor) > binaryChunkSize)? cursor + binaryChunkSize : dataEnd;
+                    else if((size_t)(dataEnd - cursor) > COLUMN_FILE_CHUNK_SIZE)
+                        cursor = (const char*)memchr(cursor + COLUMN_FILE_CHUNK_SIZE - 1, '\n', dataEnd - (cursor + COLUMN_FILE_CHUNK_SIZE - 1)) + 1;
+                    else
+                        cursor = dataEnd;
+                    chunk->end = cursor;
+                }
+                if(taskCount < chunkCount && cursor == dataEnd && isTailPending)
+                {
+                    job.chunks[taskCount].begin = tail;
+                    job.chunks[taskCount++].end = tail + tailLength;
+                    isTailPending = false;
+                }
+                
+                RunWorkerPoolTasks(&pool, taskCount, ProcessColumnFileChunk, &job);
+                
+                for(var i = 0; i < taskCount && !isOutOfMemory && !isWriteFailed; i++)
+                {
+                    const var chunk = &job.chunks[i];
+                    isOutOfMemory = chunk->isOutOfMemory;
+                    if(isOutOfMemory)
+                        break;
+                    isWriteFailed = fwrite(chunk->output, 1, chunk->outputLength, output) != chunk->outputLength;
+                    
+                    if(firstInvalidRow < 0 && chunk->firstInvalidRow >= 0)
+                        firstInvalidRow = rowCount + chunk->firstInvalidRow;
+                    invalidCount += chunk->invalidCount;
+                    rowCount += chunk->rowCount;
+                }
+            }
+            
+            isWriteFailed = fflush(output) != 0 || isWriteFailed;
+            var elapsedTime = GetCurrentTimeInSeconds() - beginTime;
+            
+            if(isOutOfMemory)
+                fputs("Out of memory!\n", stderr);
+            else if(isWriteFailed)
+                fprintf(stderr, "Cannot write file: %s\n", outputPath);
+            else
+            {
+                // 数据行从1开始编号，不包括表头与空行，这与输出中的行号一致
+                if(firstInvalidRow >= 0)
+                    fprintf(stderr, "error: row %ld: invalid number\n", firstInvalidRow + 1);
+                fprintf(stderr, "Evaluated %ld rows (%ld invalid) from %.3f GB with %d threads in %.3f s: %.2f GB/s, %.0f rows/sec\n",
+                        rowCount, invalidCount, mappingSize * 1e-9, pool.threadCount, elapsedTime,
+                        elapsedTime > 0.0? mappingSize * 1e-9 / elapsedTime : 0.0, elapsedTime > 0.0? rowCount / elapsedTime : 0.0);
+                
+                if(pStatistics != NULL)
+                {
+                    *pStatistics = (struct ColumnFileStatistics){
+                        .rowCount = rowCount, .invalidCount = invalidCount, .inputSize = mappingSize,
+                        .threadCount = pool.threadCount, .elapsedTime = elapsedTime
+                    };
+                }
+                exitStatus = invalidCount > 0? 1 : 0;
+            }
+            
+            for(var i = 0; i < chunkCount; i++)
+                free(job.chunks[i].output);
+        }
+        free(job.chunks);
+    }
+    
+    if(hasPool)
+        DestroyWorkerPool(&pool);
+    if(output != NULL && output != stdout && fclose(output) != 0 && exitStatus != 2)
+    {
+        fprintf(stderr, "Cannot write file: %s\n", outputPath);
+        exitStatus = 2;
+    }
+    DestroyArithmeticProgram(program);
+    free(job.fieldSlots);
+    free(tail);
+    for(var i = 0; i < fieldCount; i++)
+        free(names[i]);
+    if(mapping != NULL)
+        munmap(mapping, mappingSize);
+    
+    return exitStatus;
+}
+
+/**
+ * 按列文件模式的性能测试：生成约megabytes MB的CSV文件，其中有一个表达式用不到的文本字段，
+ * 同时把相同的数值写成二进制文件，分别以按列文件模式求值并报告GB/s与rows/sec。
+ * 再以拼接表达式字符串并逐行直接计算的旧做法处理前100万行作为对比，
+ * 最后检查CSV输出的文本结果与二进制输出的结果逐位相同
+ * @param megabytes CSV文件的大致大小
+ * @param threadCount 工作线程个数，若不大于0，则使用当前在线的处理器核数
+ * @return 若两种输入的结果一致，返回0，否则返回1；若无法生成文件或者存储空间不足，返回2
+*/
+static int BenchmarkColumnFile(long megabytes, int threadCount)
+{
+    static const char formula[] = "sqrt(x^2+y^2)*exp(-z)+x*y/(1+z)";
+    enum { BASELINE_ROW_COUNT = 1000000 };
+    
+    char csvPath[] = "/tmp/simplecalc-csv-XXXXXX";
+    char binaryPath[] = "/tmp/simplecalc-binary-XXXXXX";
+    char csvOutputPath[] = "/tmp/simplecalc-csv-output-XXXXXX";
+    char binaryOutputPath[] = "/tmp/simplecalc-binary-output-XXXXXX";
+    char *const paths[] = { csvPath, binaryPath, csvOutputPath, binaryOutputPath };
+    
+    var status = 2;
+    var createdCount = 0;
+    for(; createdCount < 4; createdCount++)
+    {
+        var fd = mkstemp(paths[createdCount]);
+        if(fd < 0)
+            break;
+        close(fd);
+    }
+    
+    var csvFile = (createdCount == 4)? fopen(csvPath, "wb") : NULL;
+    var binaryFile = (createdCount == 4)? fopen(binaryPath, "wb") : NULL;
+    var buffer = (char*)malloc(BATCH_STREAM_BUFFER_SIZE);
+    var baselineRows = (double*)malloc(sizeof(double) * 3 * BASELINE_ROW_COUNT);
+    
+    if(csvFile != NULL && binaryFile != NULL && buffer != NULL && baselineRows != NULL)
+    {
+        // 生成输入：x与y为带3位小数的数，z为[0, 10)中带4位小数的数，它们都以最短形式写出，因此CSV与二进制文件中的值逐位相同
+        var beginTime = GetCurrentTimeInSeconds();
+        var targetSize = (size_t)megabytes << 20;
+        struct OutputBuffer csvOutput = { .stream = csvFile, .data = buffer, .capacity = BATCH_STREAM_BUFFER_SIZE };
+        AppendOutput(&csvOutput, "id,x,y,z,label\n", 15);
+        size_t csvSize = 15;
+        long rowCount = 0;
+        uint64_t state = 20161220;
+        var isWriteFailed = false;
+        
+        while(csvSize < targetSize && !isWriteFailed)
+        {
+            double row[3];
+            char line[4 * RESULT_STRING_SIZE + 32];
+            var length = sprintf(line, "%ld", rowCount);
+            for(var i = 0; i < 3; i++)
+            {
+                state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+                var bits = (long)(state >> 33);
+                row[i] = (i < 2)? (double)(bits % 2000001 - 1000000) / 1000.0 : (double)(bits % 100000) / 10000.0;
+                line[length++] = ',';
+                length += FormatArithmeticResult(row[i], NULL, &line[length]);
+            }
+            length += sprintf(&line[length], ",p%ld\n", rowCount % 97);
+            
+            AppendOutput(&csvOutput, line, length);
+            isWriteFailed = fwrite(row, sizeof(double), 3, binaryFile) != 3;
+            if(rowCount < BASELINE_ROW_COUNT)
+                memcpy(&baselineRows[rowCount * 3], row, sizeof(row));
+            csvSize += length;
+            rowCount++;
+        }
+        FlushOutputBuffer(&csvOutput);
+        isWriteFailed = ferror(csvFile) || fclose(csvFile) != 0 || isWriteFailed;
+        isWriteFailed = fclose(binaryFile) != 0 || isWriteFailed;
+        csvFile = binaryFile = NULL;
+        
+        printf("Formula: %s\n", formula);
+        printf("Generated %ld rows in %.1f s: %.3f GB CSV (5 fields, 3 used), %.3f GB binary (x,y,z)\n",
+               rowCount, GetCurrentTimeInSeconds() - beginTime, csvSize * 1e-9, rowCount * 3 * sizeof(double) * 1e-9);
+        
+        struct ResultFormat format = { RESULT_FORMAT_MODE_SHORTEST, 0, false, MATH_KERNEL_SET_LIBM };
+        struct ColumnFileStatistics csvStatistics, binaryStatistics;
+        if(isWriteFailed)
+            fputs("Cannot write the generated input!\n", stderr);
+        else if(RunColumnFileMode(formula, csvPath, csvOutputPath, NULL, threadCount, &format, &csvStatistics) == 0 &&
+                RunColumnFileMode(formula, binaryPath, binaryOutputPath, "x,y,z", threadCount, &format, &binaryStatistics) == 0)
+        {
+            // 旧做法：把每一行的值代入表达式字符串，再逐行直接计算
+            var baselineCount = (rowCount < BASELINE_ROW_COUNT)? rowCount : BASELINE_ROW_COUNT;
+            var checksum = 0.0;
+            beginTime = GetCurrentTimeInSeconds();
+            for(long i = 0; i < baselineCount; i++)
+            {
+                const var row = &baselineRows[i * 3];
+                char expr[256];
+                char values[3][RESULT_STRING_SIZE];
+                for(var k = 0; k < 3; k++)
+                    values[k][FormatArithmeticResult(row[k], NULL, values[k])] = '\0';
+                var length = (size_t)snprintf(expr, sizeof(expr), "sqrt((%s)^2+(%s)^2)*exp(0-(%s))+(%s)*(%s)/(1+(%s))",
+                                              values[0], values[1], values[2], values[0], values[1], values[2]);
+                double value;
+                struct CalculationError error;
+                if(EvaluateArithmeticExpression(expr, length, NULL, &value, &error))
+                    checksum += value;
+            }
+            var baselineTime = GetCurrentTimeInSeconds() - beginTime;
+            
+            printf("%-44s %8.2f GB/s %12.0f rows/sec\n", "CSV, mapped and parsed in place:",
+                   csvStatistics.inputSize * 1e-9 / csvStatistics.elapsedTime, csvStatistics.rowCount / csvStatistics.elapsedTime);
+            printf("%-44s %8.2f GB/s %12.0f rows/sec\n", "binary x,y,z doubles:",
+                   binaryStatistics.inputSize * 1e-9 / binaryStatistics.elapsedTime, binaryStatistics.rowCount / binaryStatistics.elapsedTime);
+            printf("%-44s %8s      %12.0f rows/sec (checksum %g)\n", "one expression string per row (in process):", "",
+                   baselineCount / baselineTime, checksum);
+            printf("Threads: %d, CSV speedup over one string per row: %.1fx\n",
+                   csvStatistics.threadCount, csvStatistics.rowCount / csvStatistics.elapsedTime / (baselineCount / baselineTime));
+            
+            // 校验：CSV输出的每一行都应当与二进制输出中对应的double逐位相同
+            var textFd = open(csvOutputPath, O_RDONLY);
+            var binaryFd = open(binaryOutputPath, O_RDONLY);
+            struct stat textStatus, binaryStatus;
+            if(textFd >= 0 && binaryFd >= 0 && fstat(textFd, &textStatus) == 0 && fstat(binaryFd, &binaryStatus) == 0 &&
+               textStatus.st_size > 0 && (size_t)binaryStatus.st_size == rowCount * sizeof(double))
+            {
+                var text = (char*)mmap(NULL, textStatus.st_size, PROT_READ, MAP_PRIVATE, textFd, 0);
+                var results = (double*)mmap(NULL, binaryStatus.st_size, PROT_READ, MAP_PRIVATE, binaryFd, 0);
+                if(text != MAP_FAILED && results != MAP_FAILED)
+                {
+                    long mismatchCount = 0;
+                    long lineCount = 0;
+                    var end = text + textStatus.st_size;
+                    for(var cursor = text; cursor < end && lineCount < rowCount; lineCount++)
+                    {
+                        var newline = (char*)memchr(cursor, '\n', end - cursor);
+                        if(newline == NULL)
+                            break;
+                        if(!IsSameResult(strtod(cursor, NULL), results[lineCount]))
+                            mismatchCount++;
+                        cursor = newline + 1;
+                    }
+                    
+                    printf("CSV and binary results identical: %s (%ld rows, %ld mismatches)\n",
+                           (mismatchCount == 0 && lineCount == rowCount)? "yes" : "no", lineCount, mismatchCount);
+                    status = (mismatchCount == 0 && lineCount == rowCount)? 0 : 1;
+                }
+                if(text != MAP_FAILED)
+                    munmap(text, textStatus.st_size);
+                if(results != MAP_FAILED)
+                    munmap(results, binaryStatus.st_size);
+            }
+            else
+                status = 1;
+            if(textFd >= 0)
+                close(textFd);
+            if(binaryFd >= 0)
+                close(binaryFd);
+        }
+    }
+    
+    if(csvFile != NULL)
+        fclose(csvFile);
+    if(binaryFile != NULL)
+        fclose(binaryFile);
+    for(var i = 0; i < createdCount; i++)
+        unlink(paths[i]);
+    free(buffer);
+    free(baselineRows);
+    
+    return status;
+}
+
+#if defined(SIMPLE_CALCULATOR_STATISTICS)
+
+/** 统计数据中的失败原因名，以CALCULATION_ERROR为下标 */
+static const char *const statisticsErrorNames[] = {
+    [CALCULATION_ERROR_NONE] = "none",
+    [CALCULATION_ERROR_EMPTY_EXPRESSION] = "empty_expression",
+    [CALCULATION_ERROR_INVALID_CHARACTER] = "invalid_character",
+    [CALCULATION_ERROR_UNEXPECTED_OPERATOR] = "unexpected_operator",
+    [CALCULATION_ERROR_UNKNOWN_FUNCTION] = "unknown_function",
+    [CALCULATION_ERROR_MISSING_FUNCTION_ARGUMENT] = "missing_function_argument",
+    [CALCULATION_ERROR_UNMATCHED_PARENTHESIS] = "unmatched_parenthesis",
+    [CALCULATION_ERROR_OUT_OF_MEMORY] = "out_of_memory",
+    [CALCULATION_ERROR_INVALID_REDUCTION] = "invalid_reduction"
+};
+
+/** 统计数据中的阶段名，以STATISTICS_TIMER为下标 */
+static const char *const statisticsTimerNames[] = {
+    [STATISTICS_TIMER_PRESCAN] = "prescan",
+    [STATISTICS_TIMER_EVALUATE] = "evaluate",
+    [STATISTICS_TIMER_NUMBER] = "number",
+    [STATISTICS_TIMER_FUNCTION] = "function",
+    [STATISTICS_TIMER_FORMAT] = "format"
+};
+
+/** 统计所覆盖的操作符 */
+static const char statisticsOperators[] = "+-*/%^";
+
+/** 是否以Prometheus文本格式输出，由环境变量SIMPLE_CALCULATOR_STATS指定，默认为JSON */
+static bool isStatisticsPrometheus;
+
+/** 统计数据的输出路径，由环境变量SIMPLE_CALCULATOR_STATS_FILE指定，为NULL时输出到标准错误 */
+static const char *statisticsPath;
+
+/** 汇总所有线程的统计数据 */
+static void SumCalculationStatistics(struct CalculationStatistics *total)
+{
+    const var counterCount = offsetof(struct CalculationStatistics, next) / sizeof(atomic_ullong);
+    var totalCounters = (atomic_ullong*)total;
+    memset(total, 0, sizeof(*total));
+    
+    pthread_mutex_lock(&statisticsMutex);
+    for(var statistics = statisticsList; statistics != NULL; statistics = statistics->next)
+    {
+        var counters = (atomic_ullong*)statistics;
+        for(size_t i = 0; i < counterCount; i++)
+            AddStatisticsCounter(&totalCounters[i], atomic_load_explicit(&counters[i], memory_order_relaxed));
+    }
+    pthread_mutex_unlock(&statisticsMutex);
+    
+    var counters = (atomic_ullong*)&fallbackStatistics;
+    for(size_t i = 0; i < counterCount; i++)
+        AddStatisticsCounter(&totalCounters[i], atomic_load_explicit(&counters[i], memory_order_relaxed));
+}
+
+/** 读取汇总之后的计数器 */
+#define STATISTICS_VALUE(field)     ((unsigned long long)atomic_load_explicit(&total.field, memory_order_relaxed))
+
+/** 以JSON格式输出统计数据 */
+static void WriteStatisticsJson(FILE *output)
+{
+    struct CalculationStatistics total;
+    SumCalculationStatistics(&total);
+    
+    fprintf(output, "{\n  \"expressions\": %llu,\n  \"bytes\": %llu,\n  \"prescan_rejections\": %llu,\n",
+            STATISTICS_VALUE(expressionCount), STATISTICS_VALUE(byteCount), STATISTICS_VALUE(prescanRejectionCount));
+    
+    fputs("  \"phases\": {", output);
+    for(var i = 0; i < STATISTICS_TIMER_COUNT; i++)
+        fprintf(output, "%s\n    \"%s\": { \"calls\": %llu, \"cycles\": %llu }", i > 0? "," : "", statisticsTimerNames[i], STATISTICS_VALUE(timerCalls[i]), STATISTICS_VALUE(timerCycles[i]));
+    
+    fputs("\n  },\n  \"operators\": {", output);
+    for(var op = statisticsOperators; *op != '\0'; op++)
+        fprintf(output, " \"%c\": %llu,", *op, STATISTICS_VALUE(operatorCounts[(uint8_t)*op]));
+    fprintf(output, " \"neg\": %llu },\n", STATISTICS_VALUE(negationCount));
+    
+    fputs("  \"functions\": {", output);
+    var isFirst = true;
+    for(var i = 0; i < MATH_FUNCTION_TABLE_SIZE; i++)
+    {
+        if(mathFuncList[i].name[0] == '\0')
+            continue;
+        fprintf(output, "%s \"%s\": %llu", isFirst? "" : ",", mathFuncList[i].name, STATISTICS_VALUE(functionCounts[i]));
+        isFirst = false;
+    }
+    
+    fputs(" },\n  \"depth_histogram\": [", output);
+    for(var i = 0; i < STATISTICS_DEPTH_BUCKET_COUNT; i++)
+    {
+        if(i + 1 < STATISTICS_DEPTH_BUCKET_COUNT)
+            fprintf(output, " { \"le\": %llu, \"count\": %llu },", 1ULL << i, STATISTICS_VALUE(depthHistogram[i]));
+        else
+            fprintf(output, " { \"le\": null, \"count\": %llu }", STATISTICS_VALUE(depthHistogram[i]));
+    }
+    fprintf(output, " ],\n  \"depth_sum\": %llu,\n", STATISTICS_VALUE(depthSum));
     
-    // 我们下面将把多余的.00000这种字样给过滤掉，使得结果输出更好看一些
-    length = (int)strlen(result);
-    var dotIndex = -1;
-    var hasE = false;
-    for(var i = 0; i < length; i++)
+    fputs("  \"errors\": {", output);
+    for(var i = CALCULATION_ERROR_NONE + 1; i <= CALCULATION_ERROR_INVALID_REDUCTION; i++)
+        fprintf(output, "%s \"%s\": %llu", i > CALCULATION_ERROR_NONE + 1? "," : "", statisticsErrorNames[i], STATISTICS_VALUE(errorCounts[i]));
+    fputs(" }\n}\n", output);
+}
+
+/** 以Prometheus文本格式输出统计数据 */
+static void WriteStatisticsPrometheus(FILE *output)
+{
+    struct CalculationStatistics total;
+    SumCalculationStatistics(&total);
+    
+    fprintf(output, "# HELP simplecalc_expressions_total Expressions evaluated.\n# TYPE simplecalc_expressions_total counter\nsimplecalc_expressions_total %llu\n", STATISTICS_VALUE(expressionCount));
+    fprintf(output, "# HELP simplecalc_bytes_total Bytes of expressions evaluated.\n# TYPE simplecalc_bytes_total counter\nsimplecalc_bytes_total %llu\n", STATISTICS_VALUE(byteCount));
+    fprintf(output, "# HELP simplecalc_prescan_rejections_total Expressions rejected by the pre-scan.\n# TYPE simplecalc_prescan_rejections_total counter\nsimplecalc_prescan_rejections_total %llu\n", STATISTICS_VALUE(prescanRejectionCount));
+    
+    fputs("# HELP simplecalc_phase_cycles_total Time stamp counter cycles spent in each phase.\n# TYPE simplecalc_phase_cycles_total counter\n", output);
+    for(var i = 0; i < STATISTICS_TIMER_COUNT; i++)
+        fprintf(output, "simplecalc_phase_cycles_total{phase=\"%s\"} %llu\n", statisticsTimerNames[i], STATISTICS_VALUE(timerCycles[i]));
+    fputs("# HELP simplecalc_phase_calls_total Timed calls of each phase.\n# TYPE simplecalc_phase_calls_total counter\n", output);
+    for(var i = 0; i < STATISTICS_TIMER_COUNT; i++)
+        fprintf(output, "simplecalc_phase_calls_total{phase=\"%s\"} %llu\n", statisticsTimerNames[i], STATISTICS_VALUE(timerCalls[i]));
+    
+    fputs("# HELP simplecalc_operators_total Binary operators parsed, plus negation signs.\n# TYPE simplecalc_operators_total counter\n", output);
+    for(var op = statisticsOperators; *op != '\0'; op++)
+        fprintf(output, "simplecalc_operators_total{operator=\"%c\"} %llu\n", *op, STATISTICS_VALUE(operatorCounts[(uint8_t)*op]));
+    fprintf(output, "simplecalc_operators_total{operator=\"neg\"} %llu\n", STATISTICS_VALUE(negationCount));
+    
+    fputs("# HELP simplecalc_functions_total Math function names parsed.\n# TYPE simplecalc_functions_total counter\n", output);
+    for(var i = 0; i < MATH_FUNCTION_TABLE_SIZE; i++)
     {
-        if(result[i] == '.')
-            dotIndex = i;
-        else if(result[i] == 'e')
-            hasE = true;
+        if(mathFuncList[i].name[0] != '\0')
+            fprintf(output, "simplecalc_functions_total{function=\"%s\"} %llu\n", mathFuncList[i].name, STATISTICS_VALUE(functionCounts[i]));
     }
-    // 我们只有在仅存在小数点的情况下做过滤
-    if(dotIndex >= 0 && !hasE)
+    
+    // Prometheus的直方图桶是累计的
+    fputs("# HELP simplecalc_nesting_depth Parenthesis nesting depth on each opening parenthesis.\n# TYPE simplecalc_nesting_depth histogram\n", output);
+    var cumulativeCount = 0ULL;
+    for(var i = 0; i < STATISTICS_DEPTH_BUCKET_COUNT; i++)
     {
-        var index = length;
+        cumulativeCount += STATISTICS_VALUE(depthHistogram[i]);
+        if(i + 1 < STATISTICS_DEPTH_BUCKET_COUNT)
+            fprintf(output, "simplecalc_nesting_depth_bucket{le=\"%llu\"} %llu\n", 1ULL << i, cumulativeCount);
+    }
+    fprintf(output, "simplecalc_nesting_depth_bucket{le=\"+Inf\"} %llu\nsimplecalc_nesting_depth_sum %llu\nsimplecalc_nesting_depth_count %llu\n",
+            cumulativeCount, STATISTICS_VALUE(depthSum), cumulativeCount);
+    
+    fputs("# HELP simplecalc_errors_total Failed evaluations by reason.\n# TYPE simplecalc_errors_total counter\n", output);
+    for(var i = CALCULATION_ERROR_NONE + 1; i <= CALCULATION_ERROR_INVALID_REDUCTION; i++)
+        fprintf(output, "simplecalc_errors_total{reason=\"%s\"} %llu\n", statisticsErrorNames[i], STATISTICS_VALUE(errorCounts[i]));
+}
+
+#undef STATISTICS_VALUE
+
+/** 按环境变量指定的格式与路径输出统计数据。输出到文件时每次都会覆盖之前的内容 */
+static void DumpCalculationStatistics(void)
+{
+    static pthread_mutex_t dumpMutex = PTHREAD_MUTEX_INITIALIZER;
+    
+    pthread_mutex_lock(&dumpMutex);
+    var output = (statisticsPath != NULL)? fopen(statisticsPath, "w") : stderr;
+    if(output != NULL)
+    {
+        if(isStatisticsPrometheus)
+            WriteStatisticsPrometheus(output);
+        else
+            WriteStatisticsJson(output);
         
-        while(--index > 0)
-        {
-            if(result[index] != '0')
-                break;
-            
-            result[index] = '\0';
-        }
-        // 如果dotIndex后面没有具体数字了，那么我们将小数点也过滤掉
-        if(result[dotIndex + 1] == '\0')
-            result[dotIndex] = '\0';
+        if(output != stderr)
+            fclose(output);
+        else
+            fflush(output);
+    }
+    pthread_mutex_unlock(&dumpMutex);
+}
+
+/** 等待SIGUSR1并输出统计数据的线程 */
+static void* StatisticsSignalThread(void *arg)
+{
+    const var signals = (const sigset_t*)arg;
+    
+    while(true)
+    {
+        int signalNumber;
+        if(sigwait(signals, &signalNumber) == 0)
+            DumpCalculationStatistics();
     }
     
-    return true;
+    return NULL;
+}
+
+/**
+ * 开始统计输出：程序退出时输出一次，并在每次收到SIGUSR1时输出一次。
+ * SIGUSR1在创建任何其他线程之前就被屏蔽，之后所创建的线程都会继承这一屏蔽，所以它只会由专门的线程通过sigwait接收，
+ * 输出工作因而不必受信号处理函数的限制
+*/
+static void StartStatisticsReporter(void)
+{
+    static sigset_t signals;
+    
+    var format = getenv("SIMPLE_CALCULATOR_STATS");
+    isStatisticsPrometheus = format != NULL && strcmp(format, "prometheus") == 0;
+    statisticsPath = getenv("SIMPLE_CALCULATOR_STATS_FILE");
+    
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    pthread_t thread;
+    if(pthread_sigmask(SIG_BLOCK, &signals, NULL) == 0 && pthread_create(&thread, NULL, StatisticsSignalThread, &signals) == 0)
+        pthread_detach(thread);
+    
+    atexit(DumpCalculationStatistics);
 }
 
+#endif  // SIMPLE_CALCULATOR_STATISTICS
+
+/** --format选项的用法说明 */
+static const char resultFormatUsage[] = "Usage: --format <shortest|fixed[:N]|scientific>, where N is 0 to 17 digits after the decimal point (8 by default)";
+
+/**
+ * 解析--format选项的参数
+ * @param text 格式名称：shortest、scientific、fixed或者fixed:N
+ * @param pFormat 输出所解析的格式
+ * @return 若参数合法，返回true，否则返回false
+*/
+static bool ParseResultFormat(const char *text, struct ResultFormat *pFormat)
+{
+    // 只修改格式本身，保留之前由--exact与--fast-math-kernels选项所设置的计算方式
+    var isExactInteger = pFormat->isExactInteger;
+    var kernelSet = pFormat->kernelSet;
+    
+    if(strcmp(text, "shortest") == 0)
+        *pFormat = (struct ResultFormat){ RESULT_FORMAT_MODE_SHORTEST, 0, isExactInteger, kernelSet };
+    else if(strcmp(text, "scientific") == 0)
+        *pFormat = (struct ResultFormat){ RESULT_FORMAT_MODE_SCIENTIFIC, 0, isExactInteger, kernelSet };
+    else if(strcmp(text, "fixed") == 0)
+        *pFormat = (struct ResultFormat){ RESULT_FORMAT_MODE_FIXED, 8, isExactInteger, kernelSet };
+    else if(strncmp(text, "fixed:", 6) == 0 && IsDigital(text[6]))
+    {
+        var precision = atoi(&text[6]);
+        if(precision > RESULT_FORMAT_MAX_PRECISION)
+            return false;
+        *pFormat = (struct ResultFormat){ RESULT_FORMAT_MODE_FIXED, precision, isExactInteger, kernelSet };
+    }
+    else
+        return false;
+    
+    return true;
+}
 
 int main(int argc, const char * argv[])
 {
@@ -588,42 +15542,511 @@ int main(int argc, const char * argv[])
     // 是合法的。而输入：
     // SimpleCalculator 1 + 2
     // 则直接输出结果1，后面的+2会被忽略。
+#if defined(SIMPLE_CALCULATOR_STATISTICS)
+    StartStatisticsReporter();
+#endif
+    
     if(argc < 2)
     {
         puts("No expression to calculate!");
         return 0;
     }
     
-    var length = strlen(argv[1]);
-    if(length == 0)
+    // 以--开头并紧跟字母的参数不可能是合法的算术表达式，因此我们将其作为功能选项
+    if(strcmp(argv[1], "--dump-ir") == 0)
     {
-        puts("No expression to calculate!");
-        return 0;
+        if(argc < 3)
+        {
+            puts("Usage: SimpleCalculator --dump-ir <expression> [variable names...]");
+            return 1;
+        }
+        
+        return DumpIntermediateRepresentation(argv[2], argv + 3, argc - 3);
+    }
+    
+    if(strcmp(argv[1], "--bench-compile") == 0)
+    {
+        if(argc < 3)
+        {
+            puts("Usage: SimpleCalculator --bench-compile <expression> [iterations]");
+            return 1;
+        }
+        var iterations = (argc > 3)? atol(argv[3]) : 1000000L;
+        if(iterations <= 0)
+            iterations = 1000000L;
+        
+        return BenchmarkCompiledEvaluation(argv[2], iterations);
+    }
+    
+    if(strcmp(argv[1], "--bench-columns") == 0)
+    {
+        if(argc < 3)
+        {
+            puts("Usage: SimpleCalculator --bench-columns <expression with x and y> [rows]");
+            return 1;
+        }
+        var count = (argc > 3)? atol(argv[3]) : 10000000L;
+        if(count <= 0)
+            count = 10000000L;
+        
+        return BenchmarkColumnEvaluation(argv[2], count);
+    }
+    
+    if(strcmp(argv[1], "--bench-jit") == 0)
+    {
+        if(argc < 3)
+        {
+            puts("Usage: SimpleCalculator --bench-jit <expression with x and y> [iterations]");
+            return 1;
+        }
+        var iterations = (argc > 3)? atol(argv[3]) : 10000000L;
+        if(iterations <= 0)
+            iterations = 10000000L;
+        
+        return BenchmarkJitEvaluation(argv[2], iterations);
+    }
+    
+    if(strcmp(argv[1], "--verify-jit") == 0)
+    {
+        var count = (argc > 2)? atol(argv[2]) : 1000000L;
+        if(count <= 0)
+            count = 1000000L;
+        
+        return VerifyJitProgram(count, (argc > 3)? strtoull(argv[3], NULL, 0) : 20161220U);
+    }
+    
+    if(strcmp(argv[1], "--bench-number") == 0)
+    {
+        var count = (argc > 2)? atol(argv[2]) : 10000000L;
+        if(count <= 0)
+            count = 10000000L;
+        
+        return BenchmarkNumberParsing(count);
+    }
+    
+    if(strcmp(argv[1], "--bench-functions") == 0)
+    {
+        var count = (argc > 2)? atol(argv[2]) : 5000000L;
+        if(count <= 0)
+            count = 5000000L;
+        
+        return BenchmarkFunctionLookup(count);
+    }
+    
+    if(strcmp(argv[1], "--bench-kernels") == 0)
+    {
+        var count = (argc > 2)? atol(argv[2]) : 1000000L;
+        if(count <= 0)
+            count = 1000000L;
+        
+        return BenchmarkMathKernels(count);
+    }
+    
+    if(strcmp(argv[1], "--bench-gradient") == 0)
+    {
+        var variableCount = (argc > 2)? atoi(argv[2]) : 8;
+        if(variableCount <= 0)
+            variableCount = 8;
+        var rowCount = (argc > 3)? atol(argv[3]) : 100000L;
+        if(rowCount <= 0)
+            rowCount = 100000L;
+        
+        return BenchmarkGradient(variableCount, rowCount);
+    }
+    
+    if(strcmp(argv[1], "--bench-prescan") == 0)
+    {
+        var count = (argc > 2)? atol(argv[2]) : 1000000L;
+        if(count <= 0)
+            count = 1000000L;
+        
+        return BenchmarkPrevalidation(count);
+    }
+    
+    if(strcmp(argv[1], "--bench-exact") == 0)
+    {
+        var count = (argc > 2)? atol(argv[2]) : 1000000L;
+        if(count <= 0)
+            count = 1000000L;
+        
+        return BenchmarkExactIntegers(count);
+    }
+    
+    if(strcmp(argv[1], "--precompile") == 0)
+    {
+        if(argc < 4)
+        {
+            puts("Usage: SimpleCalculator --precompile <expression list> <program file> [variables, e.g. x,y]");
+            return 1;
+        }
+        
+        return RunPrecompileMode(argv[2], argv[3], (argc > 4)? argv[4] : NULL);
+    }
+    
+    if(strcmp(argv[1], "--bench-startup") == 0)
+    {
+        var count = (argc > 2)? atol(argv[2]) : 2000L;
+        if(count <= 0)
+            count = 2000L;
+        
+        return BenchmarkStartup(count);
+    }
+    
+    if(strcmp(argv[1], "--bench-suite") == 0)
+    {
+        struct CorpusParameters parameters = {
+            .seed = 20161220, .count = 200000, .depth = 4, .operators = "+-*/^%",
+            .functionPercent = 10, .literalDigits = 6, .invalidPercent = 5
+        };
+        var rounds = 3;
+        const char *jsonPath = NULL;
+        for(var i = 2; i < argc; i++)
+        {
+            if(i + 1 >= argc)
+                break;
+            if(strcmp(argv[i], "--count") == 0)
+                parameters.count = atol(argv[++i]);
+            else if(strcmp(argv[i], "--seed") == 0)
+                parameters.seed = strtoull(argv[++i], NULL, 0);
+            else if(strcmp(argv[i], "--depth") == 0)
+                parameters.depth = atoi(argv[++i]);
+            else if(strcmp(argv[i], "--operators") == 0)
+                parameters.operators = argv[++i];
+            else if(strcmp(argv[i], "--functions") == 0)
+                parameters.functionPercent = atoi(argv[++i]);
+            else if(strcmp(argv[i], "--digits") == 0)
+                parameters.literalDigits = atoi(argv[++i]);
+            else if(strcmp(argv[i], "--invalid") == 0)
+                parameters.invalidPercent = atoi(argv[++i]);
+            else if(strcmp(argv[i], "--rounds") == 0)
+                rounds = atoi(argv[++i]);
+            else if(strcmp(argv[i], "--json") == 0)
+                jsonPath = argv[++i];
+        }
+        
+        // 操作符只能取自语法所支持的二元操作符
+        if(parameters.count <= 0 || parameters.depth < 0 || parameters.depth > CORPUS_MAX_DEPTH ||
+           parameters.operators[0] == '\0' || parameters.operators[strspn(parameters.operators, "+-*/^$%")] != '\0' ||
+           parameters.functionPercent < 0 || parameters.functionPercent > 85 ||
+           parameters.literalDigits < 1 || parameters.literalDigits > 17 ||
+           parameters.invalidPercent < 0 || parameters.invalidPercent > 100 || rounds <= 0)
+        {
+            printf("Usage: SimpleCalculator --bench-suite [--count N] [--seed S] [--depth 0-%d] [--operators \"+-*/^$%%\"] "
+                   "[--functions 0-85] [--digits 1-17] [--invalid 0-100] [--rounds N] [--json path|-]\n", CORPUS_MAX_DEPTH);
+            return 1;
+        }
+        
+        return RunBenchmarkSuite(&parameters, rounds, jsonPath);
+    }
+    
+    if(strcmp(argv[1], "--bench-format") == 0)
+    {
+        var count = (argc > 2)? atol(argv[2]) : 5000000L;
+        if(count <= 0)
+            count = 5000000L;
+        
+        return BenchmarkResultFormatting(count);
+    }
+    
+    if(strcmp(argv[1], "--verify-iterative") == 0)
+    {
+        var count = (argc > 2)? atol(argv[2]) : 200000L;
+        if(count <= 0)
+            count = 200000L;
+        
+        return VerifyIterativeEvaluation(count, (argc > 3)? strtoull(argv[3], NULL, 0) : 20161220U);
+    }
+    
+    if(strcmp(argv[1], "--stress") == 0)
+    {
+        var megabytes = (argc > 2)? atol(argv[2]) : 10L;
+        if(megabytes <= 0)
+            megabytes = 10L;
+        var depth = (argc > 3)? atol(argv[3]) : 200000L;
+        if(depth <= 0)
+            depth = 200000L;
+        
+        return RunEvaluationStressTest(megabytes, depth);
+    }
+    
+    if(strcmp(argv[1], "--batch") == 0)
+    {
+        // --threads N选项启用并行批处理，N为0时使用所有处理器核；
+        // --cache N选项启用最多缓存N个结果的结果缓存；--format选项指定结果的格式；--exact选项启用精确整数模式；
+        // --fast-math-kernels选项使数学函数改用快速的近似实现
+        const char *path = NULL;
+        var threadCount = -1;
+        var cacheCapacity = 0L;
+        struct ResultFormat format = { RESULT_FORMAT_MODE_SHORTEST, 0, false, MATH_KERNEL_SET_LIBM };
+        for(var i = 2; i < argc; i++)
+        {
+            if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+                threadCount = atoi(argv[++i]);
+            else if(strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+                cacheCapacity = atol(argv[++i]);
+            else if(strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+            {
+                if(!ParseResultFormat(argv[++i], &format))
+                {
+                    puts(resultFormatUsage);
+                    return 2;
+                }
+            }
+            else if(strcmp(argv[i], "--exact") == 0)
+                format.isExactInteger = true;
+            else if(strcmp(argv[i], "--fast-math-kernels") == 0)
+                format.kernelSet = MATH_KERNEL_SET_FAST;
+            else
+                path = argv[i];
+        }
+        
+        struct ResultCache *cache = NULL;
+        if(cacheCapacity > 0)
+        {
+            cache = CreateResultCache(cacheCapacity, &format);
+            if(cache == NULL)
+            {
+                fputs("Cannot create the result cache!\n", stderr);
+                return 2;
+            }
+        }
+        
+        var status = (threadCount < 0)? RunBatchMode(path, &format, cache) : RunParallelBatchMode(path, threadCount, &format, cache);
+        DestroyResultCache(cache);
+        
+        return status;
+    }
+    
+    if(strcmp(argv[1], "--serve") == 0)
+    {
+        // 选项与--batch相同，只是默认启用结果缓存
+        if(argc < 3)
+        {
+            puts("Usage: SimpleCalculator --serve <socket path> [--threads N] [--cache N] [--format F] [--exact] [--fast-math-kernels]");
+            return 1;
+        }
+        var threadCount = 0;
+        var cacheCapacity = (long)SERVER_DEFAULT_CACHE_CAPACITY;
+        struct ResultFormat format = { RESULT_FORMAT_MODE_SHORTEST, 0, false, MATH_KERNEL_SET_LIBM };
+        for(var i = 3; i < argc; i++)
+        {
+            if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+                threadCount = atoi(argv[++i]);
+            else if(strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+                cacheCapacity = atol(argv[++i]);
+            else if(strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+            {
+                if(!ParseResultFormat(argv[++i], &format))
+                {
+                    puts(resultFormatUsage);
+                    return 1;
+                }
+            }
+            else if(strcmp(argv[i], "--exact") == 0)
+                format.isExactInteger = true;
+            else if(strcmp(argv[i], "--fast-math-kernels") == 0)
+                format.kernelSet = MATH_KERNEL_SET_FAST;
+        }
+        
+        struct ResultCache *cache = NULL;
+        if(cacheCapacity > 0 && (cache = CreateResultCache(cacheCapacity, &format)) == NULL)
+        {
+            fputs("Cannot create the result cache!\n", stderr);
+            return 2;
+        }
+        
+        var status = RunEvaluationServer(argv[2], threadCount, &format, cache);
+        DestroyResultCache(cache);
+        
+        return status;
+    }
+    
+    if(strcmp(argv[1], "--load") == 0)
+    {
+        if(argc < 3)
+        {
+            puts("Usage: SimpleCalculator --load <socket path> [clients] [requests per client] [pipeline depth]");
+            return 1;
+        }
+        var clientCount = (argc > 3)? atoi(argv[3]) : 4;
+        if(clientCount <= 0)
+            clientCount = 4;
+        var requestCount = (argc > 4)? atol(argv[4]) : 100000L;
+        if(requestCount <= 0)
+            requestCount = 100000L;
+        var pipelineDepth = (argc > 5)? atoi(argv[5]) : 16;
+        if(pipelineDepth <= 0)
+            pipelineDepth = 16;
+        
+        return RunLoadGenerator(argv[2], clientCount, requestCount, pipelineDepth);
+    }
+    
+    if(strcmp(argv[1], "--bench-parallel") == 0)
+    {
+        var lineCount = (argc > 2)? atol(argv[2]) : 2000000L;
+        if(lineCount <= 0)
+            lineCount = 2000000L;
+        
+        return BenchmarkParallelBatch(lineCount, (argc > 3)? atoi(argv[3]) : 0);
+    }
+    
+    if(strcmp(argv[1], "--sheet") == 0)
+    {
+        // --threads N选项使同一拓扑层级中的单元并行求值，N为0时使用所有处理器核；--format选项指定结果的格式
+        if(argc < 3)
+        {
+            puts("Usage: SimpleCalculator --sheet <definitions> [--threads N] [--format F], then name=formula updates on standard input");
+            return 1;
+        }
+        var threadCount = -1;
+        struct ResultFormat format = { RESULT_FORMAT_MODE_SHORTEST, 0, false, MATH_KERNEL_SET_LIBM };
+        for(var i = 3; i < argc; i++)
+        {
+            if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+                threadCount = atoi(argv[++i]);
+            else if(strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+            {
+                if(!ParseResultFormat(argv[++i], &format))
+                {
+                    puts(resultFormatUsage);
+                    return 1;
+                }
+            }
+        }
+        
+        return RunSheetMode(argv[2], threadCount, &format);
+    }
+    
+    if(strcmp(argv[1], "--bench-sheet") == 0)
+    {
+        var cellCount = (argc > 2)? atol(argv[2]) : 10000L;
+        if(cellCount <= 0)
+            cellCount = 10000L;
+        
+        return BenchmarkSheetRecomputation(cellCount, (argc > 3)? atoi(argv[3]) : 0);
+    }
+    
+    if(strcmp(argv[1], "--bench-reduce") == 0)
+    {
+        var termCount = (argc > 2)? atol(argv[2]) : 10000000L;
+        if(termCount <= 0)
+            termCount = 10000000L;
+        
+        return BenchmarkRangeReduction(termCount, (argc > 3)? atoi(argv[3]) : 0);
     }
     
-    // 对参数表达式长度做截断，取由宏指定的长度
-    if(length > MAX_ARGUMENT_LENGTH)
-        length = MAX_ARGUMENT_LENGTH;
+    if(strcmp(argv[1], "--bench-quadrature") == 0)
+    {
+        var repeatCount = (argc > 2)? atol(argv[2]) : 1000L;
+        if(repeatCount <= 0)
+            repeatCount = 1000L;
+        
+        return BenchmarkQuadrature(repeatCount);
+    }
     
-    // 我们准备一个字符串缓存，将通过程序参数传递进来的字符串表达式拷贝到当前程序的栈上，
-    // 便于后续解析操作
-    char argBuffer[MAX_ARGUMENT_LENGTH + 1];
+    if(strcmp(argv[1], "--csv") == 0 || strcmp(argv[1], "--binary") == 0)
+    {
+        // --binary之后紧跟以','分隔的字段名；--threads N选项指定工作线程个数，N为0时使用所有处理器核；
+        // --format选项指定CSV输出结果的格式，--fast-math-kernels选项使数学函数改用快速的近似实现
+        var isBinary = strcmp(argv[1], "--binary") == 0;
+        var firstIndex = isBinary? 3 : 2;
+        if(argc < firstIndex + 3)
+        {
+            if(isBinary)
+                puts("Usage: SimpleCalculator --binary <fields, e.g. x,y> <formula> <input> <output|-> [--threads N] [--fast-math-kernels]");
+            else
+                puts("Usage: SimpleCalculator --csv <formula> <input> <output|-> [--threads N] [--format F] [--fast-math-kernels]");
+            return 1;
+        }
+        var threadCount = 0;
+        struct ResultFormat format = { RESULT_FORMAT_MODE_SHORTEST, 0, false, MATH_KERNEL_SET_LIBM };
+        for(var i = firstIndex + 3; i < argc; i++)
+        {
+            if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+                threadCount = atoi(argv[++i]);
+            else if(strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+            {
+                if(!ParseResultFormat(argv[++i], &format))
+                {
+                    puts(resultFormatUsage);
+                    return 1;
+                }
+            }
+            else if(strcmp(argv[i], "--fast-math-kernels") == 0)
+                format.kernelSet = MATH_KERNEL_SET_FAST;
+        }
+        
+        return RunColumnFileMode(argv[firstIndex], argv[firstIndex + 1], argv[firstIndex + 2], isBinary? argv[2] : NULL, threadCount, &format, NULL);
+    }
+        
+    if(strcmp(argv[1], "--bench-column-file") == 0)
+    {
+        var megabytes = (argc > 2)? atol(argv[2]) : 1024L;
+        if(megabytes <= 0)
+            megabytes = 1024L;
+        
+        return BenchmarkColumnFile(megabytes, (argc > 3)? atoi(argv[3]) : 0);
+    }
     
-    // 我们这里使用strncpy也使得在做字符串拷贝的时候确保长度不超过指定的length大小。
-    // 这里之所以使用strncpy而不是memcpy，
-    // 是因为strncpy会在目标缓存最后添加一个字符串结束符'\0'
-    // 该函数在<string.h>头文件中
-    strncpy(argBuffer, argv[1], length);
+    // --format选项指定结果的格式，--exact选项启用精确整数模式，--fast-math-kernels选项使数学函数改用快速的近似实现，它们之后紧跟算术表达式
+    struct ResultFormat format = { RESULT_FORMAT_MODE_SHORTEST, 0, false, MATH_KERNEL_SET_LIBM };
+    var argIndex = 1;
+    for(; argIndex < argc - 1; argIndex++)
+    {
+        if(strcmp(argv[argIndex], "--exact") == 0)
+            format.isExactInteger = true;
+        else if(strcmp(argv[argIndex], "--fast-math-kernels") == 0)
+            format.kernelSet = MATH_KERNEL_SET_FAST;
+        else if(strcmp(argv[argIndex], "--format") == 0)
+        {
+            if(argIndex + 2 >= argc || !ParseResultFormat(argv[argIndex + 1], &format))
+            {
+                puts(resultFormatUsage);
+                return 1;
+            }
+            argIndex++;
+        }
+        else
+            break;
+    }
+    if(argIndex < argc && strcmp(argv[argIndex], "--format") == 0)
+    {
+        puts(resultFormatUsage);
+        return 1;
+    }
+    var expr = argv[argIndex];
     
-    char result[32];
+    var length = strlen(expr);
+    if(length == 0)
+    {
+        puts("No expression to calculate!");
+        return 0;
+    }
     
-    var state = CalculateArithmeticExpression(argBuffer, result);
+    // 表达式直接在argv上进行计算，不再拷贝到栈上的缓存中，因此对其长度也没有限制。
+    // 嵌套很深时，求值所需的额外空间从堆上分配
+    struct ArithmeticValue value = { false, 0, 0.0 };
+    struct CalculationError error;
+    bool state;
+    if(format.isExactInteger)
+        state = EvaluateArithmeticExpressionExactWithKernels(expr, length, format.kernelSet, NULL, &value, &error);
+    else
+        state = EvaluateArithmeticExpressionWithKernels(expr, length, format.kernelSet, NULL, &value.real, &error);
     
-    printf("The arithmetic expression to be calculated: %s\n", argBuffer);
+    printf("The arithmetic expression to be calculated: %.*s\n", (int)length, expr);
     
     if(state)
+    {
+        char result[RESULT_STRING_SIZE];
+        FormatArithmeticValue(&value, &format, result);
         printf("The answer is: %s\n", result);
+    }
     else
-        puts("Invalid expression!");
+    {
+        // 输出错误原因，并在表达式下方用^标出出错的位置
+        printf("Invalid expression: %s at offset %zu!\n", GetCalculationErrorMessage(error.code), error.offset);
+        printf("%.*s\n%*s^\n", (int)length, expr, (int)error.offset, "");
+    }
 }
 
+#endif  // !SIMPLE_CALCULATOR_LIBRARY
@@ -0,0 +1,213 @@
+//
+//  SimpleCalculator.h
+//  SimpleCalculator
+//
+//  Created by Zenny Chen on 2016/12/20.
+//  Copyright © 2016年 CodeLearning Studio. All rights reserved.
+//
+
+#ifndef SIMPLE_CALCULATOR_H
+#define SIMPLE_CALCULATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/** 计算结果的输出格式 */
+enum RESULT_FORMAT_MODE
+{
+    /** 能被精确读回的最短十进制表示，绝对值小于1e-7或者不小于1e21时使用科学计数法 */
+    RESULT_FORMAT_MODE_SHORTEST = 0,
+    
+    /** 小数点后至多保留precision位，并去掉末尾多余的零；绝对值不小于1e21时使用科学计数法的最短表示 */
+    RESULT_FORMAT_MODE_FIXED,
+    
+    /** 总是使用科学计数法的最短表示 */
+    RESULT_FORMAT_MODE_SCIENTIFIC
+};
+
+/** 数学函数的实现方式 */
+enum MATH_KERNEL_SET
+{
+    /** 使用C标准库（libm）的实现 */
+    MATH_KERNEL_SET_LIBM = 0,
+    
+    /**
+     * 对sin、cos、tan、cot、exp以及各个对数函数使用多项式近似的快速实现，其余函数仍使用libm。
+     * tan与cot的误差不超过3 ULP，其余不超过1 ULP。exp与各个对数函数只在按列求值时使用向量化的快速实现
+    */
+    MATH_KERNEL_SET_FAST
+};
+
+/** 定点格式下小数点后的最大位数 */
+#define RESULT_FORMAT_MAX_PRECISION     17
+
+/** 任何格式的结果字符串（包括结束符）都不会超过该长度 */
+#define RESULT_STRING_SIZE              48
+
+/** 计算结果的格式化方式 */
+struct ResultFormat
+{
+    enum RESULT_FORMAT_MODE mode;
+    
+    /** 定点格式下小数点后的最大位数，范围为0到RESULT_FORMAT_MAX_PRECISION */
+    int precision;
+    
+    /** 是否按精确整数模式计算，参见EvaluateArithmeticExpressionExact。整数结果总是直接输出全部数字 */
+    bool isExactInteger;
+    
+    /** 计算过程中数学函数的实现方式 */
+    enum MATH_KERNEL_SET kernelSet;
+};
+
+/** 精确整数模式的计算结果 */
+struct ArithmeticValue
+{
+    /** 结果是否为精确的整数 */
+    bool isInteger;
+    
+    /** isInteger为true时的精确结果 */
+    int64_t integer;
+    
+    /** 结果的double值，isInteger为true时为integer最接近的double */
+    double real;
+};
+
+/** 计算失败的原因 */
+enum CALCULATION_ERROR
+{
+    CALCULATION_ERROR_NONE = 0,
+    
+    /** 表达式为空 */
+    CALCULATION_ERROR_EMPTY_EXPRESSION,
+    
+    /** 表达式中出现了无法识别的字符（包括字符串结束符'\0'） */
+    CALCULATION_ERROR_INVALID_CHARACTER,
+    
+    /** 在需要操作数的位置出现了操作符 */
+    CALCULATION_ERROR_UNEXPECTED_OPERATOR,
+    
+    /** 未知的数学函数名 */
+    CALCULATION_ERROR_UNKNOWN_FUNCTION,
+    
+    /** 数学函数名后面没有紧跟'(' */
+    CALCULATION_ERROR_MISSING_FUNCTION_ARGUMENT,
+    
+    /** '('没有与之匹配的')' */
+    CALCULATION_ERROR_UNMATCHED_PARENTHESIS,
+    
+    /** 调用者所提供的工作区空间不足 */
+    CALCULATION_ERROR_OUT_OF_MEMORY,
+    
+    /**
+     * 区间归约、积分或求根的参数个数不对、索引变量名不合法、上下界不是整数（积分与求根时为不是有限值），
+     * 或者被归约的表达式以无法编译的方式依赖索引变量（如内层归约的上下界）。被归约的表达式中的其他错误按各自的原因报告
+    */
+    CALCULATION_ERROR_INVALID_REDUCTION
+};
+
+/** 结构化的错误信息 */
+struct CalculationError
+{
+    enum CALCULATION_ERROR code;
+    
+    /** 出错位置相对于表达式起始处的字节偏移 */
+    size_t offset;
+};
+
+/**
+ * 由调用者提供的工作区。
+ * 计算过程中所需的临时存储空间都从工作区中分配，并且在调用返回之前全部归还，
+ * 因此同一个工作区可以被同一线程反复使用，但不能被多个线程同时使用。
+ * 区间归约（sum、prod、min、max）以及integrate、solve例外，它们所需的存储空间总是从堆上分配
+*/
+struct CalculationArena
+{
+    unsigned char *memory;
+    size_t capacity;
+    
+    /** 当前已被占用的字节数 */
+    size_t used;
+};
+
+/** 结果缓存的统计信息 */
+struct ResultCacheStatistics
+{
+    long hitCount;
+    long missCount;
+    long evictionCount;
+    
+    /** 当前所缓存的条目个数 */
+    long entryCount;
+    
+    /** 最多能缓存的条目个数 */
+    long capacity;
+};
+
+struct ResultCache;
+struct ArithmeticProgram;
+struct ArithmeticJitProgram;
+struct ArithmeticProgramFile;
+
+/* 工作区与错误信息 */
+
+extern void InitCalculationArena(struct CalculationArena *arena, void *memory, size_t capacity);
+extern size_t GetCalculationArenaSize(size_t length);
+extern const char* GetCalculationErrorMessage(enum CALCULATION_ERROR code);
+
+/* 直接计算 */
+
+extern bool EvaluateArithmeticExpression(const char *expr, size_t length, struct CalculationArena *arena, double *pValue, struct CalculationError *pError);
+extern int FormatArithmeticResult(double value, const struct ResultFormat *format, char result[static RESULT_STRING_SIZE]);
+extern bool CalculateArithmeticExpressionWithFormat(char expr[], const struct ResultFormat *format, char result[static RESULT_STRING_SIZE]);
+extern bool CalculateArithmeticExpression(char expr[], char result[static 32]);
+
+/* 区间归约 */
+
+extern void SetReductionThreadCount(int threadCount);
+
+/* 精确整数模式 */
+
+extern bool EvaluateArithmeticExpressionExact(const char *expr, size_t length, struct CalculationArena *arena, struct ArithmeticValue *pValue, struct CalculationError *pError);
+extern int FormatArithmeticValue(const struct ArithmeticValue *value, const struct ResultFormat *format, char result[static RESULT_STRING_SIZE]);
+
+/* 结果缓存 */
+
+extern struct ResultCache* CreateResultCache(long capacity, const struct ResultFormat *format);
+extern void DestroyResultCache(struct ResultCache *cache);
+extern bool CalculateArithmeticExpressionCached(struct ResultCache *cache, char expr[], char result[static RESULT_STRING_SIZE]);
+extern void GetResultCacheStatistics(struct ResultCache *cache, struct ResultCacheStatistics *pStatistics);
+
+/* 编译后的程序 */
+
+extern struct ArithmeticProgram* CompileArithmeticExpression(const char *expr, const char *const variableNames[], int variableCount);
+extern void DestroyArithmeticProgram(struct ArithmeticProgram *program);
+extern double EvaluateArithmeticProgram(const struct ArithmeticProgram *program, const double bindings[]);
+extern double EvaluateArithmeticProgramWithKernels(const struct ArithmeticProgram *program, const double bindings[], enum MATH_KERNEL_SET kernelSet);
+extern size_t GetArithmeticProgramArenaSize(const struct ArithmeticProgram *program);
+extern bool EvaluateArithmeticProgramInArena(const struct ArithmeticProgram *program, const double bindings[], struct CalculationArena *arena, double *pValue);
+extern bool EvaluateArithmeticProgramColumns(const struct ArithmeticProgram *program, const double *const columns[], double output[], size_t count);
+extern bool EvaluateArithmeticProgramColumnsWithKernels(const struct ArithmeticProgram *program, const double *const columns[], double output[], size_t count,
+                                                        enum MATH_KERNEL_SET kernelSet);
+
+/* 前向自动微分 */
+
+extern bool EvaluateArithmeticProgramGradient(const struct ArithmeticProgram *program, const double bindings[], double *pValue, double gradient[]);
+extern bool EvaluateArithmeticProgramGradientColumns(const struct ArithmeticProgram *program, const double *const columns[], double values[], double *const gradients[], size_t count);
+
+/* 预编译程序文件 */
+
+extern bool WriteArithmeticProgramFile(const char *path, const char *const sources[], const struct ArithmeticProgram *const programs[], size_t count,
+                                       const char *const variableNames[], int variableCount, size_t *pEntryCount);
+extern struct ArithmeticProgramFile* OpenArithmeticProgramFile(const char *path);
+extern void CloseArithmeticProgramFile(struct ArithmeticProgramFile *file);
+extern const char* GetArithmeticProgramFileVariables(const struct ArithmeticProgramFile *file);
+extern const struct ArithmeticProgram* FindArithmeticProgram(const struct ArithmeticProgramFile *file, const char *expr);
+
+/* JIT */
+
+extern struct ArithmeticJitProgram* CreateArithmeticJitProgram(const struct ArithmeticProgram *program);
+extern void DestroyArithmeticJitProgram(struct ArithmeticJitProgram *jit);
+extern double EvaluateArithmeticJitProgram(const struct ArithmeticJitProgram *jit, const double bindings[]);
+
+#endif
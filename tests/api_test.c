@@ -0,0 +1,907 @@
+//
+//  api_test.c
+//  SimpleCalculator
+//
+//  库接口的测试，与libsimplecalc.a链接，通过make check运行
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <float.h>
+#include "../SimpleCalculator.h"
+
+#define var     __auto_type
+
+static int failureCount = 0;
+
+#define CHECK(condition)    do { if(!(condition)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); failureCount++; } } while(0)
+
+/** 求模的除数截断后为0时，编译后的程序按标量、工作区以及按列求值都应得到nan，而不是触发SIGFPE */
+static void TestModuloByZero(void)
+{
+    const char *names[] = { "x", "y" };
+    var program = CompileArithmeticExpression("x%y", names, 2);
+    CHECK(program != NULL);
+    if(program == NULL)
+        return;
+
+    CHECK(isnan(EvaluateArithmeticProgram(program, (const double[]){ 5.0, 0.0 })));
+    CHECK(isnan(EvaluateArithmeticProgram(program, (const double[]){ 5.0, 0.5 })));
+    CHECK(isnan(EvaluateArithmeticProgram(program, (const double[]){ 5.0, -0.9 })));
+    CHECK(EvaluateArithmeticProgram(program, (const double[]){ 7.0, 3.0 }) == 1.0);
+    CHECK(EvaluateArithmeticProgram(program, (const double[]){ -9.2e18, -1.0 }) == 0.0);
+    CHECK(isnan(EvaluateArithmeticProgramWithKernels(program, (const double[]){ 5.0, 0.0 }, MATH_KERNEL_SET_FAST)));
+
+    var size = GetArithmeticProgramArenaSize(program);
+    var memory = malloc(size);
+    struct CalculationArena arena;
+    InitCalculationArena(&arena, memory, size);
+    double value = 0.0;
+    CHECK(EvaluateArithmeticProgramInArena(program, (const double[]){ 5.0, 0.25 }, &arena, &value) && isnan(value));
+    free(memory);
+
+    // 超过一个SIMD块的行数，并且在块中间放入0除数
+    enum { ROW_COUNT = 1000 };
+    static double xs[ROW_COUNT], ys[ROW_COUNT], output[ROW_COUNT];
+    for(int i = 0; i < ROW_COUNT; i++)
+    {
+        xs[i] = i;
+        ys[i] = (i % 7 == 3)? 0.0 : 1.0 + i % 5;
+    }
+    CHECK(EvaluateArithmeticProgramColumns(program, (const double *const[]){ xs, ys }, output, ROW_COUNT));
+    for(int i = 0; i < ROW_COUNT; i++)
+    {
+        if(ys[i] == 0.0)
+            CHECK(isnan(output[i]));
+        else
+            CHECK(output[i] == (double)(i % (1 + i % 5)));
+    }
+
+    var jit = CreateArithmeticJitProgram(program);
+    if(jit != NULL)
+    {
+        CHECK(isnan(EvaluateArithmeticJitProgram(jit, (const double[]){ 5.0, 0.0 })));
+        DestroyArithmeticJitProgram(jit);
+    }
+
+    DestroyArithmeticProgram(program);
+
+    char result[RESULT_STRING_SIZE];
+    char expr[] = "5%0";
+    CHECK(CalculateArithmeticExpressionWithFormat(expr, &(struct ResultFormat){ .mode = RESULT_FORMAT_MODE_SHORTEST }, result) && strcmp(result, "nan") == 0);
+}
+
+/** 对不以'\0'结尾的字面量求值，缓冲区恰好容纳字面量本身，越界读取能被AddressSanitizer发现 */
+static bool EvaluateLiteral(const char *literal, double *pValue)
+{
+    var length = strlen(literal);
+    var buffer = (char*)malloc(length);
+    memcpy(buffer, literal, length);
+    var isSuccessful = EvaluateArithmeticExpression(buffer, length, NULL, pValue, NULL);
+    free(buffer);
+    return isSuccessful;
+}
+
+static bool IsSameDouble(double a, double b)
+{
+    return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+/** 数字字面量都应被正确舍入：快速路径与strtod的回退路径结果相同，十六进制字面量位于输入末尾时也不能越界读取 */
+static void TestNumberLiterals(void)
+{
+    static const struct
+    {
+        const char *literal;
+        double value;
+    } cases[] = {
+        { "0.1", 0.1 },
+        { "0.30000000000000004", 0.30000000000000004 },
+        { "1.7976931348623157e308", 1.7976931348623157e308 },
+        { "2.2250738585072014e-308", 0x1p-1022 },
+        // 恰好位于两个double正中间时向偶数舍入，多出的非零数字使其偏向较大的一侧
+        { "9007199254740993", 9007199254740992.0 },
+        { "9007199254740995", 9007199254740996.0 },
+        { "9007199254740993.0000000000000000001", 9007199254740994.0 },
+        { "0.1000000000000000055511151231257827021181583404541015625", 0.1 },
+        // 次正规数以及下溢、上溢
+        { "4.9406564584124654e-324", 0x1p-1074 },
+        { "2.4703282292062328e-324", 0x1p-1074 },
+        { "2.4703282292062327e-324", 0.0 },
+        { "1e-400", 0.0 },
+        { "1.7976931348623159e308", INFINITY },
+        { "1e400", INFINITY },
+        // 十六进制浮点数，其中的指数只有在p之后跟有数字时才被解析
+        { "0xff", 255.0 },
+        { "0x1.8p3", 12.0 },
+        { "0x1P-1074", 0x1p-1074 },
+        { "0x1.fffffffffffff8p0", 2.0 },
+        { "0x1.fffffffffffff7p0", 0x1.fffffffffffffp0 },
+        { "0x1f", 31.0 },
+        { "0x1", 1.0 },
+    };
+    for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        double value = NAN;
+        if(!EvaluateLiteral(cases[i].literal, &value) || !IsSameDouble(value, cases[i].value))
+        {
+            fprintf(stderr, "literal %s gives %.17g\n", cases[i].literal, value);
+            failureCount++;
+        }
+    }
+
+    // 随机的位模式以最短或者更多的有效数字输出之后，解析的结果应与strtod相同
+    uint64_t state = 0x9E3779B97F4A7C15;
+    char literal[64];
+    for(int i = 0; i < 100000; i++)
+    {
+        state = state * 6364136223846793005 + 1442695040888963407;
+        var bits = state >> 1;
+        double expected;
+        memcpy(&expected, &bits, sizeof(expected));
+        if(!isfinite(expected))
+            continue;
+        snprintf(literal, sizeof(literal), "%.*g", 1 + (int)(state % 25), expected);
+        expected = strtod(literal, NULL);
+
+        double value = NAN;
+        if(!EvaluateLiteral(literal, &value) || !IsSameDouble(value, expected))
+        {
+            fprintf(stderr, "literal %s gives %.17g instead of %.17g\n", literal, value, expected);
+            failureCount++;
+            break;
+        }
+    }
+
+    // 编译以十六进制字面量结尾的表达式，strdup所得的缓冲区之后没有多余的字节
+    static const struct
+    {
+        const char *expr;
+        double x;
+        double value;
+    } exprs[] = {
+        { "x+0x1f", 1.0, 32.0 },
+        { "0x1", 0.0, 1.0 },
+        { "x*0x1.8p1", 2.0, 6.0 },
+        { "x-0x10p-4", 2.0, 1.0 },
+    };
+    const char *names[] = { "x" };
+    for(size_t i = 0; i < sizeof(exprs) / sizeof(exprs[0]); i++)
+    {
+        var expr = strdup(exprs[i].expr);
+        var program = CompileArithmeticExpression(expr, names, 1);
+        CHECK(program != NULL && EvaluateArithmeticProgram(program, &exprs[i].x) == exprs[i].value);
+        DestroyArithmeticProgram(program);
+        free(expr);
+    }
+}
+
+/** 三种输出格式的结果，以及切换到指数形式的边界 */
+static void TestResultFormats(void)
+{
+    static const struct
+    {
+        enum RESULT_FORMAT_MODE mode;
+        int precision;
+        double value;
+        const char *result;
+    } cases[] = {
+        { RESULT_FORMAT_MODE_SHORTEST, 0, 0.1 + 0.2, "0.30000000000000004" },
+        { RESULT_FORMAT_MODE_SHORTEST, 0, 0x1p-30, "9.313225746154785e-10" },
+        { RESULT_FORMAT_MODE_SHORTEST, 0, 1.0 / 3, "0.3333333333333333" },
+        { RESULT_FORMAT_MODE_SHORTEST, 0, 100.0, "100" },
+        { RESULT_FORMAT_MODE_SHORTEST, 0, 9.99999999999999e20, "999999999999999000000" },
+        { RESULT_FORMAT_MODE_SHORTEST, 0, 1e21, "1e+21" },
+        { RESULT_FORMAT_MODE_SHORTEST, 0, 1e-7, "0.0000001" },
+        { RESULT_FORMAT_MODE_SHORTEST, 0, 9e-8, "9e-8" },
+        { RESULT_FORMAT_MODE_SHORTEST, 0, 5e-324, "5e-324" },
+        { RESULT_FORMAT_MODE_SHORTEST, 0, 1.7976931348623157e308, "1.7976931348623157e+308" },
+        { RESULT_FORMAT_MODE_SHORTEST, 0, -0.0, "-0" },
+        { RESULT_FORMAT_MODE_SHORTEST, 0, NAN, "nan" },
+        { RESULT_FORMAT_MODE_SHORTEST, 0, -INFINITY, "-inf" },
+        { RESULT_FORMAT_MODE_FIXED, 8, 1.0 / 3, "0.33333333" },
+        { RESULT_FORMAT_MODE_FIXED, 8, 0.1 + 0.2, "0.3" },
+        { RESULT_FORMAT_MODE_FIXED, 0, 2.5, "2" },
+        { RESULT_FORMAT_MODE_FIXED, 0, 3.5, "4" },
+        { RESULT_FORMAT_MODE_FIXED, 17, 0.1, "0.10000000000000001" },
+        { RESULT_FORMAT_MODE_FIXED, 3, -1.5e-10, "-0" },
+        { RESULT_FORMAT_MODE_FIXED, 3, 9.99999999999999e20, "999999999999998951424" },
+        { RESULT_FORMAT_MODE_FIXED, 8, 1e21, "1e+21" },
+        { RESULT_FORMAT_MODE_SCIENTIFIC, 0, 1.0 / 3, "3.333333333333333e-1" },
+        { RESULT_FORMAT_MODE_SCIENTIFIC, 0, 100.0, "1e+2" },
+        { RESULT_FORMAT_MODE_SCIENTIFIC, 0, 2.5, "2.5e+0" },
+        { RESULT_FORMAT_MODE_SCIENTIFIC, 0, -1.5e-10, "-1.5e-10" },
+    };
+    char result[RESULT_STRING_SIZE];
+    for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        var format = (struct ResultFormat){ .mode = cases[i].mode, .precision = cases[i].precision };
+        FormatArithmeticResult(cases[i].value, &format, result);
+        if(strcmp(result, cases[i].result) != 0)
+        {
+            fprintf(stderr, "format %d:%d of %.17g gives %s instead of %s\n", cases[i].mode, cases[i].precision, cases[i].value, result, cases[i].result);
+            failureCount++;
+        }
+    }
+
+    // 最短格式总能读回同一个double；定点格式与去掉末尾0的printf("%.Nf")相同
+    uint64_t state = 0x2545F4914F6CDD1D;
+    char expected[512];
+    for(int i = 0; i < 100000; i++)
+    {
+        state = state * 6364136223846793005 + 1442695040888963407;
+        double value;
+        if(i % 2 == 0)
+        {
+            var bits = state;
+            memcpy(&value, &bits, sizeof(value));
+            if(!isfinite(value))
+                continue;
+        }
+        else
+            value = ldexp((double)(state >> 11), (int)(state % 100) - 100);
+
+        FormatArithmeticResult(value, &(struct ResultFormat){ .mode = RESULT_FORMAT_MODE_SHORTEST }, result);
+        var parsed = strtod(result, NULL);
+        if(memcmp(&parsed, &value, sizeof(value)) != 0)
+        {
+            fprintf(stderr, "shortest format of %.17g gives %s\n", value, result);
+            failureCount++;
+            break;
+        }
+
+        if(!(fabs(value) < 1e21))
+            continue;
+        var precision = (int)(state >> 59) % 18;
+        FormatArithmeticResult(value, &(struct ResultFormat){ .mode = RESULT_FORMAT_MODE_FIXED, .precision = precision }, result);
+        snprintf(expected, sizeof(expected), "%.*f", precision, value);
+        if(strchr(expected, '.') != NULL)
+        {
+            var end = expected + strlen(expected);
+            while(end[-1] == '0')
+                end--;
+            if(end[-1] == '.')
+                end--;
+            *end = '\0';
+        }
+        if(strcmp(result, expected) != 0)
+        {
+            fprintf(stderr, "fixed:%d format of %.17g gives %s instead of %s\n", precision, value, result, expected);
+            failureCount++;
+            break;
+        }
+    }
+}
+
+/** 大量互不相同的常量应在线性时间内编译完成，并且常量池仍按位去重（0.0与-0.0是不同的常量） */
+static void TestManyConstants(void)
+{
+    enum { TERM_COUNT = 100000 };
+    var expr = (char*)malloc(TERM_COUNT * 16);
+    var cursor = expr;
+    for(int i = 0; i < TERM_COUNT; i++)
+        cursor += sprintf(cursor, "%s%d.5", i == 0? "" : "+", i);
+
+    var program = CompileArithmeticExpression(expr, NULL, 0);
+    CHECK(program != NULL);
+    if(program != NULL)
+    {
+        CHECK(EvaluateArithmeticProgram(program, NULL) == (double)TERM_COUNT * TERM_COUNT / 2);
+        DestroyArithmeticProgram(program);
+    }
+    free(expr);
+
+    const char *names[] = { "x" };
+    program = CompileArithmeticExpression("x", names, 1);
+    CHECK(program != NULL && EvaluateArithmeticProgram(program, (const double[]){ 3.0 }) == 3.0);
+    DestroyArithmeticProgram(program);
+
+    program = CompileArithmeticExpression("x*0+1/(x*-0)", names, 1);
+    CHECK(program != NULL && EvaluateArithmeticProgram(program, (const double[]){ 1.0 }) == -INFINITY);
+    DestroyArithmeticProgram(program);
+}
+
+/** 数学函数名、数学常量以及所有归约名都不能作为变量名，包括比数学函数名更长的integrate */
+static void TestVariableNames(void)
+{
+    const char *const reservedNames[] = { "sum", "prod", "min", "max", "solve", "integrate", "Integrate", "sin", "pi" };
+    for(size_t i = 0; i < sizeof(reservedNames) / sizeof(reservedNames[0]); i++)
+        CHECK(CompileArithmeticExpression("1", &reservedNames[i], 1) == NULL);
+
+    const char *const names[] = { "integrated", "integ" };
+    var program = CompileArithmeticExpression("integrated+integ", names, 2);
+    CHECK(program != NULL && EvaluateArithmeticProgram(program, (const double[]){ 1.0, 2.0 }) == 3.0);
+    DestroyArithmeticProgram(program);
+}
+
+/** 预编译程序文件中的各个源表达式，以及编译之后直接求出的它们在x=2、y=3时的值 */
+static const char *const programFileSources[] = { "x*y+1", "sin(x)/y", "PI*[2]", "sum(i,1,10,i)*x", "x$2-y" };
+enum { PROGRAM_FILE_SOURCE_COUNT = sizeof(programFileSources) / sizeof(programFileSources[0]) };
+static double programFileValues[PROGRAM_FILE_SOURCE_COUNT];
+
+static bool WriteBytes(const char *path, const unsigned char *bytes, size_t size)
+{
+    var file = fopen(path, "wb");
+    if(file == NULL)
+        return false;
+    var isSuccessful = fwrite(bytes, 1, size, file) == size;
+    return fclose(file) == 0 && isSuccessful;
+}
+
+/**
+ * 打开文件，并对其中能找到的每个程序求值。损坏的文件要么被拒绝，要么其中的程序仍能安全地求值
+ * @return 打开失败时返回-1，否则返回结果与原先一致的程序个数
+*/
+static int EvaluateProgramFile(const char *path)
+{
+    var file = OpenArithmeticProgramFile(path);
+    if(file == NULL)
+        return -1;
+
+    var matchCount = 0;
+    for(int i = 0; i < PROGRAM_FILE_SOURCE_COUNT; i++)
+    {
+        var program = FindArithmeticProgram(file, programFileSources[i]);
+        var value = (program != NULL)? EvaluateArithmeticProgram(program, (const double[]){ 2.0, 3.0 }) : NAN;
+        matchCount += value == programFileValues[i];
+    }
+    CloseArithmeticProgramFile(file);
+    return matchCount;
+}
+
+/** 写入预编译程序文件再查找并求值；截断的文件以及指令被改坏的文件都应被拒绝 */
+static void TestProgramFiles(void)
+{
+    char path[] = "/tmp/simplecalc-api-test-XXXXXX";
+    var fd = mkstemp(path);
+    CHECK(fd >= 0);
+    if(fd < 0)
+        return;
+    close(fd);
+
+    const char *names[] = { "x", "y" };
+    const struct ArithmeticProgram *programs[PROGRAM_FILE_SOURCE_COUNT];
+    for(int i = 0; i < PROGRAM_FILE_SOURCE_COUNT; i++)
+    {
+        CHECK((programs[i] = CompileArithmeticExpression(programFileSources[i], names, 2)) != NULL);
+        programFileValues[i] = (programs[i] != NULL)? EvaluateArithmeticProgram(programs[i], (const double[]){ 2.0, 3.0 }) : NAN;
+    }
+    CHECK(programFileValues[0] == 7.0 && programFileValues[3] == 110.0);
+    size_t entryCount = 0;
+    CHECK(WriteArithmeticProgramFile(path, programFileSources, programs, PROGRAM_FILE_SOURCE_COUNT, names, 2, &entryCount));
+    CHECK(entryCount == PROGRAM_FILE_SOURCE_COUNT);
+    for(int i = 0; i < PROGRAM_FILE_SOURCE_COUNT; i++)
+        DestroyArithmeticProgram((struct ArithmeticProgram*)programs[i]);
+
+    var file = OpenArithmeticProgramFile(path);
+    CHECK(file != NULL);
+    if(file == NULL)
+    {
+        unlink(path);
+        return;
+    }
+    CHECK(strcmp(GetArithmeticProgramFileVariables(file), "x,y") == 0);
+    CHECK(FindArithmeticProgram(file, "pi*(2)") != NULL);
+    CHECK(FindArithmeticProgram(file, "x*y+2") == NULL);
+    CloseArithmeticProgramFile(file);
+    CHECK(EvaluateProgramFile(path) == PROGRAM_FILE_SOURCE_COUNT);
+
+    // 读回整个文件，之后的各项测试都在它的副本上做修改
+    var input = fopen(path, "rb");
+    static unsigned char original[1 << 16], bytes[1 << 16];
+    var size = (input != NULL)? fread(original, 1, sizeof(original), input) : 0;
+    if(input != NULL)
+        fclose(input);
+    CHECK(size > 0 && size < sizeof(original));
+
+    for(size_t length = 0; length < size; length++)
+    {
+        CHECK(WriteBytes(path, original, length));
+        CHECK(OpenArithmeticProgramFile(path) == NULL);
+    }
+
+    // 文件头中指令区与源表达式区的偏移分别位于第80与第88字节，指令为4字节，低8位是操作码，高24位是操作数
+    uint64_t instructionsOffset, sourcesOffset;
+    memcpy(&instructionsOffset, &original[80], sizeof(instructionsOffset));
+    memcpy(&sourcesOffset, &original[88], sizeof(sourcesOffset));
+    CHECK(instructionsOffset < sourcesOffset && sourcesOffset <= size);
+    for(var offset = instructionsOffset; offset + 4 <= sourcesOffset && sourcesOffset <= size; offset += 4)
+    {
+        uint32_t instruction;
+        memcpy(&instruction, &original[offset], sizeof(instruction));
+
+        // 不存在的操作码
+        memcpy(bytes, original, size);
+        var corrupted = instruction | 0xff;
+        memcpy(&bytes[offset], &corrupted, sizeof(corrupted));
+        CHECK(WriteBytes(path, bytes, size) && EvaluateProgramFile(path) == -1);
+
+        // 越界的操作数：带操作数的指令（压入常量、压入变量、函数调用以及存取临时单元，即操作码1、2与11到13）被拒绝，
+        // 其余的指令忽略操作数，结果不变
+        var opcode = instruction & 0xff;
+        var hasOperand = opcode == 1 || opcode == 2 || (opcode >= 11 && opcode <= 13);
+        corrupted = instruction | 0xffffff00;
+        memcpy(&bytes[offset], &corrupted, sizeof(corrupted));
+        CHECK(WriteBytes(path, bytes, size) && EvaluateProgramFile(path) == (hasOperand? -1 : PROGRAM_FILE_SOURCE_COUNT));
+    }
+
+    // 逐个字节取反：文件要么被拒绝，要么其中的程序仍能安全地求值
+    for(size_t offset = 0; offset < size; offset++)
+    {
+        memcpy(bytes, original, size);
+        bytes[offset] ^= 0xff;
+        if(WriteBytes(path, bytes, size))
+            EvaluateProgramFile(path);
+    }
+
+    unlink(path);
+}
+
+/** 编译器不使用递归，百万项的扁平表达式以及百万层的括号嵌套都能编译，并且结果与直接求值相同 */
+static void TestHugeExpressions(void)
+{
+    enum { TERM_COUNT = 1000000 };
+    const char *names[] = { "x" };
+    var expr = (char*)malloc(TERM_COUNT * 8 + 16);
+    const char *const terms[] = { "x*2", "2*3", "x^2" };
+    const double values[] = { 3.0 * TERM_COUNT, 6.0 * TERM_COUNT, 2.25 * TERM_COUNT };
+    for(int t = 0; t < 3; t++)
+    {
+        var cursor = expr;
+        for(int i = 0; i < TERM_COUNT; i++)
+            cursor += sprintf(cursor, "%s%s", i == 0? "" : "+", terms[t]);
+
+        var program = CompileArithmeticExpression(expr, names, 1);
+        CHECK(program != NULL);
+        if(program == NULL)
+            continue;
+
+        CHECK(EvaluateArithmeticProgram(program, (const double[]){ 1.5 }) == values[t]);
+        double column[] = { 1.5, 1.5, 1.5 }, output[3];
+        CHECK(EvaluateArithmeticProgramColumns(program, (const double *const[]){ column }, output, 3) && output[2] == values[t]);
+        DestroyArithmeticProgram(program);
+
+        // 用x的值替换掉变量之后直接求值，作为对照
+        if(t == 1)
+        {
+            double value = 0.0;
+            CHECK(EvaluateArithmeticExpression(expr, strlen(expr), NULL, &value, NULL) && value == values[t]);
+        }
+    }
+
+    // 括号嵌套与函数嵌套
+    var cursor = expr;
+    for(int i = 0; i < TERM_COUNT; i++)
+        *cursor++ = '(';
+    cursor += sprintf(cursor, "x+1");
+    for(int i = 0; i < TERM_COUNT; i++)
+        *cursor++ = ')';
+    *cursor = '\0';
+    var program = CompileArithmeticExpression(expr, names, 1);
+    CHECK(program != NULL && EvaluateArithmeticProgram(program, (const double[]){ 1.5 }) == 2.5);
+    DestroyArithmeticProgram(program);
+
+    // 缺少一个右括号时编译失败，而不是崩溃
+    expr[strlen(expr) - 1] = '\0';
+    CHECK(CompileArithmeticExpression(expr, names, 1) == NULL);
+
+    // 反复开平方会收敛到1
+    cursor = expr;
+    for(int i = 0; i < TERM_COUNT; i++)
+        cursor += sprintf(cursor, "sqrt(");
+    *cursor++ = 'x';
+    for(int i = 0; i < TERM_COUNT; i++)
+        *cursor++ = ')';
+    *cursor = '\0';
+    program = CompileArithmeticExpression(expr, names, 1);
+    CHECK(program != NULL && EvaluateArithmeticProgram(program, (const double[]){ 1.5 }) == 1.0);
+    DestroyArithmeticProgram(program);
+
+    free(expr);
+}
+
+/** 在另一个线程中计算归约，与主线程的归约同时争用共享的线程池 */
+static void* EvaluateReductionThread(void *argument)
+{
+    var value = (double*)argument;
+    const char *expr = "sum(i,1,2000000,1/i^2)";
+    if(!EvaluateArithmeticExpression(expr, strlen(expr), NULL, value, NULL))
+        *value = 0.0;
+    return NULL;
+}
+
+/** 任意线程数下归约结果都逐位相同，多个线程同时归约时也是如此；归约体中求模的除数为0时结果为nan */
+static void TestReductionThreads(void)
+{
+    const char *expr = "sum(i,1,2000000,1/i^2)";
+    double expected = 0.0, value = 0.0;
+    SetReductionThreadCount(1);
+    CHECK(EvaluateArithmeticExpression(expr, strlen(expr), NULL, &expected, NULL));
+
+    const int threadCounts[] = { 2, 4, 3, 0 };
+    for(int i = 0; i < 4; i++)
+    {
+        SetReductionThreadCount(threadCounts[i]);
+        CHECK(EvaluateArithmeticExpression(expr, strlen(expr), NULL, &value, NULL) && value == expected);
+    }
+
+    SetReductionThreadCount(4);
+    double values[4] = { 0.0 };
+    pthread_t threads[4];
+    for(int i = 0; i < 4; i++)
+        CHECK(pthread_create(&threads[i], NULL, EvaluateReductionThread, &values[i]) == 0);
+    CHECK(EvaluateArithmeticExpression(expr, strlen(expr), NULL, &value, NULL) && value == expected);
+    for(int i = 0; i < 4; i++)
+    {
+        pthread_join(threads[i], NULL);
+        CHECK(values[i] == expected);
+    }
+
+    const char *modulo = "sum(i,0,3,5%i)+prod(i,-100000,100000,1+0*(7%i))";
+    CHECK(EvaluateArithmeticExpression(modulo, strlen(modulo), NULL, &value, NULL) && isnan(value));
+    SetReductionThreadCount(0);
+}
+
+/** 精确整数模式在int64_t的边界上保持精确，溢出时转为double，格式化时整数直接输出全部数字 */
+static void TestExactIntegers(void)
+{
+    const struct
+    {
+        const char *expr;
+        bool isInteger;
+        int64_t integer;
+        double real;
+        const char *result;
+    } cases[] =
+    {
+        { "9223372036854775807", true, INT64_MAX, 0x1p63, "9223372036854775807" },
+        { "-9223372036854775807-1", true, INT64_MIN, -0x1p63, "-9223372036854775808" },
+        { "(0-3)^39", true, -4052555153018976267LL, -4052555153018976267.0, "-4052555153018976267" },
+        { "(0-2)^63", true, INT64_MIN, -0x1p63, "-9223372036854775808" },
+        { "2^53+1", true, 9007199254740993LL, 0x1p53, "9007199254740993" },
+        { "(-9223372036854775807-1)%(0-1)", true, 0, 0.0, "0" },
+        { "6/3", true, 2, 2.0, "2" },
+        { "-0*5", true, 0, 0.0, "0" },
+        { "(0-3)^40", false, 0, 12157665459056928801.0, "12157665459056929000" },
+        { "9223372036854775807+1", false, 0, 0x1p63, "9223372036854776000" },
+        { "-9223372036854775807-2", false, 0, -0x1p63, "-9223372036854776000" },
+        { "9223372036854775808", false, 0, 0x1p63, "9223372036854776000" },
+        { "0-(-9223372036854775807-1)", false, 0, 0x1p63, "9223372036854776000" },
+        { "(-9223372036854775807-1)/(0-1)", false, 0, 0x1p63, "9223372036854776000" },
+        { "3037000500*3037000500", false, 0, 9223372037000250000.0, "9223372037000250000" },
+        { "2^63", false, 0, 0x1p63, "9223372036854776000" },
+        { "2^53+1.0", false, 0, 0x1p53, "9007199254740992" },
+        { "7/2", false, 0, 3.5, "3.5" },
+    };
+
+    var format = (struct ResultFormat){ .mode = RESULT_FORMAT_MODE_SHORTEST, .isExactInteger = true };
+    for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        struct ArithmeticValue value;
+        struct CalculationError error;
+        char result[RESULT_STRING_SIZE];
+        CHECK(EvaluateArithmeticExpressionExact(cases[i].expr, strlen(cases[i].expr), NULL, &value, &error));
+        CHECK(value.isInteger == cases[i].isInteger && IsSameDouble(value.real, cases[i].real));
+        if(cases[i].isInteger)
+            CHECK(value.integer == cases[i].integer);
+        FormatArithmeticValue(&value, &format, result);
+        if(strcmp(result, cases[i].result) != 0)
+        {
+            fprintf(stderr, "%s: exact result %s, expected %s\n", cases[i].expr, result, cases[i].result);
+            failureCount++;
+        }
+
+        // 通过isExactInteger选择精确模式时结果相同
+        char *expr = strdup(cases[i].expr);
+        CHECK(CalculateArithmeticExpressionWithFormat(expr, &format, result) && strcmp(result, cases[i].result) == 0);
+        free(expr);
+    }
+}
+
+/** 两个数相等，或者相对误差不超过几个ulp */
+static bool IsCloseDouble(double value, double expected)
+{
+    if(value == expected)
+        return true;
+    return fabs(value - expected) <= 4.0 * DBL_EPSILON * fabs(expected);
+}
+
+/**
+ * 前向自动微分得到的偏导数与解析结果相符，按列求值与逐行求值的结果逐位相同。
+ * 子表达式不依赖的变量在其奇点处的偏导数仍为0，比如sqrt(x) + y在x = 0处对y的偏导数为1而不是nan
+ */
+static void TestGradients(void)
+{
+    const struct
+    {
+        const char *expr;
+        double x, y;
+        double dx, dy;
+    } cases[] =
+    {
+        { "x^y", 2.0, 3.0, 12.0, 8.0 * M_LN2 },
+        { "asinh(x*y)", 0.5, 3.0, 3.0 / sqrt(3.25), 0.5 / sqrt(3.25) },
+        { "cbrt(x)", 8.0, 1.0, 1.0 / 12.0, 0.0 },
+        { "deg(x)+rad(y)", 1.0, 1.0, 180.0 / M_PI, M_PI / 180.0 },
+        { "sum(i,1,10,i)*x", 2.0, 1.0, 55.0, 0.0 },
+        { "sqrt(x)+y", 0.0, 2.0, INFINITY, 1.0 },
+        { "log(x)+y", 0.0, 2.0, INFINITY, 1.0 },
+        { "1/x+y", 0.0, 2.0, -INFINITY, 1.0 },
+        { "sqrt(x)*y", 0.0, 2.0, INFINITY, 0.0 },
+        { "y/x", 0.0, 0.0, NAN, INFINITY },
+        { "(x-x)/x+y", 0.0, 2.0, NAN, 1.0 },
+    };
+    const char *const names[] = { "x", "y" };
+    const int caseCount = sizeof(cases) / sizeof(cases[0]);
+
+    for(int i = 0; i < caseCount; i++)
+    {
+        var program = CompileArithmeticExpression(cases[i].expr, names, 2);
+        CHECK(program != NULL);
+        if(program == NULL)
+            continue;
+
+        double value = 0.0, gradient[2] = { 0.0, 0.0 };
+        var bindings = (const double[]){ cases[i].x, cases[i].y };
+        CHECK(EvaluateArithmeticProgramGradient(program, bindings, &value, gradient));
+        CHECK(IsSameDouble(value, EvaluateArithmeticProgram(program, bindings)));
+        if(!(isnan(cases[i].dx)? isnan(gradient[0]) : IsCloseDouble(gradient[0], cases[i].dx)))
+        {
+            fprintf(stderr, "%s: d/dx = %.17g, expected %.17g\n", cases[i].expr, gradient[0], cases[i].dx);
+            failureCount++;
+        }
+        if(!(isnan(cases[i].dy)? isnan(gradient[1]) : IsCloseDouble(gradient[1], cases[i].dy)))
+        {
+            fprintf(stderr, "%s: d/dy = %.17g, expected %.17g\n", cases[i].expr, gradient[1], cases[i].dy);
+            failureCount++;
+        }
+
+        // 按列求值时把这一行与其他行混在一起，覆盖整块、剩余部分以及非有限值相邻的元素
+        enum { rowCount = 301 };
+        static double xs[rowCount], ys[rowCount], values[rowCount], dxs[rowCount], dys[rowCount];
+        for(int j = 0; j < rowCount; j++)
+        {
+            xs[j] = (j % 3 == 0)? cases[i].x : cases[i].x + j * 0.125;
+            ys[j] = (j % 5 == 0)? cases[i].y : cases[i].y - j * 0.0625;
+        }
+        const double *columns[] = { xs, ys };
+        CHECK(EvaluateArithmeticProgramGradientColumns(program, columns, values, (double *const[]){ dxs, dys }, rowCount));
+        for(int j = 0; j < rowCount; j++)
+        {
+            CHECK(EvaluateArithmeticProgramGradient(program, (const double[]){ xs[j], ys[j] }, &value, gradient));
+            CHECK(IsSameDouble(values[j], value) && IsSameDouble(dxs[j], gradient[0]) && IsSameDouble(dys[j], gradient[1]));
+        }
+
+        // 不需要的偏导数列可以为NULL
+        CHECK(EvaluateArithmeticProgramGradientColumns(program, columns, values, (double *const[]){ NULL, dys }, rowCount));
+        CHECK(EvaluateArithmeticProgramGradient(program, (const double[]){ xs[7], ys[7] }, &value, gradient));
+        CHECK(IsSameDouble(values[7], value) && IsSameDouble(dys[7], gradient[1]));
+        DestroyArithmeticProgram(program);
+    }
+}
+
+/**
+ * 把表达式中的变量X、Y替换为数值的文本，所有double（包括无穷大、NaN与-0）都能精确读回。
+ * 负号不能作用于括号，所以变量前的负号直接并入数值
+ */
+static void SubstituteVariables(const char *expr, const double bindings[2], char *buffer, size_t size)
+{
+    size_t length = 0;
+    for(const char *cursor = expr; *cursor != '\0' && length < size; cursor++)
+    {
+        var isNegative = (*cursor == '-' && (cursor[1] == 'X' || cursor[1] == 'Y') && (cursor == expr || strchr("+-*/%^(", cursor[-1]) != NULL));
+        if(isNegative)
+            cursor++;
+
+        if(*cursor != 'X' && *cursor != 'Y')
+        {
+            buffer[length++] = *cursor;
+            continue;
+        }
+
+        var value = isNegative? -bindings[*cursor - 'X'] : bindings[*cursor - 'X'];
+        if(isnan(value))
+            length += snprintf(buffer + length, size - length, "(0/0)");
+        else if(isinf(value))
+            length += snprintf(buffer + length, size - length, (value > 0.0)? "(1/0)" : "(-1/0)");
+        else
+            length += snprintf(buffer + length, size - length, "(%.17g)", value);
+    }
+    buffer[(length < size)? length : size - 1] = '\0';
+}
+
+/**
+ * 优化后的程序与不经优化的直接计算结果逐位相同（NaN的符号除外），
+ * 包括恒等式化简时的-0、无穷大与NaN，以及公共子表达式只计算一次的情况
+ */
+static void TestOptimizedPrograms(void)
+{
+    const char *const exprs[] =
+    {
+        "X*0+1/(X*-0)", "X*1", "1*X", "X/1", "X-0", "0-X", "X+0", "0+X", "-X", "X*-Y*-1", "0-(0-X)", "X^1", "X^0", "1^X", "0^X", "X*0", "0/X",
+        "X-X", "X/X", "(X+1)^2/(X+1)", "(X*Y+1)/(X*Y+1)+(X*Y+1)", "sin(X)*sin(X)+cos(X)*cos(X)", "(X+Y)*(X+Y)-(X+Y)",
+        "X%Y+X%Y", "sqrt(X^2+Y^2)/sqrt(X^2+Y^2)", "sin(rad(45))*sqrt(2)*ln(e)*ln(exp(2))*X", "2^-1074*X*Y", "exp(X)-exp(X)*1+exp(X)^1",
+    };
+    const double values[] = { 0.0, -0.0, 1.0, -1.0, 0.5, 2.0, -3.0, 1e308, -1e-310, INFINITY, -INFINITY, NAN };
+    const int valueCount = sizeof(values) / sizeof(values[0]);
+    const char *const names[] = { "X", "Y" };
+
+    for(size_t i = 0; i < sizeof(exprs) / sizeof(exprs[0]); i++)
+    {
+        var program = CompileArithmeticExpression(exprs[i], names, 2);
+        CHECK(program != NULL);
+        if(program == NULL)
+            continue;
+
+        for(int j = 0; j < valueCount * valueCount; j++)
+        {
+            const double bindings[2] = { values[j / valueCount], values[j % valueCount] };
+            char buffer[512];
+            SubstituteVariables(exprs[i], bindings, buffer, sizeof(buffer));
+
+            double expected = 0.0;
+            CHECK(EvaluateArithmeticExpression(buffer, strlen(buffer), NULL, &expected, NULL));
+            var value = EvaluateArithmeticProgram(program, bindings);
+            if(!(isnan(expected)? isnan(value) : IsSameDouble(value, expected)))
+            {
+                fprintf(stderr, "%s: optimized %.17g, expected %.17g\n", buffer, value, expected);
+                failureCount++;
+            }
+        }
+        DestroyArithmeticProgram(program);
+    }
+}
+
+/** 缓存命中与未命中时返回值与结果字符串都相同，并且与不带缓存的计算一致，淘汰之后再次计算的结果也不变 */
+static void TestResultCache(void)
+{
+    const char *const exprs[] =
+    {
+        "1+2", "0.1+0.2", "2^-30", "1/3", "-0*1", "0/0", "1/0", "sin(1)", "2^53+1", "9223372036854775807+1",
+        "sum(i,1,10,i)", "1+", "(1", "foo(1)", "", "3%0", "1e400", "1e-320",
+    };
+    const int exprCount = sizeof(exprs) / sizeof(exprs[0]);
+    const struct ResultFormat formats[] =
+    {
+        { RESULT_FORMAT_MODE_SHORTEST, 0, false, MATH_KERNEL_SET_LIBM },
+        { RESULT_FORMAT_MODE_FIXED, 3, false, MATH_KERNEL_SET_LIBM },
+        { RESULT_FORMAT_MODE_SCIENTIFIC, 0, false, MATH_KERNEL_SET_LIBM },
+        { RESULT_FORMAT_MODE_SHORTEST, 0, true, MATH_KERNEL_SET_LIBM },
+    };
+    const long capacities[] = { 1024, 3 };
+
+    for(size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++)
+    {
+        for(size_t c = 0; c < sizeof(capacities) / sizeof(capacities[0]); c++)
+        {
+            var cache = CreateResultCache(capacities[c], &formats[f]);
+            CHECK(cache != NULL);
+            if(cache == NULL)
+                continue;
+
+            for(int round = 0; round < 3; round++)
+            {
+                for(int i = 0; i < exprCount; i++)
+                {
+                    char reference[RESULT_STRING_SIZE] = "", result[RESULT_STRING_SIZE];
+                    char *expr = strdup(exprs[i]);
+                    var isValid = CalculateArithmeticExpressionWithFormat(expr, &formats[f], reference);
+                    free(expr);
+
+                    memset(result, '#', sizeof(result));
+                    result[RESULT_STRING_SIZE - 1] = '\0';
+                    expr = strdup(exprs[i]);
+                    var isCachedValid = CalculateArithmeticExpressionCached(cache, expr, result);
+                    free(expr);
+                    CHECK(isCachedValid == isValid);
+                    if(isValid && strcmp(result, reference) != 0)
+                    {
+                        fprintf(stderr, "%s: cached result %s, expected %s (round %d)\n", exprs[i], result, reference, round);
+                        failureCount++;
+                    }
+                }
+            }
+
+            struct ResultCacheStatistics statistics;
+            GetResultCacheStatistics(cache, &statistics);
+            CHECK(statistics.entryCount <= statistics.capacity);
+            if(capacities[c] >= exprCount)
+                CHECK(statistics.hitCount > 0 && statistics.evictionCount == 0 && statistics.hitCount == 2 * statistics.missCount);
+            DestroyResultCache(cache);
+        }
+    }
+
+    // 条目远多于容量时反复淘汰，重新计算的结果仍然正确
+    var cache = CreateResultCache(1, NULL);
+    CHECK(cache != NULL);
+    for(int round = 0; cache != NULL && round < 2; round++)
+    {
+        for(int i = 0; i < 200; i++)
+        {
+            char expr[32], expected[32], result[RESULT_STRING_SIZE];
+            snprintf(expr, sizeof(expr), "%d*3+1", i);
+            snprintf(expected, sizeof(expected), "%d", i * 3 + 1);
+            CHECK(CalculateArithmeticExpressionCached(cache, expr, result) && strcmp(result, expected) == 0);
+        }
+    }
+    if(cache != NULL)
+    {
+        struct ResultCacheStatistics statistics;
+        GetResultCacheStatistics(cache, &statistics);
+        CHECK(statistics.evictionCount > 0 && statistics.entryCount <= statistics.capacity);
+    }
+    DestroyResultCache(cache);
+}
+
+/** 被归约的表达式中的错误按其本身的原因以及位置报告，参数个数、索引变量名与上下界的错误才报告为非法的归约 */
+static void TestReductionErrors(void)
+{
+    const struct
+    {
+        const char *expr;
+        enum CALCULATION_ERROR code;
+        size_t offset;
+    } cases[] =
+    {
+        { "sum(i,1,3,foo(i))", CALCULATION_ERROR_UNKNOWN_FUNCTION, 10 },
+        { "1+prod(k,1,3,k*bar(k))", CALCULATION_ERROR_UNKNOWN_FUNCTION, 15 },
+        { "sum(i,1,3,j)", CALCULATION_ERROR_UNKNOWN_FUNCTION, 10 },
+        { "sum(i,1,3,i#2)", CALCULATION_ERROR_INVALID_CHARACTER, 11 },
+        { "sum(i,1,3,sin i)", CALCULATION_ERROR_MISSING_FUNCTION_ARGUMENT, 13 },
+        { "sum(i,1,3,0x1p3*i+foo)", CALCULATION_ERROR_UNKNOWN_FUNCTION, 18 },
+        { "integrate(x,0,1,x*bar(x))", CALCULATION_ERROR_UNKNOWN_FUNCTION, 18 },
+        { "sum(i,1,3,sum(j,1,2,foo(j)))", CALCULATION_ERROR_UNKNOWN_FUNCTION, 20 },
+        { "sum(ii,1,3,ii*foo(i))", CALCULATION_ERROR_UNKNOWN_FUNCTION, 14 },
+        { "sum(i,1,3,sum(j,1,i,j))", CALCULATION_ERROR_INVALID_REDUCTION, 10 },
+        { "sum(i,1,3,)", CALCULATION_ERROR_INVALID_REDUCTION, 10 },
+        { "sum(i,1,3)", CALCULATION_ERROR_INVALID_REDUCTION, 9 },
+        { "sum(i,1,2,3,i)", CALCULATION_ERROR_INVALID_REDUCTION, 11 },
+        { "sum(1,1,3,2)", CALCULATION_ERROR_INVALID_REDUCTION, 4 },
+        { "sum(i,1.5,3,i)", CALCULATION_ERROR_INVALID_REDUCTION, 6 },
+        { "sum(i,1,foo,i)", CALCULATION_ERROR_UNKNOWN_FUNCTION, 8 },
+    };
+
+    for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        double value;
+        struct CalculationError error = { CALCULATION_ERROR_NONE, 0 };
+        CHECK(!EvaluateArithmeticExpression(cases[i].expr, strlen(cases[i].expr), NULL, &value, &error));
+        if(error.code != cases[i].code || error.offset != cases[i].offset)
+        {
+            fprintf(stderr, "%s: error %d at %zu, expected %d at %zu\n", cases[i].expr, error.code, error.offset, cases[i].code, cases[i].offset);
+            failureCount++;
+        }
+    }
+}
+
+int main(void)
+{
+    TestModuloByZero();
+    TestNumberLiterals();
+    TestResultFormats();
+    TestManyConstants();
+    TestVariableNames();
+    TestProgramFiles();
+    TestHugeExpressions();
+    TestReductionThreads();
+    TestReductionErrors();
+    TestGradients();
+    TestExactIntegers();
+    TestOptimizedPrograms();
+    TestResultCache();
+
+    if(failureCount > 0)
+    {
+        fprintf(stderr, "%d check(s) failed\n", failureCount);
+        return 1;
+    }
+
+    puts("All API tests passed.");
+    return 0;
+}
@@ -0,0 +1,116 @@
+#!/bin/sh
+#
+#  cli_test.sh
+#  SimpleCalculator
+#
+#  命令行程序的测试，通过make check运行，第一个参数为可执行文件的路径，第二个参数为服务端测试所用的客户端
+#
+
+CALCULATOR=${1:-./SimpleCalculator}
+SOCKET_CLIENT=$2
+failures=0
+
+# 比较实际输出与期望输出，不一致时记为失败
+expect_output()
+{
+    if [ "$2" != "$3" ]; then
+        echo "FAIL: $1" >&2
+        echo "  expected: $(printf '%s' "$3" | tr '\n' '|')" >&2
+        echo "  actual:   $(printf '%s' "$2" | tr '\n' '|')" >&2
+        failures=$((failures + 1))
+    fi
+}
+
+# JIT代码与解释器对随机表达式的结果逐位相同（不支持JIT的平台上退回解释器，同样应当通过）
+for seed in 20161220 7; do
+    if ! "$CALCULATOR" --verify-jit 50000 $seed >/dev/null 2>&1; then
+        expect_output "JIT matches the interpreter (seed $seed)" "mismatch" "identical"
+    fi
+done
+
+# 默认输出最短的往返形式，--format可以选择定点或者指数形式
+output=$(printf '0.1+0.2\n1/3\n2^-30\n1e21\n' | "$CALCULATOR" --batch 2>/dev/null)
+expect_output "default format" "$output" "$(printf '0.30000000000000004\n0.3333333333333333\n9.313225746154785e-10\n1e+21')"
+output=$(printf '0.1+0.2\n1/3\n2^-30\n' | "$CALCULATOR" --batch --format fixed:8 2>/dev/null)
+expect_output "fixed:8 format" "$output" "$(printf '0.3\n0.33333333\n0')"
+output=$(printf '1/3\n100\n' | "$CALCULATOR" --batch --format scientific 2>/dev/null)
+expect_output "scientific format" "$output" "$(printf '3.333333333333333e-1\n1e+2')"
+
+# 批处理遇到求模的除数为0时输出nan并继续，前后各行的结果都不能丢失
+for threads in "" "--threads 2"; do
+    output=$(printf '1+1\n7%%3\n5%%0\n2*3\n5%%0.5\n9%%4\n' | "$CALCULATOR" --batch $threads 2>/dev/null)
+    expect_output "batch $threads with %0 lines" "$output" "$(printf '2\n1\nnan\n6\nnan\n1')"
+done
+
+# 归约体中求模的除数为0时结果为nan；并行批处理中的归约与逐行处理的结果相同
+output=$(printf 'sum(i,0,3,5%%i)\n' | "$CALCULATOR" --batch 2>/dev/null)
+expect_output "reduction with %0 term" "$output" "nan"
+reductions='sum(i,1,1000000,1/i^2)\nprod(i,1,100000,1+1/i^2)\nmax(i,1,200000,sin(i))\nsum(i,1,100000,i%%7)\n'
+expected=$(printf "$reductions" | "$CALCULATOR" --batch 2>/dev/null)
+output=$(printf "$reductions" | "$CALCULATOR" --batch --threads 2 2>/dev/null)
+expect_output "reductions in parallel batch" "$output" "$expected"
+
+# 发散或者在子区间个数的上限内无法收敛的积分结果为nan，收敛的积分不受影响
+output=$(printf 'integrate(x,0,1,1/x)\nintegrate(x,0,1,1/x^2)\nintegrate(x,0,1,sin(1/x))\nintegrate(x,0,pi,sin(x))\nintegrate(x,0,1,ln(x))\n' | "$CALCULATOR" --batch 2>/dev/null)
+expect_output "divergent integrals" "$output" "$(printf 'nan\nnan\nnan\n2\n-0.9999999999999015')"
+
+# 表头中不能作为变量名的字段不绑定为变量，只有表达式用到它们时才报错，并指出字段名
+csv=${TMPDIR:-/tmp}/simplecalc-test-$$.csv
+printf 'order id,"a b",max,sin,price,qty,\n1,2,3,4,2.5,4,\n2,2,3,4,3,0,\n' > "$csv"
+output=$("$CALCULATOR" --csv 'price*qty+sin(max(i,1,3,i))' "$csv" - 2>/dev/null)
+expect_output "csv with invalid header names" "$output" "$(printf '10.141120008059866\n0.1411200080598672')"
+output=$("$CALCULATOR" --csv 'price*max' "$csv" - 2>&1 >/dev/null)
+expect_output "csv using an invalid header name" "$output" 'Column "max" is not a valid variable name: price*max'
+output=$("$CALCULATOR" --csv 'order*qty' "$csv" - 2>&1 >/dev/null)
+expect_output "csv using an unknown name" "$output" 'Unknown column order: order*qty'
+printf 'x,y\n5,0\n7,3\n5,0.5\n' > "$csv"
+output=$("$CALCULATOR" --csv 'x%y' "$csv" - 2>/dev/null)
+expect_output "csv with %0 rows" "$output" "$(printf 'nan\n1\nnan')"
+rm -f "$csv"
+
+# 表格中引用自身的定义报告为环，无论单元是新增的还是已有的，并且被拒绝的新单元不会留在表格中
+sheet=${TMPDIR:-/tmp}/simplecalc-test-$$.sheet
+printf 'b = 2\n' > "$sheet"
+output=$(printf 'a = a+1\nb = b*2\na\nc = b+1\n' | "$CALCULATOR" --sheet "$sheet" 2>/dev/null)
+expect_output "sheet self-reference" "$output" "$(printf 'b = 2\nerror: line 1: circular reference: a -> a\nerror: line 2: circular reference: b -> b\nerror: line 3: unknown name\nc = 3')"
+printf 'a = a+1\n' > "$sheet"
+output=$("$CALCULATOR" --sheet "$sheet" </dev/null 2>&1)
+expect_output "sheet self-reference on load" "$output" "error: circular reference: a -> a"
+printf 'integrate = 2\n' > "$sheet"
+output=$("$CALCULATOR" --sheet "$sheet" </dev/null 2>&1)
+expect_output "sheet rejects a reduction name" "$output" "error: line 1: invalid name"
+: > "$sheet"
+output=$(printf 'b = 2\nINTEGRATE = 3\na = integrate(x,0,1,x)*b\nc = sum(b,1,3,b)+a\nb = 4\n' | "$CALCULATOR" --sheet "$sheet" 2>/dev/null)
+expect_output "sheet formulas with reductions" "$output" "$(printf 'b = 2\nerror: line 2: invalid name\na = 1\nc = 7\nb = 4\na = 2\nc = 8')"
+rm -f "$sheet"
+
+# 服务端收到求模的除数为0的请求时应答nan，之后仍能回答其他连接上的请求（仅限Linux）
+if [ "$(uname -s)" = Linux ] && [ -n "$SOCKET_CLIENT" ]; then
+    socket=${TMPDIR:-/tmp}/simplecalc-test-$$.sock
+    "$CALCULATOR" --serve "$socket" --threads 1 >/dev/null 2>&1 &
+    server=$!
+    for i in 1 2 3 4 5 6 7 8 9 10; do
+        [ -S "$socket" ] && break
+        sleep 0.1
+    done
+    output=$(printf '5%%0\n' | "$SOCKET_CLIENT" "$socket")
+    expect_output "server answers 5%0" "$output" "nan"
+    output=$(printf '1+2\n2*3\n' | "$SOCKET_CLIENT" "$socket")
+    expect_output "server answers after 5%0" "$output" "$(printf '3\n6')"
+    if kill "$server" 2>/dev/null; then
+        wait "$server"
+    else
+        expect_output "server still running" "exited" "running"
+    fi
+    if [ -e "$socket" ]; then
+        expect_output "socket file removed" "present" "removed"
+        rm -f "$socket"
+    fi
+fi
+
+if [ $failures -gt 0 ]; then
+    echo "$failures CLI test(s) failed" >&2
+    exit 1
+fi
+
+echo "All CLI tests passed."
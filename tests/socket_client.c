@@ -0,0 +1,53 @@
+//
+//  socket_client.c
+//  SimpleCalculator
+//
+//  服务端测试所用的最小客户端：把标准输入的内容发送到Unix域套接字，关闭写端后把收到的全部应答写到标准输出
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+int main(int argc, const char *argv[])
+{
+    if(argc < 2)
+    {
+        fputs("Usage: socket_client <socket path>\n", stderr);
+        return 2;
+    }
+
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if(strlen(argv[1]) >= sizeof(address.sun_path))
+        return 2;
+    strcpy(address.sun_path, argv[1]);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0 || connect(fd, (const struct sockaddr*)&address, sizeof(address)) != 0)
+    {
+        perror("connect");
+        return 1;
+    }
+
+    char buffer[4096];
+    ssize_t length;
+    while((length = read(STDIN_FILENO, buffer, sizeof(buffer))) > 0)
+    {
+        for(ssize_t offset = 0; offset < length; )
+        {
+            ssize_t written = write(fd, buffer + offset, (size_t)(length - offset));
+            if(written <= 0)
+                return 1;
+            offset += written;
+        }
+    }
+    shutdown(fd, SHUT_WR);
+
+    while((length = read(fd, buffer, sizeof(buffer))) > 0)
+        fwrite(buffer, 1, (size_t)length, stdout);
+
+    close(fd);
+    return length < 0;
+}